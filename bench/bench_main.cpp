@@ -0,0 +1,98 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "bench_report.h"
+#include "benchmarks.h"
+
+#include "base/job_system.h"
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+
+namespace {
+
+struct Benchmark {
+    const char *name;
+    void (*run)(BenchReport &report, const BenchOptions &options);
+};
+
+const Benchmark kBenchmarks[] {
+    {"jobs", runJobBench},
+    {"log", runLogBench},
+    {"events", runEventBench},
+    {"present", runPresentBench},
+    {"decode", runDecodeBench},
+    {"io", runIoBench},
+    {"upload", runUploadBench},
+    {"upload_thread", runUploadThreadBench},
+    {"convert", runConvertBench},
+    {"cpu_convert", runCpuConvertBench},
+    {"seek", runSeekBench},
+    {"thumbnails", runThumbnailBench},
+    {"filters", runFilterBench},
+    {"program_cache", runProgramCacheBench},
+    {"text", runTextBench},
+    {"wall", runWallBench},
+    {"e2e", runEndToEndBench},
+    {"export", runExportBench},
+};
+
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--frames N] [--filter NAME] [--out FILE|-]\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions options {};
+    std::string filter {};
+    // Not stdout by default: the log system prints there too.
+    std::string out_path {"bench_results.json"};
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) {
+            options.frames = std::stoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ConfigManager::get()->parse();
+    LogSystem::get()->initialize();
+    JobSystem::get()->initialize();
+
+    // Runs headless: the hidden window only exists to own a context (works on Mesa llvmpipe under Xvfb).
+    options.gl = GLContext::createWithWindow({64, 64, "video-app-bench"}, false);
+    options.gl->makeCurrentContext();
+    // Never wait for vsync: presentation is measured as throughput.
+    glfwSwapInterval(0);
+
+    BenchReport report;
+    for (const auto &benchmark : kBenchmarks) {
+        if (!filter.empty() && filter != benchmark.name) {
+            continue;
+        }
+        INFO("running benchmark: {}", benchmark.name);
+        benchmark.run(report, options);
+    }
+
+    if (out_path == "-") {
+        report.writeJson(std::cout);
+    } else {
+        std::ofstream out {out_path};
+        report.writeJson(out);
+        INFO("wrote {} results to {}", report.getEntries().size(), out_path);
+    }
+
+    options.gl.reset();
+    JobSystem::get()->shutdown();
+    LogSystem::get()->shutdown();
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "bench_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+
+void writeString(std::ostream &out, const std::string &value) {
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+}  // namespace
+
+void addPercentiles(BenchReport::Entry &entry, const std::string &prefix, std::vector<double> samples) {
+    if (samples.empty()) {
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        auto rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+    entry.metrics[prefix + "_p50"] = percentile(50);
+    entry.metrics[prefix + "_p90"] = percentile(90);
+    entry.metrics[prefix + "_p99"] = percentile(99);
+    entry.metrics[prefix + "_max"] = samples.back();
+}
+
+void BenchReport::writeJson(std::ostream &out) const {
+    out << "{\n  \"results\": [";
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        const auto &entry = m_entries[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": ";
+        writeString(out, entry.name);
+
+        out << ", \"params\": {";
+        bool first = true;
+        for (const auto &[key, value] : entry.params) {
+            out << (first ? "" : ", ");
+            writeString(out, key);
+            out << ": ";
+            writeString(out, value);
+            first = false;
+        }
+
+        out << "}, \"metrics\": {";
+        first = true;
+        for (const auto &[key, value] : entry.metrics) {
+            out << (first ? "" : ", ");
+            writeString(out, key);
+            // JSON has no NaN or infinity.
+            if (std::isfinite(value)) {
+                out << ": " << std::setprecision(6) << value;
+            } else {
+                out << ": null";
+            }
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
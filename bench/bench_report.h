@@ -0,0 +1,37 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ *  @class BenchReport
+ *
+ *  @brief Collects benchmark results and writes them as JSON for regression tracking.
+ *
+ *  Every entry is one measured case: a benchmark name, string parameters identifying the case
+ *  (codec, resolution, ...) and numeric metrics.
+ */
+class BenchReport {
+public:
+    struct Entry {
+        std::string name;
+        std::map<std::string, std::string> params;
+        std::map<std::string, double> metrics;
+    };
+
+    Entry &add(const std::string &name) { return m_entries.emplace_back(Entry {name, {}, {}}); }
+
+    const std::vector<Entry> &getEntries() const { return m_entries; }
+
+    void writeJson(std::ostream &out) const;
+
+private:
+    std::vector<Entry> m_entries {};
+};
+
+/**
+ *  @brief Adds the p50, p90, p99 and max of `samples` to `entry` as `<prefix>_p50` and so on (nearest rank).
+ */
+void addPercentiles(BenchReport::Entry &entry, const std::string &prefix, std::vector<double> samples);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+/**
+ *  @class BenchTimer
+ *
+ *  @brief Measures wall time, CPU time of the calling thread and CPU time of the whole process.
+ *
+ *  Process CPU time includes driver and codec worker threads, which matters on software GL (llvmpipe)
+ *  where "GPU" work is CPU work too.
+ */
+class BenchTimer {
+public:
+    BenchTimer() { restart(); }
+
+    void restart() {
+        m_wall = std::chrono::steady_clock::now();
+        m_thread_cpu = cpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+        m_process_cpu = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    double wallSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wall).count();
+    }
+
+    double threadCpuSeconds() const { return cpuSeconds(CLOCK_THREAD_CPUTIME_ID) - m_thread_cpu; }
+
+    double processCpuSeconds() const { return cpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - m_process_cpu; }
+
+private:
+    std::chrono::steady_clock::time_point m_wall {};
+    double m_thread_cpu {};
+    double m_process_cpu {};
+
+    static double cpuSeconds(clockid_t clock) {
+        timespec ts {};
+        clock_gettime(clock, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+};
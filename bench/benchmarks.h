@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+
+#include "bench_report.h"
+
+class GLContext;
+
+struct BenchOptions {
+    int frames {120};  // frames per measured case, and length of the encoded clips
+    std::shared_ptr<GLContext> gl {};  // hidden context, current on the bench thread
+};
+
+// Demux and decode rate per codec and resolution, on clips encoded from testsrc2.
+void runDecodeBench(BenchReport &report, const BenchOptions &options);
+
+// Demux throughput, CPU time and page faults reading through the memory-mapped AVIOContext and the file protocol.
+void runIoBench(BenchReport &report, const BenchOptions &options);
+
+// PBO staging and texture upload bandwidth.
+void runUploadBench(BenchReport &report, const BenchOptions &options);
+
+// Render thread frame time with uploads on the render thread against the shared-context upload thread.
+void runUploadThreadBench(BenchReport &report, const BenchOptions &options);
+
+// YUV -> RGBA conversion cost, sws_scale against the shader path.
+void runConvertBench(BenchReport &report, const BenchOptions &options);
+
+// CPU YUV -> RGBA conversion and downscale, sws_scale against the SIMD kernels of every supported instruction set.
+void runCpuConvertBench(BenchReport &report, const BenchOptions &options);
+
+// Keyframe index build/load cost and frame-accurate seek latency percentiles, with and without the index.
+void runSeekBench(BenchReport &report, const BenchOptions &options);
+
+// Thumbnail atlas generation, keyframe-only and exact, scaling with the number of worker threads.
+void runThumbnailBench(BenchReport &report, const BenchOptions &options);
+
+// Task throughput of the work-stealing JobSystem against a mutex-protected queue pool, flat and recursively spawned.
+void runJobBench(BenchReport &report, const BenchOptions &options);
+
+// Cost per log call, disabled and enabled: spdlog macros against the binary log, on one and several threads.
+void runLogBench(BenchReport &report, const BenchOptions &options);
+
+// Input event cost, the per-frame coalescing queue against immediate std::function dispatch.
+void runEventBench(BenchReport &report, const BenchOptions &options);
+
+// Render loop pacing on a simulated clock: idle wake-ups, awake time, refresh estimate and present jitter, against
+// swapping every iteration.
+void runPresentBench(BenchReport &report, const BenchOptions &options);
+
+// GPU filter chain (scale, sharpen, LUT, overlay) per-stage GPU time and render-target pool usage, with and
+// without fusing the per-pixel passes.
+void runFilterBench(BenchReport &report, const BenchOptions &options);
+
+// Time to build the startup shader programs with the on-disk program binary cache disabled, cold and warm.
+void runProgramCacheBench(BenchReport &report, const BenchOptions &options);
+
+// Text overlay submission cost and frame time by number of glyphs, for static and changing text; one instanced
+// draw per frame whatever the count.
+void runTextBench(BenchReport &report, const BenchOptions &options);
+
+// Video wall aggregate frame rate by worker and stream count, and paced playback of an overloaded wall with and
+// without per-stream quality control.
+void runWallBench(BenchReport &report, const BenchOptions &options);
+
+// Full pipeline: demux, decode, stage, upload, convert and swap, as fast as possible.
+void runEndToEndBench(BenchReport &report, const BenchOptions &options);
+
+// Headless export (decode, GL, PBO readback, encode) throughput and per-stage load, by number of readback slots.
+void runExportBench(BenchReport &report, const BenchOptions &options);
@@ -0,0 +1,145 @@
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/yuv_converter.h"
+
+namespace {
+
+struct ConvertCase {
+    AVPixelFormat format;
+    int width;
+    int height;
+};
+
+void addResult(BenchReport &report,
+               const char *path,
+               const ConvertCase &test_case,
+               const BenchTimer &timer,
+               int frames) {
+    auto &entry = report.add("convert");
+    entry.params["path"] = path;
+    entry.params["format"] = av_get_pix_fmt_name(test_case.format);
+    entry.params["resolution"] = std::to_string(test_case.width) + "x" + std::to_string(test_case.height);
+    entry.metrics["wall_ms_per_frame"] = timer.wallSeconds() * 1000.0 / frames;
+    entry.metrics["thread_cpu_ms_per_frame"] = timer.threadCpuSeconds() * 1000.0 / frames;
+    entry.metrics["process_cpu_ms_per_frame"] = timer.processCpuSeconds() * 1000.0 / frames;
+}
+
+void benchSwscale(BenchReport &report, const ConvertCase &test_case, const std::vector<AVFramePtr> &frames, int count) {
+    SwsContext *sws = sws_getContext(test_case.width,
+                                     test_case.height,
+                                     test_case.format,
+                                     test_case.width,
+                                     test_case.height,
+                                     AV_PIX_FMT_RGBA,
+                                     SWS_BILINEAR,
+                                     nullptr,
+                                     nullptr,
+                                     nullptr);
+    if (!sws) {
+        FATAL("failed to create swscale context");
+    }
+
+    std::vector<uint8_t> rgba(static_cast<size_t>(test_case.width) * test_case.height * 4);
+    uint8_t *dst[] {rgba.data()};
+    int dst_stride[] {test_case.width * 4};
+
+    auto convert = [&](const AVFrame *frame) {
+        sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+    };
+
+    convert(frames[0].get());
+    BenchTimer timer;
+    for (int i = 0; i < count; ++i) {
+        convert(frames[i % frames.size()].get());
+    }
+    addResult(report, "sws_scale", test_case, timer, count);
+    sws_freeContext(sws);
+}
+
+void benchShader(BenchReport &report,
+                 const ConvertCase &test_case,
+                 const std::vector<AVFramePtr> &frames,
+                 int count,
+                 const std::shared_ptr<GLContext> &gl) {
+    size_t slot_size = YuvConverter::getStagingSize(test_case.format, test_case.width, test_case.height);
+    auto ring = gl->createPixelUploadRing(4, slot_size);
+    YuvConverter converter {gl};
+
+    // Render into an offscreen RGBA target of the frame's size, the same output sws_scale produces.
+    auto &state = gl->getStateCache();
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl,
+           TexImage2D,
+           GL_TEXTURE_2D,
+           0,
+           GL_RGBA8,
+           test_case.width,
+           test_case.height,
+           0,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    state.viewport(0, 0, test_case.width, test_case.height);
+
+    auto convert = [&](const AVFrame *frame) {
+        ring->pump(true);
+        auto slot = ring->tryAcquireWritable();
+        YuvConverter::stage(slot, frame);
+        converter.upload(*ring, slot, frame);
+        converter.drawFullViewport();
+    };
+
+    convert(frames[0].get());
+    glCall(gl, Finish);
+
+    BenchTimer timer;
+    {
+        // Debug builds check errors once per run rather than after every call, which would serialize the GPU.
+        GL_ERROR_SCOPE(gl, "convert");
+        for (int i = 0; i < count; ++i) {
+            convert(frames[i % frames.size()].get());
+        }
+        glCall(gl, Finish);
+    }
+    addResult(report, "shader", test_case, timer, count);
+
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+}
+
+}  // namespace
+
+void runConvertBench(BenchReport &report, const BenchOptions &options) {
+    const ConvertCase cases[] {
+        {AV_PIX_FMT_YUV420P, 1920, 1080},
+        {AV_PIX_FMT_NV12, 1920, 1080},
+        {AV_PIX_FMT_YUV420P, 3840, 2160},
+        {AV_PIX_FMT_P010LE, 3840, 2160},
+    };
+
+    for (const auto &test_case : cases) {
+        auto frames = makeSyntheticFrames(test_case.format, test_case.width, test_case.height, 4);
+
+        benchSwscale(report, test_case, frames, options.frames);
+        benchShader(report, test_case, frames, options.frames, options.gl);
+    }
+}
@@ -0,0 +1,131 @@
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "render/convert/cpu_converter.h"
+
+namespace {
+
+struct CpuConvertCase {
+    AVPixelFormat format;
+    int width;
+    int height;
+    int dst_width;
+    int dst_height;
+};
+
+BenchReport::Entry &addResult(BenchReport &report,
+                              const char *path,
+                              const char *filter,
+                              const CpuConvertCase &test_case,
+                              const BenchTimer &timer,
+                              int frames) {
+    const double seconds = timer.wallSeconds();
+    auto &entry = report.add("cpu_convert");
+    entry.params["path"] = path;
+    entry.params["filter"] = filter;
+    entry.params["format"] = av_get_pix_fmt_name(test_case.format);
+    entry.params["resolution"] = std::to_string(test_case.width) + "x" + std::to_string(test_case.height);
+    entry.params["output"] = std::to_string(test_case.dst_width) + "x" + std::to_string(test_case.dst_height);
+    entry.metrics["ms_per_frame"] = seconds * 1000.0 / frames;
+    entry.metrics["output_mpix_per_sec"] =
+        static_cast<double>(test_case.dst_width) * test_case.dst_height * frames / seconds / 1e6;
+    return entry;
+}
+
+void benchSwscale(BenchReport &report,
+                  const CpuConvertCase &test_case,
+                  const std::vector<AVFramePtr> &frames,
+                  int count,
+                  int flags,
+                  const char *filter) {
+    SwsContext *sws = sws_getContext(test_case.width,
+                                     test_case.height,
+                                     test_case.format,
+                                     test_case.dst_width,
+                                     test_case.dst_height,
+                                     AV_PIX_FMT_RGBA,
+                                     flags,
+                                     nullptr,
+                                     nullptr,
+                                     nullptr);
+    if (!sws) {
+        FATAL("failed to create swscale context");
+    }
+
+    std::vector<uint8_t> rgba(static_cast<size_t>(test_case.dst_width) * test_case.dst_height * 4);
+    uint8_t *dst[] {rgba.data()};
+    int dst_stride[] {test_case.dst_width * 4};
+
+    auto convert = [&](const AVFrame *frame) {
+        sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+    };
+
+    convert(frames[0].get());
+    BenchTimer timer;
+    for (int i = 0; i < count; ++i) {
+        convert(frames[i % frames.size()].get());
+    }
+    addResult(report, "sws_scale", filter, test_case, timer, count);
+    sws_freeContext(sws);
+}
+
+void benchKernels(BenchReport &report,
+                  const CpuConvertCase &test_case,
+                  const std::vector<AVFramePtr> &frames,
+                  int count,
+                  CpuConverter::Filter filter,
+                  CpuIsa isa) {
+    const size_t size = static_cast<size_t>(test_case.dst_width) * test_case.dst_height * 4;
+    const int stride = test_case.dst_width * 4;
+    const char *filter_name = filter == CpuConverter::Filter::Box ? "box" : "bilinear";
+
+    std::vector<uint8_t> rgba(size);
+    CpuConverter converter {filter, isa};
+    converter.convert(frames[0].get(), rgba.data(), stride, test_case.dst_width, test_case.dst_height);
+
+    BenchTimer timer;
+    for (int i = 0; i < count; ++i) {
+        converter.convert(
+            frames[i % frames.size()].get(), rgba.data(), stride, test_case.dst_width, test_case.dst_height);
+    }
+    addResult(report, getCpuIsaName(isa), filter_name, test_case, timer, count);
+}
+
+}  // namespace
+
+void runCpuConvertBench(BenchReport &report, const BenchOptions &options) {
+    const CpuConvertCase cases[] {
+        {AV_PIX_FMT_YUV420P, 1280, 720, 1280, 720},
+        {AV_PIX_FMT_YUV420P, 1920, 1080, 1920, 1080},
+        {AV_PIX_FMT_YUV420P, 1920, 1080, 960, 540},
+        {AV_PIX_FMT_YUV420P, 1920, 1080, 256, 144},
+        {AV_PIX_FMT_NV12, 1920, 1080, 256, 144},
+        {AV_PIX_FMT_YUV420P, 3840, 2160, 1920, 1080},
+        {AV_PIX_FMT_YUV420P, 3840, 2160, 320, 180},
+    };
+    const CpuIsa isas[] {CpuIsa::Scalar, CpuIsa::SSE42, CpuIsa::AVX2, CpuIsa::AVX512};
+    INFO("cpu convert kernels: best instruction set is {}", getCpuIsaName(getBestCpuIsa()));
+
+    for (const auto &test_case : cases) {
+        auto frames = makeSyntheticFrames(test_case.format, test_case.width, test_case.height, 4);
+
+        benchSwscale(report, test_case, frames, options.frames, SWS_AREA, "box");
+        benchSwscale(report, test_case, frames, options.frames, SWS_BILINEAR, "bilinear");
+        for (auto filter : {CpuConverter::Filter::Box, CpuConverter::Filter::Bilinear}) {
+            for (auto isa : isas) {
+                if (isCpuIsaSupported(isa)) {
+                    benchKernels(report, test_case, frames, options.frames, filter, isa);
+                }
+            }
+        }
+    }
+}
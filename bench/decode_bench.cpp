@@ -0,0 +1,114 @@
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "media/decoder.h"
+#include "media/demuxer.h"
+#include "media/media_engine.h"
+
+namespace {
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+void addParams(BenchReport::Entry &entry, const SyntheticCodec &codec, const Resolution &resolution) {
+    entry.params["codec"] = codec.label;
+    entry.params["resolution"] = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+}
+
+void benchDemux(BenchReport &report,
+                const SyntheticCodec &codec,
+                const Resolution &resolution,
+                const std::filesystem::path &path) {
+    Demuxer demuxer {path, MappedFileIO::Config::fromConfigManager()};
+    AVPacketPtr packet = allocPacket();
+
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    BenchTimer timer;
+    while (demuxer.readPacket(packet.get()) >= 0) {
+        ++packets;
+        bytes += packet->size;
+        av_packet_unref(packet.get());
+    }
+    double seconds = timer.wallSeconds();
+
+    auto &entry = report.add("demux");
+    addParams(entry, codec, resolution);
+    entry.metrics["packets"] = packets;
+    entry.metrics["packets_per_sec"] = packets / seconds;
+    entry.metrics["mb_per_sec"] = bytes / seconds / (1 << 20);
+}
+
+void benchDecode(BenchReport &report,
+                 const SyntheticCodec &codec,
+                 const Resolution &resolution,
+                 const std::filesystem::path &path,
+                 const MediaEngine::Config &config) {
+    // Packets are read up front so only the codec is timed.
+    Demuxer demuxer {path, config.io};
+    std::vector<AVPacketPtr> packets;
+    while (true) {
+        AVPacketPtr packet = allocPacket();
+        if (demuxer.readPacket(packet.get()) < 0) {
+            break;
+        }
+        packets.push_back(std::move(packet));
+    }
+
+    // Same setup as the player: pooled frame buffers and the configured codec threads.
+    auto buffer_pool = FrameBufferPool::create(config.frame_pool_max_bytes);
+    Decoder decoder {demuxer.getVideoStream(), config.decoder_threads, buffer_pool};
+    AVFramePtr frame = allocFrame();
+    uint64_t frames = 0;
+    auto drain = [&] {
+        while (decoder.receiveFrame(frame.get()) >= 0) {
+            ++frames;
+            av_frame_unref(frame.get());
+        }
+    };
+
+    BenchTimer timer;
+    for (const auto &packet : packets) {
+        decoder.sendPacket(packet.get());
+        drain();
+    }
+    decoder.sendPacket(nullptr);
+    drain();
+    double seconds = timer.wallSeconds();
+
+    auto &entry = report.add("decode");
+    addParams(entry, codec, resolution);
+    entry.params["threads"] = std::to_string(decoder.getCodecContext()->thread_count);
+    entry.metrics["frames"] = frames;
+    entry.metrics["fps"] = frames / seconds;
+    entry.metrics["wall_ms_per_frame"] = seconds * 1000.0 / frames;
+    entry.metrics["process_cpu_ms_per_frame"] = timer.processCpuSeconds() * 1000.0 / frames;
+}
+
+}  // namespace
+
+void runDecodeBench(BenchReport &report, const BenchOptions &options) {
+    const Resolution resolutions[] {
+        {1280, 720},
+        {1920, 1080},
+        {3840, 2160},
+    };
+    auto config = MediaEngine::Config::fromConfigManager();
+
+    for (const auto &codec : getSyntheticCodecs()) {
+        for (const auto &resolution : resolutions) {
+            auto path = encodeSyntheticClip(codec, resolution.width, resolution.height, options.frames);
+            if (path.empty()) {
+                break;
+            }
+            benchDemux(report, codec, resolution, path);
+            benchDecode(report, codec, resolution, path, config);
+        }
+    }
+}
\ No newline at end of file
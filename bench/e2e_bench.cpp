@@ -0,0 +1,154 @@
+#include <string_view>
+#include <thread>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "media/media_engine.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/yuv_converter.h"
+
+namespace {
+
+// A pipeline that produced nothing for this long is stuck; the case is abandoned instead of spinning forever.
+constexpr double kStallTimeoutSeconds = 10.0;
+
+struct EndToEndCase {
+    const char *codec;
+    int width;
+    int height;
+};
+
+void benchEndToEnd(BenchReport &report,
+                   const EndToEndCase &test_case,
+                   const std::filesystem::path &path,
+                   const std::shared_ptr<GLContext> &gl) {
+    auto config = MediaEngine::Config::fromConfigManager();
+    auto engine = MediaEngine::create(path, config);
+    auto codec_ctx = engine->getVideoDecoder()->getCodecContext();
+    size_t slot_size = YuvConverter::getStagingSize(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height);
+    if (slot_size == 0) {
+        WARN("unsupported pixel format for {}, skipping", test_case.codec);
+        return;
+    }
+
+    // Same wiring as the player, except frames are presented as fast as they arrive instead of on their pts.
+    auto ring = gl->createPixelUploadRing(config.video_frame_queue_depth + 3, slot_size);
+    ring->pump();
+    YuvConverter converter {gl};
+
+    auto &state = gl->getStateCache();
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl,
+           TexImage2D,
+           GL_TEXTURE_2D,
+           0,
+           GL_RGBA8,
+           codec_ctx->width,
+           codec_ctx->height,
+           0,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    state.viewport(0, 0, codec_ctx->width, codec_ctx->height);
+
+    BenchTimer timer;
+    engine->start([ring](AVFrame *frame, const std::stop_token &stop) {
+        auto slot = ring->acquireWritable(stop);
+        if (!slot) {
+            return false;
+        }
+        if (!YuvConverter::stage(slot, frame)) {
+            ring->publish(slot);
+            return true;
+        }
+        frame->opaque = slot;
+        return true;
+    });
+
+    uint64_t frames = 0;
+    uint64_t starved = 0;  // empty periods, not polls
+    bool waiting = false;
+    double last_frame_at = 0.0;
+    bool stuck = false;
+    while (!engine->isVideoFinished()) {
+        GL_ERROR_SCOPE(gl, "e2e frame");
+        ring->pump();
+        if (auto frame = engine->tryPopVideoFrame()) {
+            if (auto slot = static_cast<PixelUploadRing::Slot *>(frame->opaque)) {
+                converter.upload(*ring, slot, frame.get());
+            }
+            converter.drawFullViewport();
+            gl->swapBuffers();
+            ++frames;
+            waiting = false;
+            last_frame_at = timer.wallSeconds();
+        } else {
+            // Popping the end marker is not a starved frame.
+            if (!waiting && !engine->isVideoFinished()) {
+                waiting = true;
+                ++starved;
+            }
+            if (timer.wallSeconds() - last_frame_at > kStallTimeoutSeconds) {
+                stuck = true;
+                break;
+            }
+            while (auto slot = ring->tryPopFilled()) {
+                ring->discard(slot);
+            }
+            std::this_thread::yield();
+        }
+    }
+    glCall(gl, Finish);
+    double seconds = timer.wallSeconds();
+
+    auto stats = engine->getStats();
+    engine.reset();
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+    if (stuck) {
+        WARN("no {} frame for {} s after {} frames, skipping", test_case.codec, kStallTimeoutSeconds, frames);
+        return;
+    }
+
+    auto &entry = report.add("e2e");
+    entry.params["codec"] = test_case.codec;
+    entry.params["resolution"] = std::to_string(test_case.width) + "x" + std::to_string(test_case.height);
+    entry.metrics["frames"] = frames;
+    entry.metrics["fps"] = frames / seconds;
+    entry.metrics["process_cpu_ms_per_frame"] = timer.processCpuSeconds() * 1000.0 / frames;
+    entry.metrics["render_starved"] = starved;
+    entry.metrics["decoder_blocked"] = stats.video_frames.push_stalls;
+}
+
+}  // namespace
+
+void runEndToEndBench(BenchReport &report, const BenchOptions &options) {
+    const EndToEndCase cases[] {
+        {"h264", 1920, 1080},
+        {"h264", 3840, 2160},
+        {"hevc", 3840, 2160},
+    };
+
+    for (const auto &test_case : cases) {
+        for (const auto &codec : getSyntheticCodecs()) {
+            if (test_case.codec != std::string_view {codec.label}) {
+                continue;
+            }
+            auto path = encodeSyntheticClip(codec, test_case.width, test_case.height, options.frames);
+            if (!path.empty()) {
+                benchEndToEnd(report, test_case, path, options.gl);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "render/context/gl_context.h"
+#include "render/context/window_manager.h"
+
+namespace {
+
+constexpr int kFrames = 2000;
+constexpr int kCursorMovesPerFrame = 500;  // a fast mouse on a high-rate device, between two frames
+constexpr int kScrollsPerFrame = 20;
+constexpr int kListenerCounts[] {1, 8};
+
+struct Sink {
+    double sum {};
+    uint64_t calls {};
+};
+
+// The size of what the player's lambdas capture: more than std::function keeps inline.
+using Weights = std::array<double, 6>;
+
+void addParams(BenchReport::Entry &entry, int listeners) {
+    entry.params["listeners"] = std::to_string(listeners);
+    entry.params["cursor_moves_per_frame"] = std::to_string(kCursorMovesPerFrame);
+}
+
+/**
+ *  @brief The queue: GLFW-like input is posted, then dispatched once per frame.
+ */
+void benchQueued(BenchReport &report, const BenchOptions &options, int listeners) {
+    auto wm = options.gl->createWindowManager();
+    Sink sink {};
+    const Weights weights {1, 2, 3, 4, 5, 6};
+    std::vector<WindowManager::ListenerId> ids;
+    for (int i = 0; i < listeners; ++i) {
+        ids.push_back(wm->registerOnCursorPosFunc([&sink, weights](WindowManager *, double x, double y) {
+            sink.sum += x * weights[0] + y * weights[5];
+            ++sink.calls;
+        }));
+        ids.push_back(wm->registerOnScrollFunc([&sink, weights](WindowManager *, double, double y) {
+            sink.sum += y * weights[1];
+            ++sink.calls;
+        }));
+        ids.push_back(wm->registerOnKeyFunc([&sink, weights](WindowManager *, int key, int, int, int) {
+            sink.sum += key * weights[2];
+            ++sink.calls;
+        }));
+    }
+
+    auto post_frame = [&](int frame) {
+        for (int i = 0; i < kCursorMovesPerFrame; ++i) {
+            wm->postEvent({.type = WindowManager::EventType::CursorPos, .x = double(frame), .y = double(i)});
+            if (i % (kCursorMovesPerFrame / kScrollsPerFrame) == 0) {
+                wm->postEvent({.type = WindowManager::EventType::Scroll, .y = 1.0});
+            }
+        }
+        wm->postEvent({.type = WindowManager::EventType::Key, .key = frame & 0xff, .action = 1});
+    };
+    // Warm-up: the queue grows to its steady size once.
+    post_frame(0);
+    wm->dispatchEvents();
+    const auto before = wm->getStats();
+
+    double dispatch_seconds = 0;
+    BenchTimer timer;
+    for (int frame = 1; frame <= kFrames; ++frame) {
+        post_frame(frame);
+        BenchTimer dispatch_timer;
+        wm->dispatchEvents();
+        dispatch_seconds += dispatch_timer.wallSeconds();
+    }
+    const double seconds = timer.wallSeconds();
+    const auto after = wm->getStats();
+
+    for (auto id : ids) {
+        wm->unregisterFunc(id);
+    }
+
+    const auto received = after.received - before.received;
+    auto &entry = report.add("events_queued");
+    addParams(entry, listeners);
+    entry.metrics["events_per_frame"] = double(received) / kFrames;
+    entry.metrics["dispatched_per_frame"] = double(after.dispatched - before.dispatched) / kFrames;
+    entry.metrics["listener_calls_per_frame"] = double(after.listener_calls - before.listener_calls) / kFrames;
+    entry.metrics["ns_per_event"] = seconds * 1e9 / received;
+    entry.metrics["dispatch_us_per_frame"] = dispatch_seconds * 1e6 / kFrames;
+    entry.metrics["checksum"] = sink.sum;
+}
+
+/**
+ *  @brief The previous scheme: every event calls every listener right away, through a copy of a std::function.
+ */
+void benchImmediate(BenchReport &report, int listeners) {
+    using CursorFunc = std::function<void(double x, double y)>;
+    using KeyFunc = std::function<void(int key)>;
+    Sink sink {};
+    const Weights weights {1, 2, 3, 4, 5, 6};
+    std::vector<CursorFunc> cursor_funcs;
+    std::vector<CursorFunc> scroll_funcs;
+    std::vector<KeyFunc> key_funcs;
+    for (int i = 0; i < listeners; ++i) {
+        cursor_funcs.push_back([&sink, weights](double x, double y) {
+            sink.sum += x * weights[0] + y * weights[5];
+            ++sink.calls;
+        });
+        scroll_funcs.push_back([&sink, weights](double, double y) {
+            sink.sum += y * weights[1];
+            ++sink.calls;
+        });
+        key_funcs.push_back([&sink, weights](int key) {
+            sink.sum += key * weights[2];
+            ++sink.calls;
+        });
+    }
+
+    uint64_t events = 0;
+    BenchTimer timer;
+    for (int frame = 1; frame <= kFrames; ++frame) {
+        for (int i = 0; i < kCursorMovesPerFrame; ++i) {
+            for (auto func : cursor_funcs) {
+                func(double(frame), double(i));
+            }
+            ++events;
+            if (i % (kCursorMovesPerFrame / kScrollsPerFrame) == 0) {
+                for (auto func : scroll_funcs) {
+                    func(0.0, 1.0);
+                }
+                ++events;
+            }
+        }
+        for (auto func : key_funcs) {
+            func(frame & 0xff);
+        }
+        ++events;
+    }
+    const double seconds = timer.wallSeconds();
+
+    auto &entry = report.add("events_immediate");
+    addParams(entry, listeners);
+    entry.metrics["events_per_frame"] = double(events) / kFrames;
+    entry.metrics["listener_calls_per_frame"] = double(sink.calls) / kFrames;
+    entry.metrics["ns_per_event"] = seconds * 1e9 / events;
+    entry.metrics["checksum"] = sink.sum;
+}
+
+}  // namespace
+
+void runEventBench(BenchReport &report, const BenchOptions &options) {
+    for (int listeners : kListenerCounts) {
+        benchQueued(report, options, listeners);
+        benchImmediate(report, listeners);
+    }
+}
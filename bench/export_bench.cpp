@@ -0,0 +1,55 @@
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "media/transcoder.h"
+#include "render/context/gl_context.h"
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+
+}  // namespace
+
+void runExportBench(BenchReport &report, const BenchOptions &options) {
+    for (const auto &codec : getSyntheticCodecs()) {
+        if (std::string_view {codec.label} != "h264") {
+            continue;
+        }
+        auto path = encodeSyntheticClip(codec, kWidth, kHeight, options.frames);
+        if (path.empty()) {
+            continue;
+        }
+        auto output = std::filesystem::temp_directory_path() / "video-app-bench-export.mkv";
+
+        // One slot reads every frame back before the next is drawn; more let readback overlap the following frames.
+        for (size_t slots : {1, 2, 4}) {
+            Transcoder::Config config {};
+            config.readback_slots = slots;
+            config.encoder.codec = codec.encoder;
+            config.encoder.preset = "ultrafast";
+            Transcoder::Stats stats {};
+            const bool written = Transcoder::run(path, output, config, &stats);
+
+            auto &entry = report.add("export");
+            entry.params["codec"] = codec.label;
+            entry.params["resolution"] = std::to_string(kWidth) + "x" + std::to_string(kHeight);
+            entry.params["readback_slots"] = std::to_string(slots);
+            entry.metrics["written"] = written;
+            entry.metrics["fps"] = stats.fps;
+            entry.metrics["demux_busy"] = stats.demux_busy;
+            entry.metrics["decode_busy"] = stats.decode_busy;
+            entry.metrics["gl_busy"] = stats.gl_busy;
+            entry.metrics["readback_wait"] = stats.readback_wait;
+            entry.metrics["encode_busy"] = stats.encode_busy;
+        }
+        std::filesystem::remove(output);
+    }
+
+    // The export ran on its own context.
+    options.gl->makeCurrentContext();
+}
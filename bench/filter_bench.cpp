@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/filter/filter_graph.h"
+
+namespace {
+
+constexpr int kLutSize = 17;
+
+struct FilterCase {
+    int input_width;
+    int input_height;
+    int output_width;
+    int output_height;
+};
+
+GLuint createTexture(const std::shared_ptr<GLContext> &gl,
+                     GLenum target,
+                     int width,
+                     int height,
+                     int depth,
+                     const std::vector<uint8_t> &pixels,
+                     GLenum format) {
+    GLuint texture;
+    glCall(gl, GenTextures, 1, &texture);
+    gl->getStateCache().bindTexture(0, target, texture);
+    if (target == GL_TEXTURE_3D) {
+        // Rows of 17 RGB entries are not 4-byte aligned.
+        glCall(gl, PixelStorei, GL_UNPACK_ALIGNMENT, 1);
+        glCall(gl, TexImage3D, target, 0, GL_RGB8, width, height, depth, 0, format, GL_UNSIGNED_BYTE, pixels.data());
+        glCall(gl, PixelStorei, GL_UNPACK_ALIGNMENT, 4);
+        glCall(gl, TexParameteri, target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glCall(gl, TexImage2D, target, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    glCall(gl, TexParameteri, target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glCall(gl, TexParameteri, target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glCall(gl, TexParameteri, target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glCall(gl, TexParameteri, target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// Diagonal gradient with a checkerboard on top, so the scaler and the sharpener have edges to work on.
+std::vector<uint8_t> makePicture(int width, int height) {
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t *pixel = &pixels[(size_t(y) * width + x) * 4];
+            const bool check = ((x >> 5) ^ (y >> 5)) & 1;
+            pixel[0] = uint8_t(x * 255 / width);
+            pixel[1] = uint8_t(y * 255 / height);
+            pixel[2] = check ? 224 : 32;
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+// Premultiplied lower-third banner, transparent elsewhere.
+std::vector<uint8_t> makeOverlay(int width, int height) {
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    for (int y = 0; y < height / 3; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t *pixel = &pixels[(size_t(y) * width + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = 96;
+            pixel[3] = 160;
+        }
+    }
+    return pixels;
+}
+
+// Mild warm grade: red lifted, blue lowered.
+std::vector<uint8_t> makeLut() {
+    std::vector<uint8_t> entries(size_t(kLutSize) * kLutSize * kLutSize * 3);
+    size_t i = 0;
+    for (int b = 0; b < kLutSize; ++b) {
+        for (int g = 0; g < kLutSize; ++g) {
+            for (int r = 0; r < kLutSize; ++r) {
+                entries[i++] = uint8_t(std::min(255, r * 255 / (kLutSize - 1) + 12));
+                entries[i++] = uint8_t(g * 255 / (kLutSize - 1));
+                entries[i++] = uint8_t(std::max(0, b * 255 / (kLutSize - 1) - 12));
+            }
+        }
+    }
+    return entries;
+}
+
+void benchGraph(BenchReport &report,
+                const FilterCase &test_case,
+                bool fusion,
+                int count,
+                GLuint input,
+                GLuint lut,
+                GLuint overlay,
+                const std::shared_ptr<GLContext> &gl) {
+    FilterGraph graph {gl};
+    graph.addScale(test_case.output_width, test_case.output_height);
+    graph.addSharpen(0.6f);
+    graph.addLut(lut, kLutSize);
+    graph.addOverlay(overlay, 0.8f);
+    graph.setFusion(fusion);
+
+    // Compiles the stages and fills the pool.
+    graph.run(input, test_case.input_width, test_case.input_height);
+    glCall(gl, Finish);
+
+    BenchTimer timer;
+    {
+        GL_ERROR_SCOPE(gl, "filters");
+        for (int i = 0; i < count; ++i) {
+            graph.run(input, test_case.input_width, test_case.input_height);
+        }
+        glCall(gl, Finish);
+    }
+    const double wall_seconds = timer.wallSeconds();
+    const double process_cpu_seconds = timer.processCpuSeconds();
+    // Timings are read at the start of a run, so one more harvests the runs that were still in flight.
+    graph.run(input, test_case.input_width, test_case.input_height);
+
+    const auto stats = graph.getStats();
+    auto &entry = report.add("filters");
+    entry.params["chain"] = "scale+sharpen+lut+overlay";
+    entry.params["fusion"] = fusion ? "on" : "off";
+    entry.params["input"] = std::to_string(test_case.input_width) + "x" + std::to_string(test_case.input_height);
+    entry.params["output"] = std::to_string(test_case.output_width) + "x" + std::to_string(test_case.output_height);
+    entry.metrics["wall_ms_per_frame"] = wall_seconds * 1000.0 / count;
+    entry.metrics["process_cpu_ms_per_frame"] = process_cpu_seconds * 1000.0 / count;
+    entry.metrics["stages"] = stats.stages;
+    entry.metrics["timing_dropped"] = stats.timing_dropped;
+    entry.metrics["pool_targets"] = stats.pool.targets;
+    entry.metrics["pool_bytes"] = stats.pool.bytes;
+    entry.metrics["pool_peak_bytes"] = stats.pool.peak_bytes;
+    entry.metrics["pool_allocations"] = stats.pool.allocations;
+    entry.metrics["pool_reuses"] = stats.pool.reuses;
+
+    double gpu_ms = 0.0;
+    for (const auto &timing : graph.getTimings()) {
+        entry.metrics["gpu_ms_" + timing.name] = timing.mean_ms;
+        gpu_ms += timing.mean_ms;
+    }
+    entry.metrics["gpu_ms_per_frame"] = gpu_ms;
+
+    gl->getStateCache().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}  // namespace
+
+void runFilterBench(BenchReport &report, const BenchOptions &options) {
+    const FilterCase cases[] {
+        {1920, 1080, 1920, 1080},
+        {1920, 1080, 3840, 2160},
+        {3840, 2160, 1920, 1080},
+        {3840, 2160, 3840, 2160},
+    };
+
+    const auto &gl = options.gl;
+    GLuint lut = createTexture(gl, GL_TEXTURE_3D, kLutSize, kLutSize, kLutSize, makeLut(), GL_RGB);
+    for (const auto &test_case : cases) {
+        GLuint input = createTexture(gl,
+                                     GL_TEXTURE_2D,
+                                     test_case.input_width,
+                                     test_case.input_height,
+                                     1,
+                                     makePicture(test_case.input_width, test_case.input_height),
+                                     GL_RGBA);
+        GLuint overlay = createTexture(gl,
+                                       GL_TEXTURE_2D,
+                                       test_case.output_width,
+                                       test_case.output_height,
+                                       1,
+                                       makeOverlay(test_case.output_width, test_case.output_height),
+                                       GL_RGBA);
+
+        benchGraph(report, test_case, false, options.frames, input, lut, overlay, gl);
+        benchGraph(report, test_case, true, options.frames, input, lut, overlay, gl);
+
+        gl->getStateCache().deleteTextures(1, &overlay);
+        gl->getStateCache().deleteTextures(1, &input);
+    }
+    gl->getStateCache().deleteTextures(1, &lut);
+}
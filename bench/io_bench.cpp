@@ -0,0 +1,142 @@
+#include <random>
+
+#include <sys/resource.h>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "media/demuxer.h"
+
+namespace {
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+// Process-wide resource usage; the demuxer runs on the bench thread, nothing else is busy meanwhile.
+struct ResourceUsage {
+    double user_ms {};
+    double system_ms {};
+    long minor_faults {};
+    long major_faults {};
+
+    static ResourceUsage now() {
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+        auto ms = [](const timeval &time) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+        return {ms(usage.ru_utime), ms(usage.ru_stime), usage.ru_minflt, usage.ru_majflt};
+    }
+};
+
+void addResult(BenchReport::Entry &entry,
+               const Demuxer &demuxer,
+               const ResourceUsage &before,
+               const BenchTimer &timer,
+               uint64_t packet_bytes) {
+    const double seconds = timer.wallSeconds();
+    const auto after = ResourceUsage::now();
+    const AVIOContext *pb = demuxer.getFormatContext()->pb;
+    entry.metrics["mb_per_sec"] = packet_bytes / seconds / (1 << 20);
+    entry.metrics["bytes_read"] = pb->bytes_read;
+    entry.metrics["user_cpu_ms"] = after.user_ms - before.user_ms;
+    entry.metrics["system_cpu_ms"] = after.system_ms - before.system_ms;
+    entry.metrics["minor_faults"] = after.minor_faults - before.minor_faults;
+    entry.metrics["major_faults"] = after.major_faults - before.major_faults;
+    if (const MappedFileIO *mapped = demuxer.getMappedFile()) {
+        const auto stats = mapped->getStats();
+        entry.metrics["io_reads"] = stats.reads;
+        entry.metrics["readahead_calls"] = stats.readahead_calls;
+        entry.metrics["released_mb"] = stats.released_bytes / double(1 << 20);
+    }
+}
+
+void addParams(BenchReport::Entry &entry, const SyntheticCodec &codec, const Resolution &resolution, bool mapped) {
+    entry.params["codec"] = codec.label;
+    entry.params["resolution"] = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+    entry.params["io"] = mapped ? "mmap" : "protocol";
+}
+
+void benchSequential(BenchReport &report,
+                     const SyntheticCodec &codec,
+                     const Resolution &resolution,
+                     const std::filesystem::path &path,
+                     bool mapped) {
+    Demuxer demuxer {path, MappedFileIO::Config {mapped}};
+    AVPacketPtr packet = allocPacket();
+
+    uint64_t bytes = 0;
+    const auto before = ResourceUsage::now();
+    BenchTimer timer;
+    while (demuxer.readPacket(packet.get()) >= 0) {
+        bytes += packet->size;
+        av_packet_unref(packet.get());
+    }
+
+    auto &entry = report.add("io_sequential");
+    addParams(entry, codec, resolution, mapped);
+    addResult(entry, demuxer, before, timer, bytes);
+}
+
+void benchSeek(BenchReport &report,
+               const SyntheticCodec &codec,
+               const Resolution &resolution,
+               const std::filesystem::path &path,
+               bool mapped,
+               int seeks) {
+    Demuxer demuxer {path, MappedFileIO::Config {mapped}};
+    AVFormatContext *format_ctx = demuxer.getFormatContext();
+    AVPacketPtr packet = allocPacket();
+    // Same sequence of targets for both paths.
+    std::mt19937 rng {7};
+    std::uniform_int_distribution<int64_t> target {0, std::max<int64_t>(format_ctx->duration, 1)};
+
+    uint64_t bytes = 0;
+    const auto before = ResourceUsage::now();
+    BenchTimer timer;
+    for (int i = 0; i < seeks; ++i) {
+        if (av_seek_frame(format_ctx, -1, target(rng), AVSEEK_FLAG_BACKWARD) < 0) {
+            continue;
+        }
+        // Scrubbing reads a few packets after every seek.
+        for (int j = 0; j < 4 && demuxer.readPacket(packet.get()) >= 0; ++j) {
+            bytes += packet->size;
+            av_packet_unref(packet.get());
+        }
+    }
+
+    auto &entry = report.add("io_seek");
+    addParams(entry, codec, resolution, mapped);
+    entry.metrics["seeks"] = seeks;
+    entry.metrics["us_per_seek"] = timer.wallSeconds() * 1e6 / seeks;
+    addResult(entry, demuxer, before, timer, bytes);
+}
+
+}  // namespace
+
+void runIoBench(BenchReport &report, const BenchOptions &options) {
+    // Intra-only ProRes is the case the mapping is for: large packets, hundreds of MB/s.
+    const SyntheticCodec codecs[] {
+        {"libx264", "h264"},
+        {"prores_ks", "prores"},
+    };
+    const Resolution resolutions[] {
+        {1920, 1080},
+        {3840, 2160},
+    };
+
+    for (const auto &codec : codecs) {
+        for (const auto &resolution : resolutions) {
+            auto path = encodeSyntheticClip(codec, resolution.width, resolution.height, options.frames);
+            if (path.empty()) {
+                break;
+            }
+            for (bool mapped : {false, true}) {
+                benchSequential(report, codec, resolution, path, mapped);
+                benchSeek(report, codec, resolution, path, mapped, 200);
+            }
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "base/job_system.h"
+
+namespace {
+
+constexpr int kFlatTasks = 200000;
+constexpr int kTreeDepth = 17;  // 2^17 leaves, spawned by the tasks themselves
+constexpr int kWorkIterations[] {0, 200, 2000};
+
+thread_local uint64_t t_sink {};
+
+void work(int iterations) {
+    uint64_t x = t_sink | 1;
+    for (int i = 0; i < iterations; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    t_sink = x;
+}
+
+/**
+ *  @brief The baseline: one global deque behind a mutex, and a condition variable to wake workers.
+ */
+class MutexQueuePool {
+public:
+    explicit MutexQueuePool(int workers) {
+        for (int i = 0; i < workers; ++i) {
+            m_threads.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~MutexQueuePool() {
+        {
+            std::lock_guard lock {m_mutex};
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+    }
+
+    void submit(std::function<void()> task) {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard lock {m_mutex};
+            m_queue.push_back(std::move(task));
+        }
+        m_wakeup.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock lock {m_mutex};
+        m_done.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    std::mutex m_mutex {};
+    std::condition_variable m_wakeup {};
+    std::condition_variable m_done {};
+    std::deque<std::function<void()>> m_queue {};
+    std::atomic<int64_t> m_pending {0};
+    bool m_stopping {false};
+
+    // Declared last so the threads are joined before anything they touch is destroyed.
+    std::vector<std::jthread> m_threads {};
+
+    void workerLoop() {
+        std::unique_lock lock {m_mutex};
+        while (true) {
+            m_wakeup.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            auto task = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            task();
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard done_lock {m_mutex};
+                m_done.notify_all();
+            }
+            lock.lock();
+        }
+    }
+};
+
+// Binary tree of tasks, each spawning its two children: the fork pattern of recursive splitting.
+template<typename Spawn>
+void spawnTree(Spawn &spawn, int depth, int iterations) {
+    if (depth == 0) {
+        work(iterations);
+        return;
+    }
+    for (int child = 0; child < 2; ++child) {
+        spawn([&spawn, depth, iterations] { spawnTree(spawn, depth - 1, iterations); });
+    }
+}
+
+BenchReport::Entry &addEntry(BenchReport &report,
+                             const char *scheduler,
+                             const char *workload,
+                             int iterations,
+                             int workers,
+                             uint64_t tasks,
+                             double seconds) {
+    auto &entry = report.add("jobs");
+    entry.params["scheduler"] = scheduler;
+    entry.params["workload"] = workload;
+    entry.params["work_iterations"] = std::to_string(iterations);
+    entry.params["workers"] = std::to_string(workers);
+    entry.metrics["tasks"] = tasks;
+    entry.metrics["seconds"] = seconds;
+    entry.metrics["tasks_per_sec"] = tasks / seconds;
+    entry.metrics["ns_per_task"] = seconds * 1e9 / tasks;
+    return entry;
+}
+
+}  // namespace
+
+void runJobBench(BenchReport &report, const BenchOptions &options) {
+    auto jobs = JobSystem::get();
+    const int workers = jobs->getWorkerCount();
+    const uint64_t tree_tasks = (2ull << kTreeDepth) - 2;
+
+    for (int iterations : kWorkIterations) {
+        // Flat: every task is submitted from the bench thread.
+        {
+            auto before = jobs->getStats();
+            BenchTimer timer;
+            {
+                TaskGroup group;
+                for (int i = 0; i < kFlatTasks; ++i) {
+                    group.run([iterations] { work(iterations); });
+                }
+            }
+            const double seconds = timer.wallSeconds();
+            auto &entry = addEntry(report, "work_stealing", "flat", iterations, workers, kFlatTasks, seconds);
+            entry.metrics["stolen"] = jobs->getStats().stolen - before.stolen;
+        }
+        {
+            MutexQueuePool pool {workers};
+            BenchTimer timer;
+            for (int i = 0; i < kFlatTasks; ++i) {
+                pool.submit([iterations] { work(iterations); });
+            }
+            pool.wait();
+            addEntry(report, "mutex_queue", "flat", iterations, workers, kFlatTasks, timer.wallSeconds());
+        }
+
+        // Tree: tasks are spawned by tasks, where per-worker deques avoid the shared queue entirely.
+        {
+            auto before = jobs->getStats();
+            BenchTimer timer;
+            {
+                TaskGroup group;
+                auto spawn = [&group](std::function<void()> task) { group.run(std::move(task)); };
+                spawnTree(spawn, kTreeDepth, iterations);
+            }
+            const double seconds = timer.wallSeconds();
+            auto &entry = addEntry(report, "work_stealing", "tree", iterations, workers, tree_tasks, seconds);
+            entry.metrics["stolen"] = jobs->getStats().stolen - before.stolen;
+        }
+        {
+            MutexQueuePool pool {workers};
+            BenchTimer timer;
+            auto spawn = [&pool](std::function<void()> task) { pool.submit(std::move(task)); };
+            spawnTree(spawn, kTreeDepth, iterations);
+            pool.wait();
+            addEntry(report, "mutex_queue", "tree", iterations, workers, tree_tasks, timer.wallSeconds());
+        }
+    }
+}
@@ -0,0 +1,123 @@
+// Compiled out in this file only, so the cost of a call below the compile-time floor can be measured.
+#define VA_LOG_LEVEL_IO SPDLOG_LEVEL_OFF
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "log/log_system.h"
+
+// After log_system.h, which sets the compile-time spdlog level before spdlog is first included.
+#include <spdlog/async.h>
+#include <spdlog/sinks/null_sink.h>
+
+namespace {
+
+constexpr int kCallsPerThread = 1000000;
+constexpr int kThreadCounts[] {1, 4};
+
+struct LogCase {
+    const char *name;
+    bool enabled;
+    // Logs one typical per-frame message.
+    std::function<void(int64_t pts, double lateness)> call;
+};
+
+void benchCase(BenchReport &report, const LogCase &test_case, int thread_count) {
+    const auto binary_before = BinaryLog::get()->getStats();
+    std::vector<double> seconds(thread_count);
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                BenchTimer timer;
+                for (int i = 0; i < kCallsPerThread; ++i) {
+                    test_case.call(i, i * 0.001);
+                }
+                seconds[t] = timer.threadCpuSeconds();
+            });
+        }
+    }
+    BinaryLog::get()->flush();
+    const auto binary_after = BinaryLog::get()->getStats();
+
+    double total_seconds = 0;
+    for (double thread_seconds : seconds) {
+        total_seconds += thread_seconds;
+    }
+    auto &entry = report.add("log");
+    entry.params["case"] = test_case.name;
+    entry.params["level"] = test_case.enabled ? "enabled" : "disabled";
+    entry.params["threads"] = std::to_string(thread_count);
+    entry.metrics["ns_per_call"] = total_seconds * 1e9 / (double(kCallsPerThread) * thread_count);
+    entry.metrics["binary_dropped"] = binary_after.dropped - binary_before.dropped;
+}
+
+}  // namespace
+
+void runLogBench(BenchReport &report, const BenchOptions &) {
+    // Formatted messages go nowhere, so only the caller's side and the async handoff are measured; the overrun
+    // policy keeps a slow sink from blocking the callers.
+    auto logger = std::make_shared<spdlog::async_logger>("bench-logger",
+                                                         std::make_shared<spdlog::sinks::null_sink_mt>(),
+                                                         spdlog::thread_pool(),
+                                                         spdlog::async_overflow_policy::overrun_oldest);
+    auto binary_log = BinaryLog::get();
+    binary_log->stop();
+    binary_log->start(logger.get());
+
+    const LogCase cases[] {
+        // What every macro did before: copy the shared_ptr, then check the level.
+        {"spdlog_shared_ptr",
+         false,
+         [&](int64_t pts, double lateness) {
+             SPDLOG_LOGGER_DEBUG(std::shared_ptr<spdlog::logger> {logger},
+                                 "sync: present pts {} {:.1f} ms late {}",
+                                 pts,
+                                 lateness,
+                                 "video");
+         }},
+        {"spdlog",
+         false,
+         [&](int64_t pts, double lateness) {
+             SPDLOG_LOGGER_DEBUG(logger.get(), "sync: present pts {} {:.1f} ms late {}", pts, lateness, "video");
+         }},
+        {"spdlog",
+         true,
+         [&](int64_t pts, double lateness) {
+             SPDLOG_LOGGER_DEBUG(logger.get(), "sync: present pts {} {:.1f} ms late {}", pts, lateness, "video");
+         }},
+        {"binary_compiled_out",
+         false,
+         [](int64_t pts, double lateness) {
+             BLOG_DEBUG(IO, "sync: present pts {} {:.1f} ms late {}", pts, lateness, "video");
+         }},
+        {"binary",
+         false,
+         [](int64_t pts, double lateness) {
+             BLOG_DEBUG(MEDIA, "sync: present pts {} {:.1f} ms late {}", pts, lateness, "video");
+         }},
+        {"binary",
+         true,
+         [](int64_t pts, double lateness) {
+             BLOG_DEBUG(MEDIA, "sync: present pts {} {:.1f} ms late {}", pts, lateness, "video");
+         }},
+    };
+    for (const auto &test_case : cases) {
+        const auto level = test_case.enabled ? spdlog::level::trace : spdlog::level::info;
+        logger->set_level(level);
+        binary_log->setLevel(level);
+        for (int thread_count : kThreadCounts) {
+            benchCase(report, test_case, thread_count);
+        }
+    }
+
+    // Back to the app's logger and configured level.
+    binary_log->stop();
+    binary_log->start(LogSystem::get()->getLogger());
+}
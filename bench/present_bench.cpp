@@ -0,0 +1,107 @@
+#include <cmath>
+#include <random>
+#include <string>
+
+#include "benchmarks.h"
+
+#include "media/present_scheduler.h"
+
+namespace {
+
+// Everything below runs on a simulated clock: waits, loop work and vsync-blocked swaps only advance `now`.
+constexpr double kSimulatedSeconds = 60.0;
+constexpr double kLoopWork = 0.0001;        // seconds of CPU per loop iteration (events, queues, scheduling)
+constexpr double kDrawWork = 0.0004;        // clear, draw and swap submission, only when presenting
+constexpr double kPollCost = 0.00002;
+constexpr double kMaxWakeLatency = 0.0005;  // the OS wakes a sleeping thread up to this late
+constexpr double kPresentTolerance = 0.008; // as FrameScheduler: frames this early are presented
+
+struct PacingCase {
+    const char *name;
+    double fps;           // 0: paused, nothing becomes due
+    double refresh_rate;  // of the simulated display
+    double nominal_refresh_rate;
+};
+
+enum class Mode {
+    Continuous,  // the previous loop: poll, draw and swap every iteration
+    Paced,
+};
+
+void benchCase(BenchReport &report, const PacingCase &test_case, Mode mode) {
+    double now = 0;
+    std::mt19937 rng {11};
+    std::uniform_real_distribution<double> wake_latency {0.0, kMaxWakeLatency};
+    const double period = 1.0 / test_case.refresh_rate;
+
+    PresentScheduler pacer {
+        {},
+        test_case.nominal_refresh_rate,
+        [&](double timeout) { now += timeout > 0 ? timeout + wake_latency(rng) : kPollCost; },
+        {},
+        [&] { return now; },
+    };
+
+    double due = 0;
+    uint64_t frames = 0;
+    uint64_t late_frames = 0;  // presented more than one refresh after they were due
+    while (now < kSimulatedSeconds) {
+        if (mode == Mode::Continuous) {
+            pacer.requestRedraw();
+        }
+        pacer.waitForWork();
+        now += kLoopWork;
+        if (test_case.fps > 0) {
+            if (now >= due - kPresentTolerance) {
+                late_frames += now > due + period;
+                ++frames;
+                due += 1.0 / test_case.fps;
+                pacer.requestRedraw();
+            } else {
+                pacer.setFrameDue(due - kPresentTolerance - now);
+            }
+        }
+        if (pacer.shouldPresent()) {
+            now += kDrawWork;
+            pacer.beginSwap();
+            // Vsync: the swap returns at the next vblank.
+            now = (std::floor(now / period) + 1) * period;
+            pacer.endSwap();
+        }
+    }
+
+    const auto stats = pacer.getStats();
+    auto &entry = report.add("present_pacing");
+    entry.params["case"] = test_case.name;
+    entry.params["mode"] = mode == Mode::Paced ? "paced" : "continuous";
+    entry.params["refresh_hz"] = std::to_string(test_case.refresh_rate);
+    entry.metrics["iterations_per_sec"] = stats.iterations / kSimulatedSeconds;
+    entry.metrics["presents_per_sec"] = stats.presents / kSimulatedSeconds;
+    entry.metrics["frames_per_sec"] = frames / kSimulatedSeconds;
+    entry.metrics["late_frames"] = late_frames;
+    entry.metrics["sleeps"] = stats.sleeps;
+    entry.metrics["awake_percent"] = stats.awake_seconds / kSimulatedSeconds * 100;
+    entry.metrics["estimated_refresh_hz"] = stats.refresh_rate;
+    entry.metrics["refresh_error_hz"] = stats.refresh_rate - test_case.refresh_rate;
+    entry.metrics["frame_time_p50_ms"] = stats.frame_time_p50 * 1000;
+    entry.metrics["frame_time_p99_ms"] = stats.frame_time_p99 * 1000;
+    entry.metrics["jitter_p99_ms"] = stats.jitter_p99 * 1000;
+}
+
+}  // namespace
+
+void runPresentBench(BenchReport &report, const BenchOptions &) {
+    const PacingCase cases[] {
+        {"paused", 0, 60, 60},
+        {"24fps", 24000.0 / 1001, 59.94, 60},
+        {"30fps", 30, 60, 60},
+        {"60fps", 60, 60, 60},
+        {"24fps_144hz", 24, 144, 144},
+        {"60fps_unknown_refresh", 60, 144, 0},
+    };
+    for (const auto &test_case : cases) {
+        for (Mode mode : {Mode::Continuous, Mode::Paced}) {
+            benchCase(report, test_case, mode);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include <filesystem>
+#include <string>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/program_cache.h"
+#include "render/convert/yuv_converter.h"
+#include "render/filter/filter_graph.h"
+
+namespace {
+
+constexpr int kRounds = 5;
+
+// The programs a session builds before its first frame: YUV conversion plus a sharpen + grade + overlay chain.
+void buildStartupPrograms(const std::shared_ptr<GLContext> &gl, GLuint input) {
+    YuvConverter converter {gl};
+    FilterGraph graph {gl};
+    graph.addScale(64, 64);
+    graph.addSharpen(0.5f);
+    graph.addLut(0, 17);
+    graph.addOverlay(0, 1.0f);
+    // Stages are compiled on the first run, with fusion on and off.
+    graph.run(input, 64, 64);
+    graph.setFusion(false);
+    graph.run(input, 64, 64);
+    glCall(gl, Finish);
+    gl->getStateCache().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}  // namespace
+
+void runProgramCacheBench(BenchReport &report, const BenchOptions &options) {
+    const auto &gl = options.gl;
+    auto cache = gl->getProgramCache();
+    const auto directory = std::filesystem::temp_directory_path() / "video-app-bench-shaders";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+
+    auto &state = gl->getStateCache();
+    GLuint input;
+    glCall(gl, GenTextures, 1, &input);
+    state.bindTexture(0, GL_TEXTURE_2D, input);
+    glCall(gl, TexImage2D, GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // Drivers with their own shader cache (Mesa) make every compile after the first cheaper, so "disabled" goes
+    // first and is the closest to a cold process start.
+    for (const char *mode : {"disabled", "cold", "warm"}) {
+        const bool enabled = std::string {mode} != "disabled";
+        cache->setConfig({directory, enabled});
+
+        const auto before = cache->getStats();
+        double wall_ms = 0.0;
+        for (int round = 0; round < kRounds; ++round) {
+            if (std::string {mode} == "cold") {
+                std::filesystem::remove_all(directory, ec);
+            }
+            BenchTimer timer;
+            buildStartupPrograms(gl, input);
+            wall_ms += timer.wallSeconds() * 1000.0;
+        }
+        const auto after = cache->getStats();
+
+        auto &entry = report.add("program_cache");
+        entry.params["cache"] = mode;
+        // "no" for cold and warm when the driver has no binary format.
+        entry.params["active"] = cache->isEnabled() ? "yes" : "no";
+        entry.metrics["startup_ms"] = wall_ms / kRounds;
+        entry.metrics["hits"] = double(after.hits - before.hits) / kRounds;
+        entry.metrics["misses"] = double(after.misses - before.misses) / kRounds;
+        entry.metrics["rejected"] = double(after.rejected - before.rejected) / kRounds;
+        entry.metrics["load_ms"] = (after.load_ns - before.load_ns) / 1e6 / kRounds;
+        entry.metrics["build_ms"] = (after.build_ns - before.build_ns) / 1e6 / kRounds;
+    }
+
+    state.deleteTextures(1, &input);
+    cache->setConfig(ProgramCache::Config::fromConfigManager());
+    std::filesystem::remove_all(directory, ec);
+}
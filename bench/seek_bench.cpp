@@ -0,0 +1,110 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "media/frame_seeker.h"
+#include "media/keyframe_index.h"
+#include "media/media_engine.h"
+
+namespace {
+
+// Long GOPs with B-frames are where seeking hurts: up to four seconds of frames to decode after the keyframe.
+constexpr int kClipSeconds = 12;
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr SyntheticClipOptions kClipOptions {4 * kSyntheticFrameRate.num, 3};
+constexpr int kSeekCount = 100;
+
+void addParams(BenchReport::Entry &entry, const SyntheticCodec &codec) {
+    entry.params["codec"] = codec.label;
+    entry.params["resolution"] = std::to_string(kWidth) + "x" + std::to_string(kHeight);
+    entry.params["gop"] = std::to_string(kClipOptions.gop_size);
+}
+
+std::shared_ptr<KeyframeIndex> benchIndex(BenchReport &report,
+                                          const SyntheticCodec &codec,
+                                          const std::filesystem::path &path,
+                                          const KeyframeIndex::Config &config,
+                                          const MappedFileIO::Config &io) {
+    std::error_code ec;
+    std::filesystem::remove(KeyframeIndex::getSidecarPath(path, config), ec);
+
+    BenchTimer timer;
+    auto built = KeyframeIndex::loadOrBuild(path, config, io);
+    double build_seconds = timer.wallSeconds();
+
+    timer.restart();
+    auto loaded = KeyframeIndex::load(path, config);
+    double load_seconds = timer.wallSeconds();
+
+    auto &entry = report.add("keyframe_index");
+    addParams(entry, codec);
+    entry.metrics["entries"] = built->getEntryCount();
+    entry.metrics["scan_ms"] = build_seconds * 1000.0;
+    entry.metrics["load_ms"] = loaded ? load_seconds * 1000.0 : NAN;
+    return loaded ? loaded : built;
+}
+
+void benchSeeks(BenchReport &report,
+                const SyntheticCodec &codec,
+                const std::filesystem::path &path,
+                const MappedFileIO::Config &io,
+                int frame_count,
+                std::shared_ptr<const KeyframeIndex> index,
+                int threads) {
+    FrameSeeker seeker {path, io, index, threads};
+    // Same targets for every case, so runs with and without the index are comparable.
+    std::mt19937 rng {42};
+    std::uniform_int_distribution<int> pick {0, frame_count - 1};
+
+    std::vector<double> latencies_ms;
+    int misses = 0;
+    for (int i = 0; i < kSeekCount; ++i) {
+        int target = pick(rng);
+        // Halfway into the frame: a frame-accurate seek must still return frame `target`.
+        double seconds = (target + 0.5) / av_q2d(kSyntheticFrameRate);
+
+        BenchTimer timer;
+        auto frame = seeker.seekToTime(seconds);
+        latencies_ms.push_back(timer.wallSeconds() * 1000.0);
+
+        if (!frame ||
+            std::lround(seeker.toSeconds(frame->best_effort_timestamp) * av_q2d(kSyntheticFrameRate)) != target) {
+            ++misses;
+        }
+    }
+
+    const auto &stats = seeker.getStats();
+    auto &entry = report.add("seek");
+    addParams(entry, codec);
+    entry.params["index"] = index ? "sidecar" : "none";
+    entry.metrics["seeks"] = stats.seeks;
+    entry.metrics["inaccurate"] = misses;
+    entry.metrics["in_gop_seeks"] = stats.in_gop_seeks;
+    entry.metrics["packets_per_seek"] = static_cast<double>(stats.packets) / stats.seeks;
+    entry.metrics["frames_decoded_per_seek"] = static_cast<double>(stats.frames_decoded) / stats.seeks;
+    entry.metrics["nonref_skips_per_seek"] = static_cast<double>(stats.nonref_skips) / stats.seeks;
+    addPercentiles(entry, "latency_ms", std::move(latencies_ms));
+}
+
+}  // namespace
+
+void runSeekBench(BenchReport &report, const BenchOptions &options) {
+    auto config = MediaEngine::Config::fromConfigManager();
+    const int frame_count = kClipSeconds * kSyntheticFrameRate.num;
+
+    for (const auto &codec : getSyntheticCodecs()) {
+        auto path = encodeSyntheticClip(codec, kWidth, kHeight, frame_count, kClipOptions);
+        if (path.empty()) {
+            continue;
+        }
+        auto index = benchIndex(report, codec, path, config.index, config.io);
+        benchSeeks(report, codec, path, config.io, frame_count, index, config.decoder_threads);
+        benchSeeks(report, codec, path, config.io, frame_count, nullptr, config.decoder_threads);
+    }
+}
@@ -0,0 +1,207 @@
+#include "synthetic.h"
+
+#include <string>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "log/log_system.h"
+
+namespace {
+
+// Owns an output file being muxed; closes it even when encoding bails out early.
+struct OutputFile {
+    AVFormatContext *ctx {};
+
+    ~OutputFile() {
+        if (ctx && ctx->pb) {
+            avio_closep(&ctx->pb);
+        }
+        avformat_free_context(ctx);
+    }
+};
+
+bool writePackets(AVCodecContext *encoder, const AVFrame *frame, AVFormatContext *output, AVStream *stream) {
+    int ret = avcodec_send_frame(encoder, frame);
+    if (ret < 0) {
+        ERROR("failed to send frame to encoder: {}", avErrorString(ret));
+        return false;
+    }
+
+    AVPacketPtr packet = allocPacket();
+    while ((ret = avcodec_receive_packet(encoder, packet.get())) >= 0) {
+        av_packet_rescale_ts(packet.get(), encoder->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+        ret = av_interleaved_write_frame(output, packet.get());
+        if (ret < 0) {
+            ERROR("failed to write packet: {}", avErrorString(ret));
+            return false;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
+
+}  // namespace
+
+TestSource::TestSource(AVPixelFormat format, int width, int height, AVRational frame_rate) {
+    m_graph = avfilter_graph_alloc();
+    if (!m_graph) {
+        FATAL("failed to allocate filter graph!");
+    }
+
+    std::string source_args = "size=" + std::to_string(width) + "x" + std::to_string(height) +
+                              ":rate=" + std::to_string(frame_rate.num) + "/" + std::to_string(frame_rate.den);
+    std::string format_args = std::string {"pix_fmts="} + av_get_pix_fmt_name(format);
+
+    AVFilterContext *source = nullptr;
+    AVFilterContext *convert = nullptr;
+    int ret = avfilter_graph_create_filter(
+        &source, avfilter_get_by_name("testsrc2"), "source", source_args.c_str(), nullptr, m_graph);
+    if (ret >= 0) {
+        ret = avfilter_graph_create_filter(
+            &convert, avfilter_get_by_name("format"), "format", format_args.c_str(), nullptr, m_graph);
+    }
+    if (ret >= 0) {
+        ret = avfilter_graph_create_filter(
+            &m_sink, avfilter_get_by_name("buffersink"), "sink", nullptr, nullptr, m_graph);
+    }
+    if (ret >= 0) {
+        ret = avfilter_link(source, 0, convert, 0);
+    }
+    if (ret >= 0) {
+        ret = avfilter_link(convert, 0, m_sink, 0);
+    }
+    if (ret >= 0) {
+        ret = avfilter_graph_config(m_graph, nullptr);
+    }
+    if (ret < 0) {
+        avfilter_graph_free(&m_graph);
+        FATAL("failed to build testsrc2 graph for {}: {}", av_get_pix_fmt_name(format), avErrorString(ret));
+    }
+}
+
+TestSource::~TestSource() { avfilter_graph_free(&m_graph); }
+
+AVFramePtr TestSource::next() {
+    AVFramePtr frame = allocFrame();
+    int ret = av_buffersink_get_frame(m_sink, frame.get());
+    if (ret < 0) {
+        FATAL("failed to generate test frame: {}", avErrorString(ret));
+    }
+    frame->pts = m_index;
+    frame->best_effort_timestamp = m_index;
+    ++m_index;
+    return frame;
+}
+
+std::vector<AVFramePtr> makeSyntheticFrames(AVPixelFormat format, int width, int height, int count) {
+    TestSource source {format, width, height, kSyntheticFrameRate};
+    std::vector<AVFramePtr> frames;
+    for (int i = 0; i < count; ++i) {
+        frames.push_back(source.next());
+    }
+    return frames;
+}
+
+const std::vector<SyntheticCodec> &getSyntheticCodecs() {
+    static const std::vector<SyntheticCodec> codecs {
+        {"libx264", "h264"},
+        {"libx265", "hevc"},
+        {"libvpx-vp9", "vp9"},
+        {"libsvtav1", "av1"},
+        {"mpeg4", "mpeg4"},
+    };
+    return codecs;
+}
+
+std::filesystem::path encodeSyntheticClip(const SyntheticCodec &codec,
+                                          int width,
+                                          int height,
+                                          int frame_count,
+                                          const SyntheticClipOptions &options) {
+    const AVCodec *encoder = avcodec_find_encoder_by_name(codec.encoder);
+    if (!encoder) {
+        WARN("encoder {} not available, skipping {}", codec.encoder, codec.label);
+        return {};
+    }
+
+    auto path = std::filesystem::temp_directory_path() /
+                ("video-app-bench-" + std::string {codec.label} + "-" + std::to_string(width) + "x" +
+                 std::to_string(height) + "-" + std::to_string(frame_count));
+    // Default clips keep their original names so existing caches stay valid.
+    const SyntheticClipOptions defaults {};
+    if (options.gop_size != defaults.gop_size || options.max_b_frames != defaults.max_b_frames) {
+        path += "-g" + std::to_string(options.gop_size) + "-b" + std::to_string(options.max_b_frames);
+    }
+    path += ".mkv";
+    if (std::filesystem::exists(path)) {
+        return path;
+    }
+    // Written under a temporary name so an interrupted run never leaves a truncated clip in the cache.
+    auto partial_path = path;
+    partial_path += ".partial";
+
+    AVCodecContextPtr encoder_ctx {avcodec_alloc_context3(encoder)};
+    encoder_ctx->width = width;
+    encoder_ctx->height = height;
+    encoder_ctx->pix_fmt = encoder->pix_fmts ? encoder->pix_fmts[0] : AV_PIX_FMT_YUV420P;
+    encoder_ctx->time_base = av_inv_q(kSyntheticFrameRate);
+    encoder_ctx->framerate = kSyntheticFrameRate;
+    encoder_ctx->gop_size = options.gop_size;
+    if (options.max_b_frames >= 0) {
+        encoder_ctx->max_b_frames = options.max_b_frames;
+    }
+    encoder_ctx->thread_count = 0;
+    // The fastest settings are fine here: only decoding is measured, not compression.
+    av_opt_set(encoder_ctx->priv_data, "preset", "ultrafast", 0);
+    av_opt_set(encoder_ctx->priv_data, "deadline", "realtime", 0);
+    av_opt_set_int(encoder_ctx->priv_data, "cpu-used", 8, 0);
+
+    OutputFile output;
+    int ret = avformat_alloc_output_context2(&output.ctx, nullptr, "matroska", partial_path.c_str());
+    if (ret < 0) {
+        FATAL("failed to create muxer: {}", avErrorString(ret));
+    }
+    if (output.ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+        encoder_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    ret = avcodec_open2(encoder_ctx.get(), encoder, nullptr);
+    if (ret < 0) {
+        WARN("failed to open encoder {}: {}", codec.encoder, avErrorString(ret));
+        return {};
+    }
+
+    AVStream *stream = avformat_new_stream(output.ctx, nullptr);
+    stream->time_base = encoder_ctx->time_base;
+    avcodec_parameters_from_context(stream->codecpar, encoder_ctx.get());
+
+    ret = avio_open(&output.ctx->pb, partial_path.c_str(), AVIO_FLAG_WRITE);
+    if (ret >= 0) {
+        ret = avformat_write_header(output.ctx, nullptr);
+    }
+    if (ret < 0) {
+        FATAL("failed to start writing {}: {}", partial_path.string(), avErrorString(ret));
+    }
+
+    INFO("encoding {} frames of {}x{} {} into {}", frame_count, width, height, codec.label, path.string());
+    TestSource source {encoder_ctx->pix_fmt, width, height, kSyntheticFrameRate};
+    for (int i = 0; i < frame_count; ++i) {
+        AVFramePtr frame = source.next();
+        if (!writePackets(encoder_ctx.get(), frame.get(), output.ctx, stream)) {
+            return {};
+        }
+    }
+    if (!writePackets(encoder_ctx.get(), nullptr, output.ctx, stream)) {
+        return {};
+    }
+    av_write_trailer(output.ctx);
+    avio_closep(&output.ctx->pb);
+
+    std::filesystem::rename(partial_path, path);
+    return path;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+
+struct AVFilterGraph;
+struct AVFilterContext;
+
+/**
+ *  @class TestSource
+ *
+ *  @brief Generates video frames in-process with libavfilter's `testsrc2`, converted to any pixel format.
+ *
+ *  The pattern moves every frame and has gradients, text and sharp edges, so encoders and converters see
+ *  something closer to real content than a constant fill.
+ */
+class TestSource {
+public:
+    NONCOPYABLE(TestSource)
+    NONMOVABLE(TestSource)
+
+    TestSource(AVPixelFormat format, int width, int height, AVRational frame_rate);
+    ~TestSource();
+
+    /**
+     *  @return The next frame, with `pts` counting frames from 0.
+     */
+    AVFramePtr next();
+
+private:
+    AVFilterGraph *m_graph {};
+    AVFilterContext *m_sink {};
+    int64_t m_index {};
+};
+
+/**
+ *  @brief Renders the first `count` frames of a TestSource.
+ */
+std::vector<AVFramePtr> makeSyntheticFrames(AVPixelFormat format, int width, int height, int count);
+
+inline constexpr AVRational kSyntheticFrameRate {30, 1};
+
+struct SyntheticCodec {
+    const char *encoder;  // libavcodec encoder name
+    const char *label;    // codec name used in results
+};
+
+/**
+ *  @return The encoders the benchmarks try, in order; ones missing from the FFmpeg build are skipped.
+ */
+const std::vector<SyntheticCodec> &getSyntheticCodecs();
+
+struct SyntheticClipOptions {
+    int gop_size {kSyntheticFrameRate.num};  // one keyframe per second, like typical streaming content
+    int max_b_frames {-1};                   // -1 keeps the encoder preset's choice
+};
+
+/**
+ *  @brief Encodes `frame_count` frames of `testsrc2` at 30 fps into a Matroska file in the temp directory.
+ *
+ *  Clips are cached by encoder, size, length and options, so every benchmark and every run after the first reuses
+ *  them.
+ *
+ *  @return The clip path, or an empty path if the encoder is not available.
+ */
+std::filesystem::path encodeSyntheticClip(const SyntheticCodec &codec,
+                                          int width,
+                                          int height,
+                                          int frame_count,
+                                          const SyntheticClipOptions &options = {});
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <string>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/text/text_renderer.h"
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr int kPixelSize = 12;
+constexpr int kColumns = kWidth / kPixelSize;
+
+// `glyphs` printable characters in lines filling the width; `seed` shifts them, so every frame can differ.
+std::string makeText(int glyphs, int seed) {
+    std::string text;
+    text.reserve(glyphs + glyphs / kColumns);
+    for (int i = 0; i < glyphs; ++i) {
+        if (i > 0 && i % kColumns == 0) {
+            text += '\n';
+        }
+        text += static_cast<char>('!' + (i * 7 + seed) % 94);
+    }
+    return text;
+}
+
+void benchText(BenchReport &report, int glyphs, bool changing, int count, const std::shared_ptr<GLContext> &gl) {
+    TextRenderer renderer {gl};
+    const TextRenderer::Style style {kPixelSize, 0xffffffff, false};
+    std::string texts[2] {makeText(glyphs, 0), makeText(glyphs, 1)};
+
+    // Fills the atlas with every glyph used, like the first frame of an overlay would.
+    renderer.addText(texts[0], 0, 0, style);
+    renderer.draw(kWidth, kHeight);
+    glCall(gl, Finish);
+    const auto warm = renderer.getStats();
+
+    uint64_t cpu_ns = 0;
+    BenchTimer timer;
+    {
+        GL_ERROR_SCOPE(gl, "text");
+        for (int i = 0; i < count; ++i) {
+            renderer.addText(texts[changing ? i & 1 : 0], 0, 0, style);
+            renderer.draw(kWidth, kHeight);
+            cpu_ns += renderer.getStats().cpu_ns;
+        }
+        glCall(gl, Finish);
+    }
+    const double wall_seconds = timer.wallSeconds();
+    const double process_cpu_seconds = timer.processCpuSeconds();
+
+    const auto stats = renderer.getStats();
+    auto &entry = report.add("text");
+    entry.params["glyphs"] = std::to_string(glyphs);
+    entry.params["text"] = changing ? "changing" : "static";
+    entry.params["pixel_size"] = std::to_string(kPixelSize);
+    entry.metrics["wall_ms_per_frame"] = wall_seconds * 1000.0 / count;
+    entry.metrics["process_cpu_ms_per_frame"] = process_cpu_seconds * 1000.0 / count;
+    entry.metrics["submit_us_per_frame"] = cpu_ns * 1e-3 / count;
+    entry.metrics["draw_calls_per_frame"] = 1;
+    entry.metrics["instances"] = stats.instances;
+    entry.metrics["instance_bytes"] = stats.instance_bytes;
+    entry.metrics["atlas_glyphs"] = stats.atlas.glyphs;
+    entry.metrics["atlas_uploads"] = stats.atlas.uploads - warm.atlas.uploads;
+    entry.metrics["atlas_occupancy"] = stats.atlas.occupancy;
+    entry.metrics["atlas_overflows"] = stats.atlas_overflows;
+}
+
+}  // namespace
+
+void runTextBench(BenchReport &report, const BenchOptions &options) {
+    const auto &gl = options.gl;
+    auto &state = gl->getStateCache();
+
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl, TexImage2D, GL_TEXTURE_2D, 0, GL_RGBA8, kWidth, kHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+
+    for (int glyphs : {100, 1000, 10000}) {
+        benchText(report, glyphs, false, options.frames, gl);
+        benchText(report, glyphs, true, options.frames, gl);
+    }
+
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+}
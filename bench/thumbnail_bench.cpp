@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "base/job_system.h"
+#include "media/keyframe_index.h"
+#include "media/media_engine.h"
+#include "media/thumbnail_generator.h"
+
+namespace {
+
+// A 30 s clip with the default one-second GOP: 64 thumbnails spread over 30 segments in exact mode.
+constexpr int kClipSeconds = 30;
+constexpr int kWidth = 1280;
+constexpr int kHeight = 720;
+
+std::vector<int> getThreadCounts() {
+    const int workers = std::max(1, JobSystem::get()->getWorkerCount());
+    std::vector<int> counts;
+    for (int threads = 1; threads < workers; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(workers);
+    return counts;
+}
+
+}  // namespace
+
+void runThumbnailBench(BenchReport &report, const BenchOptions &options) {
+    const auto engine_config = MediaEngine::Config::fromConfigManager();
+    const auto &index_config = engine_config.index;
+    const int frame_count = kClipSeconds * kSyntheticFrameRate.num;
+
+    for (const auto &codec : getSyntheticCodecs()) {
+        auto path = encodeSyntheticClip(codec, kWidth, kHeight, frame_count);
+        if (path.empty()) {
+            continue;
+        }
+        // Built once up front, so every case measures decoding only.
+        if (index_config.enabled) {
+            KeyframeIndex::loadOrBuild(path, index_config, engine_config.io);
+        }
+
+        for (auto mode : {ThumbnailGenerator::Mode::Keyframes, ThumbnailGenerator::Mode::Exact}) {
+            double single_thread_seconds = 0.0;
+            for (int threads : getThreadCounts()) {
+                ThumbnailGenerator::Config config {};
+                config.io = engine_config.io;
+                config.threads = threads;
+                config.mode = mode;
+                ThumbnailGenerator::Stats stats {};
+                ThumbnailGenerator::generate(path, config, index_config, &stats);
+                if (threads == 1) {
+                    single_thread_seconds = stats.seconds;
+                }
+
+                const double speedup = single_thread_seconds / stats.seconds;
+                auto &entry = report.add("thumbnails");
+                entry.params["codec"] = codec.label;
+                entry.params["resolution"] = std::to_string(kWidth) + "x" + std::to_string(kHeight);
+                entry.params["mode"] = mode == ThumbnailGenerator::Mode::Keyframes ? "keyframes" : "exact";
+                entry.params["threads"] = std::to_string(stats.threads);
+                entry.metrics["seconds"] = stats.seconds;
+                entry.metrics["thumbnails_per_sec"] =
+                    (stats.keyframe_thumbnails + stats.exact_thumbnails) / stats.seconds;
+                entry.metrics["segments"] = stats.segments;
+                entry.metrics["failed"] = stats.failed_thumbnails;
+                entry.metrics["frames_decoded"] = stats.frames_decoded;
+                entry.metrics["speedup"] = speedup;
+                entry.metrics["efficiency"] = speedup / stats.threads;
+            }
+        }
+    }
+}
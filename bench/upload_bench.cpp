@@ -0,0 +1,83 @@
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/yuv_converter.h"
+
+namespace {
+
+struct UploadCase {
+    AVPixelFormat format;
+    int width;
+    int height;
+    size_t slots;
+};
+
+}  // namespace
+
+void runUploadBench(BenchReport &report, const BenchOptions &options) {
+    const UploadCase cases[] {
+        {AV_PIX_FMT_YUV420P, 1920, 1080, 3},
+        {AV_PIX_FMT_YUV420P, 1920, 1080, 8},
+        {AV_PIX_FMT_YUV420P, 3840, 2160, 3},
+        {AV_PIX_FMT_YUV420P, 3840, 2160, 8},
+        {AV_PIX_FMT_P010LE, 3840, 2160, 8},
+    };
+    const auto &gl = options.gl;
+
+    for (const auto &test_case : cases) {
+        auto frames = makeSyntheticFrames(test_case.format, test_case.width, test_case.height, 4);
+        size_t slot_size = YuvConverter::getStagingSize(test_case.format, test_case.width, test_case.height);
+        auto ring = gl->createPixelUploadRing(test_case.slots, slot_size);
+        YuvConverter converter {gl};
+
+        // Staging (CPU copy into the mapped PBO) and the GL upload are timed separately.
+        auto upload = [&](const AVFrame *frame, double *stage_seconds) {
+            ring->pump(true);
+            auto slot = ring->tryAcquireWritable();
+            BenchTimer stage_timer;
+            YuvConverter::stage(slot, frame);
+            if (stage_seconds) {
+                *stage_seconds += stage_timer.wallSeconds();
+            }
+            converter.upload(*ring, slot, frame);
+        };
+
+        upload(frames[0].get(), nullptr);
+        glCall(gl, Finish);
+        auto before = ring->getStats();
+
+        double stage_seconds = 0;
+        BenchTimer timer;
+        {
+            GL_ERROR_SCOPE(gl, "upload");
+            for (int i = 0; i < options.frames; ++i) {
+                upload(frames[i % frames.size()].get(), &stage_seconds);
+            }
+            glCall(gl, Finish);
+        }
+        double seconds = timer.wallSeconds();
+
+        auto after = ring->getStats();
+        double bytes = static_cast<double>(after.bytes_uploaded - before.bytes_uploaded);
+
+        auto &entry = report.add("upload");
+        entry.params["format"] = av_get_pix_fmt_name(test_case.format);
+        entry.params["resolution"] = std::to_string(test_case.width) + "x" + std::to_string(test_case.height);
+        entry.params["slots"] = std::to_string(test_case.slots);
+        entry.metrics["mb_per_sec"] = bytes / seconds / (1 << 20);
+        entry.metrics["wall_ms_per_frame"] = seconds * 1000.0 / options.frames;
+        entry.metrics["stage_ms_per_frame"] = stage_seconds * 1000.0 / options.frames;
+        entry.metrics["fence_waits"] = after.fence_waits - before.fence_waits;
+        entry.metrics["fence_wait_ms"] = (after.fence_wait_ns - before.fence_wait_ns) / 1e6;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <stop_token>
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "base/histogram.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/upload_thread.h"
+#include "render/convert/yuv_converter.h"
+
+namespace {
+
+// The picture drawn every frame; its cost is the same in both modes.
+constexpr int kTargetWidth = 1280;
+constexpr int kTargetHeight = 720;
+constexpr size_t kSlots = 6;
+
+struct UploadThreadCase {
+    AVPixelFormat format;
+    int width;
+    int height;
+};
+
+enum class Mode {
+    Sync,      // the render thread uploads, as without the upload thread
+    Threaded,
+};
+
+void benchCase(BenchReport &report, const UploadThreadCase &test_case, Mode mode, const BenchOptions &options) {
+    const auto &gl = options.gl;
+    auto frames = makeSyntheticFrames(test_case.format, test_case.width, test_case.height, 4);
+    size_t slot_size = YuvConverter::getStagingSize(test_case.format, test_case.width, test_case.height);
+    YuvConverter converter {gl};
+
+    std::unique_ptr<UploadThread> uploader {};
+    std::shared_ptr<PixelUploadRing> ring {};
+    if (mode == Mode::Threaded) {
+        uploader = std::make_unique<UploadThread>(gl, UploadThread::Config {});
+        ring = uploader->createRing(kSlots, slot_size);
+    } else {
+        ring = gl->createPixelUploadRing(kSlots, slot_size);
+    }
+
+    auto &state = gl->getStateCache();
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl,
+           TexImage2D,
+           GL_TEXTURE_2D,
+           0,
+           GL_RGBA8,
+           kTargetWidth,
+           kTargetHeight,
+           0,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    state.viewport(0, 0, kTargetWidth, kTargetHeight);
+
+    // Staging stands in for the decode thread and is not part of the render thread's frame time.
+    std::stop_source stop {};
+    auto stage = [&](const AVFrame *frame) {
+        PixelUploadRing::Slot *slot = nullptr;
+        if (uploader) {
+            slot = ring->acquireWritable(stop.get_token());
+        } else {
+            ring->pump(true);
+            slot = ring->tryAcquireWritable();
+        }
+        YuvConverter::stage(slot, frame);
+        return slot;
+    };
+
+    Histogram frame_times {0.0001, 1000};  // 0.1 ms buckets up to 100 ms
+    uint64_t shown = 0;
+    auto render_frame = [&](const AVFramePtr &frame) {
+        auto slot = stage(frame.get());
+        BenchTimer timer;
+        if (uploader) {
+            uploader->upload(ring.get(), slot, AVFramePtr {av_frame_clone(frame.get())});
+            if (auto set = uploader->acquireLatest()) {
+                converter.setFrame(set->planes, set->frame.get());
+                ++shown;
+            }
+        } else {
+            converter.upload(*ring, slot, frame.get());
+            ++shown;
+        }
+        converter.drawFullViewport();
+        glCall(gl, Flush);
+        return timer.wallSeconds();
+    };
+
+    render_frame(frames[0]);
+    glCall(gl, Finish);
+    shown = 0;
+
+    BenchTimer timer;
+    {
+        GL_ERROR_SCOPE(gl, "upload thread");
+        for (int i = 0; i < options.frames; ++i) {
+            frame_times.add(render_frame(frames[i % frames.size()]));
+        }
+        glCall(gl, Finish);
+    }
+    double seconds = timer.wallSeconds();
+
+    auto &entry = report.add("upload_thread");
+    entry.params["format"] = av_get_pix_fmt_name(test_case.format);
+    entry.params["resolution"] = std::to_string(test_case.width) + "x" + std::to_string(test_case.height);
+    entry.params["mode"] = mode == Mode::Threaded ? "threaded" : "sync";
+    entry.metrics["fps"] = options.frames / seconds;
+    entry.metrics["render_ms_mean"] = frame_times.getMean() * 1000;
+    entry.metrics["render_ms_p99"] = frame_times.getPercentile(0.99) * 1000;
+    entry.metrics["render_ms_max"] = frame_times.getMax() * 1000;
+    entry.metrics["shown_frames"] = shown;
+    if (uploader) {
+        const auto stats = uploader->getStats();
+        entry.metrics["superseded"] = stats.superseded;
+        entry.metrics["upload_thread_ms_mean"] = stats.mean_upload_ms;
+    }
+
+    // The ring goes back to the upload thread that destroys it, before that thread stops.
+    ring.reset();
+    uploader.reset();
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+}
+
+}  // namespace
+
+void runUploadThreadBench(BenchReport &report, const BenchOptions &options) {
+    const UploadThreadCase cases[] {
+        {AV_PIX_FMT_YUV420P, 1280, 720},
+        {AV_PIX_FMT_YUV420P, 1920, 1080},
+        {AV_PIX_FMT_YUV420P, 3840, 2160},
+        {AV_PIX_FMT_P010LE, 3840, 2160},
+    };
+    for (const auto &test_case : cases) {
+        for (Mode mode : {Mode::Sync, Mode::Threaded}) {
+            benchCase(report, test_case, mode, options);
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench_timer.h"
+#include "benchmarks.h"
+#include "synthetic.h"
+
+#include "base/job_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/wall/video_wall.h"
+
+namespace {
+
+constexpr int kOutputWidth = 1920;
+constexpr int kOutputHeight = 1080;
+constexpr int kStreams = 16;
+constexpr double kPacedSeconds = 5.0;
+
+std::vector<int> getWorkerCounts() {
+    const int hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> counts;
+    for (int workers = 1; workers < hardware; workers *= 2) {
+        counts.push_back(workers);
+    }
+    counts.push_back(hardware);
+    return counts;
+}
+
+// The first synthetic codec available, encoded at the given size.
+std::pair<std::filesystem::path, const char *> getClip(int width, int height, int frame_count) {
+    for (const auto &codec : getSyntheticCodecs()) {
+        auto path = encodeSyntheticClip(codec, width, height, frame_count);
+        if (!path.empty()) {
+            return {path, codec.label};
+        }
+    }
+    return {};
+}
+
+// Every frame of every stream, shown as soon as it is decoded: aggregate decode, convert and upload throughput.
+void benchThroughput(BenchReport &report,
+                     const std::filesystem::path &path,
+                     const char *codec,
+                     const char *resolution,
+                     int streams,
+                     int workers,
+                     double *single_worker_fps,
+                     const std::shared_ptr<GLContext> &gl) {
+    JobSystem::get()->initialize({workers, false});
+    auto config = VideoWall::Config::fromConfigManager();
+    config.paced = false;
+    config.loop = false;
+    VideoWall wall {gl, std::vector<std::filesystem::path>(streams, path), config};
+
+    BenchTimer timer;
+    {
+        GL_ERROR_SCOPE(gl, "wall");
+        while (!wall.isFinished()) {
+            if (wall.update(0.0) == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            wall.draw(kOutputWidth, kOutputHeight);
+        }
+        glCall(gl, Finish);
+    }
+    const double wall_seconds = timer.wallSeconds();
+    const double process_cpu_seconds = timer.processCpuSeconds();
+
+    const auto stats = wall.getStats();
+    const double fps = stats.presented / wall_seconds;
+    if (workers == 1) {
+        *single_worker_fps = fps;
+    }
+    const double speedup = *single_worker_fps > 0 ? fps / *single_worker_fps : 0.0;
+    auto &entry = report.add("wall");
+    entry.params["mode"] = "throughput";
+    entry.params["codec"] = codec;
+    entry.params["resolution"] = resolution;
+    entry.params["streams"] = std::to_string(streams);
+    entry.params["workers"] = std::to_string(workers);
+    entry.metrics["seconds"] = wall_seconds;
+    entry.metrics["aggregate_fps"] = fps;
+    entry.metrics["fps_per_stream"] = fps / streams;
+    entry.metrics["speedup"] = speedup;
+    entry.metrics["efficiency"] = speedup / workers;
+    entry.metrics["process_cpu_seconds"] = process_cpu_seconds;
+    entry.metrics["busy_workers"] = stats.decode_busy_seconds / wall_seconds;
+    entry.metrics["decode_stalls"] = stats.decode_stalls;
+}
+
+// Streams played on their clocks on too few workers, with and without quality control.
+void benchPaced(BenchReport &report,
+                const std::filesystem::path &path,
+                const char *codec,
+                const char *resolution,
+                int workers,
+                bool qos,
+                const std::shared_ptr<GLContext> &gl) {
+    JobSystem::get()->initialize({workers, false});
+    auto config = VideoWall::Config::fromConfigManager();
+    config.loop = true;
+    if (!qos) {
+        config.qos_degrade_ratio = 1e9;
+    }
+    VideoWall wall {gl, std::vector<std::filesystem::path>(kStreams, path), config};
+
+    const auto start = std::chrono::steady_clock::now();
+    double time = 0.0;
+    {
+        GL_ERROR_SCOPE(gl, "wall");
+        while (time < kPacedSeconds) {
+            wall.update(time);
+            wall.draw(kOutputWidth, kOutputHeight);
+            glCall(gl, Finish);
+            // A 60 Hz display.
+            const std::chrono::duration<double> next {time + 1.0 / 60};
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::nanoseconds>(next));
+            time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    const auto stats = wall.getStats();
+    auto &entry = report.add("wall");
+    entry.params["mode"] = "paced";
+    entry.params["codec"] = codec;
+    entry.params["resolution"] = resolution;
+    entry.params["streams"] = std::to_string(kStreams);
+    entry.params["workers"] = std::to_string(workers);
+    entry.params["qos"] = qos ? "on" : "off";
+    entry.metrics["shown_fps"] = stats.presented / time;
+    entry.metrics["shown_fps_per_stream"] = stats.presented / time / kStreams;
+    entry.metrics["dropped"] = stats.dropped;
+    entry.metrics["missed"] = stats.underruns;
+    entry.metrics["quality_changes"] = stats.quality_changes;
+    entry.metrics["degraded_streams"] = stats.degraded_streams;
+    entry.metrics["busy_workers"] = stats.decode_busy_seconds / time;
+}
+
+}  // namespace
+
+void runWallBench(BenchReport &report, const BenchOptions &options) {
+    const auto &gl = options.gl;
+    auto &state = gl->getStateCache();
+
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl,
+           TexImage2D,
+           GL_TEXTURE_2D,
+           0,
+           GL_RGBA8,
+           kOutputWidth,
+           kOutputHeight,
+           0,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+
+    // Throughput by worker count, then by stream count on every worker.
+    if (auto [path, codec] = getClip(640, 360, options.frames); !path.empty()) {
+        double single_worker_fps = 0.0;
+        for (int workers : getWorkerCounts()) {
+            benchThroughput(report, path, codec, "640x360", kStreams, workers, &single_worker_fps, gl);
+        }
+        const int workers = getWorkerCounts().back();
+        for (int streams : {1, 4, 32}) {
+            double unused = 0.0;
+            benchThroughput(report, path, codec, "640x360", streams, workers, &unused, gl);
+        }
+    }
+
+    // Sixteen 720p streams on two workers is more than most machines decode in real time.
+    if (auto [path, codec] = getClip(1280, 720, static_cast<int>(kPacedSeconds * kSyntheticFrameRate.num));
+        !path.empty()) {
+        benchPaced(report, path, codec, "1280x720", 2, false, gl);
+        benchPaced(report, path, codec, "1280x720", 2, true, gl);
+    }
+
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+    JobSystem::get()->initialize();
+}
@@ -0,0 +1,82 @@
+#include "audio_device.h"
+
+#include "log/log_system.h"
+
+AudioDevice::~AudioDevice() {
+    alcMakeContextCurrent(nullptr);
+    if (m_context) {
+        alcDestroyContext(m_context);
+    }
+    if (m_device) {
+        alcCloseDevice(m_device);
+    }
+    DEBUG("release AudioDevice: {}", (void *)this);
+}
+
+std::shared_ptr<AudioDevice> AudioDevice::openDefault() {
+    std::shared_ptr<AudioDevice> device {new AudioDevice {}};
+
+    device->m_device = alcOpenDevice(nullptr);
+    if (!device->m_device) {
+        FATAL("failed to open audio device!");
+    }
+    device->createContext(nullptr);
+
+    INFO("opened audio device {} at {} Hz",
+         alcGetString(device->m_device, ALC_DEVICE_SPECIFIER),
+         device->m_sample_rate);
+    return device;
+}
+
+std::shared_ptr<AudioDevice> AudioDevice::openLoopback(int sample_rate) {
+    if (!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback")) {
+        FATAL("ALC_SOFT_loopback is not supported!");
+    }
+
+    auto open_loopback =
+        reinterpret_cast<LPALCLOOPBACKOPENDEVICESOFT>(alcGetProcAddress(nullptr, "alcLoopbackOpenDeviceSOFT"));
+    auto render_samples =
+        reinterpret_cast<LPALCRENDERSAMPLESSOFT>(alcGetProcAddress(nullptr, "alcRenderSamplesSOFT"));
+    if (!open_loopback || !render_samples) {
+        FATAL("failed to load ALC_SOFT_loopback functions!");
+    }
+
+    std::shared_ptr<AudioDevice> device {new AudioDevice {}};
+    device->m_device = open_loopback(nullptr);
+    if (!device->m_device) {
+        FATAL("failed to open loopback audio device!");
+    }
+    device->m_render_samples = render_samples;
+
+    const ALCint attributes[] {
+        ALC_FORMAT_CHANNELS_SOFT,
+        ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT,
+        ALC_SHORT_SOFT,
+        ALC_FREQUENCY,
+        sample_rate,
+        0,
+    };
+    device->createContext(attributes);
+
+    INFO("opened loopback audio device at {} Hz", device->m_sample_rate);
+    return device;
+}
+
+void AudioDevice::renderLoopback(int16_t *buffer, int frames) {
+    if (!m_render_samples) {
+        FATAL("not a loopback device!");
+    }
+    m_render_samples(m_device, buffer, frames);
+}
+
+void AudioDevice::createContext(const ALCint *attributes) {
+    m_context = alcCreateContext(m_device, attributes);
+    if (!m_context || !alcMakeContextCurrent(m_context)) {
+        FATAL("failed to create audio context!");
+    }
+
+    ALCint sample_rate = 0;
+    alcGetIntegerv(m_device, ALC_FREQUENCY, 1, &sample_rate);
+    m_sample_rate = sample_rate;
+}
\ No newline at end of file
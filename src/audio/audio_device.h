@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <AL/al.h>
+#include <AL/alc.h>
+#include <AL/alext.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+/**
+ *  @class AudioDevice
+ *
+ *  @brief Owns an OpenAL device and context.
+ *
+ *  Either a real output device, or an ALC_SOFT_loopback device that only mixes when `renderLoopback` is called.
+ *  Loopback devices need no audio hardware, which makes the audio path testable headless.
+ *
+ *  @note The context is made current for the whole process; only one AudioDevice should exist at a time.
+ */
+class AudioDevice {
+public:
+    NONCOPYABLE(AudioDevice)
+    NONMOVABLE(AudioDevice)
+
+    ~AudioDevice();
+
+    /**
+     *  @brief Opens the system's default output device.
+     *
+     *  @note Throws std::runtime_error on failure.
+     */
+    static std::shared_ptr<AudioDevice> openDefault();
+
+    /**
+     *  @brief Opens a loopback device rendering 16-bit stereo at `sample_rate`.
+     *
+     *  @note Throws std::runtime_error if ALC_SOFT_loopback is unavailable.
+     */
+    static std::shared_ptr<AudioDevice> openLoopback(int sample_rate);
+
+    /**
+     *  @brief Mixes `frames` stereo sample frames into `buffer`, advancing playback of every source.
+     *
+     *  @note Only valid on loopback devices; may be called from any thread.
+     */
+    void renderLoopback(int16_t *buffer, int frames);
+
+    bool isLoopback() const { return m_render_samples != nullptr; }
+
+    int getSampleRate() const { return m_sample_rate; }
+
+private:
+    ALCdevice *m_device {};
+    ALCcontext *m_context {};
+    int m_sample_rate {};
+
+    LPALCRENDERSAMPLESSOFT m_render_samples {};
+
+    AudioDevice() = default;
+
+    void createContext(const ALCint *attributes);
+};
\ No newline at end of file
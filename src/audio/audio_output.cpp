@@ -0,0 +1,312 @@
+#include "audio_output.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+AudioOutput::Config AudioOutput::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.buffer_count = config_manager->getIntValue("audio", "buffer_count", config.buffer_count);
+    config.buffer_samples = config_manager->getIntValue("audio", "buffer_samples", config.buffer_samples);
+    config.ring_chunks = config_manager->getIntValue("audio", "ring_chunks", config.ring_chunks);
+    return config;
+}
+
+AudioOutput::AudioOutput(std::shared_ptr<AudioDevice> device, const Config &config)
+    : m_device(device), m_config(config), m_sample_rate(device->getSampleRate()), m_chunks(config.ring_chunks),
+      m_free_chunks(config.ring_chunks), m_filled_chunks(config.ring_chunks), m_playback_time(NAN) {
+    if (config.buffer_count < 2 || config.buffer_samples <= 0 || config.ring_chunks <= 0) {
+        FATAL("invalid audio config: {} buffers x {} samples, {} chunks",
+              config.buffer_count,
+              config.buffer_samples,
+              config.ring_chunks);
+    }
+
+    for (auto &chunk : m_chunks) {
+        chunk.samples.resize(static_cast<size_t>(config.buffer_samples) * kChannels);
+        m_free_chunks.tryPush(&chunk);
+    }
+
+    alGenSources(1, &m_source_id);
+    m_buffers.resize(config.buffer_count);
+    alGenBuffers(config.buffer_count, m_buffers.data());
+    if (alGetError() != AL_NO_ERROR) {
+        FATAL("failed to create OpenAL source and buffers!");
+    }
+    m_free_buffers = m_buffers;
+    m_queued_buffers.reserve(config.buffer_count);
+    m_buffer_pts.resize(config.buffer_count);
+
+    INFO("audio output: {} buffers x {} samples at {} Hz ({:.1f} ms), {} ring chunks",
+         config.buffer_count,
+         config.buffer_samples,
+         m_sample_rate,
+         1000.0 * config.buffer_count * config.buffer_samples / m_sample_rate,
+         config.ring_chunks);
+}
+
+AudioOutput::~AudioOutput() {
+    m_resample_thread = {};
+    m_output_thread = {};
+
+    alSourceStop(m_source_id);
+    alSourcei(m_source_id, AL_BUFFER, 0);
+    alDeleteSources(1, &m_source_id);
+    alDeleteBuffers(static_cast<ALsizei>(m_buffers.size()), m_buffers.data());
+    swr_free(&m_swr);
+
+    INFO("audio output: {} underruns, {} buffers queued", m_underruns.load(), m_buffers_queued.load());
+    DEBUG("release AudioOutput: {}", (void *)this);
+}
+
+std::shared_ptr<AudioOutput> AudioOutput::create(std::shared_ptr<AudioDevice> device, const Config &config) {
+    return std::shared_ptr<AudioOutput> {new AudioOutput {device, config}};
+}
+
+void AudioOutput::start(FrameSource source, EndOfSource at_end, AVRational time_base) {
+    if (m_resample_thread.joinable()) {
+        FATAL("AudioOutput already started!");
+    }
+    m_source = std::move(source);
+    m_at_end = std::move(at_end);
+    m_time_base = time_base;
+
+    m_resample_thread = std::jthread([this](std::stop_token stop) { resampleLoop(stop); });
+    m_output_thread = std::jthread([this](std::stop_token stop) { outputLoop(stop); });
+}
+
+void AudioOutput::setPaused(bool paused) { m_paused = paused; }
+
+AudioOutput::Stats AudioOutput::getStats() const {
+    size_t ring_chunks = m_filled_chunks.size();
+    double queued_samples =
+        m_al_queued_samples.load(std::memory_order_relaxed) + static_cast<double>(ring_chunks) * m_config.buffer_samples;
+    return {
+        m_underruns.load(std::memory_order_relaxed),
+        m_buffers_queued.load(std::memory_order_relaxed),
+        ring_chunks,
+        queued_samples / m_sample_rate,
+    };
+}
+
+void AudioOutput::resampleLoop(std::stop_token stop) {
+    Tracer::get()->setThreadName("audio resample");
+    while (!stop.stop_requested()) {
+        AVFramePtr frame = m_source();
+        if (!frame) {
+            if (!m_drained && m_at_end && m_at_end()) {
+                TRACE_ZONE("drain");
+                if (!drain(stop)) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        TRACE_ZONE("resample");
+        m_drained = false;
+        if (!resample(frame.get(), stop)) {
+            break;
+        }
+    }
+    DEBUG("audio resample thread finished");
+}
+
+bool AudioOutput::resample(const AVFrame *frame, const std::stop_token &stop) {
+    if (frame->format != m_swr_format || frame->sample_rate != m_swr_rate ||
+        frame->ch_layout.nb_channels != m_swr_channels) {
+        AVChannelLayout stereo {};
+        av_channel_layout_default(&stereo, kChannels);
+
+        // The tail of the previous input would otherwise be lost with its resampler.
+        if (m_swr && !convert(nullptr, 0, stop)) {
+            return false;
+        }
+        swr_free(&m_swr);
+        int ret = swr_alloc_set_opts2(&m_swr,
+                                      &stereo,
+                                      AV_SAMPLE_FMT_S16,
+                                      m_sample_rate,
+                                      &frame->ch_layout,
+                                      static_cast<AVSampleFormat>(frame->format),
+                                      frame->sample_rate,
+                                      0,
+                                      nullptr);
+        if (ret < 0 || (ret = swr_init(m_swr)) < 0) {
+            ERROR("failed to create resampler: {}", avErrorString(ret));
+            swr_free(&m_swr);
+            return false;
+        }
+        m_swr_format = frame->format;
+        m_swr_rate = frame->sample_rate;
+        m_swr_channels = frame->ch_layout.nb_channels;
+        DEBUG("audio resampler: {} Hz {} ch {} -> {} Hz stereo s16",
+              m_swr_rate,
+              m_swr_channels,
+              av_get_sample_fmt_name(static_cast<AVSampleFormat>(m_swr_format)),
+              m_sample_rate);
+    }
+
+    // Samples still buffered inside swr come before this frame's first sample.
+    if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+        m_next_sample_time = frame->best_effort_timestamp * av_q2d(m_time_base) -
+                             static_cast<double>(swr_get_delay(m_swr, m_sample_rate)) / m_sample_rate;
+    }
+
+    return convert(const_cast<const uint8_t **>(frame->extended_data), frame->nb_samples, stop);
+}
+
+bool AudioOutput::convert(const uint8_t **in, int in_count, const std::stop_token &stop) {
+    // A null `in` flushes swr. Otherwise later rounds pass `in` with no samples, which only takes out what is
+    // buffered: a null input there would flush the resampler in the middle of the stream.
+    while (true) {
+        while (!m_current_chunk) {
+            if (auto chunk = m_free_chunks.tryPop()) {
+                m_current_chunk = *chunk;
+                m_current_filled = 0;
+            } else if (stop.stop_requested()) {
+                return false;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        auto out = reinterpret_cast<uint8_t *>(m_current_chunk->samples.data() + m_current_filled * kChannels);
+        int wanted = m_config.buffer_samples - m_current_filled;
+        int got = swr_convert(m_swr, &out, wanted, in, in_count);
+        in_count = 0;
+        if (got < 0) {
+            WARN("failed to resample audio: {}", avErrorString(got));
+            return true;
+        }
+
+        m_current_filled += got;
+        m_next_sample_time += static_cast<double>(got) / m_sample_rate;
+        if (m_current_filled == m_config.buffer_samples) {
+            publishChunk();
+        }
+        // Less output than asked for means swr has nothing buffered anymore.
+        if (got < wanted) {
+            return true;
+        }
+    }
+}
+
+bool AudioOutput::drain(const std::stop_token &stop) {
+    if (m_swr) {
+        if (!convert(nullptr, 0, stop)) {
+            return false;
+        }
+        // A flushed resampler is not fed again; the next frame creates a new one.
+        swr_free(&m_swr);
+        m_swr_format = -1;
+    }
+    if (m_current_chunk && m_current_filled > 0) {
+        const int padding = m_config.buffer_samples - m_current_filled;
+        std::fill(m_current_chunk->samples.begin() + m_current_filled * kChannels, m_current_chunk->samples.end(), 0);
+        m_current_filled = m_config.buffer_samples;
+        m_next_sample_time += static_cast<double>(padding) / m_sample_rate;
+        publishChunk();
+    }
+    m_drained = true;
+    return true;
+}
+
+void AudioOutput::publishChunk() {
+    m_current_chunk->pts = m_next_sample_time - static_cast<double>(m_current_filled) / m_sample_rate;
+    m_filled_chunks.tryPush(m_current_chunk);
+    m_current_chunk = nullptr;
+}
+
+void AudioOutput::outputLoop(std::stop_token stop) {
+    // Wake up a few times per buffer so the source is topped up well before it drains.
+    auto period = std::chrono::microseconds(1000000ll * m_config.buffer_samples / m_sample_rate / 4);
+    Tracer::get()->setThreadName("audio output");
+    while (!stop.stop_requested()) {
+        {
+            TRACE_ZONE("refill");
+            refill();
+        }
+        std::this_thread::sleep_for(period);
+    }
+    DEBUG("audio output thread finished");
+}
+
+void AudioOutput::refill() {
+    ALint processed = 0;
+    alGetSourcei(m_source_id, AL_BUFFERS_PROCESSED, &processed);
+    while (processed-- > 0) {
+        ALuint buffer;
+        alSourceUnqueueBuffers(m_source_id, 1, &buffer);
+        m_queued_buffers.erase(m_queued_buffers.begin());
+        m_free_buffers.push_back(buffer);
+    }
+
+    const bool paused = m_paused;
+    while (!paused && !m_free_buffers.empty()) {
+        auto chunk = m_filled_chunks.tryPop();
+        if (!chunk) {
+            break;
+        }
+
+        ALuint buffer = m_free_buffers.back();
+        m_free_buffers.pop_back();
+        alBufferData(buffer,
+                     AL_FORMAT_STEREO16,
+                     (*chunk)->samples.data(),
+                     static_cast<ALsizei>((*chunk)->samples.size() * sizeof(int16_t)),
+                     m_sample_rate);
+        m_buffer_pts[bufferIndex(buffer)] = (*chunk)->pts;
+        alSourceQueueBuffers(m_source_id, 1, &buffer);
+        m_queued_buffers.push_back(buffer);
+        m_free_chunks.tryPush(*chunk);
+        m_buffers_queued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ALint state = AL_INITIAL;
+    ALint queued = 0;
+    alGetSourcei(m_source_id, AL_SOURCE_STATE, &state);
+    alGetSourcei(m_source_id, AL_BUFFERS_QUEUED, &queued);
+
+    if (paused) {
+        if (state == AL_PLAYING) {
+            alSourcePause(m_source_id);
+        }
+    } else if (state != AL_PLAYING && queued > 0) {
+        // A stopped source with buffers queued again means it drained before we could refill it.
+        if (state == AL_STOPPED && m_started) {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        alSourcePlay(m_source_id);
+        m_started = true;
+    }
+
+    ALint sample_offset = 0;
+    alGetSourcei(m_source_id, AL_SAMPLE_OFFSET, &sample_offset);
+    m_al_queued_samples.store(queued * m_config.buffer_samples - sample_offset, std::memory_order_relaxed);
+
+    if (!m_queued_buffers.empty() && m_started) {
+        // The sample offset counts from the head of the queue, processed buffers included.
+        double pts = m_buffer_pts[bufferIndex(m_queued_buffers.front())];
+        m_playback_time.store(pts + static_cast<double>(sample_offset) / m_sample_rate, std::memory_order_relaxed);
+    }
+}
+
+size_t AudioOutput::bufferIndex(ALuint buffer) const {
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        if (m_buffers[i] == buffer) {
+            return i;
+        }
+    }
+    return 0;
+}
\ No newline at end of file
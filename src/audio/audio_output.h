@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "audio/audio_device.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/spsc_queue.h"
+#include "media/av_utils.h"
+
+struct SwrContext;
+
+/**
+ *  @class AudioOutput
+ *
+ *  @brief Streams decoded audio frames to an OpenAL source.
+ *
+ *  Two threads, connected by lock-free SPSC queues of preallocated PCM chunks:
+ *  - the resample thread pulls frames from the frame source and converts them with libswresample to 16-bit
+ *    stereo at the device rate, writing straight into free chunks;
+ *  - the output thread refills the OpenAL source from filled chunks with `alSourceQueueBuffers` and restarts it
+ *    after an underrun.
+ *
+ *  OpenAL latency is `buffer_count * buffer_samples`; the chunk ring adds slack against decode hiccups without
+ *  adding latency as long as the source is fed.
+ *
+ *  When the source reaches its end, and before the resampler is re-created for a new input format, the samples
+ *  swr still holds are flushed out; at the end the last, partly filled chunk is padded with silence and queued.
+ */
+class AudioOutput {
+public:
+    NONCOPYABLE(AudioOutput)
+    NONMOVABLE(AudioOutput)
+
+    struct Config {
+        int buffer_count {4};        // OpenAL buffers queued on the source
+        int buffer_samples {1024};   // sample frames per buffer and per chunk
+        int ring_chunks {16};        // preallocated chunks between the resample and output threads
+
+        /**
+         *  @brief Reads the `[audio]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t underruns;        // times the source ran dry and stopped
+        uint64_t buffers_queued;   // buffers handed to OpenAL
+        size_t ring_chunks;        // filled chunks waiting for the output thread
+        double queued_latency;     // seconds from the last resampled sample to the speaker
+    };
+
+    /**
+     *  @brief Returns the next audio frame to play, or nullptr if none is ready. Called on the resample thread.
+     */
+    using FrameSource = std::function<AVFramePtr()>;
+
+    /**
+     *  @brief Returns true when the frame source has run out for good rather than being momentarily empty; the
+     *         samples still held by the resampler are then played out. Called on the resample thread.
+     */
+    using EndOfSource = std::function<bool()>;
+
+    /**
+     *  @brief Stops both threads and deletes the source and buffers.
+     */
+    ~AudioOutput();
+
+    static std::shared_ptr<AudioOutput> create(std::shared_ptr<AudioDevice> device, const Config &config);
+
+    /**
+     *  @param source Where decoded frames come from; it becomes the only consumer of that queue.
+     *  @param at_end Tells an empty source at the end of its input from one that is only behind.
+     *  @param time_base Time base of the frames' timestamps.
+     */
+    void start(FrameSource source, EndOfSource at_end, AVRational time_base);
+
+    void setPaused(bool paused);
+    bool isPaused() const { return m_paused; }
+
+    /**
+     *  @return The presentation time, in seconds, of the sample currently being played, or NAN before the first
+     *          buffer started playing.
+     */
+    double getPlaybackTime() const { return m_playback_time.load(std::memory_order_relaxed); }
+
+    Stats getStats() const;
+
+    const Config &getConfig() const { return m_config; }
+
+private:
+    struct Chunk {
+        std::vector<int16_t> samples;
+        double pts;
+    };
+
+    static constexpr int kChannels = 2;
+
+    std::shared_ptr<AudioDevice> m_device {};
+    Config m_config {};
+    int m_sample_rate {};
+
+    std::vector<Chunk> m_chunks {};
+    SpscQueue<Chunk *> m_free_chunks;
+    SpscQueue<Chunk *> m_filled_chunks;
+
+    // Resample thread state.
+    FrameSource m_source {};
+    EndOfSource m_at_end {};
+    AVRational m_time_base {};
+    SwrContext *m_swr {};
+    int m_swr_format {-1};
+    int m_swr_rate {};
+    int m_swr_channels {};
+    Chunk *m_current_chunk {};
+    int m_current_filled {};
+    double m_next_sample_time {};
+    bool m_drained {true};  // nothing is held back in swr or the current chunk since the last drain
+
+    // Output thread state.
+    ALuint m_source_id {};
+    std::vector<ALuint> m_buffers {};
+    std::vector<ALuint> m_free_buffers {};
+    std::vector<ALuint> m_queued_buffers {};  // in source queue order
+    std::vector<double> m_buffer_pts {};  // indexed like m_buffers
+    bool m_started {false};
+
+    std::atomic<bool> m_paused {false};
+    std::atomic<double> m_playback_time;
+    std::atomic<uint64_t> m_underruns {0};
+    std::atomic<uint64_t> m_buffers_queued {0};
+    std::atomic<int> m_al_queued_samples {0};
+
+    std::jthread m_resample_thread {};
+    std::jthread m_output_thread {};
+
+    AudioOutput(std::shared_ptr<AudioDevice> device, const Config &config);
+
+    void resampleLoop(std::stop_token stop);
+    bool resample(const AVFrame *frame, const std::stop_token &stop);
+    bool convert(const uint8_t **in, int in_count, const std::stop_token &stop);
+    bool drain(const std::stop_token &stop);
+    void publishChunk();
+
+    void outputLoop(std::stop_token stop);
+    void refill();
+
+    size_t bufferIndex(ALuint buffer) const;
+};
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "atomic_file.h"
+
+#include <cerrno>
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool writeFileAtomically(const std::filesystem::path &path, const void *data, size_t size, std::error_code &ec) {
+    ec.clear();
+    std::string temp_path = path.string() + ".XXXXXX";
+    int fd = mkostemp(temp_path.data(), O_CLOEXEC);
+    if (fd < 0) {
+        ec = std::error_code {errno, std::generic_category()};
+        return false;
+    }
+    // mkstemp creates the file readable by the owner only; cached files are shared like ones written normally.
+    fchmod(fd, 0644);
+
+    auto bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        const ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec = std::error_code {errno, std::generic_category()};
+            break;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    if (::close(fd) != 0 && !ec) {
+        ec = std::error_code {errno, std::generic_category()};
+    }
+    if (!ec) {
+        std::filesystem::rename(temp_path, path, ec);
+    }
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temp_path, ignored);
+        return false;
+    }
+    return true;
+}
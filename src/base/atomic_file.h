@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+
+/**
+ *  @brief Writes `size` bytes to `path` through a uniquely named temporary file next to it, then renames it over
+ *         `path`.
+ *
+ *  Readers see either the previous file or the complete new one, never a partial write. The temporary name comes
+ *  from `mkstemp`, so writers in other threads or processes each have their own file and the last rename wins.
+ *  The temporary file is removed if anything fails.
+ *
+ *  @return false with `ec` set if the file could not be written.
+ */
+bool writeFileAtomically(const std::filesystem::path &path, const void *data, size_t size, std::error_code &ec);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+// Apple silicon uses 128-byte cache lines; everything else we target uses 64.
+#if defined(__APPLE__) && defined(__aarch64__)
+inline constexpr std::size_t kCacheLineSize = 128;
+#else
+inline constexpr std::size_t kCacheLineSize = 64;
+#endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/noncopyable.h"
+
+template<typename Signature, size_t Capacity = 64>
+class Delegate;
+
+/**
+ *  @class Delegate
+ *
+ *  @brief Move-only callable wrapper that always stores the callable inline, in `Capacity` bytes.
+ *
+ *  Unlike `std::function` it never allocates: a callable that does not fit is a compile error rather than a
+ *  heap fallback. Lambdas capturing a handful of references or pointers fit the default capacity.
+ *
+ *  @note Calling an empty delegate is undefined; check with `operator bool` first.
+ */
+template<typename R, typename... Args, size_t Capacity>
+class Delegate<R(Args...), Capacity> {
+public:
+    NONCOPYABLE(Delegate)
+
+    Delegate() = default;
+
+    template<typename F>
+        requires(!std::is_same_v<std::decay_t<F>, Delegate> && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>)
+    Delegate(F &&func) {
+        using T = std::decay_t<F>;
+        static_assert(sizeof(T) <= Capacity, "callable does not fit the delegate, capture less or by pointer");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned callable");
+        static_assert(std::is_nothrow_move_constructible_v<T>, "callable must be nothrow movable");
+        ::new (static_cast<void *>(m_storage)) T(std::forward<F>(func));
+        m_ops = &kOps<T>;
+    }
+
+    Delegate(Delegate &&other) noexcept { moveFrom(other); }
+
+    Delegate &operator=(Delegate &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~Delegate() { reset(); }
+
+    void reset() {
+        if (m_ops) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    explicit operator bool() const { return m_ops != nullptr; }
+
+    // Const like std::function: the stored callable itself may be mutable.
+    R operator()(Args... args) const {
+        return m_ops->invoke(const_cast<std::byte *>(m_storage), std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*move)(void *dst, void *src);
+        void (*destroy)(void *storage);
+    };
+
+    template<typename T>
+    static constexpr Ops kOps {
+        [](void *storage, Args &&...args) -> R {
+            return std::invoke(*static_cast<T *>(storage), std::forward<Args>(args)...);
+        },
+        [](void *dst, void *src) {
+            ::new (dst) T(std::move(*static_cast<T *>(src)));
+            static_cast<T *>(src)->~T();
+        },
+        [](void *storage) { static_cast<T *>(storage)->~T(); },
+    };
+
+    alignas(std::max_align_t) std::byte m_storage[Capacity];
+    const Ops *m_ops {};
+
+    void moveFrom(Delegate &other) {
+        if (other.m_ops) {
+            other.m_ops->move(m_storage, other.m_storage);
+            m_ops = std::exchange(other.m_ops, nullptr);
+        }
+    }
+};
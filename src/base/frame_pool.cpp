@@ -0,0 +1,249 @@
+#include "frame_pool.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "log/log_system.h"
+
+namespace {
+
+// Plane start and stride alignment; covers the widest SIMD (AVX-512) libavcodec may use.
+constexpr size_t kAlign = 64;
+
+// libavcodec may read up to this many bytes past the end of a plane.
+constexpr size_t kPlanePadding = 16 + kAlign - 1;
+
+constexpr size_t alignUp(size_t value, size_t align) { return (value + align - 1) & ~(align - 1); }
+
+}  // namespace
+
+AVObjectPool::AVObjectPool() {
+    m_frames.reserve(kMaxRetained);
+    m_packets.reserve(kMaxRetained);
+}
+
+AVObjectPool::~AVObjectPool() {
+    for (auto frame : m_frames) {
+        av_frame_free(&frame);
+    }
+    for (auto packet : m_packets) {
+        av_packet_free(&packet);
+    }
+}
+
+AVFrame *AVObjectPool::acquireFrame() {
+    {
+        std::lock_guard lock {m_mutex};
+        if (!m_frames.empty()) {
+            AVFrame *frame = m_frames.back();
+            m_frames.pop_back();
+            return frame;
+        }
+    }
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    return av_frame_alloc();
+}
+
+void AVObjectPool::releaseFrame(AVFrame *frame) {
+    if (!frame) {
+        return;
+    }
+
+    // Unreferencing outside the lock: it may run a buffer release callback that takes other locks.
+    av_frame_unref(frame);
+    {
+        std::lock_guard lock {m_mutex};
+        if (m_frames.size() < kMaxRetained) {
+            m_frames.push_back(frame);
+            return;
+        }
+    }
+    av_frame_free(&frame);
+}
+
+AVPacket *AVObjectPool::acquirePacket() {
+    {
+        std::lock_guard lock {m_mutex};
+        if (!m_packets.empty()) {
+            AVPacket *packet = m_packets.back();
+            m_packets.pop_back();
+            return packet;
+        }
+    }
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    return av_packet_alloc();
+}
+
+void AVObjectPool::releasePacket(AVPacket *packet) {
+    if (!packet) {
+        return;
+    }
+
+    av_packet_unref(packet);
+    {
+        std::lock_guard lock {m_mutex};
+        if (m_packets.size() < kMaxRetained) {
+            m_packets.push_back(packet);
+            return;
+        }
+    }
+    av_packet_free(&packet);
+}
+
+FrameBufferPool::FrameBufferPool(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+FrameBufferPool::~FrameBufferPool() {
+    for (auto &[key, blocks] : m_free) {
+        for (auto block : blocks) {
+            av_free(block->data);
+            delete block;
+        }
+    }
+    DEBUG("release FrameBufferPool: {}", (void *)this);
+}
+
+std::shared_ptr<FrameBufferPool> FrameBufferPool::create(size_t max_bytes) {
+    return std::shared_ptr<FrameBufferPool> {new FrameBufferPool {max_bytes}};
+}
+
+void FrameBufferPool::attach(AVCodecContext *ctx) {
+    if (!ctx->codec || !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)) {
+        DEBUG("decoder does not support custom buffers, not using FrameBufferPool");
+        return;
+    }
+    ctx->opaque = this;
+    ctx->get_buffer2 = getBuffer2;
+}
+
+FrameBufferPool::Stats FrameBufferPool::getStats() const {
+    std::lock_guard lock {m_mutex};
+    return {m_allocations, m_reuses, m_evictions, m_cap_rejections, m_bytes_in_use, m_bytes_pooled};
+}
+
+FrameBufferPool::Block *FrameBufferPool::acquireBlock(const Key &key, size_t size) {
+    std::lock_guard lock {m_mutex};
+
+    auto &free_list = m_free[key];
+    while (!free_list.empty()) {
+        Block *block = free_list.back();
+        free_list.pop_back();
+        m_bytes_pooled -= block->size;
+
+        if (block->size >= size) {
+            ++m_reuses;
+            m_bytes_in_use += block->size;
+            block->owner = shared_from_this();
+            return block;
+        }
+        // Same resolution but a different decoder alignment; not reusable.
+        av_free(block->data);
+        delete block;
+    }
+
+    if (!evictFor(size)) {
+        ++m_cap_rejections;
+        return nullptr;
+    }
+
+    auto data = static_cast<uint8_t *>(av_malloc(size));
+    if (!data) {
+        return nullptr;
+    }
+    ++m_allocations;
+    m_bytes_in_use += size;
+    return new Block {data, size, key, shared_from_this()};
+}
+
+void FrameBufferPool::recycle(Block *block) {
+    // Keeps the pool alive until the lock below is released, even if this was the last outstanding buffer.
+    auto self = std::move(block->owner);
+
+    std::lock_guard lock {m_mutex};
+    m_bytes_in_use -= block->size;
+    m_bytes_pooled += block->size;
+    m_free[block->key].push_back(block);
+}
+
+bool FrameBufferPool::evictFor(size_t size) {
+    for (auto &[key, blocks] : m_free) {
+        while (m_bytes_in_use + m_bytes_pooled + size > m_max_bytes && !blocks.empty()) {
+            Block *block = blocks.back();
+            blocks.pop_back();
+            m_bytes_pooled -= block->size;
+            av_free(block->data);
+            delete block;
+            ++m_evictions;
+        }
+    }
+    return m_bytes_in_use + m_bytes_pooled + size <= m_max_bytes;
+}
+
+int FrameBufferPool::getBuffer(AVCodecContext *ctx, AVFrame *frame, int flags) {
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    if (ctx->codec_type != AVMEDIA_TYPE_VIDEO || !desc ||
+        (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    int width = frame->width;
+    int height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+
+    int linesizes[4] {};
+    int ret = av_image_fill_linesizes(linesizes, format, width);
+    if (ret < 0) {
+        return ret;
+    }
+    ptrdiff_t strides[4] {};
+    for (int i = 0; i < 4; ++i) {
+        linesizes[i] = static_cast<int>(alignUp(linesizes[i], kAlign));
+        strides[i] = linesizes[i];
+    }
+
+    size_t plane_sizes[4] {};
+    ret = av_image_fill_plane_sizes(plane_sizes, format, height, strides);
+    if (ret < 0) {
+        return ret;
+    }
+
+    size_t total = 0;
+    for (auto plane_size : plane_sizes) {
+        if (plane_size) {
+            total += alignUp(plane_size + kPlanePadding, kAlign);
+        }
+    }
+
+    Block *block = acquireBlock({format, frame->width, frame->height}, total);
+    if (!block) {
+        WARN("frame buffer pool exhausted ({} bytes cap)", m_max_bytes);
+        return AVERROR(ENOMEM);
+    }
+
+    frame->buf[0] = av_buffer_create(block->data, block->size, releaseBuffer, block, 0);
+    if (!frame->buf[0]) {
+        recycle(block);
+        return AVERROR(ENOMEM);
+    }
+
+    uint8_t *ptr = block->data;
+    for (int i = 0; i < 4 && plane_sizes[i]; ++i) {
+        frame->data[i] = ptr;
+        frame->linesize[i] = linesizes[i];
+        ptr += alignUp(plane_sizes[i] + kPlanePadding, kAlign);
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+int FrameBufferPool::getBuffer2(AVCodecContext *ctx, AVFrame *frame, int flags) {
+    return static_cast<FrameBufferPool *>(ctx->opaque)->getBuffer(ctx, frame, flags);
+}
+
+void FrameBufferPool::releaseBuffer(void *opaque, uint8_t *data) {
+    auto block = static_cast<Block *>(opaque);
+    block->owner->recycle(block);
+}
\ No newline at end of file
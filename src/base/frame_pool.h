@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/singleton.h"
+
+/**
+ *  @class AVObjectPool
+ *
+ *  @brief Recycles AVFrame and AVPacket structs so the pipeline does not allocate one per frame or packet.
+ *
+ *  Released objects are unreferenced and kept on a bounded free list; `AVFramePtr` and `AVPacketPtr` return
+ *  their objects here instead of freeing them.
+ *
+ *  @note Thread-safe.
+ */
+class AVObjectPool : public Singleton<AVObjectPool> {
+    friend Singleton<AVObjectPool>;
+
+public:
+    virtual ~AVObjectPool();
+
+    AVFrame *acquireFrame();
+    void releaseFrame(AVFrame *frame);
+
+    AVPacket *acquirePacket();
+    void releasePacket(AVPacket *packet);
+
+    /**
+     *  @return How many AVFrame/AVPacket structs had to be allocated because the free list was empty.
+     */
+    uint64_t getAllocationCount() const { return m_allocations.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kMaxRetained = 512;
+
+    std::mutex m_mutex {};
+    std::vector<AVFrame *> m_frames {};
+    std::vector<AVPacket *> m_packets {};
+
+    std::atomic<uint64_t> m_allocations {0};
+
+    AVObjectPool();
+};
+
+/**
+ *  @class FrameBufferPool
+ *
+ *  @brief Pixel buffer allocator for libavcodec with per-resolution free lists and a hard memory cap.
+ *
+ *  `attach` installs a custom `get_buffer2` on a video decoder. Each frame gets one pre-sized, reference-counted
+ *  block holding all planes; when the last reference is dropped (by the decoder or any consumer, on any thread)
+ *  the block goes back to the free list for its format and resolution instead of to the heap.
+ *
+ *  When a new block would exceed the cap, free blocks of other resolutions are released first; if that is not
+ *  enough the allocation fails with AVERROR(ENOMEM), so the cap must cover the decoder's reference frames plus
+ *  every frame queued downstream.
+ *
+ *  @note Thread-safe. Outstanding buffers keep the pool alive.
+ */
+class FrameBufferPool : public std::enable_shared_from_this<FrameBufferPool> {
+public:
+    NONCOPYABLE(FrameBufferPool)
+    NONMOVABLE(FrameBufferPool)
+
+    struct Stats {
+        uint64_t allocations;     // blocks taken from the heap
+        uint64_t reuses;          // blocks served from a free list
+        uint64_t evictions;       // free blocks released to stay under the cap
+        uint64_t cap_rejections;  // requests refused because of the cap
+        size_t bytes_in_use;
+        size_t bytes_pooled;
+    };
+
+    ~FrameBufferPool();
+
+    static std::shared_ptr<FrameBufferPool> create(size_t max_bytes);
+
+    /**
+     *  @brief Makes `ctx` allocate frames from this pool.
+     *
+     *  @note Must be called before `avcodec_open2`. Does nothing for decoders without AV_CODEC_CAP_DR1.
+     */
+    void attach(AVCodecContext *ctx);
+
+    Stats getStats() const;
+
+    size_t getMaxBytes() const { return m_max_bytes; }
+
+private:
+    using Key = std::tuple<int, int, int>;  // format, width, height
+
+    struct Block {
+        uint8_t *data;
+        size_t size;
+        Key key;
+        std::shared_ptr<FrameBufferPool> owner;  // set while handed out
+    };
+
+    const size_t m_max_bytes;
+
+    mutable std::mutex m_mutex {};
+    std::map<Key, std::vector<Block *>> m_free {};
+    size_t m_bytes_in_use {};
+    size_t m_bytes_pooled {};
+
+    uint64_t m_allocations {};
+    uint64_t m_reuses {};
+    uint64_t m_evictions {};
+    uint64_t m_cap_rejections {};
+
+    explicit FrameBufferPool(size_t max_bytes);
+
+    Block *acquireBlock(const Key &key, size_t size);
+    void recycle(Block *block);
+    bool evictFor(size_t size);
+
+    int getBuffer(AVCodecContext *ctx, AVFrame *frame, int flags);
+
+    static int getBuffer2(AVCodecContext *ctx, AVFrame *frame, int flags);
+    static void releaseBuffer(void *opaque, uint8_t *data);
+};
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+inline constexpr uint64_t kFnv1aOffset = 0xcbf29ce484222325ull;
+
+/**
+ *  @brief 64-bit FNV-1a. Unlike `std::hash`, its values are specified, so they can name files that outlive a build
+ *         or are shared between builds.
+ *
+ *  @param hash The hash of what comes before `data`, to hash several pieces as if they were one.
+ */
+constexpr uint64_t fnv1a64(std::string_view data, uint64_t hash = kFnv1aOffset) {
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  @class Histogram
+ *
+ *  @brief Fixed-width buckets for timing distributions; adding a value is constant time and never allocates.
+ *
+ *  Values past the last bucket are counted in it; percentiles falling there report the exact maximum.
+ */
+class Histogram {
+public:
+    Histogram(double bucket_width, size_t bucket_count) : m_width(bucket_width), m_buckets(bucket_count) {}
+
+    void add(double value) {
+        value = std::max(value, 0.0);
+        const auto bucket = static_cast<size_t>(value / m_width);
+        ++m_buckets[std::min(bucket, m_buckets.size() - 1)];
+        ++m_count;
+        m_sum += value;
+        m_max = std::max(m_max, value);
+    }
+
+    void reset() {
+        std::fill(m_buckets.begin(), m_buckets.end(), 0);
+        m_count = 0;
+        m_sum = 0;
+        m_max = 0;
+    }
+
+    uint64_t getCount() const { return m_count; }
+    double getMean() const { return m_count ? m_sum / m_count : 0.0; }
+    double getMax() const { return m_max; }
+
+    /**
+     *  @return The upper edge of the bucket holding the `fraction` quantile (0..1), at most the maximum; 0 if
+     *          empty.
+     */
+    double getPercentile(double fraction) const {
+        if (m_count == 0) {
+            return 0.0;
+        }
+        const auto rank = static_cast<uint64_t>(std::clamp(fraction, 0.0, 1.0) * (m_count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if (seen >= rank) {
+                return std::min((i + 1) * m_width, m_max);
+            }
+        }
+        return m_max;
+    }
+
+private:
+    double m_width;
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count {};
+    double m_sum {};
+    double m_max {};
+};
@@ -0,0 +1,356 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <string>
+
+#include <pthread.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#endif
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+namespace {
+
+// Rounds of yielding before an idle worker sleeps; waking a sleeper costs far more than a few yields.
+constexpr int kSpinsBeforeSleep = 64;
+
+// Tasks run by a waiting thread nest on its stack; past this depth a waiter blocks instead of helping.
+constexpr int kMaxHelpDepth = 16;
+
+thread_local const JobSystem *t_owner {};
+thread_local int t_worker_index {-1};
+thread_local int t_help_depth {0};
+
+uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+}  // namespace
+
+JobSystem::Config JobSystem::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.workers = config_manager->getIntValue("jobs", "workers", config.workers);
+    config.pin_threads = config_manager->getIntValue("jobs", "pin_threads", config.pin_threads) != 0;
+    return config;
+}
+
+JobSystem::~JobSystem() { shutdown(); }
+
+void JobSystem::initialize(const Config &config) {
+    shutdown();
+
+    int count = config.workers > 0 ? config.workers : static_cast<int>(std::thread::hardware_concurrency());
+    count = std::max(1, count);
+    {
+        std::unique_lock lock {m_workers_mutex};
+        for (int i = 0; i < count; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->rng_state = 0x9e3779b9u * (i + 1);
+            m_workers.push_back(std::move(worker));
+        }
+    }
+    {
+        std::scoped_lock lock {m_injection_mutex, m_sleep_mutex};
+        m_stopping = false;
+    }
+    // Started only once every worker exists, since they steal from each other.
+    for (int i = 0; i < count; ++i) {
+        m_workers[i]->thread = std::jthread([this, i, pin = config.pin_threads] { workerLoop(i, pin); });
+    }
+    DEBUG("job system: {} workers{}", count, config.pin_threads ? ", pinned" : "");
+}
+
+void JobSystem::shutdown() {
+    if (m_workers.empty()) {
+        return;
+    }
+    {
+        // From here on nothing is injected, so the workers run out of tasks and stop.
+        std::scoped_lock lock {m_injection_mutex, m_sleep_mutex};
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    for (auto &worker : m_workers) {
+        worker->thread.join();
+    }
+    logStats();
+    {
+        std::unique_lock lock {m_workers_mutex};
+        m_workers.clear();
+    }
+    m_injected = 0;
+    m_helped = 0;
+}
+
+void JobSystem::submit(std::function<void()> task) { enqueue(new Task {std::move(task), nullptr}); }
+
+bool JobSystem::runOne() {
+    Worker *self = nullptr;
+    Task *task = nullptr;
+    if (t_owner == this) {
+        self = m_workers[t_worker_index].get();
+        task = findTask(self);
+    } else {
+        std::shared_lock lock {m_workers_mutex};
+        task = findTask(nullptr);
+    }
+    if (!task) {
+        return false;
+    }
+    execute(task);
+    if (self) {
+        self->executed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_helped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+int JobSystem::getCurrentWorkerIndex() const { return t_owner == this ? t_worker_index : -1; }
+
+JobSystem::Stats JobSystem::getStats() const {
+    Stats stats {};
+    for (const auto &worker : m_workers) {
+        stats.executed += worker->executed.load(std::memory_order_relaxed);
+        stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+        stats.sleeps += worker->sleeps.load(std::memory_order_relaxed);
+    }
+    stats.injected = m_injected.load(std::memory_order_relaxed);
+    stats.helped = m_helped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void JobSystem::logStats() const {
+    auto stats = getStats();
+    INFO("job system: {} tasks on {} workers, {} stolen, {} injected, {} run by waiters, {} sleeps",
+         stats.executed,
+         m_workers.size(),
+         stats.stolen,
+         stats.injected,
+         stats.helped,
+         stats.sleeps);
+}
+
+void JobSystem::enqueue(Task *task) {
+    // Counted before it becomes visible, so a worker that finds it never drives the count negative.
+    if (t_owner == this) {
+        // A worker and its deque live until shutdown() has joined it.
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        m_workers[t_worker_index]->deque.push(task);
+    } else {
+        std::unique_lock lock {m_injection_mutex};
+        // Not started or shutting down: the workers may be gone before they would get to it.
+        if (m_stopping.load(std::memory_order_relaxed)) {
+            lock.unlock();
+            execute(task);
+            return;
+        }
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        m_injection_queue.push_back(task);
+        m_injected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Pairs with the sleeping check in workerLoop: either the worker sees the task or we see the sleeper.
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard lock {m_sleep_mutex};
+        m_wakeup.notify_one();
+    }
+}
+
+JobSystem::Task *JobSystem::findTask(Worker *self) {
+    if (self) {
+        if (auto task = self->deque.pop()) {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return *task;
+        }
+    }
+
+    {
+        std::unique_lock lock {m_injection_mutex, std::try_to_lock};
+        if (lock && !m_injection_queue.empty()) {
+            Task *task = m_injection_queue.front();
+            m_injection_queue.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    static thread_local uint32_t t_rng_state = 0x2545f491u;
+    const size_t count = m_workers.size();
+    if (count == 0) {
+        return nullptr;
+    }
+    const size_t start = xorshift(self ? self->rng_state : t_rng_state) % count;
+    for (size_t i = 0; i < count; ++i) {
+        Worker *victim = m_workers[(start + i) % count].get();
+        if (victim == self) {
+            continue;
+        }
+        if (auto task = victim->deque.steal()) {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            if (self) {
+                self->stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            return *task;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Task *task) {
+    TaskGroup *group = task->group;
+    try {
+        task->function();
+    } catch (const std::exception &e) {
+        ERROR("task failed: {}", e.what());
+    }
+    // Captures are destroyed before the group is told, so a waiter never outlives what its tasks hold.
+    delete task;
+    if (group) {
+        group->finish();
+    }
+}
+
+void JobSystem::workerLoop(int index, bool pin) {
+    Tracer::get()->setThreadName("job worker " + std::to_string(index));
+    if (pin) {
+        pinCurrentThread(index);
+    }
+    t_owner = this;
+    t_worker_index = index;
+    Worker *self = m_workers[index].get();
+
+    int idle_spins = 0;
+    while (true) {
+        if (Task *task = findTask(self)) {
+            execute(task);
+            self->executed.fetch_add(1, std::memory_order_relaxed);
+            idle_spins = 0;
+            continue;
+        }
+        if (m_stopping.load(std::memory_order_acquire) && m_queued.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+        if (++idle_spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        idle_spins = 0;
+        std::unique_lock lock {m_sleep_mutex};
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (m_queued.load(std::memory_order_seq_cst) == 0 && !m_stopping) {
+            self->sleeps.fetch_add(1, std::memory_order_relaxed);
+            m_wakeup.wait(lock, [this] { return m_queued.load(std::memory_order_seq_cst) > 0 || m_stopping; });
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    t_owner = nullptr;
+    t_worker_index = -1;
+}
+
+void JobSystem::pinCurrentThread(int core) {
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        WARN("failed to pin job worker to core {}: {}", core % cores, ret);
+    }
+#elif defined(__APPLE__)
+    // macOS has no hard affinity; distinct affinity tags ask the scheduler to keep workers on different cores.
+    thread_affinity_policy_data_t policy {core % cores + 1};
+    kern_return_t ret = thread_policy_set(pthread_mach_thread_np(pthread_self()),
+                                          THREAD_AFFINITY_POLICY,
+                                          reinterpret_cast<thread_policy_t>(&policy),
+                                          THREAD_AFFINITY_POLICY_COUNT);
+    if (ret != KERN_SUCCESS) {
+        DEBUG("thread affinity is not supported here: {}", ret);
+    }
+#else
+    WARN("pinning job workers is not supported on this platform");
+#endif
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    m_jobs->enqueue(new JobSystem::Task {std::move(task), this});
+}
+
+void TaskGroup::then(std::function<void()> continuation) {
+    {
+        std::lock_guard lock {m_mutex};
+        if (m_pending.load(std::memory_order_acquire) != 0) {
+            m_continuation = std::move(continuation);
+            return;
+        }
+        m_pending.store(1, std::memory_order_relaxed);
+    }
+    // Outside the lock: without workers the continuation runs inline and finishes on this thread.
+    m_jobs->enqueue(new JobSystem::Task {std::move(continuation), this});
+}
+
+void TaskGroup::wait() {
+    while (true) {
+        if (m_pending.load(std::memory_order_acquire) == 0) {
+            // Zero is only ever stored under the lock, so once we hold it the last finisher is done with us.
+            std::lock_guard lock {m_mutex};
+            if (m_pending.load(std::memory_order_acquire) == 0 && !m_continuation) {
+                return;
+            }
+        }
+        if (t_help_depth < kMaxHelpDepth) {
+            ++t_help_depth;
+            const bool ran = m_jobs->runOne();
+            --t_help_depth;
+            if (ran) {
+                continue;
+            }
+        }
+        // Bounded, since tasks queued by other threads while we sleep would otherwise wait for a worker.
+        std::unique_lock lock {m_mutex};
+        m_done.wait_for(lock, std::chrono::milliseconds(1), [this] {
+            return m_pending.load(std::memory_order_acquire) == 0 && !m_continuation;
+        });
+    }
+}
+
+void TaskGroup::finish() {
+    // Only the decrement that could reach zero takes the lock.
+    int64_t pending = m_pending.load(std::memory_order_relaxed);
+    while (pending > 1) {
+        if (m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+
+    std::function<void()> continuation;
+    {
+        std::lock_guard lock {m_mutex};
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        if (!m_continuation) {
+            m_done.notify_all();
+            return;
+        }
+        // The continuation takes over the finished task's count, so waiters keep waiting.
+        m_pending.store(1, std::memory_order_relaxed);
+        continuation = std::move(m_continuation);
+        m_continuation = nullptr;
+    }
+    m_jobs->enqueue(new JobSystem::Task {std::move(continuation), this});
+}
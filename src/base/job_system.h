@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "base/cache_line.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/singleton.h"
+#include "base/work_stealing_deque.h"
+
+class TaskGroup;
+
+/**
+ *  @class JobSystem
+ *
+ *  @brief Process-wide work-stealing thread pool for short, CPU-bound tasks.
+ *
+ *  Every worker owns a Chase-Lev deque. Tasks submitted from a worker go to the bottom of its own deque and are
+ *  run newest first, which keeps recursively split work cache-warm; idle workers steal the oldest task from a
+ *  random victim. Tasks submitted from other threads go through a shared injection queue. Workers with nothing
+ *  to run or steal sleep until new work arrives.
+ *
+ *  Long-lived loops (demuxing, decoding, prefetching) keep their own threads; a blocked task holds a worker.
+ *
+ *  @note Thread-safe. Tasks submitted before `initialize`, or from outside the pool once `shutdown` has begun, run
+ *        inline on the caller.
+ */
+class JobSystem : public Singleton<JobSystem> {
+    friend Singleton<JobSystem>;
+
+public:
+    struct Config {
+        int workers {0};           // 0 uses every hardware thread
+        bool pin_threads {false};  // pins worker i to core i; a scheduling hint where hard affinity is unavailable
+
+        /**
+         *  @brief Reads the `[jobs]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t executed;  // tasks run by workers
+        uint64_t stolen;    // of which taken from another worker's deque
+        uint64_t injected;  // submitted from outside the pool
+        uint64_t helped;    // tasks run by threads waiting on a TaskGroup
+        uint64_t sleeps;    // times a worker went to sleep for lack of work
+    };
+
+    virtual ~JobSystem();
+
+    /**
+     *  @brief Starts the workers. Calling it again restarts them with the new config.
+     */
+    void initialize(const Config &config = Config::fromConfigManager());
+
+    /**
+     *  @brief Runs every queued task, then stops and joins the workers.
+     *
+     *  @note Tasks submitted meanwhile from other threads, e.g. a TaskGroup rescheduling itself, run inline there.
+     */
+    void shutdown();
+
+    /**
+     *  @brief Queues `task` without tracking its completion.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     *  @brief Runs one queued task on the calling thread, if there is one.
+     *
+     *  @return false if no task was found.
+     */
+    bool runOne();
+
+    int getWorkerCount() const { return static_cast<int>(m_workers.size()); }
+
+    /**
+     *  @return The index of the calling worker thread, or -1 if the caller is not one of the workers.
+     */
+    int getCurrentWorkerIndex() const;
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    struct Task {
+        std::function<void()> function;
+        TaskGroup *group;
+    };
+
+    struct alignas(kCacheLineSize) Worker {
+        WorkStealingDeque<Task *> deque {};
+        uint32_t rng_state {};
+        std::atomic<uint64_t> executed {0};
+        std::atomic<uint64_t> stolen {0};
+        std::atomic<uint64_t> sleeps {0};
+        std::jthread thread {};
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers {};
+    // Held shared by threads outside the pool while they steal, so shutdown() does not release a worker under them.
+    std::shared_mutex m_workers_mutex {};
+
+    std::mutex m_injection_mutex {};
+    std::deque<Task *> m_injection_queue {};
+
+    // Queued and not yet taken, across every deque and the injection queue; workers sleep while it is zero.
+    std::atomic<int64_t> m_queued {0};
+    std::atomic<int> m_sleeping {0};
+    std::atomic<bool> m_stopping {true};  // until initialize, and from shutdown on; changed under both mutexes
+    std::mutex m_sleep_mutex {};
+    std::condition_variable m_wakeup {};
+
+    std::atomic<uint64_t> m_injected {0};
+    std::atomic<uint64_t> m_helped {0};
+
+    JobSystem() = default;
+
+    void enqueue(Task *task);
+    Task *findTask(Worker *self);
+    void execute(Task *task);
+    void workerLoop(int index, bool pin);
+
+    static void pinCurrentThread(int core);
+
+    friend TaskGroup;
+};
+
+/**
+ *  @class TaskGroup
+ *
+ *  @brief Tracks a set of tasks so a caller can wait for all of them or chain a continuation after them.
+ *
+ *  A thread waiting on a group runs queued tasks in the meantime, so groups can be waited on from inside tasks
+ *  (fork-join) without starving the pool.
+ *
+ *  @note `run`, `then` and `wait` may be called from any thread. The destructor waits.
+ */
+class TaskGroup {
+public:
+    NONCOPYABLE(TaskGroup)
+    NONMOVABLE(TaskGroup)
+
+    explicit TaskGroup(JobSystem *jobs = JobSystem::get()) : m_jobs(jobs) {}
+    ~TaskGroup() { wait(); }
+
+    void run(std::function<void()> task);
+
+    /**
+     *  @brief Queues `continuation` once every task run so far has finished; at once if none is pending.
+     *
+     *  The continuation belongs to the group: `wait` returns only after it has run, and it may itself call `run`
+     *  or `then` on the group. Only one continuation can be pending at a time; a second call replaces it.
+     */
+    void then(std::function<void()> continuation);
+
+    /**
+     *  @brief Blocks until every task and continuation of the group has finished, running queued tasks meanwhile.
+     */
+    void wait();
+
+private:
+    JobSystem *m_jobs;
+    std::atomic<int64_t> m_pending {0};
+    std::mutex m_mutex {};
+    std::condition_variable m_done {};
+    std::function<void()> m_continuation {};
+
+    // Called by the job system after each of the group's tasks.
+    void finish();
+
+    friend JobSystem;
+};
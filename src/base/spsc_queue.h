@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "base/cache_line.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+/**
+ *  @class SpscQueue
+ *
+ *  @brief Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ *  @note `tryPush` must only be called from one producer thread and `tryPop` from one consumer thread.
+ *        `size` may be called from any thread and returns an approximate value.
+ */
+template<typename T>
+class SpscQueue {
+public:
+    NONCOPYABLE(SpscQueue)
+    NONMOVABLE(SpscQueue)
+
+    explicit SpscQueue(size_t capacity) : m_slots(capacity + 1), m_buffer(new Slot[capacity + 1]) {}
+
+    ~SpscQueue() {
+        while (tryPop()) {
+        }
+    }
+
+    bool tryPush(T &&value) { return emplace(std::move(value)); }
+    bool tryPush(const T &value) { return emplace(value); }
+
+    template<typename... Args>
+    bool emplace(Args &&...args) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = increment(tail);
+        if (next == m_head_cache) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (next == m_head_cache) {
+                return false;
+            }
+        }
+        new (m_buffer[tail].storage) T(std::forward<Args>(args)...);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> tryPop() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return std::nullopt;
+            }
+        }
+        T *slot = std::launder(reinterpret_cast<T *>(m_buffer[head].storage));
+        std::optional<T> value {std::move(*slot)};
+        slot->~T();
+        m_head.store(increment(head), std::memory_order_release);
+        return value;
+    }
+
+    /**
+     *  @brief Returns a pointer to the oldest element without removing it, or nullptr when empty.
+     *
+     *  @note Consumer side only. The pointer stays valid until the next `tryPop`.
+     */
+    T *front() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return nullptr;
+            }
+        }
+        return std::launder(reinterpret_cast<T *>(m_buffer[head].storage));
+    }
+
+    size_t size() const {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : tail + m_slots - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return m_slots - 1; }
+
+private:
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    const size_t m_slots;
+    std::unique_ptr<Slot[]> m_buffer;
+
+    // Producer and consumer indices live on separate cache lines, each next to a cached copy of the
+    // other side's index so the common case touches no shared line.
+    alignas(kCacheLineSize) std::atomic<size_t> m_tail {0};
+    size_t m_head_cache {0};
+
+    alignas(kCacheLineSize) std::atomic<size_t> m_head {0};
+    size_t m_tail_cache {0};
+
+    size_t increment(size_t index) const { return index + 1 == m_slots ? 0 : index + 1; }
+};
\ No newline at end of file
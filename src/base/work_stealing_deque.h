@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "base/cache_line.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+/**
+ *  @class WorkStealingDeque
+ *
+ *  @brief Unbounded lock-free Chase-Lev deque: the owner pushes and pops at the bottom, thieves steal at the top.
+ *
+ *  Follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., 2013). The ring doubles when
+ *  full; replaced rings are kept until the deque is destroyed, since a thief may still be reading one.
+ *
+ *  @note `push` and `pop` must only be called from the owner thread; `steal` and `size` from any thread.
+ */
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "elements are copied racily and must be trivially copyable");
+
+public:
+    NONCOPYABLE(WorkStealingDeque)
+    NONMOVABLE(WorkStealingDeque)
+
+    explicit WorkStealingDeque(size_t capacity = 256) {
+        m_rings.push_back(std::make_unique<Ring>(std::bit_ceil(std::max<size_t>(capacity, 2))));
+        m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(T value) {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        Ring *ring = m_ring.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(ring->mask)) {
+            ring = grow(ring, top, bottom);
+        }
+        ring->store(bottom, value);
+        // The paper's release fence plus relaxed store, folded into one release store (also visible to TSan).
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    std::optional<T> pop() {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Ring *ring = m_ring.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T value = ring->load(bottom);
+        if (top == bottom) {
+            // Last element: race the thieves for it.
+            const bool won =
+                m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    std::optional<T> steal() {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return std::nullopt;
+        }
+        T value = m_ring.load(std::memory_order_acquire)->load(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    /**
+     *  @return An approximate element count.
+     */
+    size_t size() const {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Ring {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Ring(size_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+        T load(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void store(int64_t index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(kCacheLineSize) std::atomic<int64_t> m_top {0};
+    alignas(kCacheLineSize) std::atomic<int64_t> m_bottom {0};
+    std::atomic<Ring *> m_ring {};
+    std::vector<std::unique_ptr<Ring>> m_rings {};  // owner only; the last one is current
+
+    Ring *grow(Ring *ring, int64_t top, int64_t bottom) {
+        auto bigger = std::make_unique<Ring>((ring->mask + 1) * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->store(i, ring->load(i));
+        }
+        m_rings.push_back(std::move(bigger));
+        m_ring.store(m_rings.back().get(), std::memory_order_release);
+        return m_rings.back().get();
+    }
+};
@@ -1,5 +1,6 @@
 #include "config_manager.h"
 
+#include <charconv>
 #include <fstream>
 #include <stdexcept>
 
@@ -63,4 +64,18 @@ std::string ConfigManager::getValue(const std::string &section, const std::strin
     } else {
         return kv->second;
     }
+}
+
+long long ConfigManager::getIntValue(const std::string &section, const std::string &key, long long default_value) const {
+    std::string value = getValue(section, key);
+    if (value.empty()) {
+        return default_value;
+    }
+
+    long long result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc {} || ptr != value.data() + value.size()) {
+        return default_value;
+    }
+    return result;
 }
\ No newline at end of file
@@ -18,6 +18,11 @@ public:
 
     std::string getValue(const std::string &section, const std::string &key) const;
 
+    /**
+     *  @brief Reads an integer value, falling back to `default_value` when the key is missing or malformed.
+     */
+    long long getIntValue(const std::string &section, const std::string &key, long long default_value) const;
+
 private:
     std::filesystem::path m_config_file_path {};
 
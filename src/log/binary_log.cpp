@@ -0,0 +1,239 @@
+#include "binary_log.h"
+
+#include <algorithm>
+#include <bit>
+
+#include <spdlog/details/os.h>
+
+#include "config/config_manager.h"
+
+thread_local BinaryLog::ThreadBuffer BinaryLog::s_thread_owner {};
+
+BinaryLog::ThreadBuffer::~ThreadBuffer() {
+    // Records logged from later thread_local destructors are dropped instead of starting a new ring.
+    s_thread_exited = true;
+    s_thread_buffer = nullptr;
+    if (buffer) {
+        buffer->m_retired.store(true, std::memory_order_release);
+    }
+}
+
+BinaryLog::Buffer::Buffer(size_t thread_id, size_t capacity)
+    : m_thread_id(thread_id), m_data(capacity), m_mask(capacity - 1) {}
+
+std::byte *BinaryLog::Buffer::reserve(size_t size) {
+    const uint64_t capacity = m_data.size();
+    if (size > capacity / 2) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    const uint64_t offset = head & m_mask;
+    const uint64_t contiguous = capacity - offset;
+    // A record that does not fit before the end starts over at the beginning, behind a padding record.
+    const uint64_t needed = size <= contiguous ? size : contiguous + size;
+    if (head + needed - m_cached_tail > capacity) {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if (head + needed - m_cached_tail > capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    std::byte *out = m_data.data() + offset;
+    if (needed != size) {
+        // Records are 8-byte aligned, so there is always room for the size and the flag.
+        const auto padding_size = static_cast<uint32_t>(contiguous);
+        const bool padding = true;
+        std::memcpy(out, &padding_size, sizeof(padding_size));
+        std::memcpy(out + offsetof(RecordHeader, padding), &padding, sizeof(padding));
+        out = m_data.data();
+    }
+    m_reserved_head = head + needed;
+    return out;
+}
+
+bool BinaryLog::Buffer::commit() {
+    m_head.store(m_reserved_head, std::memory_order_release);
+    if (m_reserved_head - m_cached_tail <= m_data.size() / 2) {
+        return false;
+    }
+    // The cached tail may be from before the last drain.
+    m_cached_tail = m_tail.load(std::memory_order_acquire);
+    return m_reserved_head - m_cached_tail > m_data.size() / 2;
+}
+
+BinaryLog::Buffer *BinaryLog::createThreadBuffer() {
+    if (s_thread_exited) {
+        return nullptr;
+    }
+    std::lock_guard lock {m_buffers_mutex};
+    m_buffers.push_back(std::make_unique<Buffer>(spdlog::details::os::thread_id(), m_buffer_capacity));
+    s_thread_buffer = m_buffers.back().get();
+    s_thread_owner.buffer = s_thread_buffer;
+    return s_thread_buffer;
+}
+
+void BinaryLog::start(spdlog::logger *logger) {
+    auto config_manager = ConfigManager::get();
+    const long long level = config_manager->getIntValue("binlog", "level", m_level.load());
+    setLevel(static_cast<spdlog::level::level_enum>(std::clamp<long long>(level, 0, spdlog::level::off)));
+    {
+        // Rounded up to a power of two so the ring offset is a mask; applies to threads that log from now on.
+        const long long buffer_kb = config_manager->getIntValue("binlog", "buffer_kb", m_buffer_capacity / 1024);
+        std::lock_guard lock {m_buffers_mutex};
+        m_buffer_capacity = std::bit_ceil(static_cast<size_t>(std::max(4ll, buffer_kb)) * 1024);
+    }
+    m_flush_interval = std::chrono::milliseconds {std::max(
+        1ll, config_manager->getIntValue("binlog", "flush_interval_ms", m_flush_interval.count()))};
+
+    {
+        std::lock_guard lock {m_drain_mutex};
+        m_logger = logger;
+    }
+    m_thread = std::jthread {[this](std::stop_token stop) { run(stop); }};
+}
+
+void BinaryLog::stop() {
+    if (m_thread.joinable()) {
+        m_thread.request_stop();
+        m_thread.join();
+    }
+    std::lock_guard lock {m_drain_mutex};
+    if (m_logger) {
+        drainLocked();
+        const auto stats = getStats();
+        m_logger->debug("binary log: {} records, {} dropped, {} threads", stats.records, stats.dropped, stats.threads);
+    }
+    m_logger = nullptr;
+}
+
+void BinaryLog::flush() {
+    std::lock_guard lock {m_drain_mutex};
+    drainLocked();
+}
+
+BinaryLog::Stats BinaryLog::getStats() const {
+    Stats stats {};
+    stats.records = m_records.load(std::memory_order_relaxed);
+    std::lock_guard lock {m_buffers_mutex};
+    stats.dropped = m_released_dropped;
+    for (const auto &buffer : m_buffers) {
+        stats.dropped += buffer->m_dropped.load(std::memory_order_relaxed);
+    }
+    stats.threads = m_buffers.size() + m_released_buffers;
+    stats.buffers = m_buffers.size();
+    return stats;
+}
+
+void BinaryLog::requestDrain() {
+    // Only the first writer past half full wakes the thread; the periodic wake-up covers a lost notification.
+    if (!m_drain_requested.load(std::memory_order_relaxed) &&
+        !m_drain_requested.exchange(true, std::memory_order_relaxed)) {
+        m_wakeup.notify_one();
+    }
+}
+
+void BinaryLog::run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock {m_wakeup_mutex};
+            m_wakeup.wait_for(lock, stop, m_flush_interval, [this] {
+                return m_drain_requested.load(std::memory_order_relaxed);
+            });
+        }
+        m_drain_requested.store(false, std::memory_order_relaxed);
+        flush();
+    }
+}
+
+void BinaryLog::drainLocked() {
+    if (!m_logger) {
+        return;
+    }
+
+    struct Pending {
+        int64_t time;
+        Buffer *buffer;
+        uint64_t position;
+    };
+    std::vector<Buffer *> buffers;
+    {
+        std::lock_guard lock {m_buffers_mutex};
+        for (const auto &buffer : m_buffers) {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    // Rings are merged by timestamp, so messages from different threads come out in the order they were logged.
+    std::vector<Pending> pending;
+    std::vector<uint64_t> heads;
+    std::vector<Buffer *> retired;
+    for (Buffer *buffer : buffers) {
+        // Read before the head: a ring retired by then has nothing past that head, and is empty after this drain.
+        if (buffer->m_retired.load(std::memory_order_acquire)) {
+            retired.push_back(buffer);
+        }
+        const uint64_t head = buffer->m_head.load(std::memory_order_acquire);
+        heads.push_back(head);
+        for (uint64_t position = buffer->m_tail.load(std::memory_order_relaxed); position < head;) {
+            const std::byte *data = buffer->m_data.data() + (position & buffer->m_mask);
+            // Padding records may be shorter than a header: only its size and flag are read first.
+            RecordHeader header;
+            std::memcpy(&header, data, offsetof(RecordHeader, padding) + sizeof(bool));
+            if (!header.padding) {
+                std::memcpy(&header, data, sizeof(header));
+                pending.push_back({header.time, buffer, position});
+            }
+            position += header.size;
+        }
+    }
+    std::stable_sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) {
+        return a.time < b.time;
+    });
+
+    fmt::memory_buffer message;
+    for (const auto &record : pending) {
+        const std::byte *data = record.buffer->m_data.data() + (record.position & record.buffer->m_mask);
+        RecordHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        const Site &site = *header.site;
+
+        message.clear();
+        fmt::format_to(std::back_inserter(message), "[{}:{}] ", site.module, record.buffer->getThreadId());
+        try {
+            header.decode(site, data + sizeof(header), message);
+        } catch (const fmt::format_error &e) {
+            fmt::format_to(std::back_inserter(message), "<format error: {}> {}", e.what(), site.format);
+        }
+        m_logger->log(spdlog::log_clock::time_point {spdlog::log_clock::duration {header.time}},
+                      spdlog::source_loc {site.file, site.line, site.function},
+                      site.level,
+                      spdlog::string_view_t {message.data(), message.size()});
+    }
+    m_records.fetch_add(pending.size(), std::memory_order_relaxed);
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        Buffer *buffer = buffers[i];
+        buffer->m_tail.store(heads[i], std::memory_order_release);
+        const uint64_t dropped = buffer->m_dropped.load(std::memory_order_relaxed);
+        if (dropped != buffer->m_reported_dropped) {
+            m_logger->warn("binary log: {} records dropped on thread {}, ring full",
+                           dropped - buffer->m_reported_dropped,
+                           buffer->getThreadId());
+            buffer->m_reported_dropped = dropped;
+        }
+    }
+
+    if (!retired.empty()) {
+        std::lock_guard lock {m_buffers_mutex};
+        std::erase_if(m_buffers, [&](const std::unique_ptr<Buffer> &buffer) {
+            if (std::find(retired.begin(), retired.end(), buffer.get()) == retired.end()) {
+                return false;
+            }
+            m_released_dropped += buffer->m_dropped.load(std::memory_order_relaxed);
+            ++m_released_buffers;
+            return true;
+        });
+    }
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/singleton.h"
+
+// Compile-time floor per module, as spdlog level numbers (SPDLOG_LEVEL_TRACE = 0 ... SPDLOG_LEVEL_OFF = 6). Calls
+// below it compile to nothing; set with e.g. -DVA_LOG_LEVEL_MEDIA=2 (see CMakeLists.txt).
+#ifndef VA_LOG_LEVEL_CORE
+#define VA_LOG_LEVEL_CORE SPDLOG_LEVEL_TRACE
+#endif
+#ifndef VA_LOG_LEVEL_MEDIA
+#define VA_LOG_LEVEL_MEDIA SPDLOG_LEVEL_TRACE
+#endif
+#ifndef VA_LOG_LEVEL_RENDER
+#define VA_LOG_LEVEL_RENDER SPDLOG_LEVEL_TRACE
+#endif
+#ifndef VA_LOG_LEVEL_AUDIO
+#define VA_LOG_LEVEL_AUDIO SPDLOG_LEVEL_TRACE
+#endif
+#ifndef VA_LOG_LEVEL_IO
+#define VA_LOG_LEVEL_IO SPDLOG_LEVEL_TRACE
+#endif
+
+/**
+ *  @class BinaryLog
+ *
+ *  @brief Log path for per-frame and per-packet messages: the calling thread only copies the raw arguments into
+ *         its own buffer, and formatting happens later on the drain thread.
+ *
+ *  Every thread writes records into its own single-writer byte ring, so a call takes no lock and does not
+ *  allocate: a level check, a clock read and a few stores. A record holds its call site (format string, level,
+ *  source location, all static), a decoder instantiated for the argument types, a timestamp and the arguments.
+ *  Strings are copied; everything else must be trivially copyable and is stored as is. If a ring is full, the record
+ *  is dropped and counted rather than blocking the caller. A ring is retired when its thread exits and freed by the
+ *  drain once everything in it has been passed on.
+ *
+ *  The drain thread wakes every `flush_interval_ms`, or earlier when a ring is half full, merges the rings by
+ *  timestamp and hands the formatted messages with their original time and location to the async spdlog logger,
+ *  whose thread pool writes them to the sinks.
+ *
+ *  @note Use through the BLOG_* macros, which check the module's compile-time level first.
+ */
+class BinaryLog : public Singleton<BinaryLog> {
+    friend Singleton<BinaryLog>;
+
+public:
+    struct Site {
+        const char *module;
+        spdlog::level::level_enum level;
+        const char *format;
+        const char *file;
+        int line;
+        const char *function;
+    };
+
+    struct Stats {
+        uint64_t records;  // formatted and passed on
+        uint64_t dropped;  // did not fit into their thread's ring
+        size_t threads;    // that ever logged
+        size_t buffers;    // rings still allocated: live threads, and exited ones not drained yet
+    };
+
+    virtual ~BinaryLog() { stop(); }
+
+    /**
+     *  @brief Reads the `[binlog]` section of the config file and starts draining into `logger`.
+     *
+     *  @note Records written before are kept and drained too, as long as they fit.
+     */
+    void start(spdlog::logger *logger);
+
+    /**
+     *  @brief Drains what is left and stops the drain thread.
+     */
+    void stop();
+
+    bool shouldLog(spdlog::level::level_enum level) const {
+        return level >= m_level.load(std::memory_order_relaxed);
+    }
+
+    void setLevel(spdlog::level::level_enum level) { m_level.store(level, std::memory_order_relaxed); }
+
+    /**
+     *  @brief Formats and passes on every record written so far, on the calling thread.
+     */
+    void flush();
+
+    Stats getStats() const;
+
+    template<typename T>
+    static constexpr bool kIsString = std::is_convertible_v<const T &, std::string_view>;
+
+    // How an argument is kept in the ring, and what the format string sees.
+    template<typename T>
+    using Stored = std::conditional_t<kIsString<T>, std::string_view, std::decay_t<T>>;
+
+    /**
+     *  @brief Copies one record into the calling thread's ring. The format string is checked against the stored
+     *         argument types at compile time.
+     */
+    template<typename... Args>
+    void write(const Site &site, fmt::format_string<Stored<Args>...>, const Args &...args) {
+        static_assert((std::is_trivially_copyable_v<Stored<Args>> && ...),
+                      "binary log arguments must be strings or trivially copyable");
+        const size_t size = alignRecord(sizeof(RecordHeader) + (encodedSize(args) + ... + 0));
+        Buffer *buffer = getThreadBuffer();
+        std::byte *out = buffer ? buffer->reserve(size) : nullptr;
+        if (!out) {
+            return;
+        }
+        const RecordHeader header {
+            static_cast<uint32_t>(size),
+            false,
+            &site,
+            &decodeRecord<Stored<Args>...>,
+            spdlog::log_clock::now().time_since_epoch().count(),
+        };
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        (encode(out, args), ...);
+        if (buffer->commit()) {
+            requestDrain();
+        }
+    }
+
+private:
+    using Decoder = void (*)(const Site &site, const std::byte *args, fmt::memory_buffer &out);
+
+    struct RecordHeader {
+        uint32_t size;  // of the whole record, header included
+        bool padding;   // skipped: fills the end of the ring up to the wrap
+        const Site *site;
+        Decoder decode;
+        int64_t time;   // spdlog::log_clock ticks
+    };
+
+    /**
+     *  @class Buffer
+     *
+     *  @brief Single-writer, single-reader ring of variable-size records, contiguous in memory.
+     */
+    class Buffer {
+    public:
+        NONCOPYABLE(Buffer)
+        NONMOVABLE(Buffer)
+
+        Buffer(size_t thread_id, size_t capacity);
+
+        /**
+         *  @return Space for a record of `size` bytes, or nullptr if the ring is full (the record is counted as
+         *          dropped).
+         */
+        std::byte *reserve(size_t size);
+
+        /**
+         *  @brief Publishes the reserved record.
+         *
+         *  @return true if the ring is now more than half full, and should be drained early.
+         */
+        bool commit();
+
+        size_t getThreadId() const { return m_thread_id; }
+
+    private:
+        friend BinaryLog;
+
+        size_t m_thread_id;
+        std::vector<std::byte> m_data;
+        uint64_t m_mask;
+
+        std::atomic<uint64_t> m_head {0};  // bytes published by the writer
+        std::atomic<uint64_t> m_tail {0};  // bytes consumed by the drain
+        std::atomic<uint64_t> m_dropped {0};
+        std::atomic<bool> m_retired {false};  // the writer thread exited; nothing is written anymore
+
+        // Writer only.
+        uint64_t m_reserved_head {};
+        uint64_t m_cached_tail {};
+
+        // Drain only.
+        uint64_t m_reported_dropped {};
+    };
+
+    std::atomic<int> m_level {spdlog::level::debug};
+    size_t m_buffer_capacity {256 * 1024};
+    std::chrono::milliseconds m_flush_interval {50};
+
+    mutable std::mutex m_buffers_mutex {};
+    std::vector<std::unique_ptr<Buffer>> m_buffers {};
+    uint64_t m_released_dropped {};  // guarded by m_buffers_mutex, of the rings already freed
+    size_t m_released_buffers {};    // guarded by m_buffers_mutex
+
+    std::mutex m_drain_mutex {};
+    spdlog::logger *m_logger {};  // guarded by m_drain_mutex
+    std::atomic<uint64_t> m_records {0};
+
+    std::mutex m_wakeup_mutex {};
+    std::condition_variable_any m_wakeup {};
+    std::atomic<bool> m_drain_requested {false};
+
+    // Declared last so the thread is joined before anything it touches is destroyed.
+    std::jthread m_thread {};
+
+    // Retires the thread's ring when the thread exits.
+    struct ThreadBuffer {
+        Buffer *buffer {};
+        ~ThreadBuffer();
+    };
+
+    static inline thread_local Buffer *s_thread_buffer = nullptr;
+    static inline thread_local bool s_thread_exited = false;
+    static thread_local ThreadBuffer s_thread_owner;
+
+    BinaryLog() = default;
+
+    Buffer *getThreadBuffer() { return s_thread_buffer ? s_thread_buffer : createThreadBuffer(); }
+
+    /**
+     *  @return A new ring for the calling thread, or nullptr once the thread is exiting.
+     */
+    Buffer *createThreadBuffer();
+
+    void requestDrain();
+
+    void run(std::stop_token stop);
+
+    /**
+     *  @brief Drains every ring. Must be called with m_drain_mutex held.
+     */
+    void drainLocked();
+
+    static constexpr size_t alignRecord(size_t size) { return (size + 7) & ~size_t {7}; }
+
+    template<typename T>
+    static size_t encodedSize(const T &value) {
+        if constexpr (kIsString<T>) {
+            return sizeof(uint32_t) + toStringView(value).size();
+        } else {
+            return sizeof(Stored<T>);
+        }
+    }
+
+    template<typename T>
+    static void encode(std::byte *&out, const T &value) {
+        if constexpr (kIsString<T>) {
+            const std::string_view view = toStringView(value);
+            const auto length = static_cast<uint32_t>(view.size());
+            std::memcpy(out, &length, sizeof(length));
+            std::memcpy(out + sizeof(length), view.data(), view.size());
+            out += sizeof(length) + view.size();
+        } else {
+            const Stored<T> stored = value;
+            std::memcpy(out, &stored, sizeof(stored));
+            out += sizeof(stored);
+        }
+    }
+
+    template<typename T>
+    static T decode(const std::byte *&in) {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            uint32_t length;
+            std::memcpy(&length, in, sizeof(length));
+            const std::string_view view {reinterpret_cast<const char *>(in + sizeof(length)), length};
+            in += sizeof(length) + length;
+            return view;
+        } else {
+            T value;
+            std::memcpy(&value, in, sizeof(value));
+            in += sizeof(value);
+            return value;
+        }
+    }
+
+    template<typename... Values>
+    static void decodeRecord(const Site &site, const std::byte *args, fmt::memory_buffer &out) {
+        // Braced initialization evaluates left to right, the order the arguments were encoded in.
+        const std::tuple<Values...> values {decode<Values>(args)...};
+        std::apply(
+            [&](const auto &...value) {
+                fmt::vformat_to(std::back_inserter(out), site.format, fmt::make_format_args(value...));
+            },
+            values);
+    }
+
+    template<typename T>
+    static std::string_view toStringView(const T &value) {
+        if constexpr (std::is_convertible_v<const T &, const char *>) {
+            const char *string = value;
+            return string ? std::string_view {string} : std::string_view {"(null)"};
+        } else {
+            return value;
+        }
+    }
+};
+
+/**
+ *  @brief Logs through BinaryLog if `severity` (TRACE, DEBUG, INFO, WARN or ERROR) reaches the compile-time floor of
+ *         `module` (CORE, MEDIA, RENDER, AUDIO or IO) and the runtime level.
+ */
+#define BINARY_LOG(module, severity, format, ...) \
+    do { \
+        if constexpr (SPDLOG_LEVEL_##severity >= VA_LOG_LEVEL_##module) { \
+            static constexpr BinaryLog::Site binary_log_site { \
+                #module, \
+                static_cast<spdlog::level::level_enum>(SPDLOG_LEVEL_##severity), \
+                format, \
+                __FILE__, \
+                __LINE__, \
+                SPDLOG_FUNCTION, \
+            }; \
+            auto binary_log = BinaryLog::get(); \
+            if (binary_log->shouldLog(binary_log_site.level)) { \
+                binary_log->write(binary_log_site, format __VA_OPT__(, ) __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define BLOG_TRACE(module, ...) BINARY_LOG(module, TRACE, __VA_ARGS__)
+#define BLOG_DEBUG(module, ...) BINARY_LOG(module, DEBUG, __VA_ARGS__)
+#define BLOG_INFO(module, ...) BINARY_LOG(module, INFO, __VA_ARGS__)
+#define BLOG_WARN(module, ...) BINARY_LOG(module, WARN, __VA_ARGS__)
+#define BLOG_ERROR(module, ...) BINARY_LOG(module, ERROR, __VA_ARGS__)
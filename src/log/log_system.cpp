@@ -23,6 +23,11 @@ void LogSystem::initialize() {
         "video-app-logger", sinks.begin(), sinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::block
     );
     m_logger->set_level(spdlog::level::trace);
+    BinaryLog::get()->start(m_logger.get());
 }
 
-void LogSystem::shutdown() { m_logger.reset(); }
\ No newline at end of file
+void LogSystem::shutdown() {
+    // Drained before the logger it writes into goes away.
+    BinaryLog::get()->stop();
+    m_logger.reset();
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <spdlog/fmt/fmt.h>
 
 #include "base/singleton.h"
+#include "log/binary_log.h"
 
 class LogSystem : public Singleton<LogSystem> {
     friend Singleton<LogSystem>;
@@ -18,12 +19,17 @@ public:
     void initialize();
     void shutdown();
 
-    std::shared_ptr<spdlog::logger> getLogger() { return m_logger; }
+    /**
+     *  @return The logger, not a shared_ptr copy: every log macro calls this, and copying would cost an atomic
+     *          reference count round trip before the level check.
+     */
+    spdlog::logger *getLogger() { return m_logger.get(); }
 
 private:
     std::shared_ptr<spdlog::logger> m_logger;
 
-    LogSystem() = default;
+    // BinaryLog is constructed first so it is destroyed after, and shutdown can still stop it.
+    LogSystem() { BinaryLog::get(); }
 };
 
 #define TRACE(...) SPDLOG_LOGGER_TRACE(LogSystem::get()->getLogger(), __VA_ARGS__)
@@ -33,6 +39,7 @@ private:
 #define ERROR(...) SPDLOG_LOGGER_ERROR(LogSystem::get()->getLogger(), __VA_ARGS__)
 #define FATAL(...) \
     do { \
+        BinaryLog::get()->flush(); \
         SPDLOG_LOGGER_CRITICAL(LogSystem::get()->getLogger(), __VA_ARGS__); \
         LogSystem::get()->getLogger()->flush(); \
         std::string message = fmt::format(__VA_ARGS__); \
@@ -1,12 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <string_view>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "audio/audio_output.h"
+#include "base/job_system.h"
 #include "config/config_manager.h"
 #include "log/log_system.h"
 
+#include "media/frame_cache.h"
+#include "media/frame_scheduler.h"
+#include "media/master_clock.h"
+#include "media/media_engine.h"
+#include "media/playlist.h"
+#include "media/present_scheduler.h"
+#include "media/thumbnail_generator.h"
+#include "media/transcoder.h"
+
 #include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/gpu_tracer.h"
+#include "render/context/pixel_upload_ring.h"
 #include "render/context/window_manager.h"
+#include "render/convert/upload_thread.h"
+#include "render/convert/yuv_converter.h"
+#include "render/text/subtitle_overlay.h"
+#include "render/text/text_renderer.h"
+#include "render/wall/video_wall.h"
+
+#include "trace/tracer.h"
+
+// Seconds moved per scroll wheel notch while scrubbing.
+constexpr double kScrubSecondsPerNotch = 0.25;
 
 int main(int argc, char **argv) {
     ConfigManager::get()->parse();
     LogSystem::get()->initialize();
+    Tracer::get()->initialize();
+    Tracer::get()->setThreadName("render");
+    JobSystem::get()->initialize();
+
+    // Headless contact sheet: video-app --thumbnails <media> <out.png>
+    if (argc > 3 && std::string_view {argv[1]} == "--thumbnails") {
+        ThumbnailGenerator::Stats stats {};
+        auto atlas = ThumbnailGenerator::generate(argv[2],
+                                                  ThumbnailGenerator::Config::fromConfigManager(),
+                                                  KeyframeIndex::Config::fromConfigManager(),
+                                                  &stats);
+        INFO("thumbnails: {} keyframe + {} exact in {:.3f}s, {} segments on {} threads, {} frames decoded",
+             stats.keyframe_thumbnails,
+             stats.exact_thumbnails,
+             stats.seconds,
+             stats.segments,
+             stats.threads,
+             stats.frames_decoded);
+        const bool written = ThumbnailGenerator::writePng(atlas, argv[3]);
+        JobSystem::get()->shutdown();
+        LogSystem::get()->shutdown();
+        return written ? 0 : 1;
+    }
+
+    // Headless export through the GL pipeline: video-app --export <media> <out>
+    if (argc > 3 && std::string_view {argv[1]} == "--export") {
+        Transcoder::Stats stats {};
+        const bool written = Transcoder::run(argv[2], argv[3], Transcoder::Config::fromConfigManager(), &stats);
+        INFO("export: {} frames in {:.3f}s, {:.1f} fps", stats.frames, stats.seconds, stats.fps);
+        INFO("export busy: demux {:.0f}%, decode {:.0f}%, GL {:.0f}%, readback wait {:.0f}%, encode {:.0f}%",
+             stats.demux_busy * 100,
+             stats.decode_busy * 100,
+             stats.gl_busy * 100,
+             stats.readback_wait * 100,
+             stats.encode_busy * 100);
+        JobSystem::get()->shutdown();
+        LogSystem::get()->shutdown();
+        return written ? 0 : 1;
+    }
+
+    // Monitoring wall of every input at once: video-app --wall <media>...
+    if (argc > 2 && std::string_view {argv[1]} == "--wall") {
+        auto gl = GLContext::createWithWindow({1280, 720, "video-app wall"});
+        auto wm = gl->createWindowManager();
+        wm->registerOnKeyFunc([](WindowManager *wm, int key, int, int action, int) {
+            if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+                wm->setShouldClose(true);
+            }
+        });
+        gl->makeCurrentContext();
+        // Streams run on their own clocks; the swap interval paces the loop to the display.
+        gl->setSwapInterval(1);
+        {
+            const std::vector<std::filesystem::path> paths(argv + 2, argv + argc);
+            VideoWall wall {gl, paths, VideoWall::Config::fromConfigManager()};
+            const auto start = std::chrono::steady_clock::now();
+            while (!wm->shouldClose() && !wall.isFinished()) {
+                TRACE_ZONE("wall frame");
+                GL_ERROR_SCOPE(gl, "wall frame");
+                wm->pollEvents();
+                wall.update(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+                int width, height;
+                gl->getFramebufferSize(&width, &height);
+                gl->getStateCache().viewport(0, 0, width, height);
+                glCall(gl, ClearColor, 0.0, 0.0, 0.0, 1.0);
+                glCall(gl, Clear, GL_COLOR_BUFFER_BIT);
+                wall.draw(width, height);
+                gl->swapBuffers();
+            }
+        }
+        wm.reset();
+        gl.reset();
+        JobSystem::get()->shutdown();
+        LogSystem::get()->shutdown();
+        return 0;
+    }
 
     auto gl = GLContext::createWithWindow({800, 600, "video-app"});
 
@@ -15,21 +126,422 @@ int main(int argc, char **argv) {
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
             wm->setShouldClose(true);
         }
+        // Dumps the most recent trace history on demand.
+        if (key == GLFW_KEY_F9 && action == GLFW_PRESS) {
+            Tracer::get()->dump();
+        }
     });
     gl->makeCurrentContext();
 
+    auto converter = std::make_unique<YuvConverter>(gl);
+    // Subtitles and the optional statistics go over the picture in one instanced draw.
+    auto text_renderer = std::make_unique<TextRenderer>(gl);
+    SubtitleOverlay subtitles {SubtitleOverlay::Config::fromConfigManager()};
+    // Presentation rate shown in the statistics, refreshed about once a second.
+    double overlay_fps {};
+    uint64_t overlay_fps_presented {};
+    auto overlay_fps_since = std::chrono::steady_clock::now();
+    // Uploads on its own shared context, so frame time does not grow with the frame size.
+    std::unique_ptr<UploadThread> uploader {};
+    if (auto upload_config = UploadThread::Config::fromConfigManager(); upload_config.enabled) {
+        uploader = std::make_unique<UploadThread>(gl, upload_config);
+    }
+    // Rings of the items being played or pre-rolled, by playlist index; each item stages into its own.
+    std::map<size_t, std::shared_ptr<PixelUploadRing>> upload_rings {};
+    std::shared_ptr<PixelUploadRing> upload_ring {};  // ring of the item on screen
+    // Paused frames are staged here on the render thread; the item's own ring has its decode thread as only writer.
+    std::shared_ptr<PixelUploadRing> scrub_ring {};
+    std::shared_ptr<AudioDevice> audio_device {};
+    std::shared_ptr<AudioOutput> audio_output {};
+    bool audio_unavailable = false;
+    std::shared_ptr<FrameCache> frame_cache {};
+
+    auto sync_config = FrameScheduler::Config::fromConfigManager();
+    MasterClock clock {sync_config.master};
+    FrameScheduler scheduler {clock, sync_config};
+    // Draws only when the picture changes and sleeps in the event wait otherwise, instead of swapping continuously.
+    PresentScheduler pacer {PresentScheduler::Config::fromConfigManager(),
+                            gl->getRefreshRate(),
+                            [&wm](double timeout) { wm->waitEvents(timeout); },
+                            [&gl](int interval) { gl->setSwapInterval(interval); }};
+    wm->registerOnFramebufferSizeFunc([&](WindowManager *, int, int) { pacer.requestRedraw(); });
+    AVRational video_time_base {};
+    double default_frame_duration {1.0 / 30};
+    size_t shown_item {SIZE_MAX};
+
+    // Space pauses; while paused, Left/Right step one frame and the scroll wheel scrubs, served by frame_cache.
+    bool paused = false;
+    int64_t last_presented_pts {AV_NOPTS_VALUE};
+    int64_t scrub_pts {AV_NOPTS_VALUE};
+    int64_t shown_scrub_pts {AV_NOPTS_VALUE};
+    FrameCache::Direction scrub_direction {FrameCache::Direction::Forward};
+
+    // Items are opened in the background; this runs on the render thread right before an item starts decoding.
+    auto engine_config = MediaEngine::Config::fromConfigManager();
+    std::unique_ptr<Playlist> playlist {};
+    auto start_item = [&](const Playlist::Item &item) -> MediaEngine::VideoFrameHook {
+        if (item.engine->hasAudio() && !audio_output && !audio_unavailable) {
+            try {
+                audio_device = AudioDevice::openDefault();
+            } catch (const std::runtime_error &) {
+                WARN("no audio device, playing without sound");
+                audio_unavailable = true;
+            }
+            if (audio_device) {
+                audio_output = AudioOutput::create(audio_device, AudioOutput::Config::fromConfigManager());
+                // audio_output is released before playlist, so the raw pointer outlives the resample thread.
+                audio_output->start([playlist = playlist.get()] { return playlist->tryPopAudioFrame(); },
+                                    [playlist = playlist.get()] { return playlist->isAudioDrained(); },
+                                    Playlist::kTimeBase);
+            }
+        }
+
+        auto decoder = item.engine->getVideoDecoder();
+        if (!decoder) {
+            return {};
+        }
+        auto codec_ctx = decoder->getCodecContext();
+        size_t slot_size = YuvConverter::getStagingSize(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height);
+        if (slot_size == 0) {
+            WARN("unsupported pixel format {} in {}, not showing its video",
+                 av_get_pix_fmt_name(codec_ctx->pix_fmt),
+                 item.path.string());
+            return {};
+        }
+        // Every queued frame holds a slot, plus one being written and two still fenced on the GPU.
+        const size_t slot_count = engine_config.video_frame_queue_depth + 3;
+        std::shared_ptr<PixelUploadRing> ring {};
+        if (uploader) {
+            ring = uploader->createRing(slot_count, slot_size);
+        } else {
+            ring = gl->createPixelUploadRing(slot_count, slot_size);
+            ring->pump();
+        }
+        upload_rings[item.index] = ring;
+
+        // Decoded pixels are copied into mapped PBO memory on the decode thread, not here. The ring is only
+        // released once the item's video has finished, after its decode thread stopped calling this.
+        return [ring = ring.get()](AVFrame *frame, const std::stop_token &stop) {
+            if (!YuvConverter::isSupported(static_cast<AVPixelFormat>(frame->format))) {
+                return true;
+            }
+            auto slot = ring->acquireWritable(stop);
+            if (!slot) {
+                return false;
+            }
+            if (!YuvConverter::stage(slot, frame)) {
+                WARN("frame does not fit into upload slot, dropping it");
+                ring->publish(slot);
+                return true;
+            }
+            frame->opaque = slot;
+            return true;
+        };
+    };
+    playlist = std::make_unique<Playlist>(engine_config, Playlist::Config::fromConfigManager(), start_item);
+    for (int i = 1; i < argc; ++i) {
+        playlist->append(argv[i]);
+    }
+    wm->registerOnDropFunc([&](WindowManager *, int path_count, const char *paths[]) {
+        for (int i = 0; i < path_count; ++i) {
+            playlist->append(paths[i]);
+        }
+    });
+
+    // Picks up the ring, frame cache and timing of the item the playlist switched to.
+    auto sync_video_item = [&] {
+        const Playlist::Item *item = playlist->getVideoItem();
+        if (!item || item->index == shown_item) {
+            return;
+        }
+        shown_item = item->index;
+        // Earlier items have finished their video, so nothing writes into their rings anymore.
+        upload_rings.erase(upload_rings.begin(), upload_rings.lower_bound(shown_item));
+        auto ring = upload_rings.find(shown_item);
+        upload_ring = ring != upload_rings.end() ? ring->second : nullptr;
+        playlist->releaseFrameCache(std::move(frame_cache));
+        frame_cache = item->frame_cache;
+        last_presented_pts = scrub_pts = shown_scrub_pts = AV_NOPTS_VALUE;
+
+        default_frame_duration = 1.0 / 30;
+        if (auto decoder = item->engine->getVideoDecoder()) {
+            auto codec_ctx = decoder->getCodecContext();
+            video_time_base = decoder->getTimeBase();
+            if (codec_ctx->framerate.num > 0 && codec_ctx->framerate.den > 0) {
+                default_frame_duration = av_q2d(av_inv_q(codec_ctx->framerate));
+            }
+            subtitles.setStream(item->engine->getSubtitleStream(), codec_ctx->width, codec_ctx->height);
+        } else {
+            subtitles.setStream(nullptr, 0, 0);
+        }
+    };
+
+    {
+        auto set_paused = [&](bool value) {
+            if (value == paused) {
+                return;
+            }
+            paused = value;
+            clock.setPaused(paused);
+            if (audio_output) {
+                audio_output->setPaused(paused);
+            }
+            // Scrubbing starts from the frame on screen; resuming continues playback where it was paused.
+            scrub_pts = shown_scrub_pts = last_presented_pts;
+        };
+        auto frame_step = [&] {
+            int64_t step = frame_cache->getFrameDuration();
+            if (step <= 0) {
+                step = std::max<int64_t>(1, std::llround(default_frame_duration / av_q2d(video_time_base)));
+            }
+            return step;
+        };
+
+        // The frame cache follows the item on screen; items without one cannot be paused or scrubbed.
+        wm->registerOnKeyFunc([&](WindowManager *, int key, int, int action, int) {
+            if (action == GLFW_RELEASE || !frame_cache) {
+                return;
+            }
+            if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+                set_paused(!paused);
+            } else if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) && last_presented_pts != AV_NOPTS_VALUE) {
+                set_paused(true);
+                scrub_direction =
+                    key == GLFW_KEY_RIGHT ? FrameCache::Direction::Forward : FrameCache::Direction::Backward;
+                // One tick before the current frame lands on the previous one, whatever its duration.
+                scrub_pts += key == GLFW_KEY_RIGHT ? frame_step() : -1;
+            }
+        });
+        wm->registerOnScrollFunc([&](WindowManager *, double, double yoffset) {
+            if (yoffset == 0 || last_presented_pts == AV_NOPTS_VALUE || !frame_cache) {
+                return;
+            }
+            set_paused(true);
+            scrub_direction = yoffset > 0 ? FrameCache::Direction::Forward : FrameCache::Direction::Backward;
+            scrub_pts += std::llround(yoffset * kScrubSecondsPerNotch / av_q2d(video_time_base));
+        });
+    }
+
     while (!wm->shouldClose()) {
-        wm->pollEvents();
+        TRACE_ZONE("frame");
+        GL_ERROR_SCOPE(gl, "frame");
+        pacer.waitForWork();
+
+        playlist->update();
+        // With the upload thread, the rings are its own to pump and drain.
+        if (!uploader) {
+            for (const auto &[index, ring] : upload_rings) {
+                ring->pump();
+            }
+            if (scrub_ring) {
+                scrub_ring->pump();
+            }
+        }
+        if (audio_output) {
+            clock.setAudioTime(audio_output->getPlaybackTime());
+        }
+
+        bool presented = false;
+        {
+            // Only frames that are already decoded are considered; the render loop never waits on the engine.
+            bool frame_waiting = false;
+            while (auto head = playlist->peekVideoFrame()) {
+                sync_video_item();
+                double pts = playlist->getVideoTime(head);
+                double duration =
+                    head->duration > 0 ? head->duration * av_q2d(video_time_base) : default_frame_duration;
+
+                auto action = scheduler.schedule(pts, duration);
+                if (action == FrameScheduler::Action::Wait) {
+                    frame_waiting = true;
+                    // The master clock is frozen while paused, so the frame only becomes due after resuming.
+                    if (!paused) {
+                        pacer.setFrameDue(pts - clock.getTime() - sync_config.present_tolerance);
+                    }
+                    break;
+                }
+
+                auto frame = playlist->tryPopVideoFrame();
+                auto slot = static_cast<PixelUploadRing::Slot *>(frame->opaque);
+                if (action == FrameScheduler::Action::Drop) {
+                    // Late frames never touch the GPU; their staged slot goes straight back to the writer.
+                    if (slot && uploader) {
+                        uploader->discard(upload_ring.get(), slot);
+                    } else if (slot) {
+                        upload_ring->discard(slot);
+                    }
+                    continue;
+                }
+                last_presented_pts = frame->best_effort_timestamp;
+                presented = true;
+                if (slot && uploader) {
+                    // Shown once acquired below, in this or a later iteration; the upload thread wakes the loop.
+                    uploader->upload(upload_ring.get(), slot, std::move(frame));
+                } else if (slot) {
+                    TRACE_GPU_ZONE(gl, "texture upload");
+                    converter->upload(*upload_ring, slot, frame.get());
+                    pacer.requestRedraw();
+                }
+                break;
+            }
+            if (!presented && !paused && !frame_waiting && !playlist->isFinished()) {
+                pacer.setExpectingFrames();
+            }
 
+            // The cached frame is staged here rather than on a decode thread; if no slot is free, retry next loop.
+            if (paused && frame_cache && upload_ring && scrub_pts != shown_scrub_pts) {
+                // One slot being written and two still fenced on the GPU, sized like the item's own slots.
+                if (!scrub_ring || scrub_ring->getSlotSize() != upload_ring->getSlotSize()) {
+                    constexpr size_t kScrubSlotCount = 3;
+                    if (uploader) {
+                        scrub_ring = uploader->createRing(kScrubSlotCount, upload_ring->getSlotSize());
+                    } else {
+                        scrub_ring = gl->createPixelUploadRing(kScrubSlotCount, upload_ring->getSlotSize());
+                        scrub_ring->pump();
+                    }
+                }
+                if (auto frame = frame_cache->get(scrub_pts, scrub_direction)) {
+                    if (auto slot = scrub_ring->tryAcquireWritable()) {
+                        if (YuvConverter::stage(slot, frame.get())) {
+                            // Steps continue from the frame shown, not from wherever inside it the target fell.
+                            scrub_pts = shown_scrub_pts = frame->best_effort_timestamp;
+                            if (uploader) {
+                                uploader->upload(scrub_ring.get(), slot, std::move(frame));
+                            } else {
+                                TRACE_GPU_ZONE(gl, "scrub upload");
+                                converter->upload(*scrub_ring, slot, frame.get());
+                                pacer.requestRedraw();
+                            }
+                        } else if (uploader) {
+                            uploader->discard(scrub_ring.get(), slot);
+                            shown_scrub_pts = scrub_pts;
+                        } else {
+                            scrub_ring->discard(slot);
+                            shown_scrub_pts = scrub_pts;
+                        }
+                    }
+                }
+            }
+            if (paused && scrub_pts != shown_scrub_pts) {
+                // Not cached yet or no free slot: look again soon rather than after the idle timeout.
+                pacer.setExpectingFrames();
+            }
+
+            // Slots that could not be staged come back through the filled queue.
+            if (!uploader) {
+                for (const auto &[index, ring] : upload_rings) {
+                    while (auto slot = ring->tryPopFilled()) {
+                        ring->discard(slot);
+                    }
+                }
+            }
+        }
+        if (uploader) {
+            if (auto set = uploader->acquireLatest()) {
+                converter->setFrame(set->planes, set->frame.get());
+                pacer.requestRedraw();
+            }
+        }
+        if (const Playlist::Item *item = playlist->getVideoItem(); item && item->index == shown_item) {
+            while (auto packet = item->engine->tryPopSubtitlePacket()) {
+                subtitles.addPacket(packet.get());
+            }
+        }
+        if (!audio_output) {
+            // Without an audio device, keep the audio queues from backing up the demuxers; this also moves the
+            // playlist's audio side along.
+            while (playlist->tryPopAudioFrame()) {
+            }
+        }
+
+        // Nothing changed on screen: no clear, draw or swap until the next frame is due or input arrives.
+        if (!pacer.shouldPresent()) {
+            continue;
+        }
+        if (shown_item != SIZE_MAX) {
+            scheduler.endFrame(presented);
+        }
+
+        int width, height;
+        gl->getFramebufferSize(&width, &height);
+        gl->getStateCache().viewport(0, 0, width, height);
         glCall(gl, ClearColor, 0.2, 0.3, 0.3, 1.0);
         glCall(gl, Clear, GL_COLOR_BUFFER_BIT);
 
-        gl->swapBuffers();
+        if (converter) {
+            converter->draw(width, height);
+        }
+        {
+            // Subtitles follow the frame on screen, including while paused or scrubbing.
+            const int64_t shown_pts =
+                paused && shown_scrub_pts != AV_NOPTS_VALUE ? shown_scrub_pts : last_presented_pts;
+            int x, y, w, h;
+            if (shown_pts != AV_NOPTS_VALUE && converter && converter->getDisplayRect(width, height, &x, &y, &w, &h)) {
+                subtitles.layout(text_renderer.get(), shown_pts * av_q2d(video_time_base), x, y, w, h);
+            }
+            const Playlist::Item *item = playlist->getVideoItem();
+            if (subtitles.getConfig().stats && item) {
+                const auto frames = scheduler.getStats();
+                const auto media = item->engine->getStats();
+                const auto text = text_renderer->getStats();
+                const auto now = std::chrono::steady_clock::now();
+                if (const double elapsed = std::chrono::duration<double>(now - overlay_fps_since).count();
+                    elapsed >= 1.0) {
+                    overlay_fps = (frames.presented - overlay_fps_presented) / elapsed;
+                    overlay_fps_presented = frames.presented;
+                    overlay_fps_since = now;
+                }
+                text_renderer->addText(fmt::format("{:.1f} fps  presented {}  dropped {}  repeated {}\n"
+                                                   "lateness {:.1f} ms mean, {:.1f} ms max\n"
+                                                   "packets {}/{}  frames {}/{}\n"
+                                                   "overlay {} quads, {:.0f} us",
+                                                   overlay_fps,
+                                                   frames.presented,
+                                                   frames.dropped,
+                                                   frames.repeated,
+                                                   frames.mean_lateness * 1e3,
+                                                   frames.max_lateness * 1e3,
+                                                   media.video_packets.size,
+                                                   media.video_packets.capacity,
+                                                   media.video_frames.size,
+                                                   media.video_frames.capacity,
+                                                   text.instances,
+                                                   text.cpu_ns * 1e-3),
+                                       8,
+                                       8,
+                                       {16, 0xffffffff, true});
+            }
+            text_renderer->draw(width, height);
+        }
+
+        {
+            TRACE_ZONE("swap buffers");
+            pacer.beginSwap();
+            gl->swapBuffers();
+            pacer.endSwap();
+        }
     }
 
+    if (shown_item != SIZE_MAX) {
+        scheduler.logStats();
+    }
+    pacer.logStats();
+    frame_cache.reset();
+    audio_output.reset();
+    audio_device.reset();
+    // Before the rings: the decode threads stage into them until the engines are gone.
+    playlist.reset();
+    text_renderer.reset();
+    converter.reset();
+    upload_ring.reset();
+    upload_rings.clear();
+    scrub_ring.reset();
+    // After the rings, which it destroys, and before the context it shares with.
+    uploader.reset();
     wm.reset();
     gl.reset();
 
+    JobSystem::get()->shutdown();
     LogSystem::get()->shutdown();
     return 0;
 }
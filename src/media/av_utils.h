@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+}
+
+#include "base/frame_pool.h"
+
+// Packets and frames go back to AVObjectPool instead of the heap.
+struct AVPacketDeleter {
+    void operator()(AVPacket *packet) const { AVObjectPool::get()->releasePacket(packet); }
+};
+
+struct AVFrameDeleter {
+    void operator()(AVFrame *frame) const { AVObjectPool::get()->releaseFrame(frame); }
+};
+
+struct AVCodecContextDeleter {
+    void operator()(AVCodecContext *ctx) const { avcodec_free_context(&ctx); }
+};
+
+struct AVFormatContextDeleter {
+    void operator()(AVFormatContext *ctx) const { avformat_close_input(&ctx); }
+};
+
+using AVPacketPtr = std::unique_ptr<AVPacket, AVPacketDeleter>;
+using AVFramePtr = std::unique_ptr<AVFrame, AVFrameDeleter>;
+using AVCodecContextPtr = std::unique_ptr<AVCodecContext, AVCodecContextDeleter>;
+using AVFormatContextPtr = std::unique_ptr<AVFormatContext, AVFormatContextDeleter>;
+
+inline AVPacketPtr allocPacket() { return AVPacketPtr {AVObjectPool::get()->acquirePacket()}; }
+
+inline AVFramePtr allocFrame() { return AVFramePtr {AVObjectPool::get()->acquireFrame()}; }
+
+/**
+ *  @brief C++ replacement for `av_err2str`, which relies on compound literals.
+ */
+inline std::string avErrorString(int errnum) {
+    char buffer[AV_ERROR_MAX_STRING_SIZE] {};
+    av_strerror(errnum, buffer, sizeof(buffer));
+    return buffer;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "decoder.h"
+
+#include <algorithm>
+
+#include "log/log_system.h"
+
+Decoder::Decoder(const AVStream *stream,
+                 int thread_count,
+                 std::shared_ptr<FrameBufferPool> buffer_pool,
+                 int lowres)
+    : m_buffer_pool(buffer_pool), m_time_base(stream->time_base) {
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        FATAL("no decoder for codec {}", avcodec_get_name(stream->codecpar->codec_id));
+    }
+
+    m_codec_ctx.reset(avcodec_alloc_context3(codec));
+    if (!m_codec_ctx) {
+        FATAL("failed to allocate codec context!");
+    }
+
+    int ret = avcodec_parameters_to_context(m_codec_ctx.get(), stream->codecpar);
+    if (ret < 0) {
+        FATAL("failed to copy codec parameters: {}", avErrorString(ret));
+    }
+
+    m_codec_ctx->pkt_timebase = stream->time_base;
+    m_codec_ctx->thread_count = thread_count;
+    m_codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    m_codec_ctx->lowres = std::clamp(lowres, 0, static_cast<int>(codec->max_lowres));
+    if (m_buffer_pool) {
+        m_buffer_pool->attach(m_codec_ctx.get());
+    }
+
+    ret = avcodec_open2(m_codec_ctx.get(), codec, nullptr);
+    if (ret < 0) {
+        FATAL("failed to open decoder {}: {}", codec->name, avErrorString(ret));
+    }
+
+    INFO("opened decoder {} with {} threads{}",
+         codec->name,
+         m_codec_ctx->thread_count,
+         m_codec_ctx->lowres > 0 ? fmt::format(", lowres {}", m_codec_ctx->lowres) : "");
+}
+
+Decoder::~Decoder() { DEBUG("release Decoder: {}", (void *)this); }
+
+int Decoder::sendPacket(const AVPacket *packet) { return avcodec_send_packet(m_codec_ctx.get(), packet); }
+
+int Decoder::receiveFrame(AVFrame *frame) { return avcodec_receive_frame(m_codec_ctx.get(), frame); }
+
+void Decoder::flush() { avcodec_flush_buffers(m_codec_ctx.get()); }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+
+#include "base/frame_pool.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+
+/**
+ *  @class Decoder
+ *
+ *  @brief Thin wrapper around an AVCodecContext opened for one stream.
+ *
+ *  @note Not thread-safe; owned and driven by a single decode thread once opened.
+ */
+class Decoder {
+public:
+    NONCOPYABLE(Decoder)
+    NONMOVABLE(Decoder)
+
+    /**
+     *  @param stream The stream whose codec parameters are used to open the decoder.
+     *  @param thread_count Number of codec-internal threads, 0 lets libavcodec decide.
+     *  @param buffer_pool Optional pool the decoder allocates its frames from.
+     *  @param lowres Decodes at 1/2^lowres of the coded size, for codecs that can (see `AVCodec::max_lowres`);
+     *                clamped to what the codec supports.
+     */
+    Decoder(const AVStream *stream,
+            int thread_count,
+            std::shared_ptr<FrameBufferPool> buffer_pool = {},
+            int lowres = 0);
+    ~Decoder();
+
+    /**
+     *  @brief Submits a packet, or nullptr to enter draining mode.
+     *
+     *  @return See `avcodec_send_packet`.
+     */
+    int sendPacket(const AVPacket *packet);
+
+    /**
+     *  @return See `avcodec_receive_frame`.
+     */
+    int receiveFrame(AVFrame *frame);
+
+    /**
+     *  @brief Discards buffered frames, e.g. after a seek or after draining.
+     */
+    void flush();
+
+    AVCodecContext *getCodecContext() const { return m_codec_ctx.get(); }
+
+    AVRational getTimeBase() const { return m_time_base; }
+
+    const std::shared_ptr<FrameBufferPool> &getBufferPool() const { return m_buffer_pool; }
+
+private:
+    // Declared before the codec context, which may still release pooled buffers when it is freed.
+    std::shared_ptr<FrameBufferPool> m_buffer_pool {};
+    AVCodecContextPtr m_codec_ctx {};
+    AVRational m_time_base {};
+};
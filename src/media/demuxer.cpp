@@ -0,0 +1,59 @@
+#include "demuxer.h"
+
+#include "log/log_system.h"
+
+Demuxer::Demuxer(const std::filesystem::path &path, const MappedFileIO::Config &io, bool subtitles) : m_path(path) {
+    AVFormatContext *format_ctx = nullptr;
+    m_mapped_file = MappedFileIO::open(path, io);
+    if (m_mapped_file) {
+        format_ctx = avformat_alloc_context();
+        if (!format_ctx) {
+            FATAL("failed to allocate format context");
+        }
+        // The file name is still passed below, so probing keeps its extension hint.
+        format_ctx->pb = m_mapped_file->getContext();
+    }
+    int ret = avformat_open_input(&format_ctx, path.string().c_str(), nullptr, nullptr);
+    if (ret < 0) {
+        FATAL("failed to open {}: {}", path.string(), avErrorString(ret));
+    }
+    m_format_ctx.reset(format_ctx);
+
+    ret = avformat_find_stream_info(format_ctx, nullptr);
+    if (ret < 0) {
+        FATAL("failed to find stream info of {}: {}", path.string(), avErrorString(ret));
+    }
+
+    m_video_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    m_audio_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_AUDIO, -1, m_video_stream_index, nullptr, 0);
+    if (m_video_stream_index < 0 && m_audio_stream_index < 0) {
+        FATAL("no audio or video stream in {}", path.string());
+    }
+    if (subtitles) {
+        // A stream without a decoder would only be read to be dropped.
+        const AVCodec *codec = nullptr;
+        const int index =
+            av_find_best_stream(format_ctx, AVMEDIA_TYPE_SUBTITLE, -1, m_video_stream_index, &codec, 0);
+        m_subtitle_stream_index = index >= 0 && codec ? index : -1;
+    }
+
+    // Streams we do not consume are discarded inside libavformat instead of being read and dropped.
+    for (unsigned i = 0; i < format_ctx->nb_streams; ++i) {
+        const int index = static_cast<int>(i);
+        if (index != m_video_stream_index && index != m_audio_stream_index && index != m_subtitle_stream_index) {
+            format_ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    INFO("opened {} ({}, {}), video stream: {}, audio stream: {}, subtitle stream: {}",
+         path.string(),
+         format_ctx->iformat->name,
+         m_mapped_file ? "mapped" : "protocol",
+         m_video_stream_index,
+         m_audio_stream_index,
+         m_subtitle_stream_index);
+}
+
+Demuxer::~Demuxer() { DEBUG("release Demuxer: {}", (void *)this); }
+
+int Demuxer::readPacket(AVPacket *packet) { return av_read_frame(m_format_ctx.get(), packet); }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <filesystem>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/mapped_file_io.h"
+
+/**
+ *  @class Demuxer
+ *
+ *  @brief Opens a media file and reads compressed packets from its best video and audio streams, and optionally
+ *         its best subtitle stream.
+ *
+ *  Local files are read through a MappedFileIO unless `io.enabled` is false; anything else goes through
+ *  libavformat's protocols.
+ *
+ *  @note Not thread-safe; owned and driven by a single demux thread once opened.
+ */
+class Demuxer {
+public:
+    NONCOPYABLE(Demuxer)
+    NONMOVABLE(Demuxer)
+
+    /**
+     *  @param io How local files are read, normally `MappedFileIO::Config::fromConfigManager()` or the owner's copy.
+     *  @param subtitles Also read the best subtitle stream; otherwise it is discarded like every other stream.
+     */
+    Demuxer(const std::filesystem::path &path, const MappedFileIO::Config &io, bool subtitles = false);
+    ~Demuxer();
+
+    /**
+     *  @brief Reads the next packet of any stream into `packet`.
+     *
+     *  @return 0 on success, AVERROR_EOF at the end of input, or another negative AVERROR code.
+     */
+    int readPacket(AVPacket *packet);
+
+    AVFormatContext *getFormatContext() const { return m_format_ctx.get(); }
+
+    int getVideoStreamIndex() const { return m_video_stream_index; }
+    int getAudioStreamIndex() const { return m_audio_stream_index; }
+    int getSubtitleStreamIndex() const { return m_subtitle_stream_index; }
+
+    /**
+     *  @return The stream, or nullptr if the input has no such stream.
+     */
+    AVStream *getVideoStream() const { return getStream(m_video_stream_index); }
+    AVStream *getAudioStream() const { return getStream(m_audio_stream_index); }
+    AVStream *getSubtitleStream() const { return getStream(m_subtitle_stream_index); }
+
+    const std::filesystem::path &getPath() const { return m_path; }
+
+    /**
+     *  @return The memory-mapped input, or nullptr if the file is read through libavformat's protocols.
+     */
+    const MappedFileIO *getMappedFile() const { return m_mapped_file.get(); }
+
+private:
+    std::filesystem::path m_path {};
+    // Declared before the format context, which reads through it until it is closed.
+    std::unique_ptr<MappedFileIO> m_mapped_file {};
+    AVFormatContextPtr m_format_ctx {};
+
+    int m_video_stream_index {-1};
+    int m_audio_stream_index {-1};
+    int m_subtitle_stream_index {-1};
+
+    AVStream *getStream(int index) const { return index >= 0 ? m_format_ctx->streams[index] : nullptr; }
+};
@@ -0,0 +1,257 @@
+#include "frame_cache.h"
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+FrameCache::Config FrameCache::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.budget_bytes = config_manager->getIntValue("cache", "budget_mb", config.budget_bytes >> 20) << 20;
+    config.prefetch_frames = config_manager->getIntValue("cache", "prefetch_frames", config.prefetch_frames);
+    config.trailing_frames = config_manager->getIntValue("cache", "trailing_frames", config.trailing_frames);
+    config.io = MappedFileIO::Config::fromConfigManager();
+    return config;
+}
+
+FrameCache::FrameCache(const std::filesystem::path &path,
+                       const Config &config,
+                       const KeyframeIndex::Config &index_config,
+                       int thread_count)
+    : m_config(config), m_index_config(index_config), m_path(path) {
+    // A sidecar that already exists is mapped right away; building one is left to the prefetch thread.
+    auto index = index_config.enabled ? KeyframeIndex::load(path, index_config) : nullptr;
+    m_seeker = std::make_unique<FrameSeeker>(path, config.io, std::move(index), thread_count);
+    m_time_base = m_seeker->getTimeBase();
+    m_frame_duration = m_seeker->getFrameDuration();
+
+    m_prefetch_thread = std::jthread([this](std::stop_token stop) { prefetchLoop(stop); });
+}
+
+FrameCache::~FrameCache() {
+    m_prefetch_thread.request_stop();
+    m_prefetch_thread = {};
+
+    logStats();
+    DEBUG("release FrameCache: {}", (void *)this);
+}
+
+std::shared_ptr<FrameCache> FrameCache::create(const std::filesystem::path &path,
+                                               const Config &config,
+                                               const KeyframeIndex::Config &index_config,
+                                               int thread_count) {
+    return std::shared_ptr<FrameCache> {new FrameCache {path, config, index_config, thread_count}};
+}
+
+AVFramePtr FrameCache::get(int64_t pts, Direction direction) {
+    std::lock_guard lock {m_mutex};
+    // Only the first lookup of a position counts; the render loop polls until a miss is filled.
+    const bool moved = pts != m_playhead || direction != m_direction;
+    if (moved) {
+        m_playhead = pts;
+        m_direction = direction;
+        m_moved = true;
+        m_idle = false;
+        m_generation.fetch_add(1, std::memory_order_relaxed);
+        m_wakeup.notify_one();
+    }
+
+    auto it = find(pts);
+    if (it == m_entries.end()) {
+        m_misses += moved;
+        return nullptr;
+    }
+    m_hits += moved;
+
+    AVFramePtr frame = allocFrame();
+    if (!frame || av_frame_ref(frame.get(), it->second.frame.get()) < 0) {
+        return nullptr;
+    }
+    return frame;
+}
+
+FrameCache::Stats FrameCache::getStats() const {
+    std::lock_guard lock {m_mutex};
+    return {m_hits, m_misses, m_evictions, m_inserted, m_entries.size(), m_bytes};
+}
+
+void FrameCache::logStats() const {
+    auto stats = getStats();
+    const uint64_t lookups = stats.hits + stats.misses;
+    INFO("frame cache: {:.1f}% hit rate ({}/{}), {} frames decoded, {} evicted, {} frames / {} MiB resident",
+         lookups ? 100.0 * stats.hits / lookups : 0.0,
+         stats.hits,
+         lookups,
+         stats.inserted,
+         stats.evictions,
+         stats.frames,
+         stats.bytes >> 20);
+}
+
+void FrameCache::prefetchLoop(std::stop_token stop) {
+    Tracer::get()->setThreadName("frame cache");
+
+    std::unique_lock lock {m_mutex};
+    while (!stop.stop_requested()) {
+        auto gap = findGap();
+        if (!gap) {
+            m_wakeup.wait(lock, stop, [this] { return m_moved; });
+            m_moved = false;
+            continue;
+        }
+        m_moved = false;
+        lock.unlock();
+        fill(*gap, stop);
+        lock.lock();
+
+        // Nothing decoded for the start of the gap and no bound learned: retrying would loop on the same gap.
+        if (find(gap->from) == m_entries.end() && !m_moved && (m_start == AV_NOPTS_VALUE || gap->from >= m_start) &&
+            (m_end == AV_NOPTS_VALUE || gap->from < m_end)) {
+            m_idle = true;
+        }
+    }
+    DEBUG("frame cache thread finished");
+}
+
+void FrameCache::fill(const Gap &gap, const std::stop_token &stop) {
+    TRACE_ZONE("prefetch");
+    if (!m_seeker->hasIndex() && m_index_config.enabled) {
+        TRACE_ZONE("load keyframe index");
+        m_seeker->setIndex(KeyframeIndex::loadOrBuild(m_path, m_index_config, m_config.io));
+    }
+    const uint64_t generation = m_generation.load(std::memory_order_relaxed);
+
+    // Continuing the current decode beats seeking when the gap starts shortly after it.
+    const int64_t position = m_seeker->getPosition();
+    const int64_t lookahead = m_frame_duration * (m_config.prefetch_frames + 1);
+    AVFramePtr frame;
+    if (position != AV_NOPTS_VALUE && position < gap.from && gap.from - position <= lookahead) {
+        frame = m_seeker->readFrame();
+    } else {
+        frame = m_seeker->seek(gap.from);
+        if (frame && frame->best_effort_timestamp > gap.from) {
+            std::lock_guard lock {m_mutex};
+            m_start = frame->best_effort_timestamp;
+        }
+    }
+
+    int64_t end = AV_NOPTS_VALUE;
+    while (frame && !stop.stop_requested()) {
+        const int64_t pts = frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE) {
+            WARN("frame without timestamp, cannot cache it");
+            return;
+        }
+        const int64_t duration = frame->duration > 0 ? frame->duration : m_frame_duration;
+        end = pts + duration;
+        if (!insert(std::move(frame), duration) || end > gap.to ||
+            m_generation.load(std::memory_order_relaxed) != generation) {
+            return;
+        }
+        frame = m_seeker->readFrame();
+    }
+
+    // The stream ended before the gap did.
+    if (!frame && end != AV_NOPTS_VALUE) {
+        std::lock_guard lock {m_mutex};
+        m_end = end;
+    }
+}
+
+bool FrameCache::insert(AVFramePtr frame, int64_t duration) {
+    const int64_t pts = frame->best_effort_timestamp;
+    const size_t bytes = getFrameBytes(frame.get());
+
+    std::lock_guard lock {m_mutex};
+    auto [it, inserted] = m_entries.try_emplace(pts, Entry {std::move(frame), duration, bytes});
+    if (!inserted) {
+        return !m_idle;
+    }
+    m_bytes += bytes;
+    ++m_inserted;
+
+    while (m_bytes > m_config.budget_bytes && m_entries.size() > 1) {
+        // Whichever end of the cache is farthest from the playhead goes first.
+        auto first = m_entries.begin();
+        auto last = std::prev(m_entries.end());
+        auto victim = m_playhead - first->first > last->first - m_playhead ? first : last;
+        if (isInWindow(victim->first)) {
+            // The budget cannot hold the whole window; keep what is there instead of thrashing.
+            m_idle = true;
+        }
+        m_bytes -= victim->second.bytes;
+        m_entries.erase(victim);
+        ++m_evictions;
+    }
+    return !m_idle;
+}
+
+std::optional<FrameCache::Gap> FrameCache::findGap() const {
+    if (m_playhead == AV_NOPTS_VALUE || m_idle) {
+        return std::nullopt;
+    }
+    // Without a nominal frame duration there is no grid to prefetch on; only the playhead itself is fetched.
+    const int64_t step = m_frame_duration;
+    const int ahead = step > 0 ? m_config.prefetch_frames : 0;
+    const int behind = step > 0 ? m_config.trailing_frames : 0;
+    const int play_sign = m_direction == Direction::Forward ? 1 : -1;
+
+    auto in_stream = [&](int64_t pts) {
+        return (m_start == AV_NOPTS_VALUE || pts >= m_start) && (m_end == AV_NOPTS_VALUE || pts < m_end);
+    };
+
+    // The playhead first, then the direction of play, then the trailing side.
+    for (int sign : {play_sign, -play_sign}) {
+        const int count = sign == play_sign ? ahead : behind;
+        for (int i = sign == play_sign ? 0 : 1; i <= count; ++i) {
+            const int64_t pts = m_playhead + sign * i * step;
+            if (!in_stream(pts)) {
+                break;
+            }
+            if (find(pts) != m_entries.end()) {
+                continue;
+            }
+            int64_t other_end = pts;
+            for (int j = i + 1; j <= count; ++j) {
+                const int64_t next = m_playhead + sign * j * step;
+                if (!in_stream(next) || find(next) != m_entries.end()) {
+                    break;
+                }
+                other_end = next;
+            }
+            return sign > 0 ? Gap {pts, other_end} : Gap {other_end, pts};
+        }
+    }
+    return std::nullopt;
+}
+
+std::map<int64_t, FrameCache::Entry>::const_iterator FrameCache::find(int64_t pts) const {
+    auto it = m_entries.upper_bound(pts);
+    if (it == m_entries.begin()) {
+        return m_entries.end();
+    }
+    --it;
+    return pts < it->first + it->second.duration ? it : m_entries.end();
+}
+
+bool FrameCache::isInWindow(int64_t pts) const {
+    const int64_t ahead = m_frame_duration * m_config.prefetch_frames;
+    const int64_t behind = m_frame_duration * m_config.trailing_frames;
+    if (m_direction == Direction::Forward) {
+        return pts >= m_playhead - behind && pts <= m_playhead + ahead;
+    }
+    return pts >= m_playhead - ahead && pts <= m_playhead + behind;
+}
+
+size_t FrameCache::getFrameBytes(const AVFrame *frame) {
+    size_t bytes = 0;
+    for (auto buf : frame->buf) {
+        if (buf) {
+            bytes += buf->size;
+        }
+    }
+    for (int i = 0; i < frame->nb_extended_buf; ++i) {
+        bytes += frame->extended_buf[i]->size;
+    }
+    return bytes;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/frame_seeker.h"
+#include "media/keyframe_index.h"
+
+/**
+ *  @class FrameCache
+ *
+ *  @brief Byte-budgeted cache of decoded video frames around a playhead, for scrubbing and single-stepping.
+ *
+ *  A background thread keeps the frames around the playhead decoded: `prefetch_frames` in the direction of play
+ *  and `trailing_frames` on the other side. Gaps behind the playhead are filled by seeking to their start and
+ *  decoding forward, so stepping backwards decodes each GOP once instead of once per step. When the budget is
+ *  exceeded, the frames farthest from the playhead are evicted first; if that would evict frames inside the
+ *  window, prefetching pauses until the playhead moves rather than thrashing.
+ *
+ *  Frames are kept as refcounted AVFrames; the GL texture of the frame on screen is the only resident texture.
+ *
+ *  @note `get` and the accessors are thread-safe; the cache owns its own FrameSeeker, independent from playback.
+ */
+class FrameCache {
+public:
+    NONCOPYABLE(FrameCache)
+    NONMOVABLE(FrameCache)
+
+    enum class Direction {
+        Forward,
+        Backward,
+    };
+
+    struct Config {
+        size_t budget_bytes {512ull * 1024 * 1024};
+        int prefetch_frames {48};  // decoded ahead of the playhead, in the direction of play
+        int trailing_frames {12};  // kept on the other side
+        MappedFileIO::Config io {};
+
+        /**
+         *  @brief Reads the `[cache]` and `[io]` sections of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t hits;    // playhead moves whose frame was already cached
+        uint64_t misses;  // playhead moves that had to wait for the prefetch thread
+        uint64_t evictions;
+        uint64_t inserted;  // frames decoded into the cache
+        size_t frames;
+        size_t bytes;
+    };
+
+    /**
+     *  @brief Stops and joins the prefetch thread.
+     */
+    ~FrameCache();
+
+    /**
+     *  @param index_config Where to find or build the keyframe index used for seeking.
+     *  @param thread_count Codec threads of the cache's decoder.
+     *
+     *  @note Throws std::runtime_error if the file cannot be opened or has no video stream.
+     */
+    static std::shared_ptr<FrameCache> create(const std::filesystem::path &path,
+                                              const Config &config,
+                                              const KeyframeIndex::Config &index_config,
+                                              int thread_count);
+
+    /**
+     *  @brief Moves the playhead to `pts` and returns the frame displayed there if it is cached. Never blocks.
+     *
+     *  @return A new reference to the frame, or nullptr if the prefetch thread has not decoded it yet.
+     */
+    AVFramePtr get(int64_t pts, Direction direction);
+
+    AVRational getTimeBase() const { return m_time_base; }
+
+    /**
+     *  @return The nominal frame duration in time base units; 0 if unknown.
+     */
+    int64_t getFrameDuration() const { return m_frame_duration; }
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    struct Entry {
+        AVFramePtr frame;
+        int64_t duration;
+        size_t bytes;
+    };
+
+    // A run of missing frames, as the pts of its first and last frame.
+    struct Gap {
+        int64_t from;
+        int64_t to;
+    };
+
+    Config m_config {};
+    KeyframeIndex::Config m_index_config {};
+    std::filesystem::path m_path {};
+
+    // Only touched by the prefetch thread once started.
+    std::unique_ptr<FrameSeeker> m_seeker {};
+
+    AVRational m_time_base {};
+    int64_t m_frame_duration {};
+
+    mutable std::mutex m_mutex {};
+    std::condition_variable_any m_wakeup {};
+    std::map<int64_t, Entry> m_entries {};
+    size_t m_bytes {};
+    int64_t m_playhead {AV_NOPTS_VALUE};
+    Direction m_direction {Direction::Forward};
+    int64_t m_start {AV_NOPTS_VALUE};  // known bounds of the stream, learned while decoding
+    int64_t m_end {AV_NOPTS_VALUE};
+    bool m_moved {false};  // playhead moved since the prefetch thread last looked
+    bool m_idle {false};   // nothing left to prefetch until the playhead moves
+    std::atomic<uint64_t> m_generation {0};
+
+    uint64_t m_hits {};
+    uint64_t m_misses {};
+    uint64_t m_evictions {};
+    uint64_t m_inserted {};
+
+    // Declared last so the thread is joined before anything it touches is destroyed.
+    std::jthread m_prefetch_thread {};
+
+    FrameCache(const std::filesystem::path &path,
+               const Config &config,
+               const KeyframeIndex::Config &index_config,
+               int thread_count);
+
+    void prefetchLoop(std::stop_token stop);
+
+    /**
+     *  @brief Decodes the frames of `gap` into the cache, stopping early if the playhead moves.
+     */
+    void fill(const Gap &gap, const std::stop_token &stop);
+
+    /**
+     *  @return false if the frame pushed the cache over its budget and prefetching should pause.
+     */
+    bool insert(AVFramePtr frame, int64_t duration);
+
+    // The following require m_mutex.
+    std::optional<Gap> findGap() const;
+    std::map<int64_t, Entry>::const_iterator find(int64_t pts) const;
+    bool isInWindow(int64_t pts) const;
+
+    static size_t getFrameBytes(const AVFrame *frame);
+};
@@ -0,0 +1,121 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+
+FrameScheduler::Config FrameScheduler::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.master = MasterClock::parseSource(config_manager->getValue("sync", "master"), config.master);
+    config.max_consecutive_drops =
+        config_manager->getIntValue("sync", "max_consecutive_drops", config.max_consecutive_drops);
+    config.present_tolerance =
+        config_manager->getIntValue("sync", "present_tolerance_ms", config.present_tolerance * 1000) / 1000.0;
+    config.stats_interval = config_manager->getIntValue("sync", "stats_interval", config.stats_interval);
+    return config;
+}
+
+FrameScheduler::FrameScheduler(MasterClock &clock, const Config &config) : m_clock(clock), m_config(config) {}
+
+FrameScheduler::Action FrameScheduler::schedule(double pts, double duration) {
+    double clock = m_clock.getTime();
+
+    // Nothing to sync against yet (or no timestamp to sync with), so present right away.
+    if (std::isnan(clock) || std::isnan(pts)) {
+        if (!std::isnan(pts)) {
+            m_clock.setVideoTime(pts);
+        }
+        m_consecutive_drops = 0;
+        m_has_frame = true;
+        ++m_interval.presented;
+        BLOG_TRACE(MEDIA, "sync: present pts {:.3f} (no clock)", pts);
+        return Action::Present;
+    }
+
+    double lateness = clock - pts;
+    if (lateness < -m_config.present_tolerance) {
+        return Action::Wait;
+    }
+    if (lateness > duration && m_consecutive_drops < m_config.max_consecutive_drops) {
+        ++m_consecutive_drops;
+        ++m_interval.dropped;
+        BLOG_TRACE(MEDIA, "sync: drop pts {:.3f}, {:.1f} ms late", pts, lateness * 1000);
+        return Action::Drop;
+    }
+
+    m_clock.setVideoTime(pts);
+    m_consecutive_drops = 0;
+    m_has_frame = true;
+    ++m_interval.presented;
+    m_interval.lateness_sum += lateness;
+    m_interval.max_lateness = std::max(m_interval.max_lateness, lateness);
+    BLOG_TRACE(MEDIA, "sync: present pts {:.3f}, {:.1f} ms late", pts, lateness * 1000);
+    return Action::Present;
+}
+
+void FrameScheduler::endFrame(bool presented) {
+    if (!presented && m_has_frame && !m_clock.isPaused()) {
+        ++m_interval.repeated;
+    }
+
+    double now = m_clock.getNow();
+    if (std::isnan(m_interval_start)) {
+        m_interval_start = now;
+    }
+    if (m_config.stats_interval > 0 && now - m_interval_start >= m_config.stats_interval) {
+        logInterval(now);
+    }
+}
+
+FrameScheduler::Stats FrameScheduler::getStats() const {
+    Counters total = m_total;
+    total.add(m_interval);
+    return total.toStats();
+}
+
+void FrameScheduler::logStats() const {
+    auto stats = getStats();
+    INFO("sync [{}]: {} presented, {} dropped, {} repeated, lateness mean {:.1f} ms max {:.1f} ms",
+         MasterClock::getSourceName(m_clock.getActiveSource()),
+         stats.presented,
+         stats.dropped,
+         stats.repeated,
+         stats.mean_lateness * 1000,
+         stats.max_lateness * 1000);
+}
+
+void FrameScheduler::logInterval(double now) {
+    auto stats = m_interval.toStats();
+    INFO("sync [{}] last {:.1f}s: {} presented, {} dropped, {} repeated, lateness mean {:.1f} ms max {:.1f} ms",
+         MasterClock::getSourceName(m_clock.getActiveSource()),
+         now - m_interval_start,
+         stats.presented,
+         stats.dropped,
+         stats.repeated,
+         stats.mean_lateness * 1000,
+         stats.max_lateness * 1000);
+
+    m_total.add(m_interval);
+    m_interval = {};
+    m_interval_start = now;
+}
+
+void FrameScheduler::Counters::add(const Counters &other) {
+    max_lateness = std::max(max_lateness, other.max_lateness);
+    presented += other.presented;
+    dropped += other.dropped;
+    repeated += other.repeated;
+    lateness_sum += other.lateness_sum;
+}
+
+FrameScheduler::Stats FrameScheduler::Counters::toStats() const {
+    return {
+        presented,
+        dropped,
+        repeated,
+        presented ? lateness_sum / presented : 0.0,
+        max_lateness,
+    };
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "media/master_clock.h"
+
+/**
+ *  @class FrameScheduler
+ *
+ *  @brief Decides, once per presented buffer, which decoded video frame goes on screen.
+ *
+ *  The render loop offers the frame at the head of the queue until one is presented or the head is early:
+ *  - early frames wait, and the previous frame is repeated on this swap;
+ *  - frames already superseded by the next one (late by more than their duration) are dropped without being
+ *    uploaded, up to `max_consecutive_drops` in a row so the picture keeps moving under sustained load;
+ *  - anything else is presented and advances the video clock.
+ *
+ *  Per-frame decisions are traced, and a summary of the last interval is logged every `stats_interval` seconds.
+ *  All timing comes from the MasterClock, so a fake TimeSource makes the policy fully deterministic.
+ */
+class FrameScheduler {
+public:
+    enum class Action {
+        Present,
+        Wait,
+        Drop,
+    };
+
+    struct Config {
+        MasterClock::Source master {MasterClock::Source::Audio};
+        int max_consecutive_drops {8};
+        double present_tolerance {0.008};  // seconds a frame may be early and still be presented
+        double stats_interval {5.0};       // seconds between log summaries, 0 disables them
+
+        /**
+         *  @brief Reads the `[sync]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t presented;
+        uint64_t dropped;
+        uint64_t repeated;      // swaps that showed the previous frame again
+        double mean_lateness;   // seconds, over presented frames; negative means early
+        double max_lateness;
+    };
+
+    FrameScheduler(MasterClock &clock, const Config &config);
+
+    /**
+     *  @brief Decides what to do with the frame at the head of the queue.
+     *
+     *  @param pts Frame presentation time in seconds.
+     *  @param duration Frame duration in seconds.
+     */
+    Action schedule(double pts, double duration);
+
+    /**
+     *  @brief Closes the current swap.
+     *
+     *  @param presented Whether a new frame was presented; if not, the previous one was repeated.
+     */
+    void endFrame(bool presented);
+
+    /**
+     *  @return Totals since construction.
+     */
+    Stats getStats() const;
+
+    void logStats() const;
+
+    const Config &getConfig() const { return m_config; }
+
+private:
+    struct Counters {
+        uint64_t presented {};
+        uint64_t dropped {};
+        uint64_t repeated {};
+        double lateness_sum {};
+        double max_lateness {};
+
+        void add(const Counters &other);
+        FrameScheduler::Stats toStats() const;
+    };
+
+    MasterClock &m_clock;
+    Config m_config {};
+
+    int m_consecutive_drops {};
+    bool m_has_frame {false};
+
+    Counters m_total {};
+    Counters m_interval {};
+    double m_interval_start {NAN};
+
+    void logInterval(double now);
+};
\ No newline at end of file
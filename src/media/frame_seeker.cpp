@@ -0,0 +1,216 @@
+#include "frame_seeker.h"
+
+#include <cmath>
+
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+FrameSeeker::FrameSeeker(const std::filesystem::path &path,
+                         const MappedFileIO::Config &io,
+                         std::shared_ptr<const KeyframeIndex> index,
+                         int thread_count,
+                         std::shared_ptr<FrameBufferPool> buffer_pool)
+    : m_index(std::move(index)) {
+    m_demuxer = std::make_unique<Demuxer>(path, io);
+    AVStream *stream = m_demuxer->getVideoStream();
+    if (!stream) {
+        FATAL("no video stream in {}", path.string());
+    }
+    // Only video is decoded here.
+    if (auto audio_stream = m_demuxer->getAudioStream()) {
+        audio_stream->discard = AVDISCARD_ALL;
+    }
+
+    m_stream_index = stream->index;
+    m_time_base = stream->time_base;
+    m_start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+        m_frame_duration = av_rescale_q(1, av_inv_q(stream->avg_frame_rate), m_time_base);
+    }
+
+    m_decoder = std::make_unique<Decoder>(stream, thread_count, std::move(buffer_pool));
+    m_packet = allocPacket();
+}
+
+FrameSeeker::~FrameSeeker() { DEBUG("release FrameSeeker: {}", (void *)this); }
+
+AVFramePtr FrameSeeker::seek(int64_t pts) {
+    TRACE_ZONE("seek");
+    ++m_stats.seeks;
+
+    const KeyframeIndex::Entry *keyframe = m_index ? m_index->findKeyframe(m_stream_index, pts) : nullptr;
+    // Within the GOP being decoded, decoding forward is cheaper than going back to its keyframe.
+    const bool in_gop = keyframe && m_last && keyframe->pts <= m_position && m_position <= pts;
+    AVFramePtr previous {};
+    if (in_gop) {
+        ++m_stats.in_gop_seeks;
+        previous = allocFrame();
+        if (av_frame_ref(previous.get(), m_last.get()) < 0) {
+            previous.reset();
+        }
+    } else if (!seekDemuxer(pts, keyframe)) {
+        return nullptr;
+    }
+
+    // The target is the last frame starting at or before `pts`, so it is only known once the next one shows up.
+    m_discard_before = pts;
+    auto frame = m_pending ? std::move(m_pending) : decodeFrame();
+    while (frame) {
+        int64_t frame_pts = getFramePts(frame.get());
+        if (frame_pts == AV_NOPTS_VALUE || frame_pts >= pts) {
+            if (frame_pts > pts && previous) {
+                m_pending = std::move(frame);
+                frame = std::move(previous);
+            }
+            break;
+        }
+        previous = std::move(frame);
+        frame = decodeFrame();
+    }
+    m_discard_before = AV_NOPTS_VALUE;
+
+    // Past the last frame, the last frame stays on screen.
+    return remember(frame ? std::move(frame) : std::move(previous));
+}
+
+AVFramePtr FrameSeeker::seekToTime(double seconds) {
+    return seek(m_start_time + std::llround(seconds / av_q2d(m_time_base)));
+}
+
+AVFramePtr FrameSeeker::seekKeyframe(int64_t pts) {
+    TRACE_ZONE("seek keyframe");
+    ++m_stats.seeks;
+
+    // Without an index, libavformat's search lands on the keyframe at or before `pts` as well.
+    const KeyframeIndex::Entry *keyframe = m_index ? m_index->findKeyframe(m_stream_index, pts) : nullptr;
+    if (!seekDemuxer(pts, keyframe)) {
+        return nullptr;
+    }
+    int ret;
+    while ((ret = m_demuxer->readPacket(m_packet.get())) >= 0) {
+        if (m_packet->stream_index == m_stream_index && (m_packet->flags & AV_PKT_FLAG_KEY)) {
+            break;
+        }
+        av_packet_unref(m_packet.get());
+    }
+    if (ret < 0) {
+        return nullptr;
+    }
+
+    ++m_stats.packets;
+    m_decoder->getCodecContext()->skip_frame = AVDISCARD_DEFAULT;
+    ret = m_decoder->sendPacket(m_packet.get());
+    av_packet_unref(m_packet.get());
+    if (ret < 0) {
+        WARN("failed to send packet to decoder: {}", avErrorString(ret));
+        return nullptr;
+    }
+    // Draining hands the frame out right away instead of after the codec's reorder delay.
+    m_decoder->sendPacket(nullptr);
+    m_draining = true;
+    auto frame = decodeFrame();
+    m_decoder->flush();
+    m_draining = false;
+    return frame;
+}
+
+AVFramePtr FrameSeeker::readFrame() { return remember(m_pending ? std::move(m_pending) : decodeFrame()); }
+
+bool FrameSeeker::seekDemuxer(int64_t pts, const KeyframeIndex::Entry *keyframe) {
+    AVFormatContext *format_ctx = m_demuxer->getFormatContext();
+    int ret;
+    if (keyframe) {
+        ++m_stats.index_seeks;
+        // Demuxers relying on the generic index would find the keyframe by bisecting the file with reads; its byte
+        // offset gets there directly. Others have a native index and land exactly on the keyframe's timestamp.
+        const int flags = format_ctx->iformat->flags;
+        ret = -1;
+        if (keyframe->pos >= 0 && (flags & AVFMT_GENERIC_INDEX) && !(flags & AVFMT_NO_BYTE_SEEK)) {
+            ret = av_seek_frame(format_ctx, m_stream_index, keyframe->pos, AVSEEK_FLAG_BYTE);
+        }
+        if (ret < 0) {
+            ret = av_seek_frame(format_ctx, m_stream_index, keyframe->pts, AVSEEK_FLAG_BACKWARD);
+        }
+    } else {
+        ++m_stats.search_seeks;
+        ret = av_seek_frame(format_ctx, m_stream_index, pts, AVSEEK_FLAG_BACKWARD);
+    }
+    if (ret < 0) {
+        WARN("failed to seek to {}: {}", pts, avErrorString(ret));
+        return false;
+    }
+
+    m_decoder->flush();
+    m_pending.reset();
+    m_last.reset();
+    m_position = AV_NOPTS_VALUE;
+    m_draining = false;
+    return true;
+}
+
+AVFramePtr FrameSeeker::decodeFrame() {
+    AVFramePtr frame = allocFrame();
+    if (!frame) {
+        ERROR("failed to allocate frame!");
+        return nullptr;
+    }
+
+    while (true) {
+        int ret = m_decoder->receiveFrame(frame.get());
+        if (ret >= 0) {
+            ++m_stats.frames_decoded;
+            return frame;
+        }
+        if (ret != AVERROR(EAGAIN) || m_draining) {
+            if (ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+                WARN("failed to decode frame: {}", avErrorString(ret));
+            }
+            return nullptr;
+        }
+
+        ret = m_demuxer->readPacket(m_packet.get());
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                WARN("failed to read packet: {}", avErrorString(ret));
+            }
+            m_draining = true;
+            m_decoder->sendPacket(nullptr);
+            continue;
+        }
+        if (m_packet->stream_index != m_stream_index) {
+            av_packet_unref(m_packet.get());
+            continue;
+        }
+
+        // A frame that ends before the target is never shown; if no other frame references it, it need not be
+        // decoded either. Frames overlapping the target are always decoded, since one of them is the answer.
+        int64_t duration = getPacketDuration(m_packet.get());
+        const bool skip_nonref = m_discard_before != AV_NOPTS_VALUE && m_packet->pts != AV_NOPTS_VALUE &&
+                                 duration > 0 && m_packet->pts + duration <= m_discard_before;
+        m_decoder->getCodecContext()->skip_frame = skip_nonref ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+        ++m_stats.packets;
+        m_stats.nonref_skips += skip_nonref;
+
+        ret = m_decoder->sendPacket(m_packet.get());
+        av_packet_unref(m_packet.get());
+        if (ret < 0) {
+            WARN("failed to send packet to decoder: {}", avErrorString(ret));
+        }
+    }
+}
+
+AVFramePtr FrameSeeker::remember(AVFramePtr frame) {
+    if (!frame) {
+        return nullptr;
+    }
+    m_position = getFramePts(frame.get());
+    m_last = allocFrame();
+    if (av_frame_ref(m_last.get(), frame.get()) < 0) {
+        m_last.reset();
+    }
+    return frame;
+}
+
+int64_t FrameSeeker::getPacketDuration(const AVPacket *packet) const {
+    return packet->duration > 0 ? packet->duration : m_frame_duration;
+}
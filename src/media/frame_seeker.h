@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/decoder.h"
+#include "media/demuxer.h"
+#include "media/keyframe_index.h"
+
+/**
+ *  @class FrameSeeker
+ *
+ *  @brief Random access to the decoded video frames of a file, exact to the frame.
+ *
+ *  A seek jumps to the last keyframe at or before the target, taken from the KeyframeIndex, and decodes forward
+ *  from there. Frames that end before the target are decoded with `AVDISCARD_NONREF`, so non-reference frames
+ *  (typically B-frames) are not decoded at all on the way. A target further into the GOP that is already being
+ *  decoded does not seek the demuxer.
+ *
+ *  Without an index, seeks fall back to libavformat's own search.
+ *
+ *  @note Not thread-safe; owns its own demuxer and decoder, independent from any MediaEngine on the same file.
+ */
+class FrameSeeker {
+public:
+    NONCOPYABLE(FrameSeeker)
+    NONMOVABLE(FrameSeeker)
+
+    struct Stats {
+        uint64_t seeks;
+        uint64_t index_seeks;     // demuxer moved straight to an indexed keyframe
+        uint64_t search_seeks;    // demuxer searched by libavformat, without the index
+        uint64_t in_gop_seeks;    // target reached by decoding forward, without seeking the demuxer
+        uint64_t packets;         // video packets sent to the decoder
+        uint64_t nonref_skips;    // packets sent while non-reference frames were being discarded
+        uint64_t frames_decoded;  // frames received from the decoder, including ones before the target
+    };
+
+    /**
+     *  @param io How the file is read, see Demuxer.
+     *  @param index Keyframe index of `path`, or nullptr to seek without one.
+     *
+     *  @note Throws std::runtime_error if the file cannot be opened or has no video stream.
+     */
+    FrameSeeker(const std::filesystem::path &path,
+                const MappedFileIO::Config &io,
+                std::shared_ptr<const KeyframeIndex> index,
+                int thread_count,
+                std::shared_ptr<FrameBufferPool> buffer_pool = {});
+    ~FrameSeeker();
+
+    /**
+     *  @return The frame displayed at `pts` (in the stream's time base): the last frame starting at or before it,
+     *          or the first frame if `pts` precedes the stream. nullptr on error or if the stream has no frames.
+     */
+    AVFramePtr seek(int64_t pts);
+
+    /**
+     *  @brief Like `seek`, with `seconds` counted from the start of the stream.
+     */
+    AVFramePtr seekToTime(double seconds);
+
+    /**
+     *  @brief Decodes only the keyframe at or before `pts`; no other packet reaches the decoder.
+     *
+     *  @return The keyframe, or nullptr on error.
+     *
+     *  @note Leaves no decode position: the next call must be a seek, not `readFrame`.
+     */
+    AVFramePtr seekKeyframe(int64_t pts);
+
+    /**
+     *  @return The frame following the last one returned, or nullptr at the end of the stream.
+     */
+    AVFramePtr readFrame();
+
+    AVRational getTimeBase() const { return m_time_base; }
+
+    /**
+     *  @return The pts of the first frame, 0 if the container does not say.
+     */
+    int64_t getStartTime() const { return m_start_time; }
+
+    /**
+     *  @return Seconds of `pts` from the start of the stream.
+     */
+    double toSeconds(int64_t pts) const { return (pts - m_start_time) * av_q2d(m_time_base); }
+
+    /**
+     *  @return The nominal frame duration in time base units, from the stream's average frame rate; 0 if unknown.
+     */
+    int64_t getFrameDuration() const { return m_frame_duration; }
+
+    /**
+     *  @return The pts of the last frame returned, AV_NOPTS_VALUE before the first one or after a failed seek.
+     */
+    int64_t getPosition() const { return m_position; }
+
+    /**
+     *  @brief Replaces the keyframe index, e.g. once one has been built for a file that had none.
+     */
+    void setIndex(std::shared_ptr<const KeyframeIndex> index) { m_index = std::move(index); }
+    bool hasIndex() const { return m_index != nullptr; }
+
+    const Decoder &getDecoder() const { return *m_decoder; }
+
+    const Stats &getStats() const { return m_stats; }
+
+private:
+    std::unique_ptr<Demuxer> m_demuxer {};
+    std::unique_ptr<Decoder> m_decoder {};
+    std::shared_ptr<const KeyframeIndex> m_index {};
+
+    int m_stream_index {-1};
+    AVRational m_time_base {};
+    int64_t m_start_time {};
+    int64_t m_frame_duration {};  // nominal, in time base units; 0 if unknown
+
+    AVPacketPtr m_packet {};
+    AVFramePtr m_pending {};  // decoded past a seek target, returned by the next readFrame
+    AVFramePtr m_last {};     // reference to the last frame returned, for targets that land on it again
+    int64_t m_position {AV_NOPTS_VALUE};  // pts of the last frame returned
+    int64_t m_discard_before {AV_NOPTS_VALUE};  // frames ending at or before this may skip decoding
+    bool m_draining {false};
+
+    Stats m_stats {};
+
+    bool seekDemuxer(int64_t pts, const KeyframeIndex::Entry *keyframe);
+
+    AVFramePtr decodeFrame();
+
+    /**
+     *  @brief Records `frame` as the current position before it is returned.
+     */
+    AVFramePtr remember(AVFramePtr frame);
+
+    /**
+     *  @return The time-base duration of `packet`, falling back to the nominal frame duration.
+     */
+    int64_t getPacketDuration(const AVPacket *packet) const;
+
+    static int64_t getFramePts(const AVFrame *frame) { return frame->best_effort_timestamp; }
+};
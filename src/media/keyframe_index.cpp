@@ -0,0 +1,270 @@
+#include "keyframe_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "base/atomic_file.h"
+#include "base/hash.h"
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "media/demuxer.h"
+
+namespace {
+
+// Identifies the version of the source a sidecar was built from.
+bool getSourceStamp(const std::filesystem::path &source, uint64_t *size, int64_t *mtime) {
+    std::error_code ec;
+    *size = std::filesystem::file_size(source, ec);
+    if (ec) {
+        return false;
+    }
+    *mtime = std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+    return !ec;
+}
+
+}  // namespace
+
+KeyframeIndex::Config KeyframeIndex::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.directory = config_manager->getValue("index", "directory");
+    config.enabled = config_manager->getIntValue("index", "enabled", config.enabled) != 0;
+    return config;
+}
+
+KeyframeIndex::Builder::Builder(const Demuxer &demuxer) {
+    for (const AVStream *stream : {demuxer.getVideoStream(), demuxer.getAudioStream()}) {
+        if (!stream) {
+            continue;
+        }
+        // Every audio packet is a keyframe; one entry per interval is plenty to seek to.
+        int64_t min_interval = 0;
+        if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+            min_interval = static_cast<int64_t>(kMinIntraInterval / av_q2d(stream->time_base));
+        }
+        m_streams.push_back({stream->index, stream->time_base, min_interval, AV_NOPTS_VALUE, {}});
+    }
+}
+
+void KeyframeIndex::Builder::addPacket(const AVPacket *packet) {
+    if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+        return;
+    }
+    auto stream = std::find_if(
+        m_streams.begin(), m_streams.end(), [&](const Stream &s) { return s.index == packet->stream_index; });
+    if (stream == m_streams.end()) {
+        return;
+    }
+
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    if (stream->min_interval > 0 && stream->last_pts != AV_NOPTS_VALUE &&
+        pts - stream->last_pts < stream->min_interval) {
+        return;
+    }
+    stream->last_pts = pts;
+    stream->entries.push_back({pts, packet->dts, packet->pos});
+}
+
+std::shared_ptr<KeyframeIndex> KeyframeIndex::Builder::finish(const std::filesystem::path &source,
+                                                              const Config &config) {
+    for (auto &stream : m_streams) {
+        std::stable_sort(stream.entries.begin(), stream.entries.end(), [](const Entry &a, const Entry &b) {
+            return a.pts < b.pts;
+        });
+    }
+
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    getSourceStamp(source, &source_size, &source_mtime);
+    auto bytes = serialize(source_size, source_mtime);
+
+    // Renamed into place, so a concurrent reader never maps a half-written file and two players indexing the same
+    // source at once do not write into the same file.
+    auto path = getSidecarPath(source, config);
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (writeFileAtomically(path, bytes.data(), bytes.size(), ec)) {
+        if (auto index = load(source, config)) {
+            INFO("wrote keyframe index of {} to {}", source.string(), path.string());
+            return index;
+        }
+    }
+
+    WARN("failed to write keyframe index {}, keeping it in memory", path.string());
+    auto index = std::shared_ptr<KeyframeIndex> {new KeyframeIndex {}};
+    index->m_owned = std::move(bytes);
+    index->attach(index->m_owned.data(), index->m_owned.size(), source_size, source_mtime);
+    return index;
+}
+
+std::vector<std::byte> KeyframeIndex::Builder::serialize(uint64_t source_size, int64_t source_mtime) const {
+    uint64_t entry_count = 0;
+    for (const auto &stream : m_streams) {
+        entry_count += stream.entries.size();
+    }
+
+    std::vector<std::byte> bytes(sizeof(FileHeader) + m_streams.size() * sizeof(StreamHeader) +
+                                 entry_count * sizeof(Entry));
+    auto *header = reinterpret_cast<FileHeader *>(bytes.data());
+    std::memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = kVersion;
+    header->stream_count = static_cast<uint32_t>(m_streams.size());
+    header->source_size = source_size;
+    header->source_mtime = source_mtime;
+    header->entry_count = entry_count;
+
+    auto *stream_headers = reinterpret_cast<StreamHeader *>(header + 1);
+    auto *entries = reinterpret_cast<Entry *>(stream_headers + m_streams.size());
+    uint64_t first_entry = 0;
+    for (const auto &stream : m_streams) {
+        *stream_headers++ = {stream.index,
+                             stream.time_base.num,
+                             stream.time_base.den,
+                             0,
+                             first_entry,
+                             static_cast<uint64_t>(stream.entries.size())};
+        std::copy(stream.entries.begin(), stream.entries.end(), entries + first_entry);
+        first_entry += stream.entries.size();
+    }
+    return bytes;
+}
+
+KeyframeIndex::~KeyframeIndex() {
+    if (m_mapping) {
+        munmap(m_mapping, m_mapping_size);
+    }
+    DEBUG("release KeyframeIndex: {}", (void *)this);
+}
+
+std::shared_ptr<KeyframeIndex> KeyframeIndex::load(const std::filesystem::path &source, const Config &config) {
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    if (!getSourceStamp(source, &source_size, &source_mtime)) {
+        return nullptr;
+    }
+
+    auto path = getSidecarPath(source, config);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st {};
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(FileHeader))) {
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto index = std::shared_ptr<KeyframeIndex> {new KeyframeIndex {}};
+    index->m_mapping = mapping;
+    index->m_mapping_size = st.st_size;
+    if (!index->attach(static_cast<const std::byte *>(mapping), st.st_size, source_size, source_mtime)) {
+        DEBUG("keyframe index {} is stale or invalid", path.string());
+        return nullptr;
+    }
+    DEBUG("mapped keyframe index {} ({} entries)", path.string(), index->getEntryCount());
+    return index;
+}
+
+std::shared_ptr<KeyframeIndex> KeyframeIndex::loadOrBuild(const std::filesystem::path &source,
+                                                          const Config &config,
+                                                          const MappedFileIO::Config &io) {
+    if (auto index = load(source, config)) {
+        return index;
+    }
+
+    Demuxer demuxer {source, io};
+    Builder builder {demuxer};
+    AVPacketPtr packet = allocPacket();
+    int ret;
+    while ((ret = demuxer.readPacket(packet.get())) >= 0) {
+        builder.addPacket(packet.get());
+        av_packet_unref(packet.get());
+    }
+    if (ret != AVERROR_EOF) {
+        WARN("keyframe scan of {} stopped early: {}", source.string(), avErrorString(ret));
+    }
+    return builder.finish(source, config);
+}
+
+std::filesystem::path KeyframeIndex::getSidecarPath(const std::filesystem::path &source, const Config &config) {
+    auto directory = config.directory.empty() ? std::filesystem::temp_directory_path() / "video-app-index"
+                                              : config.directory;
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(source, ec).lexically_normal();
+    // FNV-1a rather than std::hash, so every build finds the sidecars of the others.
+    return directory / fmt::format("{}-{:016x}.kfindex", source.stem().string(), fnv1a64(absolute.string()));
+}
+
+std::span<const KeyframeIndex::Entry> KeyframeIndex::getEntries(int stream_index) const {
+    for (uint32_t i = 0; i < m_header->stream_count; ++i) {
+        if (m_streams[i].stream_index == stream_index) {
+            return {m_entries + m_streams[i].first_entry, static_cast<size_t>(m_streams[i].entry_count)};
+        }
+    }
+    return {};
+}
+
+AVRational KeyframeIndex::getTimeBase(int stream_index) const {
+    for (uint32_t i = 0; i < m_header->stream_count; ++i) {
+        if (m_streams[i].stream_index == stream_index) {
+            return {m_streams[i].time_base_num, m_streams[i].time_base_den};
+        }
+    }
+    return {0, 1};
+}
+
+const KeyframeIndex::Entry *KeyframeIndex::findKeyframe(int stream_index, int64_t pts) const {
+    auto entries = getEntries(stream_index);
+    if (entries.empty()) {
+        return nullptr;
+    }
+    auto it = std::upper_bound(
+        entries.begin(), entries.end(), pts, [](int64_t value, const Entry &entry) { return value < entry.pts; });
+    return it == entries.begin() ? &entries.front() : &*(it - 1);
+}
+
+size_t KeyframeIndex::getEntryCount() const { return m_header->entry_count; }
+
+bool KeyframeIndex::attach(const std::byte *data, size_t size, uint64_t source_size, int64_t source_mtime) {
+    auto header = reinterpret_cast<const FileHeader *>(data);
+    if (size < sizeof(FileHeader) || std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->version != kVersion || header->source_size != source_size || header->source_mtime != source_mtime) {
+        return false;
+    }
+    // Counts come from the file, so they are checked against its size before anything is multiplied or indexed.
+    const size_t stream_bytes = size - sizeof(FileHeader);
+    if (header->stream_count > stream_bytes / sizeof(StreamHeader)) {
+        return false;
+    }
+    const size_t entry_bytes = stream_bytes - header->stream_count * sizeof(StreamHeader);
+    if (header->entry_count > entry_bytes / sizeof(Entry) || entry_bytes != header->entry_count * sizeof(Entry)) {
+        return false;
+    }
+
+    auto streams = reinterpret_cast<const StreamHeader *>(header + 1);
+    for (uint32_t i = 0; i < header->stream_count; ++i) {
+        if (streams[i].first_entry > header->entry_count ||
+            streams[i].entry_count > header->entry_count - streams[i].first_entry) {
+            return false;
+        }
+    }
+    m_header = header;
+    m_streams = streams;
+    m_entries = reinterpret_cast<const Entry *>(streams + header->stream_count);
+    return true;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/mapped_file_io.h"
+
+class Demuxer;
+
+/**
+ *  @class KeyframeIndex
+ *
+ *  @brief Keyframe positions (pts, dts and byte offset) of every consumed stream of a media file.
+ *
+ *  The index is persisted as a sidecar file in the configured directory and memory-mapped when loaded, so opening
+ *  a file that was played before costs one `mmap` instead of a scan. Sidecars are keyed by the source path and
+ *  invalidated by its size and modification time.
+ *
+ *  Entries of each stream are sorted by pts. Streams where every packet is a keyframe (audio) are thinned to one
+ *  entry per `kMinIntraInterval` seconds.
+ *
+ *  @note Immutable once created; safe to share between threads.
+ */
+class KeyframeIndex {
+public:
+    NONCOPYABLE(KeyframeIndex)
+    NONMOVABLE(KeyframeIndex)
+
+    struct Entry {
+        int64_t pts;
+        int64_t dts;
+        int64_t pos;  // byte offset of the packet, or -1 if the demuxer does not know it
+    };
+
+    struct Config {
+        std::filesystem::path directory {};  // where sidecars live; empty means a directory under the temp dir
+        bool enabled {true};
+
+        /**
+         *  @brief Reads the `[index]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    /**
+     *  @class Builder
+     *
+     *  @brief Collects keyframes from packets as they are demuxed.
+     *
+     *  @note Packets must be fed in file order from the start, without seeking, or the index would have holes.
+     */
+    class Builder {
+    public:
+        explicit Builder(const Demuxer &demuxer);
+
+        void addPacket(const AVPacket *packet);
+
+        /**
+         *  @brief Writes the sidecar of `source` and maps it back.
+         *
+         *  @return The index; kept in memory if the sidecar cannot be written.
+         */
+        std::shared_ptr<KeyframeIndex> finish(const std::filesystem::path &source, const Config &config);
+
+    private:
+        struct Stream {
+            int index;
+            AVRational time_base;
+            int64_t min_interval;  // in time base units, 0 keeps every keyframe
+            int64_t last_pts;
+            std::vector<Entry> entries;
+        };
+
+        std::vector<Stream> m_streams {};
+
+        std::vector<std::byte> serialize(uint64_t source_size, int64_t source_mtime) const;
+    };
+
+    ~KeyframeIndex();
+
+    /**
+     *  @return The index of `source` from its sidecar, or nullptr if there is none or it is stale.
+     */
+    static std::shared_ptr<KeyframeIndex> load(const std::filesystem::path &source, const Config &config);
+
+    /**
+     *  @brief Loads the sidecar of `source`, or scans the file's packets (without decoding) to build one.
+     *
+     *  @param io How `source` is read for the scan, see Demuxer.
+     */
+    static std::shared_ptr<KeyframeIndex> loadOrBuild(const std::filesystem::path &source,
+                                                      const Config &config,
+                                                      const MappedFileIO::Config &io);
+
+    static std::filesystem::path getSidecarPath(const std::filesystem::path &source, const Config &config);
+
+    /**
+     *  @return The entries of `stream_index`, empty if the stream is not indexed.
+     */
+    std::span<const Entry> getEntries(int stream_index) const;
+
+    /**
+     *  @return The time base of the entries of `stream_index`, {0, 1} if the stream is not indexed.
+     */
+    AVRational getTimeBase(int stream_index) const;
+
+    /**
+     *  @return The last keyframe at or before `pts`, the first keyframe if `pts` precedes all of them, or nullptr if
+     *          the stream has no entries.
+     */
+    const Entry *findKeyframe(int stream_index, int64_t pts) const;
+
+    size_t getEntryCount() const;
+
+    /**
+     *  @return true if the index is backed by a mapped sidecar, false if it only lives in memory.
+     */
+    bool isMapped() const { return m_mapping != nullptr; }
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t stream_count;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t entry_count;
+    };
+
+    struct StreamHeader {
+        int32_t stream_index;
+        int32_t time_base_num;
+        int32_t time_base_den;
+        uint32_t reserved;
+        uint64_t first_entry;
+        uint64_t entry_count;
+    };
+
+    // The file is the FileHeader, then `stream_count` StreamHeaders, then all entries; everything is 8-byte aligned
+    // so the mapping can be read in place.
+    static constexpr char kMagic[8] {'V', 'A', 'K', 'F', 'I', 'D', 'X', '\0'};
+    static constexpr uint32_t kVersion = 1;
+
+    static constexpr double kMinIntraInterval = 0.5;
+
+    void *m_mapping {};
+    size_t m_mapping_size {};
+    std::vector<std::byte> m_owned {};  // used instead of a mapping when the sidecar could not be written
+
+    const FileHeader *m_header {};
+    const StreamHeader *m_streams {};
+    const Entry *m_entries {};
+
+    KeyframeIndex() = default;
+
+    /**
+     *  @return true if `data` holds a well-formed index for a source of the given size and modification time.
+     */
+    bool attach(const std::byte *data, size_t size, uint64_t source_size, int64_t source_mtime);
+};
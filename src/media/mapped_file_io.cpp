@@ -0,0 +1,170 @@
+#include "mapped_file_io.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+MappedFileIO::Config MappedFileIO::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.enabled = config_manager->getIntValue("io", "mmap", config.enabled) != 0;
+    config.readahead_bytes =
+        config_manager->getIntValue("io", "readahead_mb", config.readahead_bytes >> 20) << 20;
+    return config;
+}
+
+std::unique_ptr<MappedFileIO> MappedFileIO::open(const std::filesystem::path &path, const Config &config) {
+    if (!config.enabled) {
+        return nullptr;
+    }
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return nullptr;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        WARN("failed to open {} for mapping: {}", path.string(), std::strerror(errno));
+        return nullptr;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        WARN("failed to map {}: {}", path.string(), std::strerror(errno));
+        return nullptr;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    return std::unique_ptr<MappedFileIO>(new MappedFileIO(config, static_cast<uint8_t *>(data), size));
+}
+
+MappedFileIO::MappedFileIO(const Config &config, uint8_t *data, size_t size)
+    : m_config(config), m_data(data), m_size(size), m_page_size(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+    m_config.readahead_bytes = std::max(m_config.readahead_bytes, m_page_size);
+
+    auto *buffer = static_cast<unsigned char *>(av_malloc(kBufferSize));
+    m_context = buffer ? avio_alloc_context(buffer, kBufferSize, 0, this, &readPacket, nullptr, &seek) : nullptr;
+    if (!m_context) {
+        av_free(buffer);
+        munmap(m_data, m_size);
+        FATAL("failed to allocate AVIOContext");
+    }
+    updateReadahead();
+}
+
+MappedFileIO::~MappedFileIO() {
+    DEBUG("release MappedFileIO: {}", (void *)this);
+    // libavformat may have replaced the buffer it was given.
+    av_freep(&m_context->buffer);
+    avio_context_free(&m_context);
+    munmap(m_data, m_size);
+}
+
+MappedFileIO::Stats MappedFileIO::getStats() const {
+    return {
+        m_size,
+        m_bytes_read.load(std::memory_order_relaxed),
+        m_reads.load(std::memory_order_relaxed),
+        m_seeks.load(std::memory_order_relaxed),
+        m_readahead_calls.load(std::memory_order_relaxed),
+        m_released_bytes.load(std::memory_order_relaxed),
+    };
+}
+
+void MappedFileIO::updateReadahead() {
+    if (m_position >= m_size) {
+        return;
+    }
+    const size_t readahead = m_config.readahead_bytes;
+    const bool inside = m_position >= m_window_begin && m_position < m_window_end;
+    if (inside && (m_window_end == m_size || m_window_end - m_position > readahead / 2)) {
+        return;
+    }
+
+    TRACE_ZONE("readahead");
+    const size_t begin = alignDown(m_position);
+    const size_t end = std::min(m_size, begin + readahead);
+    // Only the part not already advised, when moving forward through the file.
+    const size_t advise_begin = inside ? m_window_end : begin;
+    if (end > advise_begin) {
+        madvise(m_data + advise_begin, end - advise_begin, MADV_WILLNEED);
+        m_readahead_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_window_begin = begin;
+    m_window_end = end;
+
+    // Unmap what lies more than a window behind; reading it again is a minor fault served from the page cache.
+    const size_t release_end = begin > readahead ? alignDown(begin - readahead) : 0;
+    if (release_end > m_released_end) {
+        madvise(m_data + m_released_end, release_end - m_released_end, MADV_DONTNEED);
+        m_released_bytes.fetch_add(release_end - m_released_end, std::memory_order_relaxed);
+        m_released_end = release_end;
+    } else if (begin < m_released_end) {
+        // Seeked back into the released range: it gets mapped again from here on.
+        m_released_end = begin;
+    }
+}
+
+int MappedFileIO::readPacket(void *opaque, uint8_t *buffer, int size) {
+    auto *self = static_cast<MappedFileIO *>(opaque);
+    if (self->m_position >= self->m_size) {
+        return AVERROR_EOF;
+    }
+    const size_t count = std::min(static_cast<size_t>(size), self->m_size - self->m_position);
+    std::memcpy(buffer, self->m_data + self->m_position, count);
+    self->m_position += count;
+    self->m_bytes_read.fetch_add(count, std::memory_order_relaxed);
+    self->m_reads.fetch_add(1, std::memory_order_relaxed);
+    self->updateReadahead();
+    return static_cast<int>(count);
+}
+
+int64_t MappedFileIO::seek(void *opaque, int64_t offset, int whence) {
+    auto *self = static_cast<MappedFileIO *>(opaque);
+    const auto size = static_cast<int64_t>(self->m_size);
+    int64_t position;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return size;
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = static_cast<int64_t>(self->m_position) + offset;
+            break;
+        case SEEK_END:
+            position = size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    // Past the end is allowed, like lseek; the next read reports EOF.
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+    self->m_position = static_cast<size_t>(position);
+    self->m_seeks.fetch_add(1, std::memory_order_relaxed);
+    self->updateReadahead();
+    return position;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+struct AVIOContext;
+
+/**
+ *  @class MappedFileIO
+ *
+ *  @brief An `AVIOContext` reading a local file through a read-only memory mapping instead of the `file` protocol.
+ *
+ *  libavformat's file protocol issues a `read()` per 32 KiB buffer refill, which adds up to tens of thousands of
+ *  syscalls per second on high-bitrate intra codecs. Here refills are a `memcpy` out of the mapping and seeks are
+ *  pointer arithmetic. The kernel is kept ahead of the reader with a sliding `MADV_WILLNEED` window, and pages far
+ *  behind it are unmapped again (they stay in the page cache), so resident memory does not grow with the file.
+ *
+ *  Unlike the file protocol, which returns a read error, a mapping faults with SIGBUS when the file is truncated
+ *  under it and a page past the new end is read. Files that may be rewritten in place while playing (growing
+ *  recordings, files replaced by copying over them) should be read with `[io] mmap = 0`.
+ *
+ *  @note Reads and seeks come from whichever thread drives the owning AVFormatContext; stats can be read from any
+ *        thread.
+ */
+class MappedFileIO {
+public:
+    NONCOPYABLE(MappedFileIO)
+    NONMOVABLE(MappedFileIO)
+
+    struct Config {
+        bool enabled {true};
+        size_t readahead_bytes {16ull << 20};  // size of the window advised ahead of the read position
+
+        /**
+         *  @brief Reads the `[io]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t file_bytes {};
+        uint64_t bytes_read {};
+        uint64_t reads {};           // buffer refills served from the mapping
+        uint64_t seeks {};
+        uint64_t readahead_calls {};  // madvise(MADV_WILLNEED) calls, one per window step or far seek
+        uint64_t released_bytes {};   // bytes unmapped behind the read position
+    };
+
+    /**
+     *  @return The mapped file, or nullptr if mapping is disabled or `path` is not a non-empty regular file (pipes,
+     *          devices and URLs keep using libavformat's own protocols).
+     */
+    static std::unique_ptr<MappedFileIO> open(const std::filesystem::path &path, const Config &config);
+
+    ~MappedFileIO();
+
+    /**
+     *  @return The context to set as `AVFormatContext::pb` before `avformat_open_input`. Owned by this object,
+     *          which must outlive the format context.
+     */
+    AVIOContext *getContext() const { return m_context; }
+
+    Stats getStats() const;
+
+private:
+    // Refill size of the AVIOContext buffer; a memcpy, so it only needs to be large enough to amortize the call.
+    static constexpr int kBufferSize = 256 * 1024;
+
+    Config m_config {};
+    uint8_t *m_data {};  // mapped read-only
+    size_t m_size {};
+    size_t m_page_size {};
+    AVIOContext *m_context {};
+
+    // Only touched by the reading thread.
+    size_t m_position {};
+    size_t m_window_begin {};  // [begin, end) last advised with MADV_WILLNEED
+    size_t m_window_end {};
+    size_t m_released_end {};  // pages below this were unmapped
+
+    std::atomic<uint64_t> m_bytes_read {0};
+    std::atomic<uint64_t> m_reads {0};
+    std::atomic<uint64_t> m_seeks {0};
+    std::atomic<uint64_t> m_readahead_calls {0};
+    std::atomic<uint64_t> m_released_bytes {0};
+
+    MappedFileIO(const Config &config, uint8_t *data, size_t size);
+
+    /**
+     *  @brief Moves the readahead window along once the read position gets within half a window of its end or
+     *         leaves it, and unmaps pages more than a window behind.
+     */
+    void updateReadahead();
+
+    size_t alignDown(size_t offset) const { return offset & ~(m_page_size - 1); }
+
+    static int readPacket(void *opaque, uint8_t *buffer, int size);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+};
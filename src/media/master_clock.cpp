@@ -0,0 +1,106 @@
+#include "master_clock.h"
+
+#include <chrono>
+#include <cmath>
+
+double MasterClock::steadyTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MasterClock::Source MasterClock::parseSource(const std::string &name, Source fallback) {
+    if (name == "audio") {
+        return Source::Audio;
+    }
+    if (name == "video") {
+        return Source::Video;
+    }
+    if (name == "external") {
+        return Source::External;
+    }
+    return fallback;
+}
+
+const char *MasterClock::getSourceName(Source source) {
+    switch (source) {
+        case Source::Audio:
+            return "audio";
+        case Source::Video:
+            return "video";
+        case Source::External:
+            return "external";
+    }
+    return "unknown";
+}
+
+MasterClock::MasterClock(Source source, TimeSource now) : m_source(source), m_now(std::move(now)) {}
+
+void MasterClock::setAudioTime(double pts) {
+    if (std::isnan(pts) || pts == m_last_audio_pts) {
+        return;
+    }
+    m_last_audio_pts = pts;
+    m_audio.set(pts, getNow());
+    anchorExternal(pts);
+}
+
+void MasterClock::setVideoTime(double pts) {
+    double now = getNow();
+    if (!m_video.valid || std::abs(m_video.get(now) - pts) > kVideoResyncThreshold) {
+        m_video.set(pts, now);
+    }
+    anchorExternal(pts);
+}
+
+void MasterClock::setExternalTime(double pts) { m_external.set(pts, getNow()); }
+
+void MasterClock::setPaused(bool paused) {
+    if (paused == m_paused) {
+        return;
+    }
+    if (paused) {
+        m_paused_at = m_now();
+    } else {
+        // Shift every anchor by the time spent paused so no clock jumps forward on resume.
+        double paused_for = m_now() - m_paused_at;
+        m_audio.updated_at += paused_for;
+        m_video.updated_at += paused_for;
+        m_external.updated_at += paused_for;
+    }
+    m_paused = paused;
+}
+
+double MasterClock::getTime() const {
+    double now = getNow();
+    switch (getActiveSource()) {
+        case Source::Audio:
+            return m_audio.get(now);
+        case Source::Video:
+            return m_video.get(now);
+        case Source::External:
+            return m_external.get(now);
+    }
+    return NAN;
+}
+
+MasterClock::Source MasterClock::getActiveSource() const {
+    if (m_source == Source::Audio && !m_audio.valid) {
+        return Source::External;
+    }
+    return m_source;
+}
+
+double MasterClock::getNow() const { return m_paused ? m_paused_at : m_now(); }
+
+double MasterClock::Clock::get(double now) const { return valid ? pts + (now - updated_at) : NAN; }
+
+void MasterClock::Clock::set(double pts, double now) {
+    this->pts = pts;
+    updated_at = now;
+    valid = true;
+}
+
+void MasterClock::anchorExternal(double pts) {
+    if (!m_external.valid) {
+        m_external.set(pts, getNow());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <string>
+
+/**
+ *  @class MasterClock
+ *
+ *  @brief Playback clock that audio and video are synchronized against.
+ *
+ *  Keeps one clock per time source, each anchored to the monotonic time at which it was last set and
+ *  extrapolated from there:
+ *  - the audio clock follows the sample currently leaving the speakers;
+ *  - the video clock follows the last presented frame;
+ *  - the external clock runs freely on wall time from the first timestamp it saw.
+ *
+ *  The selected source is the master. An audio master falls back to the external clock until audio playback has
+ *  started.
+ *
+ *  @note Not thread-safe; meant to be driven from the render loop.
+ */
+class MasterClock {
+public:
+    enum class Source {
+        Audio,
+        Video,
+        External,
+    };
+
+    /**
+     *  @brief Monotonic time in seconds. Injectable so scheduling can be driven by a fake clock.
+     */
+    using TimeSource = std::function<double()>;
+
+    static double steadyTime();
+
+    /**
+     *  @return The source named `name` ("audio", "video" or "external"), or `fallback` if unknown.
+     */
+    static Source parseSource(const std::string &name, Source fallback);
+
+    static const char *getSourceName(Source source);
+
+    explicit MasterClock(Source source, TimeSource now = steadyTime);
+
+    /**
+     *  @brief Updates the audio clock, ignoring NAN and unchanged values.
+     *
+     *  @note Audio playback time only advances when the output thread refreshes it; re-anchoring only on change
+     *        keeps the clock extrapolating smoothly in between.
+     */
+    void setAudioTime(double pts);
+
+    /**
+     *  @brief Updates the video clock with the pts of the frame just presented.
+     *
+     *  @note Frames that land close to the extrapolated time do not re-anchor the clock, so presenting on vsync
+     *        boundaries does not accumulate drift.
+     */
+    void setVideoTime(double pts);
+
+    /**
+     *  @brief Re-anchors the external clock, e.g. after a seek.
+     */
+    void setExternalTime(double pts);
+
+    void setPaused(bool paused);
+    bool isPaused() const { return m_paused; }
+
+    /**
+     *  @return The master time in seconds, or NAN if the master has not seen a timestamp yet.
+     */
+    double getTime() const;
+
+    double getAudioTime() const { return m_audio.get(getNow()); }
+    double getVideoTime() const { return m_video.get(getNow()); }
+    double getExternalTime() const { return m_external.get(getNow()); }
+
+    Source getSource() const { return m_source; }
+
+    /**
+     *  @return The source `getTime` currently follows, after fallbacks.
+     */
+    Source getActiveSource() const;
+
+    /**
+     *  @return The injected monotonic time, frozen while paused.
+     */
+    double getNow() const;
+
+private:
+    struct Clock {
+        double pts {};
+        double updated_at {};
+        bool valid {false};
+
+        double get(double now) const;
+        void set(double pts, double now);
+    };
+
+    // A video frame further than this from the extrapolated clock re-anchors it (seek, discontinuity).
+    static constexpr double kVideoResyncThreshold = 0.1;
+
+    Source m_source {};
+    TimeSource m_now {};
+
+    Clock m_audio {};
+    Clock m_video {};
+    Clock m_external {};
+    double m_last_audio_pts {NAN};
+
+    bool m_paused {false};
+    double m_paused_at {};
+
+    void anchorExternal(double pts);
+};
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "media_engine.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+namespace {
+
+// Stores how long the enclosing thread function ran into `total` when it returns.
+struct RunTimer {
+    std::atomic<uint64_t> &total;
+    std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+
+    ~RunTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        total.store(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+};
+
+}  // namespace
+
+MediaEngine::Config MediaEngine::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.video_packet_queue_depth =
+        config_manager->getIntValue("media", "video_packet_queue_depth", config.video_packet_queue_depth);
+    config.audio_packet_queue_depth =
+        config_manager->getIntValue("media", "audio_packet_queue_depth", config.audio_packet_queue_depth);
+    config.video_frame_queue_depth =
+        config_manager->getIntValue("media", "video_frame_queue_depth", config.video_frame_queue_depth);
+    config.audio_frame_queue_depth =
+        config_manager->getIntValue("media", "audio_frame_queue_depth", config.audio_frame_queue_depth);
+    config.subtitle_packet_queue_depth =
+        config_manager->getIntValue("media", "subtitle_packet_queue_depth", config.subtitle_packet_queue_depth);
+    config.subtitles = config_manager->getIntValue("media", "subtitles", config.subtitles) != 0;
+    config.decoder_threads = config_manager->getIntValue("media", "decoder_threads", config.decoder_threads);
+    config.frame_pool_max_bytes =
+        config_manager->getIntValue("media", "frame_pool_max_mb", config.frame_pool_max_bytes >> 20) << 20;
+    config.index = KeyframeIndex::Config::fromConfigManager();
+    config.io = MappedFileIO::Config::fromConfigManager();
+    return config;
+}
+
+MediaEngine::MediaEngine(const std::filesystem::path &path, const Config &config)
+    : m_config(config),
+      m_video_packets(config.video_packet_queue_depth),
+      m_audio_packets(config.audio_packet_queue_depth),
+      m_video_frames(config.video_frame_queue_depth),
+      m_audio_frames(config.audio_frame_queue_depth),
+      m_subtitle_packets(config.subtitle_packet_queue_depth) {
+    m_demuxer = std::make_unique<Demuxer>(path, config.io, config.subtitles);
+
+    if (auto stream = m_demuxer->getVideoStream()) {
+        m_frame_buffer_pool = FrameBufferPool::create(config.frame_pool_max_bytes);
+        m_video_decoder = std::make_unique<Decoder>(stream, config.decoder_threads, m_frame_buffer_pool);
+    }
+    if (auto stream = m_demuxer->getAudioStream()) {
+        m_audio_decoder = std::make_unique<Decoder>(stream, config.decoder_threads);
+    }
+    m_subtitle_stream = m_demuxer->getSubtitleStream();
+    m_video_finished = !m_video_decoder;
+    m_audio_finished = !m_audio_decoder;
+
+    if (config.index.enabled) {
+        m_keyframe_index = KeyframeIndex::load(path, config.index);
+        if (!m_keyframe_index) {
+            m_index_builder = std::make_unique<KeyframeIndex::Builder>(*m_demuxer);
+        }
+    }
+}
+
+MediaEngine::~MediaEngine() {
+    m_demux_thread.request_stop();
+    m_video_decode_thread.request_stop();
+    m_audio_decode_thread.request_stop();
+    m_demux_thread = {};
+    m_video_decode_thread = {};
+    m_audio_decode_thread = {};
+
+    logStats();
+    DEBUG("release MediaEngine: {}", (void *)this);
+}
+
+std::shared_ptr<MediaEngine> MediaEngine::create(const std::filesystem::path &path, const Config &config) {
+    return std::shared_ptr<MediaEngine> {new MediaEngine {path, config}};
+}
+
+void MediaEngine::start(VideoFrameHook video_frame_hook) {
+    if (m_demux_thread.joinable()) {
+        FATAL("MediaEngine already started!");
+    }
+    m_video_frame_hook = std::move(video_frame_hook);
+
+    m_demux_thread = std::jthread([this](std::stop_token stop) {
+        RunTimer timer {m_demux_ns};
+        demuxLoop(stop);
+    });
+    if (m_video_decoder) {
+        m_video_decode_thread = std::jthread([this](std::stop_token stop) {
+            RunTimer timer {m_video_decode_ns};
+            decodeLoop(stop,
+                       m_video_decoder.get(),
+                       &m_video_packets,
+                       &m_video_frames,
+                       m_video_frame_hook ? &m_video_frame_hook : nullptr);
+        });
+    }
+    if (m_audio_decoder) {
+        m_audio_decode_thread =
+            std::jthread(decodeLoop, m_audio_decoder.get(), &m_audio_packets, &m_audio_frames, nullptr);
+    }
+}
+
+AVPacketPtr MediaEngine::tryPopSubtitlePacket() {
+    if (!m_subtitle_stream) {
+        return nullptr;
+    }
+    auto packet = m_subtitle_packets.tryPop();
+    return packet ? std::move(*packet) : nullptr;
+}
+
+std::shared_ptr<const KeyframeIndex> MediaEngine::getKeyframeIndex() const {
+    std::lock_guard lock {m_index_mutex};
+    return m_keyframe_index;
+}
+
+double MediaEngine::getStartTime() const {
+    const int64_t start_time = m_demuxer->getFormatContext()->start_time;
+    return start_time == AV_NOPTS_VALUE ? 0.0 : start_time * av_q2d(AV_TIME_BASE_Q);
+}
+
+double MediaEngine::getDuration() const {
+    const int64_t duration = m_demuxer->getFormatContext()->duration;
+    return duration == AV_NOPTS_VALUE ? NAN : duration * av_q2d(AV_TIME_BASE_Q);
+}
+
+MediaEngine::Stats MediaEngine::getStats() const {
+    return {
+        m_video_packets.getStats(),
+        m_audio_packets.getStats(),
+        m_video_frames.getStats(),
+        m_audio_frames.getStats(),
+        m_subtitle_packets.getStats(),
+        m_frame_buffer_pool ? m_frame_buffer_pool->getStats() : FrameBufferPool::Stats {},
+        AVObjectPool::get()->getAllocationCount(),
+        m_demuxer->getMappedFile() ? m_demuxer->getMappedFile()->getStats() : MappedFileIO::Stats {},
+        m_demux_ns.load(std::memory_order_relaxed) * 1e-9,
+        m_video_decode_ns.load(std::memory_order_relaxed) * 1e-9,
+    };
+}
+
+void MediaEngine::logStats() const {
+    auto stats = getStats();
+    auto log_queue = [](const char *name, const auto &queue) {
+        INFO("{}: {}/{} queued, {} push stalls, {} pop stalls",
+             name,
+             queue.size,
+             queue.capacity,
+             queue.push_stalls,
+             queue.pop_stalls);
+    };
+    log_queue("video packets", stats.video_packets);
+    log_queue("audio packets", stats.audio_packets);
+    log_queue("video frames", stats.video_frames);
+    log_queue("audio frames", stats.audio_frames);
+    if (m_subtitle_stream) {
+        log_queue("subtitle packets", stats.subtitle_packets);
+    }
+    INFO("frame buffers: {} allocated, {} reused, {} evicted, {} rejected, {} MiB in use, {} MiB pooled",
+         stats.frame_buffers.allocations,
+         stats.frame_buffers.reuses,
+         stats.frame_buffers.evictions,
+         stats.frame_buffers.cap_rejections,
+         stats.frame_buffers.bytes_in_use >> 20,
+         stats.frame_buffers.bytes_pooled >> 20);
+    INFO("AVFrame/AVPacket allocations: {}", stats.object_allocations);
+    if (stats.input.file_bytes > 0) {
+        INFO("mapped input: {}/{} MiB read in {} reads, {} seeks, {} readahead calls, {} MiB released",
+             stats.input.bytes_read >> 20,
+             stats.input.file_bytes >> 20,
+             stats.input.reads,
+             stats.input.seeks,
+             stats.input.readahead_calls,
+             stats.input.released_bytes >> 20);
+    }
+}
+
+void MediaEngine::demuxLoop(std::stop_token stop) {
+    const int video_index = m_video_decoder ? m_demuxer->getVideoStreamIndex() : -1;
+    const int audio_index = m_audio_decoder ? m_demuxer->getAudioStreamIndex() : -1;
+    const int subtitle_index = m_subtitle_stream ? m_subtitle_stream->index : -1;
+    Tracer::get()->setThreadName("demux");
+
+    while (!stop.stop_requested()) {
+        TRACE_ZONE("demux packet");
+        AVPacketPtr packet = allocPacket();
+        if (!packet) {
+            ERROR("failed to allocate packet!");
+            break;
+        }
+
+        int ret = m_demuxer->readPacket(packet.get());
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                ERROR("failed to read packet: {}", avErrorString(ret));
+            } else if (m_index_builder) {
+                TRACE_ZONE("write keyframe index");
+                auto index = m_index_builder->finish(m_demuxer->getPath(), m_config.index);
+                m_index_builder.reset();
+                std::lock_guard lock {m_index_mutex};
+                m_keyframe_index = std::move(index);
+            }
+            break;
+        }
+        if (m_index_builder) {
+            m_index_builder->addPacket(packet.get());
+        }
+        BLOG_TRACE(MEDIA,
+                   "demux: stream {} pts {} size {}{}",
+                   packet->stream_index,
+                   packet->pts,
+                   packet->size,
+                   packet->flags & AV_PKT_FLAG_KEY ? " key" : "");
+
+        if (packet->stream_index == video_index) {
+            m_video_packets.push(std::move(packet), stop);
+        } else if (packet->stream_index == audio_index) {
+            m_audio_packets.push(std::move(packet), stop);
+        } else if (packet->stream_index == subtitle_index) {
+            // Sparse and cheap to lose; waiting on a stalled render thread would starve the decoders instead.
+            if (!m_subtitle_packets.tryPush(std::move(packet))) {
+                DEBUG("subtitle packet queue full, dropping packet");
+            }
+        }
+    }
+
+    // A null packet tells the decode threads to drain.
+    if (m_video_decoder) {
+        m_video_packets.push(nullptr, stop);
+    }
+    if (m_audio_decoder) {
+        m_audio_packets.push(nullptr, stop);
+    }
+    DEBUG("demux thread finished");
+}
+
+void MediaEngine::decodeLoop(std::stop_token stop,
+                             Decoder *decoder,
+                             MediaQueue<AVPacketPtr> *packets,
+                             MediaQueue<AVFramePtr> *frames,
+                             const VideoFrameHook *hook) {
+    const bool is_video = decoder->getCodecContext()->codec_type == AVMEDIA_TYPE_VIDEO;
+    Tracer::get()->setThreadName(is_video ? "video decode" : "audio decode");
+
+    // Any exit but a stop request ends the stream for the consumer, so it never waits on a decoder that gave up.
+    bool failed = false;
+    while (!failed) {
+        auto packet = packets->pop(stop);
+        if (!packet) {
+            break;
+        }
+        const bool draining = *packet == nullptr;
+
+        int ret;
+        {
+            TRACE_ZONE("send packet");
+            ret = decoder->sendPacket(packet->get());
+        }
+        if (ret < 0 && ret != AVERROR_EOF) {
+            WARN("failed to send packet to decoder: {}", avErrorString(ret));
+        }
+
+        while (!stop.stop_requested()) {
+            AVFramePtr frame = allocFrame();
+            if (!frame) {
+                ERROR("failed to allocate frame!");
+                failed = true;
+                break;
+            }
+
+            {
+                TRACE_ZONE("receive frame");
+                ret = decoder->receiveFrame(frame.get());
+            }
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                break;
+            }
+            if (ret < 0) {
+                WARN("failed to decode frame: {}", avErrorString(ret));
+                break;
+            }
+            BLOG_TRACE(MEDIA, "decode: {} frame pts {}", is_video ? "video" : "audio", frame->best_effort_timestamp);
+            if (hook) {
+                TRACE_ZONE("video frame hook");
+                if (!(*hook)(frame.get(), stop)) {
+                    failed = true;
+                    break;
+                }
+            }
+            if (!frames->push(std::move(frame), stop)) {
+                return;
+            }
+        }
+
+        if (draining) {
+            break;
+        }
+    }
+    // A null frame marks the end of the stream for the consumer.
+    frames->push(nullptr, stop);
+    DEBUG("decode thread finished");
+}
+
+AVFramePtr MediaEngine::tryPopFrame(MediaQueue<AVFramePtr> &frames, bool &finished) {
+    if (finished) {
+        return nullptr;
+    }
+
+    auto frame = frames.tryPop();
+    if (!frame) {
+        return nullptr;
+    }
+    if (!*frame) {
+        finished = true;
+        return nullptr;
+    }
+    return std::move(*frame);
+}
+
+const AVFrame *MediaEngine::peekFrame(MediaQueue<AVFramePtr> &frames, bool &finished) {
+    if (finished) {
+        return nullptr;
+    }
+
+    auto frame = frames.front();
+    if (!frame) {
+        return nullptr;
+    }
+    if (!*frame) {
+        frames.tryPop();
+        finished = true;
+        return nullptr;
+    }
+    return frame->get();
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/decoder.h"
+#include "media/demuxer.h"
+#include "media/keyframe_index.h"
+#include "media/media_queue.h"
+
+/**
+ *  @class MediaEngine
+ *
+ *  @brief Pipelined demux/decode engine.
+ *
+ *  One demux thread feeds per-stream packet queues, and one decode thread per stream turns them into frames.
+ *  All queues are bounded SPSC rings, so the render loop only ever pulls frames that are already decoded and
+ *  never blocks on I/O or the codec.
+ *
+ *  Subtitle packets, if enabled, are not decoded here: they are queued as they are for the render thread, which
+ *  decodes them with a SubtitleDecoder. The demux thread never waits on them; if that queue is full, packets are
+ *  dropped.
+ *
+ *  Files without a keyframe index sidecar get one built by the demux thread as it reads, written once the whole
+ *  file has been demuxed.
+ *
+ *  @note `peekVideoFrame`/`tryPopVideoFrame` and `tryPopAudioFrame` must each be called from a single consumer thread.
+ */
+class MediaEngine {
+public:
+    NONCOPYABLE(MediaEngine)
+    NONMOVABLE(MediaEngine)
+
+    struct Config {
+        size_t video_packet_queue_depth {256};
+        size_t audio_packet_queue_depth {256};
+        size_t video_frame_queue_depth {8};
+        size_t audio_frame_queue_depth {64};
+        size_t subtitle_packet_queue_depth {64};
+        bool subtitles {true};
+        int decoder_threads {0};
+        size_t frame_pool_max_bytes {1024ull * 1024 * 1024};
+        KeyframeIndex::Config index {};
+        MappedFileIO::Config io {};
+
+        /**
+         *  @brief Reads the `[media]`, `[index]` and `[io]` sections of the config file, keeping defaults for missing
+         *         keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    /**
+     *  @brief Called on the video decode thread for each decoded frame, right before it is queued.
+     *
+     *  Lets the consumer do per-frame work off the render thread, e.g. staging pixels into mapped GPU memory; any
+     *  result can be attached to the frame through `AVFrame::opaque`. Should honour `stop` if it blocks.
+     *
+     *  @return false to stop decoding; the stream then ends for the consumer as if the file did.
+     */
+    using VideoFrameHook = std::function<bool(AVFrame *frame, const std::stop_token &stop)>;
+
+    struct Stats {
+        MediaQueue<AVPacketPtr>::Stats video_packets;
+        MediaQueue<AVPacketPtr>::Stats audio_packets;
+        MediaQueue<AVFramePtr>::Stats video_frames;
+        MediaQueue<AVFramePtr>::Stats audio_frames;
+        MediaQueue<AVPacketPtr>::Stats subtitle_packets;
+        FrameBufferPool::Stats frame_buffers;
+        uint64_t object_allocations;  // AVFrame/AVPacket structs allocated by AVObjectPool
+        MappedFileIO::Stats input;     // all zero if the file is not memory-mapped
+        double demux_seconds;         // wall time the demux thread ran, 0 until it finished
+        double video_decode_seconds;  // wall time the video decode thread ran, 0 until it finished
+    };
+
+    /**
+     *  @brief Stops and joins all pipeline threads.
+     */
+    ~MediaEngine();
+
+    /**
+     *  @brief Opens `path` and its decoders without starting any thread.
+     *
+     *  @note Throws std::runtime_error if the file cannot be opened or has no decodable stream.
+     */
+    static std::shared_ptr<MediaEngine> create(const std::filesystem::path &path, const Config &config);
+
+    /**
+     *  @brief Starts the demux and decode threads.
+     *
+     *  @param video_frame_hook Optional per-frame hook run on the video decode thread.
+     */
+    void start(VideoFrameHook video_frame_hook = {});
+
+    /**
+     *  @return The next decoded video frame, or nullptr if none is ready yet. Never blocks.
+     */
+    AVFramePtr tryPopVideoFrame() { return tryPopFrame(m_video_frames, m_video_finished); }
+
+    /**
+     *  @return The next decoded video frame without popping it, or nullptr if none is ready yet. Never blocks.
+     */
+    const AVFrame *peekVideoFrame() { return peekFrame(m_video_frames, m_video_finished); }
+
+    /**
+     *  @return The next decoded audio frame, or nullptr if none is ready yet. Never blocks.
+     */
+    AVFramePtr tryPopAudioFrame() { return tryPopFrame(m_audio_frames, m_audio_finished); }
+
+    /**
+     *  @return The next packet of the subtitle stream, or nullptr if none is queued. Never blocks.
+     */
+    AVPacketPtr tryPopSubtitlePacket();
+
+    bool hasVideo() const { return m_video_decoder != nullptr; }
+    bool hasAudio() const { return m_audio_decoder != nullptr; }
+    bool hasSubtitles() const { return m_subtitle_stream != nullptr; }
+
+    /**
+     *  @return true once the last video frame has been popped (or if there is no video stream).
+     */
+    bool isVideoFinished() const { return m_video_finished; }
+    bool isAudioFinished() const { return m_audio_finished; }
+
+    const Decoder *getVideoDecoder() const { return m_video_decoder.get(); }
+    const Decoder *getAudioDecoder() const { return m_audio_decoder.get(); }
+
+    /**
+     *  @return The subtitle stream packets are queued for, nullptr if there is none or subtitles are disabled.
+     */
+    const AVStream *getSubtitleStream() const { return m_subtitle_stream; }
+
+    /**
+     *  @return The container's first timestamp in seconds, 0 if unknown.
+     */
+    double getStartTime() const;
+
+    /**
+     *  @return The container's duration in seconds, NAN if unknown.
+     */
+    double getDuration() const;
+
+    /**
+     *  @return The keyframe index of the file: loaded at open, or built once demuxing reached the end of the file.
+     *          nullptr before that, or if indexing is disabled.
+     *
+     *  @note Thread-safe.
+     */
+    std::shared_ptr<const KeyframeIndex> getKeyframeIndex() const;
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    Config m_config {};
+
+    std::shared_ptr<FrameBufferPool> m_frame_buffer_pool {};
+
+    std::unique_ptr<Demuxer> m_demuxer {};
+    std::unique_ptr<Decoder> m_video_decoder {};
+    std::unique_ptr<Decoder> m_audio_decoder {};
+    const AVStream *m_subtitle_stream {};
+
+    MediaQueue<AVPacketPtr> m_video_packets;
+    MediaQueue<AVPacketPtr> m_audio_packets;
+    MediaQueue<AVFramePtr> m_video_frames;
+    MediaQueue<AVFramePtr> m_audio_frames;
+    MediaQueue<AVPacketPtr> m_subtitle_packets;
+
+    VideoFrameHook m_video_frame_hook {};
+
+    // Only touched by the demux thread once started.
+    std::unique_ptr<KeyframeIndex::Builder> m_index_builder {};
+
+    mutable std::mutex m_index_mutex {};
+    std::shared_ptr<const KeyframeIndex> m_keyframe_index {};
+
+    bool m_video_finished {false};
+    bool m_audio_finished {false};
+
+    std::atomic<uint64_t> m_demux_ns {0};
+    std::atomic<uint64_t> m_video_decode_ns {0};
+
+    // Declared last so the threads are joined before anything they touch is destroyed.
+    std::jthread m_demux_thread {};
+    std::jthread m_video_decode_thread {};
+    std::jthread m_audio_decode_thread {};
+
+    MediaEngine(const std::filesystem::path &path, const Config &config);
+
+    void demuxLoop(std::stop_token stop);
+
+    static void decodeLoop(std::stop_token stop,
+                           Decoder *decoder,
+                           MediaQueue<AVPacketPtr> *packets,
+                           MediaQueue<AVFramePtr> *frames,
+                           const VideoFrameHook *hook);
+
+    static AVFramePtr tryPopFrame(MediaQueue<AVFramePtr> &frames, bool &finished);
+    static const AVFrame *peekFrame(MediaQueue<AVFramePtr> &frames, bool &finished);
+};
\ No newline at end of file
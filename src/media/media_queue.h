@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "base/spsc_queue.h"
+
+/**
+ *  @class MediaQueue
+ *
+ *  @brief SpscQueue with blocking helpers for pipeline threads and stall accounting.
+ *
+ *  A push stall is counted each time the producer finds the queue full, a pop stall each time the consumer
+ *  finds it empty. Both are counted once per full or empty period, not per retry: a consumer polling `tryPop`
+ *  every loop iteration counts one stall until a value arrives, like one blocking `pop`. Time spent in the
+ *  blocking waits is summed too, which tells how busy the threads on either side are.
+ */
+template<typename T>
+class MediaQueue {
+public:
+    struct Stats {
+        size_t size;
+        size_t capacity;
+        uint64_t push_stalls;
+        uint64_t pop_stalls;
+        uint64_t push_wait_ns;  // blocked in `push`
+        uint64_t pop_wait_ns;   // blocked in `pop`
+    };
+
+    explicit MediaQueue(size_t depth) : m_queue(depth) {}
+
+    /**
+     *  @brief Pushes `value`, waiting for space if needed.
+     *
+     *  @return false if `stop` was requested before space became available.
+     */
+    bool push(T &&value, const std::stop_token &stop) {
+        if (m_queue.tryPush(std::move(value))) {
+            m_push_blocked = false;
+            return true;
+        }
+
+        countStall(m_push_blocked, m_push_stalls);
+        WaitTimer timer {m_push_wait_ns};
+        for (int spin = 0; !stop.stop_requested(); ++spin) {
+            if (m_queue.tryPush(std::move(value))) {
+                m_push_blocked = false;
+                return true;
+            }
+            backoff(spin);
+        }
+        return false;
+    }
+
+    /**
+     *  @brief Pushes `value` if there is space, counting a push stall the first time it finds the queue full.
+     *         Never blocks.
+     *
+     *  @return false if the queue was full; `value` is left untouched.
+     */
+    bool tryPush(T &&value) {
+        if (m_queue.tryPush(std::move(value))) {
+            m_push_blocked = false;
+            return true;
+        }
+        countStall(m_push_blocked, m_push_stalls);
+        return false;
+    }
+
+    /**
+     *  @brief Pops the oldest value, waiting for one if needed.
+     *
+     *  @return std::nullopt if `stop` was requested before a value arrived.
+     */
+    std::optional<T> pop(const std::stop_token &stop) {
+        if (auto value = m_queue.tryPop()) {
+            m_pop_starved = false;
+            return value;
+        }
+
+        countStall(m_pop_starved, m_pop_stalls);
+        WaitTimer timer {m_pop_wait_ns};
+        for (int spin = 0; !stop.stop_requested(); ++spin) {
+            if (auto value = m_queue.tryPop()) {
+                m_pop_starved = false;
+                return value;
+            }
+            backoff(spin);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     *  @brief Pops the oldest value if there is one, counting a pop stall the first time it finds the queue empty.
+     *         Never blocks.
+     */
+    std::optional<T> tryPop() {
+        auto value = m_queue.tryPop();
+        if (value) {
+            m_pop_starved = false;
+        } else {
+            countStall(m_pop_starved, m_pop_stalls);
+        }
+        return value;
+    }
+
+    T *front() { return m_queue.front(); }
+
+    size_t size() const { return m_queue.size(); }
+
+    Stats getStats() const {
+        return {
+            m_queue.size(),
+            m_queue.capacity(),
+            m_push_stalls.load(std::memory_order_relaxed),
+            m_pop_stalls.load(std::memory_order_relaxed),
+            m_push_wait_ns.load(std::memory_order_relaxed),
+            m_pop_wait_ns.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    SpscQueue<T> m_queue;
+
+    std::atomic<uint64_t> m_push_stalls {0};
+    std::atomic<uint64_t> m_pop_stalls {0};
+    std::atomic<uint64_t> m_push_wait_ns {0};
+    std::atomic<uint64_t> m_pop_wait_ns {0};
+    // Whether the last attempt on each side failed, so a full or empty period is counted once.
+    bool m_push_blocked {false};  // producer only
+    bool m_pop_starved {false};   // consumer only
+
+    // Adds the lifetime of the wait to `total`.
+    struct WaitTimer {
+        std::atomic<uint64_t> &total;
+        std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+
+        ~WaitTimer() {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            total.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                            std::memory_order_relaxed);
+        }
+    };
+
+    static void countStall(bool &stalled, std::atomic<uint64_t> &stalls) {
+        if (!stalled) {
+            stalled = true;
+            stalls.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void backoff(int spin) {
+        if (spin < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+};
\ No newline at end of file
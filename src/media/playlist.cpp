@@ -0,0 +1,486 @@
+#include "playlist.h"
+
+#include <algorithm>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "media/master_clock.h"
+#include "trace/tracer.h"
+
+Playlist::Config Playlist::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.preroll_seconds =
+        config_manager->getIntValue("playlist", "preroll_ms", std::llround(config.preroll_seconds * 1000)) / 1000.0;
+    config.frame_cache = config_manager->getIntValue("playlist", "frame_cache", config.frame_cache) != 0;
+    config.cache = FrameCache::Config::fromConfigManager();
+    return config;
+}
+
+Playlist::Playlist(const MediaEngine::Config &engine_config, const Config &config, StartFunc start)
+    : m_engine_config(engine_config), m_config(config), m_start(std::move(start)) {
+    m_preroll_thread = std::jthread([this](std::stop_token stop) { prerollLoop(stop); });
+}
+
+Playlist::~Playlist() {
+    m_preroll_thread.request_stop();
+    m_preroll_thread = {};
+
+    // Engines first: their decode threads run the start hook, which writes into the entry.
+    m_released_engines.clear();
+    m_released_frame_caches.clear();
+    m_video_entry.reset();
+    m_audio_entry.reset();
+    for (auto &entry : m_entries) {
+        entry->item.frame_cache.reset();
+        entry->item.engine.reset();
+    }
+    logStats();
+    DEBUG("release Playlist: {}", (void *)this);
+}
+
+void Playlist::append(const std::filesystem::path &path) {
+    auto entry = std::make_shared<Entry>();
+    entry->item.path = path;
+
+    std::lock_guard lock {m_mutex};
+    entry->item.index = m_entries.size();
+    if (m_entries.empty()) {
+        entry->requested_at = MasterClock::steadyTime();
+    }
+    m_entries.push_back(std::move(entry));
+    INFO("playlist: queued {} as item {}", path.string(), m_entries.size() - 1);
+    m_wakeup.notify_one();
+}
+
+void Playlist::releaseFrameCache(std::shared_ptr<FrameCache> frame_cache) {
+    if (!frame_cache) {
+        return;
+    }
+    std::lock_guard lock {m_mutex};
+    m_released_frame_caches.push_back(std::move(frame_cache));
+    m_wakeup.notify_one();
+}
+
+size_t Playlist::size() const {
+    std::lock_guard lock {m_mutex};
+    return m_entries.size();
+}
+
+void Playlist::update() {
+    std::vector<std::shared_ptr<Entry>> opened;
+    {
+        std::lock_guard lock {m_mutex};
+        // Once the item on screen is within `preroll_seconds` of its end, the one after it is opened.
+        if (m_video_entry && m_open_target <= m_video_entry->item.index) {
+            const auto &item = m_video_entry->item;
+            const double position = m_video_entry->position.load(std::memory_order_relaxed);
+            const double remaining =
+                item.start_time + item.duration - (std::isnan(position) ? item.start_time : position);
+            if (m_config.preroll_seconds <= 0 || std::isnan(remaining) || remaining <= m_config.preroll_seconds) {
+                m_open_target = item.index + 1;
+                if (auto next = findNext(item.index)) {
+                    next->requested_at = MasterClock::steadyTime();
+                }
+                m_wakeup.notify_one();
+            }
+        }
+        for (const auto &entry : m_entries) {
+            if (entry->state == State::Opened) {
+                entry->state = State::Started;
+                opened.push_back(entry);
+            }
+        }
+    }
+
+    for (const auto &entry : opened) {
+        TRACE_ZONE("start playlist item");
+        auto hook = m_start ? m_start(entry->item) : MediaEngine::VideoFrameHook {};
+        // The time the first frame is decoded tells how long the pre-roll took.
+        entry->item.engine->start([entry = entry.get(), hook = std::move(hook)](AVFrame *frame,
+                                                                                  const std::stop_token &stop) {
+            if (std::isnan(entry->first_frame_at.load(std::memory_order_relaxed))) {
+                entry->first_frame_at.store(MasterClock::steadyTime(), std::memory_order_relaxed);
+            }
+            return hook ? hook(frame, stop) : true;
+        });
+    }
+}
+
+const AVFrame *Playlist::peekVideoFrame() {
+    while (true) {
+        if (!m_video_entry) {
+            m_video_entry = findFirstStarted();
+            if (!m_video_entry) {
+                return nullptr;
+            }
+            m_video_index.store(m_video_entry->item.index, std::memory_order_relaxed);
+            m_video_switched = true;
+            if (auto decoder = m_video_entry->item.engine->getVideoDecoder()) {
+                m_video_time_base = decoder->getTimeBase();
+            }
+        }
+        const auto &engine = m_video_entry->item.engine;
+        if (auto frame = engine->peekVideoFrame()) {
+            return frame;
+        }
+        if (!engine->isVideoFinished() || !switchVideo()) {
+            return nullptr;
+        }
+    }
+}
+
+AVFramePtr Playlist::tryPopVideoFrame() {
+    if (!m_video_entry) {
+        return nullptr;
+    }
+    AVFramePtr frame = m_video_entry->item.engine->tryPopVideoFrame();
+    if (!frame) {
+        return nullptr;
+    }
+
+    const double now = MasterClock::steadyTime();
+    const double time_base = av_q2d(m_video_time_base);
+    const double time = getVideoTime(frame.get());
+    if (m_video_switched && !std::isnan(m_last_video_pop_at) && !m_video_queue_ran_dry) {
+        // Wall time between the last frame of the previous item and this one, beyond their distance on the
+        // timeline: what the switch itself cost.
+        const double expected = std::isnan(time) || std::isnan(m_last_video_time) ? 0.0 : time - m_last_video_time;
+        const double gap = std::max(0.0, now - m_last_video_pop_at - expected);
+        const auto &item = m_video_entry->item;
+        const double first_frame_at = m_video_entry->first_frame_at.load(std::memory_order_relaxed);
+        double requested_at;
+        {
+            std::lock_guard lock {m_mutex};
+            ++m_transitions;
+            m_video_gap_sum += gap;
+            m_max_video_gap = std::max(m_max_video_gap, gap);
+            requested_at = m_video_entry->requested_at;
+        }
+        INFO("playlist: switched to item {} ({}), video gap {:.2f} ms, opened in {:.1f} ms, first frame decoded "
+             "{:.1f} ms after the pre-roll request",
+             item.index,
+             item.path.filename().string(),
+             gap * 1000.0,
+             item.open_seconds * 1000.0,
+             (first_frame_at - requested_at) * 1000.0);
+    }
+    m_video_switched = false;
+    m_video_queue_ran_dry = false;
+
+    m_last_video_pop_at = now;
+    m_last_video_time = time;
+    if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+        const double position = frame->best_effort_timestamp * time_base;
+        const double end = position + (frame->duration > 0 ? frame->duration * time_base : 0.0);
+        auto &video_end = m_video_entry->video_end;
+        video_end = std::isnan(video_end) ? end : std::max(video_end, end);
+        updatePosition(*m_video_entry, position);
+    }
+    return frame;
+}
+
+double Playlist::getVideoTime(const AVFrame *frame) const {
+    if (!m_video_entry || frame->best_effort_timestamp == AV_NOPTS_VALUE) {
+        return NAN;
+    }
+    return m_video_entry->offset.load(std::memory_order_relaxed) +
+           frame->best_effort_timestamp * av_q2d(m_video_time_base) - m_video_entry->item.start_time;
+}
+
+bool Playlist::switchVideo() {
+    auto &current = *m_video_entry;
+    const double now = MasterClock::steadyTime();
+    if (!current.item.engine->hasAudio() && std::isnan(current.end.load(std::memory_order_relaxed))) {
+        setEnd(current, current.video_end);
+    }
+
+    std::shared_ptr<Entry> next;
+    {
+        std::lock_guard lock {m_mutex};
+        next = findNext(current.item.index);
+        const bool ready = next && next->state == State::Started;
+        if (!next) {
+            // Playback resumes whenever something is appended; that wait is not a transition gap.
+            m_video_queue_ran_dry = true;
+        } else if (std::isnan(m_video_switch_started_at)) {
+            m_video_switch_started_at = now;
+            m_late_prerolls += !ready;
+        }
+        // The end stays unknown while the audio of the current item is still playing out.
+        if (!ready || std::isnan(current.end.load(std::memory_order_relaxed))) {
+            return false;
+        }
+    }
+
+    next->offset.store(current.end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_video_entry = std::move(next);
+    m_video_index.store(m_video_entry->item.index, std::memory_order_relaxed);
+    m_video_switched = true;
+    m_video_switch_started_at = NAN;
+    if (auto decoder = m_video_entry->item.engine->getVideoDecoder()) {
+        m_video_time_base = decoder->getTimeBase();
+    }
+    releasePlayed();
+    return true;
+}
+
+AVFramePtr Playlist::tryPopAudioFrame() {
+    while (true) {
+        if (!m_audio_entry) {
+            m_audio_entry = findFirstStarted();
+            if (!m_audio_entry) {
+                return nullptr;
+            }
+            m_audio_index.store(m_audio_entry->item.index, std::memory_order_relaxed);
+            if (auto decoder = m_audio_entry->item.engine->getAudioDecoder()) {
+                m_audio_time_base = decoder->getTimeBase();
+            }
+        }
+
+        auto &entry = *m_audio_entry;
+        if (AVFramePtr frame = entry.item.engine->tryPopAudioFrame()) {
+            if (!std::isnan(m_audio_switch_started_at)) {
+                const double stall = MasterClock::steadyTime() - m_audio_switch_started_at;
+                m_audio_switch_started_at = NAN;
+                std::lock_guard lock {m_mutex};
+                m_max_audio_stall = std::max(m_max_audio_stall, stall);
+            }
+            if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                const double position = frame->best_effort_timestamp * av_q2d(m_audio_time_base);
+                const double duration = frame->sample_rate > 0 ? double(frame->nb_samples) / frame->sample_rate : 0;
+                entry.audio_end = position + duration;
+                updatePosition(entry, position);
+
+                const double time = entry.offset.load(std::memory_order_relaxed) + position - entry.item.start_time;
+                frame->pts = frame->best_effort_timestamp = std::llround(time / av_q2d(kTimeBase));
+            }
+            return frame;
+        }
+        if (!entry.item.engine->isAudioFinished()) {
+            return nullptr;
+        }
+        if (std::isnan(m_audio_switch_started_at)) {
+            m_audio_switch_started_at = MasterClock::steadyTime();
+        }
+        if (!switchAudio()) {
+            return nullptr;
+        }
+    }
+}
+
+bool Playlist::switchAudio() {
+    auto &current = *m_audio_entry;
+    if (current.item.engine->hasAudio() && std::isnan(current.end.load(std::memory_order_relaxed))) {
+        setEnd(current, current.audio_end);
+    }
+    // Without audio the end is set by the video side once the last frame is out.
+    const double end = current.end.load(std::memory_order_relaxed);
+    if (std::isnan(end)) {
+        return false;
+    }
+
+    std::shared_ptr<Entry> next;
+    {
+        std::lock_guard lock {m_mutex};
+        next = findNext(current.item.index);
+        if (!next) {
+            // Nothing queued: the wait for a new item is not a stall.
+            m_audio_switch_started_at = NAN;
+            m_audio_ran_dry = true;
+            return false;
+        }
+        if (next->state != State::Started) {
+            return false;
+        }
+    }
+    next->offset.store(end, std::memory_order_relaxed);
+    m_audio_ran_dry = false;
+    m_audio_entry = std::move(next);
+    m_audio_index.store(m_audio_entry->item.index, std::memory_order_relaxed);
+    m_audio_time_base = {};
+    if (auto decoder = m_audio_entry->item.engine->getAudioDecoder()) {
+        m_audio_time_base = decoder->getTimeBase();
+    }
+    releasePlayed();
+    return true;
+}
+
+bool Playlist::isFinished() const {
+    if (!m_video_entry || !m_video_entry->item.engine->isVideoFinished()) {
+        return false;
+    }
+    std::lock_guard lock {m_mutex};
+    return !findNext(m_video_entry->item.index) && m_audio_index.load() == m_video_entry->item.index &&
+           m_video_entry->item.engine->isAudioFinished();
+}
+
+void Playlist::setEnd(Entry &entry, double end) {
+    if (std::isnan(end)) {
+        end = std::isnan(entry.item.duration) ? entry.item.start_time : entry.item.start_time + entry.item.duration;
+    }
+    entry.end.store(entry.offset.load(std::memory_order_relaxed) + end - entry.item.start_time,
+                    std::memory_order_relaxed);
+}
+
+void Playlist::updatePosition(Entry &entry, double position) {
+    // Both sides report; the item is as far as the one ahead.
+    double current = entry.position.load(std::memory_order_relaxed);
+    while ((std::isnan(current) || position > current) &&
+           !entry.position.compare_exchange_weak(current, position, std::memory_order_relaxed)) {
+    }
+}
+
+void Playlist::releasePlayed() {
+    const size_t played = std::min(m_video_index.load(std::memory_order_relaxed),
+                                   m_audio_index.load(std::memory_order_relaxed));
+    // Joining an engine's threads and freeing its queues and cache takes milliseconds this thread cannot spare.
+    std::lock_guard lock {m_mutex};
+    bool released = false;
+    for (size_t i = 0; i < played; ++i) {
+        auto &item = m_entries[i]->item;
+        if (item.engine) {
+            m_released_engines.push_back(std::move(item.engine));
+            released = true;
+        }
+        if (item.frame_cache) {
+            m_released_frame_caches.push_back(std::move(item.frame_cache));
+            released = true;
+        }
+    }
+    if (released) {
+        m_wakeup.notify_one();
+    }
+}
+
+std::shared_ptr<Playlist::Entry> Playlist::findFirstStarted() {
+    std::lock_guard lock {m_mutex};
+    for (const auto &entry : m_entries) {
+        if (entry->state == State::Failed) {
+            continue;
+        }
+        if (entry->state != State::Started) {
+            return nullptr;
+        }
+        // The timeline starts at whichever item opened first.
+        if (std::isnan(entry->offset.load(std::memory_order_relaxed))) {
+            entry->offset.store(0.0, std::memory_order_relaxed);
+        }
+        return entry;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Playlist::Entry> Playlist::findNext(size_t index) const {
+    for (size_t i = index + 1; i < m_entries.size(); ++i) {
+        if (m_entries[i]->state != State::Failed) {
+            return m_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Playlist::Entry> Playlist::findEntryToOpen() const {
+    for (size_t i = 0; i < m_entries.size() && i <= m_open_target; ++i) {
+        if (m_entries[i]->state == State::Pending) {
+            return m_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+void Playlist::prerollLoop(std::stop_token stop) {
+    Tracer::get()->setThreadName("playlist");
+
+    std::unique_lock lock {m_mutex};
+    while (!stop.stop_requested()) {
+        if (hasReleased()) {
+            auto engines = std::move(m_released_engines);
+            auto frame_caches = std::move(m_released_frame_caches);
+            m_released_engines.clear();
+            m_released_frame_caches.clear();
+            lock.unlock();
+            {
+                TRACE_ZONE("release played items");
+                engines.clear();
+                frame_caches.clear();
+            }
+            lock.lock();
+            continue;
+        }
+
+        auto entry = findEntryToOpen();
+        if (!entry) {
+            m_wakeup.wait(lock, stop, [this] { return findEntryToOpen() != nullptr || hasReleased(); });
+            continue;
+        }
+        entry->state = State::Opening;
+        lock.unlock();
+        open(*entry);
+        lock.lock();
+
+        if (entry->item.engine) {
+            entry->state = State::Opened;
+            ++m_opened_items;
+            m_open_seconds_sum += entry->item.open_seconds;
+        } else {
+            entry->state = State::Failed;
+            ++m_failed_items;
+            // The item it stood in for still has to be pre-rolled.
+            if (m_open_target == entry->item.index) {
+                if (++m_open_target < m_entries.size()) {
+                    m_entries[m_open_target]->requested_at = MasterClock::steadyTime();
+                }
+            }
+        }
+    }
+    DEBUG("playlist thread finished");
+}
+
+void Playlist::open(Entry &entry) {
+    TRACE_ZONE("open playlist item");
+    auto &item = entry.item;
+    const double started_at = MasterClock::steadyTime();
+    try {
+        item.engine = MediaEngine::create(item.path, m_engine_config);
+        item.start_time = item.engine->getStartTime();
+        item.duration = item.engine->getDuration();
+        if (m_config.frame_cache && item.engine->hasVideo()) {
+            item.frame_cache = FrameCache::create(
+                item.path, m_config.cache, m_engine_config.index, m_engine_config.decoder_threads);
+        }
+    } catch (const std::runtime_error &e) {
+        ERROR("playlist: skipping {}: {}", item.path.string(), e.what());
+        item.engine.reset();
+        item.frame_cache.reset();
+        return;
+    }
+    item.open_seconds = MasterClock::steadyTime() - started_at;
+    DEBUG("playlist: opened item {} in {:.1f} ms", item.index, item.open_seconds * 1000.0);
+}
+
+Playlist::Stats Playlist::getStats() const {
+    std::lock_guard lock {m_mutex};
+    return {
+        m_transitions,
+        m_late_prerolls,
+        m_failed_items,
+        m_max_video_gap,
+        m_transitions > 0 ? m_video_gap_sum / m_transitions : 0.0,
+        m_max_audio_stall,
+        m_opened_items > 0 ? m_open_seconds_sum / m_opened_items : 0.0,
+    };
+}
+
+void Playlist::logStats() const {
+    auto stats = getStats();
+    INFO("playlist: {} transitions, {} late pre-rolls, {} failed items, video gap mean {:.2f} ms max {:.2f} ms, "
+         "max audio stall {:.2f} ms, mean open {:.1f} ms",
+         stats.transitions,
+         stats.late_prerolls,
+         stats.failed_items,
+         stats.mean_video_gap * 1000.0,
+         stats.max_video_gap * 1000.0,
+         stats.max_audio_stall * 1000.0,
+         stats.mean_open_seconds * 1000.0);
+}
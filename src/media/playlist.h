@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/frame_cache.h"
+#include "media/media_engine.h"
+
+/**
+ *  @class Playlist
+ *
+ *  @brief Plays a queue of media files back to back on one continuous timeline, without gaps between items.
+ *
+ *  The next item is opened and probed on a background thread once the current one is within `preroll_seconds`
+ *  of its end, and started right away, so by the time it is needed its first video frames are decoded and its
+ *  audio frames are queued. Switching items is then only a matter of popping from the next engine.
+ *
+ *  Every item is placed on the timeline where the previous one ends: at the end of its audio if it has audio,
+ *  so samples follow each other exactly, otherwise at the end of its video. Audio frames are handed out with
+ *  timestamps rewritten to the timeline in `kTimeBase`; video frames keep their own timestamps and are placed
+ *  with `getVideoTime`.
+ *
+ *  Video and audio advance independently: audio runs ahead by the output latency and usually switches first.
+ *  Each switch is measured: the presentation gap between the last frame of one item and the first frame of the
+ *  next (ideally zero), and how long the audio consumer had to wait for the next item's first frame.
+ *
+ *  @note `append` is thread-safe. `update` and the video functions must be called from one thread (the render
+ *        loop), `tryPopAudioFrame` from one audio consumer at a time.
+ */
+class Playlist {
+public:
+    NONCOPYABLE(Playlist)
+    NONMOVABLE(Playlist)
+
+    struct Config {
+        double preroll_seconds {10.0};  // the next item is opened this long before the current one ends
+        bool frame_cache {true};        // open a FrameCache for every video item, for pausing and scrubbing
+        FrameCache::Config cache {};
+
+        /**
+         *  @brief Reads the `[playlist]` and `[cache]` sections of the config file, keeping defaults for missing
+         *         keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    /**
+     *  @brief An opened item; immutable once handed out.
+     */
+    struct Item {
+        size_t index {};
+        std::filesystem::path path {};
+        std::shared_ptr<MediaEngine> engine {};
+        std::shared_ptr<FrameCache> frame_cache {};  // nullptr if disabled or the item has no video
+        double start_time {};                        // first timestamp of the file, in seconds
+        double duration {NAN};                       // seconds, NAN if unknown
+        double open_seconds {};                      // time spent opening and probing on the pre-roll thread
+    };
+
+    struct Stats {
+        uint64_t transitions;     // video switches between items
+        uint64_t late_prerolls;   // switches where the next item was not ready when the current one ended
+        uint64_t failed_items;    // items that could not be opened and were skipped
+        double max_video_gap;     // seconds between the expected and the actual first frame of the next item
+        double mean_video_gap;
+        double max_audio_stall;   // seconds the audio consumer found no frame while switching items
+        double mean_open_seconds; // open and probe time per item, off the render thread
+    };
+
+    /**
+     *  @brief Called from `update` once an item is opened, before its threads start.
+     *
+     *  @return The video frame hook to start the engine with (may be empty).
+     */
+    using StartFunc = std::function<MediaEngine::VideoFrameHook(const Item &item)>;
+
+    // Time base of the rewritten audio timestamps.
+    static constexpr AVRational kTimeBase {1, AV_TIME_BASE};
+
+    Playlist(const MediaEngine::Config &engine_config, const Config &config, StartFunc start);
+
+    /**
+     *  @brief Stops the pre-roll thread and releases all items.
+     */
+    ~Playlist();
+
+    /**
+     *  @brief Queues `path` after the last item.
+     */
+    void append(const std::filesystem::path &path);
+
+    /**
+     *  @brief Starts items the pre-roll thread has opened and asks it for the next item when it is time.
+     *
+     *  @note Call once per render loop iteration.
+     */
+    void update();
+
+    /**
+     *  @return The next video frame of the current item, or of the next item once the current one finished and
+     *          the next one is placed on the timeline; nullptr if none is ready. Never blocks.
+     */
+    const AVFrame *peekVideoFrame();
+
+    /**
+     *  @return The frame `peekVideoFrame` returned, or nullptr.
+     */
+    AVFramePtr tryPopVideoFrame();
+
+    /**
+     *  @return The position of a frame of the current video item on the playlist timeline, in seconds; NAN if the
+     *          frame has no timestamp.
+     */
+    double getVideoTime(const AVFrame *frame) const;
+
+    /**
+     *  @return The item video frames currently come from, or nullptr before the first one is started.
+     */
+    const Item *getVideoItem() const { return m_video_entry ? &m_video_entry->item : nullptr; }
+
+    /**
+     *  @return The next audio frame, with `pts` and `best_effort_timestamp` in `kTimeBase` on the playlist
+     *          timeline, or nullptr if none is ready. Never blocks.
+     */
+    AVFramePtr tryPopAudioFrame();
+
+    /**
+     *  @return true while the audio of the last item has been handed out and nothing is queued after it, so no
+     *          further audio frame follows until another item is appended. Audio consumer only.
+     */
+    bool isAudioDrained() const { return m_audio_ran_dry; }
+
+    /**
+     *  @brief Drops a reference to an item's frame cache on the pre-roll thread rather than the calling one, in case
+     *         it is the last: freeing a cache is too slow for the render loop. Thread-safe.
+     */
+    void releaseFrameCache(std::shared_ptr<FrameCache> frame_cache);
+
+    size_t size() const;
+
+    /**
+     *  @return true once every item has been played to the end.
+     */
+    bool isFinished() const;
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    enum class State {
+        Pending,
+        Opening,
+        Opened,
+        Started,
+        Failed,
+    };
+
+    struct Entry {
+        Item item {};
+        State state {State::Pending};              // guarded by m_mutex
+        std::atomic<double> offset {NAN};          // timeline position of `item.start_time`, once known
+        std::atomic<double> end {NAN};             // timeline position where the next item starts, once known
+        std::atomic<double> position {NAN};        // item time of the latest frame consumed, in seconds
+        std::atomic<double> first_frame_at {NAN};  // when the first video frame was decoded
+        double requested_at {NAN};                 // when the pre-roll was asked for, guarded by m_mutex
+        double audio_end {NAN};                    // item time where the audio ends, audio consumer only
+        double video_end {NAN};                    // item time where the video ends, video thread only
+    };
+
+    MediaEngine::Config m_engine_config {};
+    Config m_config {};
+    StartFunc m_start {};
+
+    mutable std::mutex m_mutex {};
+    std::condition_variable_any m_wakeup {};
+    std::vector<std::shared_ptr<Entry>> m_entries {};
+    size_t m_open_target {};  // entries up to this index may be opened
+    // Played items waiting for the pre-roll thread to destroy them, away from the render and audio threads.
+    std::vector<std::shared_ptr<MediaEngine>> m_released_engines {};
+    std::vector<std::shared_ptr<FrameCache>> m_released_frame_caches {};
+
+    // Video side, render thread only.
+    std::shared_ptr<Entry> m_video_entry {};
+    AVRational m_video_time_base {};
+    double m_last_video_pop_at {NAN};
+    double m_last_video_time {NAN};  // timeline position of the last popped frame
+    double m_video_switch_started_at {NAN};  // when the current item ran out of video
+    bool m_video_switched {false};           // the next pop is the first frame of a new item
+    bool m_video_queue_ran_dry {false};      // the current item ended with nothing queued after it
+    std::atomic<size_t> m_video_index {0};
+
+    // Audio side, audio consumer only.
+    std::shared_ptr<Entry> m_audio_entry {};
+    AVRational m_audio_time_base {};
+    double m_audio_switch_started_at {NAN};
+    bool m_audio_ran_dry {false};  // the current item's audio ended with nothing queued after it
+    std::atomic<size_t> m_audio_index {0};
+
+    // Guarded by m_mutex.
+    uint64_t m_transitions {};
+    uint64_t m_late_prerolls {};
+    uint64_t m_failed_items {};
+    uint64_t m_opened_items {};
+    double m_video_gap_sum {};
+    double m_max_video_gap {};
+    double m_max_audio_stall {};
+    double m_open_seconds_sum {};
+
+    // Declared last so the thread is joined before anything it touches is destroyed.
+    std::jthread m_preroll_thread {};
+
+    void prerollLoop(std::stop_token stop);
+
+    /**
+     *  @return true if played items are waiting to be destroyed. Needs m_mutex.
+     */
+    bool hasReleased() const { return !m_released_engines.empty() || !m_released_frame_caches.empty(); }
+
+    /**
+     *  @brief Opens and probes the entry's file, and its frame cache. Runs on the pre-roll thread.
+     */
+    void open(Entry &entry);
+
+    /**
+     *  @return The first entry that did not fail to open, if it is started; nullptr otherwise.
+     */
+    std::shared_ptr<Entry> findFirstStarted();
+
+    /**
+     *  @return The first entry after `index` that did not fail to open, or nullptr. Needs m_mutex.
+     */
+    std::shared_ptr<Entry> findNext(size_t index) const;
+
+    /**
+     *  @return The pending entry the pre-roll thread should open next, or nullptr. Needs m_mutex.
+     */
+    std::shared_ptr<Entry> findEntryToOpen() const;
+
+    /**
+     *  @return true if the video side moved on to the next item.
+     */
+    bool switchVideo();
+    bool switchAudio();
+
+    /**
+     *  @brief Hands the engines and frame caches of items both sides have moved past to the pre-roll thread, which
+     *         joins their threads and frees them.
+     */
+    void releasePlayed();
+
+    /**
+     *  @brief Places the end of `entry` on the timeline at item time `end`, falling back to its duration.
+     */
+    static void setEnd(Entry &entry, double end);
+
+    void updatePosition(Entry &entry, double position);
+};
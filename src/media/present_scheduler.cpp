@@ -0,0 +1,192 @@
+#include "present_scheduler.h"
+
+#include <algorithm>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+PresentScheduler::Config PresentScheduler::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.swap_interval = config_manager->getIntValue("present", "swap_interval", config.swap_interval);
+    config.idle_timeout =
+        config_manager->getIntValue("present", "idle_timeout_ms", config.idle_timeout * 1000) / 1000.0;
+    config.wake_margin =
+        config_manager->getIntValue("present", "wake_margin_us", config.wake_margin * 1e6) / 1e6;
+    return config;
+}
+
+PresentScheduler::PresentScheduler(const Config &config,
+                                   double nominal_refresh_rate,
+                                   WaitFunc wait,
+                                   SwapIntervalFunc set_swap_interval,
+                                   MasterClock::TimeSource now)
+    : m_config(config), m_wait(std::move(wait)), m_now(std::move(now)) {
+    m_config.swap_interval = std::max(m_config.swap_interval, 0);
+    m_refresh_period = 1.0 / (nominal_refresh_rate > 0 ? nominal_refresh_rate : kDefaultRefreshRate);
+    m_nominal_period = m_refresh_period;
+    if (set_swap_interval) {
+        set_swap_interval(m_config.swap_interval);
+    }
+    INFO("present: swap interval {}, nominal refresh {:.2f} Hz", m_config.swap_interval, getRefreshRate());
+}
+
+void PresentScheduler::waitForWork() {
+    const double now = m_now();
+    if (!std::isnan(m_awake_since)) {
+        m_awake_seconds += std::max(0.0, now - m_awake_since - m_iteration_swap_seconds);
+    }
+    m_iteration_swap_seconds = 0;
+    ++m_iterations;
+
+    double timeout = m_config.idle_timeout;
+    if (m_redraw || m_presented) {
+        timeout = 0;
+    } else {
+        if (!std::isnan(m_next_due_at)) {
+            // Woken a little early for a frame further out; one closer than the margin is slept for exactly, not
+            // polled for.
+            const double until_due = m_next_due_at - now;
+            const double margin = until_due > m_config.wake_margin ? m_config.wake_margin : 0.0;
+            timeout = std::min(timeout, until_due - margin);
+        }
+        if (m_expecting_frames) {
+            timeout = std::min(timeout, m_refresh_period);
+        }
+    }
+    m_next_due_at = NAN;
+    m_expecting_frames = false;
+    m_presented = false;
+
+    if (timeout > 0) {
+        TRACE_ZONE("wait for work");
+        ++m_sleeps;
+        m_wait(timeout);
+    } else {
+        m_wait(0);
+    }
+    m_awake_since = m_now();
+    m_wait_seconds += m_awake_since - now;
+}
+
+void PresentScheduler::setFrameDue(double delay) {
+    if (std::isnan(delay)) {
+        return;
+    }
+    const double due_at = m_now() + delay;
+    m_next_due_at = std::isnan(m_next_due_at) ? due_at : std::min(m_next_due_at, due_at);
+}
+
+void PresentScheduler::beginSwap() { m_swap_started_at = m_now(); }
+
+void PresentScheduler::endSwap() {
+    const double now = m_now();
+    if (!std::isnan(m_swap_started_at)) {
+        m_iteration_swap_seconds += now - m_swap_started_at;
+        m_swap_seconds += now - m_swap_started_at;
+        m_swap_started_at = NAN;
+    }
+    if (!std::isnan(m_last_present_at)) {
+        measureInterval(now - m_last_present_at);
+    }
+    m_last_present_at = now;
+    ++m_presents;
+    m_redraw = false;
+    m_presented = true;
+}
+
+void PresentScheduler::measureInterval(double interval) {
+    // Longer gaps are a paused or idle player, not frame pacing.
+    if (interval > m_config.idle_timeout) {
+        return;
+    }
+    m_frame_times.add(interval);
+
+    const double vblanks = std::round(interval / m_refresh_period);
+    m_jitter.add(std::abs(interval - std::max(vblanks, 1.0) * m_refresh_period));
+
+    // Without vsync, swaps return whenever the driver is done and say nothing about the display.
+    if (m_config.swap_interval == 0) {
+        return;
+    }
+    // Vsync never returns faster than one refresh: the display is faster than estimated (wrong nominal rate), or the
+    // swap returned early. Only the first keeps happening.
+    if (interval < 0.8 * m_refresh_period) {
+        m_long_run.count = 0;
+        if (addToRun(m_short_run, interval)) {
+            m_refresh_period = m_short_run.mean;
+        }
+        return;
+    }
+    m_short_run.count = 0;
+    if (vblanks > kMaxMeasuredVblanks) {
+        // Usually an idle gap. A run of them below the nominal rate means early swaps lowered the estimate, which
+        // then starts over from the nominal rate.
+        if (m_refresh_period < 0.8 * m_nominal_period && addToRun(m_long_run, interval)) {
+            m_refresh_period = m_nominal_period;
+        }
+        return;
+    }
+    m_long_run.count = 0;
+    const double period = interval / vblanks;
+    if (std::abs(period - m_refresh_period) < 0.2 * m_refresh_period) {
+        m_refresh_period += kRefreshSmoothing * (period - m_refresh_period);
+        return;
+    }
+    // An odd number of half refreshes: the display is twice as fast and content is presented every other vblank at
+    // most, so no interval is a single refresh.
+    const double half_period = interval / std::round(2 * interval / m_refresh_period);
+    if (std::abs(half_period - 0.5 * m_refresh_period) < 0.1 * m_refresh_period && addToRun(m_half_run, half_period)) {
+        m_refresh_period = m_half_run.mean;
+    }
+    // Otherwise far off means a missed vblank or a stall, not a different refresh rate.
+}
+
+bool PresentScheduler::addToRun(IntervalRun &run, double interval) {
+    if (run.count == 0 || std::abs(interval - run.mean) >= 0.2 * run.mean) {
+        run = {interval, 0};
+    }
+    ++run.count;
+    run.mean += (interval - run.mean) / run.count;
+    if (run.count < kMinConsistentIntervals) {
+        return false;
+    }
+    run.count = 0;
+    return true;
+}
+
+PresentScheduler::Stats PresentScheduler::getStats() const {
+    return {
+        m_iterations,
+        m_presents,
+        m_sleeps,
+        m_awake_seconds,
+        m_wait_seconds,
+        m_swap_seconds,
+        getRefreshRate(),
+        m_frame_times.getPercentile(0.5),
+        m_frame_times.getPercentile(0.99),
+        m_frame_times.getMax(),
+        m_jitter.getPercentile(0.5),
+        m_jitter.getPercentile(0.99),
+    };
+}
+
+void PresentScheduler::logStats() const {
+    const auto stats = getStats();
+    const double total = stats.awake_seconds + stats.wait_seconds + stats.swap_seconds;
+    INFO("present: {} iterations ({} slept), {} presents, awake {:.1f}% of {:.1f}s, refresh {:.2f} Hz",
+         stats.iterations,
+         stats.sleeps,
+         stats.presents,
+         total > 0 ? stats.awake_seconds / total * 100 : 0.0,
+         total,
+         stats.refresh_rate);
+    INFO("present: frame time p50 {:.1f} ms p99 {:.1f} ms max {:.1f} ms, jitter p50 {:.2f} ms p99 {:.2f} ms",
+         stats.frame_time_p50 * 1000,
+         stats.frame_time_p99 * 1000,
+         stats.frame_time_max * 1000,
+         stats.jitter_p50 * 1000,
+         stats.jitter_p99 * 1000);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#include "base/histogram.h"
+#include "media/master_clock.h"
+
+/**
+ *  @class PresentScheduler
+ *
+ *  @brief Paces the render loop: draws and swaps only when the picture changed, and otherwise sleeps in the
+ *         event wait until input arrives or the next decoded frame is due.
+ *
+ *  Each loop iteration starts with `waitForWork`. The loop then reports what it found: `requestRedraw` when
+ *  something on screen changed, `setFrameDue` when a decoded frame is waiting for its time, `setExpectingFrames`
+ *  while playing with nothing decoded yet. Only if `shouldPresent` does it draw and swap, between `beginSwap` and
+ *  `endSwap`. A paused player therefore wakes up only for input or every `idle_timeout`.
+ *
+ *  The display refresh rate is estimated from the times swaps return, which vsync aligns to vblanks. Presents that
+ *  are always the same whole number of vblanks apart (24 fps paced on 144 Hz) cannot tell the rate from a divisor
+ *  of it; the estimate needs the nominal rate or some intervals of other lengths. Frame times (between presents)
+ *  and present jitter (distance from the nearest whole number of refresh periods) are kept in histograms.
+ *
+ *  All timing comes from the injected TimeSource and all blocking from the injected wait, so the pacing policy can
+ *  be driven by a fake clock.
+ *
+ *  @note Not thread-safe; meant to be driven from the render loop.
+ */
+class PresentScheduler {
+public:
+    struct Config {
+        int swap_interval {1};         // vblanks per swap, 0 disables vsync
+        double idle_timeout {0.25};    // longest sleep, so background work (pre-roll, audio) is still picked up
+        double wake_margin {0.002};    // seconds woken up before a frame is due
+
+        /**
+         *  @brief Reads the `[present]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t iterations;     // calls to waitForWork
+        uint64_t presents;
+        uint64_t sleeps;         // iterations that blocked with a timeout instead of polling
+        double awake_seconds;    // loop time outside of waits and swaps: what the loop costs in CPU
+        double wait_seconds;
+        double swap_seconds;
+        double refresh_rate;     // estimated, Hz
+        double frame_time_p50;   // seconds between presents
+        double frame_time_p99;
+        double frame_time_max;
+        double jitter_p50;       // seconds off the nearest whole number of refresh periods
+        double jitter_p99;
+    };
+
+    /**
+     *  @brief Processes events, blocking up to `timeout` seconds for one to arrive; 0 only polls.
+     */
+    using WaitFunc = std::function<void(double timeout)>;
+    using SwapIntervalFunc = std::function<void(int interval)>;
+
+    /**
+     *  @param nominal_refresh_rate Refresh rate the estimate starts from, in Hz; 0 or less if unknown.
+     */
+    PresentScheduler(const Config &config,
+                     double nominal_refresh_rate,
+                     WaitFunc wait,
+                     SwapIntervalFunc set_swap_interval,
+                     MasterClock::TimeSource now = MasterClock::steadyTime);
+
+    /**
+     *  @brief Polls events if a redraw is pending or the previous iteration swapped. Otherwise sleeps in the event
+     *         wait until the earliest due frame, the next refresh while frames are expected, or `idle_timeout`.
+     *         Clears what the loop reported.
+     */
+    void waitForWork();
+
+    /**
+     *  @brief The picture changed; the current iteration has to draw and swap.
+     */
+    void requestRedraw() { m_redraw = true; }
+
+    /**
+     *  @brief A decoded frame becomes presentable in `delay` seconds. The earliest of an iteration counts.
+     */
+    void setFrameDue(double delay);
+
+    /**
+     *  @brief Something may become ready any moment (playback running with nothing decoded yet, a scrub target
+     *         still loading): look again after one refresh period.
+     */
+    void setExpectingFrames() { m_expecting_frames = true; }
+
+    bool shouldPresent() const { return m_redraw; }
+
+    void beginSwap();
+
+    /**
+     *  @brief Records the present and clears the redraw request.
+     */
+    void endSwap();
+
+    /**
+     *  @return The estimated refresh rate in Hz.
+     */
+    double getRefreshRate() const { return 1.0 / m_refresh_period; }
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+    const Config &getConfig() const { return m_config; }
+
+private:
+    static constexpr double kDefaultRefreshRate = 60.0;
+    // Weight of one measured vblank interval in the refresh estimate.
+    static constexpr double kRefreshSmoothing = 0.05;
+    // Intervals spanning more vblanks than this are idle gaps, not a measure of the refresh rate.
+    static constexpr int kMaxMeasuredVblanks = 4;
+    // Intervals that do not fit the estimate must agree this many times before it follows them, so a few swaps
+    // returning early (occluded window, driver not blocking) do not move it.
+    static constexpr int kMinConsistentIntervals = 8;
+
+    // Intervals agreeing with each other within 20%, and their mean.
+    struct IntervalRun {
+        double mean {};
+        int count {};
+    };
+
+    Config m_config {};
+    WaitFunc m_wait {};
+    MasterClock::TimeSource m_now {};
+
+    bool m_redraw {true};  // the first iteration draws
+    bool m_expecting_frames {false};
+    bool m_presented {false};  // the loop has not looked at the queue since the last swap, so it may not sleep
+    double m_next_due_at {NAN};
+
+    double m_refresh_period {};
+    double m_nominal_period {};
+    IntervalRun m_short_run {};  // consecutive intervals shorter than one refresh
+    IntervalRun m_long_run {};   // consecutive intervals too long to measure
+    IntervalRun m_half_run {};   // odd numbers of half refreshes
+    double m_swap_started_at {NAN};
+    double m_last_present_at {NAN};
+    double m_awake_since {NAN};
+    double m_iteration_swap_seconds {};
+
+    uint64_t m_iterations {};
+    uint64_t m_presents {};
+    uint64_t m_sleeps {};
+    double m_awake_seconds {};
+    double m_wait_seconds {};
+    double m_swap_seconds {};
+
+    Histogram m_frame_times {0.0005, 400};  // 0.5 ms buckets up to 200 ms
+    Histogram m_jitter {0.0001, 200};       // 0.1 ms buckets up to 20 ms
+
+    /**
+     *  @brief Feeds the interval between two presents into the histograms and the refresh estimate.
+     */
+    void measureInterval(double interval);
+
+    /**
+     *  @brief Adds `interval` to `run`, which starts over from it if it disagrees.
+     *
+     *  @return Whether the run reached kMinConsistentIntervals; it starts over empty then.
+     */
+    static bool addToRun(IntervalRun &run, double interval);
+};
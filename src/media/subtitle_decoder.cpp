@@ -0,0 +1,164 @@
+#include "subtitle_decoder.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "log/log_system.h"
+
+SubtitleDecoder::SubtitleDecoder(const AVStream *stream, int video_width, int video_height)
+    : m_time_base(stream->time_base) {
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        FATAL("no decoder for subtitle codec {}", avcodec_get_name(stream->codecpar->codec_id));
+    }
+
+    m_codec_ctx.reset(avcodec_alloc_context3(codec));
+    if (!m_codec_ctx) {
+        FATAL("failed to allocate codec context!");
+    }
+
+    int ret = avcodec_parameters_to_context(m_codec_ctx.get(), stream->codecpar);
+    if (ret < 0) {
+        FATAL("failed to copy codec parameters: {}", avErrorString(ret));
+    }
+    m_codec_ctx->pkt_timebase = stream->time_base;
+
+    ret = avcodec_open2(m_codec_ctx.get(), codec, nullptr);
+    if (ret < 0) {
+        FATAL("failed to open subtitle decoder {}: {}", codec->name, avErrorString(ret));
+    }
+
+    m_canvas_width = m_codec_ctx->width > 0 ? m_codec_ctx->width : video_width;
+    m_canvas_height = m_codec_ctx->height > 0 ? m_codec_ctx->height : video_height;
+    INFO("opened subtitle decoder {}, canvas {}x{}", codec->name, m_canvas_width, m_canvas_height);
+}
+
+SubtitleDecoder::~SubtitleDecoder() { DEBUG("release SubtitleDecoder: {}", (void *)this); }
+
+bool SubtitleDecoder::decode(const AVPacket *packet, Subtitle *subtitle) {
+    AVSubtitle decoded {};
+    int got_subtitle = 0;
+    // Takes a non-const packet for historical reasons, but does not modify it.
+    int ret = avcodec_decode_subtitle2(m_codec_ctx.get(), &decoded, &got_subtitle, const_cast<AVPacket *>(packet));
+    if (ret < 0) {
+        WARN("failed to decode subtitle: {}", avErrorString(ret));
+        return false;
+    }
+    if (!got_subtitle) {
+        return false;
+    }
+
+    double base = NAN;
+    if (decoded.pts != AV_NOPTS_VALUE) {
+        base = decoded.pts / static_cast<double>(AV_TIME_BASE);
+    } else if (packet->pts != AV_NOPTS_VALUE) {
+        base = packet->pts * av_q2d(m_time_base);
+    }
+    if (std::isnan(base)) {
+        avsubtitle_free(&decoded);
+        return false;
+    }
+
+    subtitle->id = m_next_id++;
+    subtitle->start = base + decoded.start_display_time / 1000.0;
+    subtitle->end = INFINITY;
+    if (decoded.end_display_time > decoded.start_display_time && decoded.end_display_time != UINT32_MAX) {
+        subtitle->end = base + decoded.end_display_time / 1000.0;
+    } else if (packet->duration > 0) {
+        subtitle->end = base + packet->duration * av_q2d(m_time_base);
+    }
+    subtitle->lines.clear();
+    subtitle->images.clear();
+
+    for (unsigned i = 0; i < decoded.num_rects; ++i) {
+        const AVSubtitleRect *rect = decoded.rects[i];
+        switch (rect->type) {
+            case SUBTITLE_BITMAP: {
+                if (rect->w <= 0 || rect->h <= 0 || !rect->data[0] || !rect->data[1]) {
+                    break;
+                }
+                Image image {rect->x, rect->y, rect->w, rect->h, std::vector<uint8_t>(size_t(rect->w) * rect->h * 4)};
+                // Palette entries are native-endian 0xAARRGGBB.
+                const auto *palette = reinterpret_cast<const uint32_t *>(rect->data[1]);
+                uint8_t *dst = image.rgba.data();
+                for (int y = 0; y < rect->h; ++y) {
+                    const uint8_t *indices = rect->data[0] + size_t(y) * rect->linesize[0];
+                    for (int x = 0; x < rect->w; ++x) {
+                        const uint32_t color = palette[indices[x]];
+                        const uint32_t alpha = color >> 24;
+                        dst[0] = static_cast<uint8_t>(((color >> 16) & 0xff) * alpha / 255);
+                        dst[1] = static_cast<uint8_t>(((color >> 8) & 0xff) * alpha / 255);
+                        dst[2] = static_cast<uint8_t>((color & 0xff) * alpha / 255);
+                        dst[3] = static_cast<uint8_t>(alpha);
+                        dst += 4;
+                    }
+                }
+                subtitle->images.push_back(std::move(image));
+                break;
+            }
+            case SUBTITLE_TEXT: {
+                if (!rect->text) {
+                    break;
+                }
+                const char *line = rect->text;
+                while (const char *end = std::strchr(line, '\n')) {
+                    subtitle->lines.emplace_back(line, end);
+                    line = end + 1;
+                }
+                if (*line) {
+                    subtitle->lines.emplace_back(line);
+                }
+                break;
+            }
+            case SUBTITLE_ASS:
+                if (rect->ass) {
+                    for (auto &line : parseAssDialogue(rect->ass)) {
+                        subtitle->lines.push_back(std::move(line));
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    avsubtitle_free(&decoded);
+    return true;
+}
+
+void SubtitleDecoder::flush() { avcodec_flush_buffers(m_codec_ctx.get()); }
+
+std::vector<std::string> SubtitleDecoder::parseAssDialogue(const char *ass) {
+    // ReadOrder, Layer, Style, Name, MarginL, MarginR, MarginV and Effect come before the text.
+    const char *text = ass;
+    for (int field = 0; field < 8 && text; ++field) {
+        text = std::strchr(text, ',');
+        if (text) {
+            ++text;
+        }
+    }
+    if (!text) {
+        text = ass;
+    }
+
+    std::vector<std::string> lines(1);
+    for (const char *c = text; *c; ++c) {
+        if (*c == '{') {
+            // Override block, e.g. {\i1} or {\pos(10,20)}.
+            const char *end = std::strchr(c, '}');
+            if (!end) {
+                break;
+            }
+            c = end;
+        } else if (*c == '\\' && (c[1] == 'N' || c[1] == 'n')) {
+            lines.emplace_back();
+            ++c;
+        } else if (*c == '\\' && c[1] == 'h') {
+            lines.back() += ' ';
+            ++c;
+        } else if (*c != '\r' && *c != '\n') {
+            lines.back() += *c;
+        }
+    }
+    std::erase_if(lines, [](const std::string &line) { return line.empty(); });
+    return lines;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+
+/**
+ *  @class SubtitleDecoder
+ *
+ *  @brief Decodes a subtitle stream through libavcodec into lines of text or premultiplied RGBA bitmaps.
+ *
+ *  Text formats (SubRip, ASS, WebVTT, mov_text...) come out as plain lines: ASS override tags are stripped and
+ *  only the text field of a dialogue event is kept. Bitmap formats (PGS, DVB, VobSub) come out as images placed on
+ *  the canvas the stream was authored for.
+ *
+ *  @note Not thread-safe; owned by the thread that draws the subtitles.
+ */
+class SubtitleDecoder {
+public:
+    NONCOPYABLE(SubtitleDecoder)
+    NONMOVABLE(SubtitleDecoder)
+
+    struct Image {
+        int x;
+        int y;
+        int width;
+        int height;
+        std::vector<uint8_t> rgba;  // premultiplied, `width * 4` bytes per row
+    };
+
+    struct Subtitle {
+        uint64_t id;   // unique per decoder, e.g. to key atlas entries
+        double start;  // seconds, in the stream's timeline
+        double end;    // INFINITY until the next subtitle replaces it
+        std::vector<std::string> lines;
+        std::vector<Image> images;
+    };
+
+    /**
+     *  @param video_width, video_height Canvas of bitmap subtitles that do not give their own.
+     */
+    SubtitleDecoder(const AVStream *stream, int video_width, int video_height);
+    ~SubtitleDecoder();
+
+    /**
+     *  @brief Decodes one packet.
+     *
+     *  @return true if it completed a subtitle, stored into `subtitle`. An empty subtitle (no lines nor images)
+     *          clears the screen from its start on.
+     */
+    bool decode(const AVPacket *packet, Subtitle *subtitle);
+
+    void flush();
+
+    /**
+     *  @return Size of the canvas bitmap positions refer to; the video size if the stream does not say.
+     */
+    int getCanvasWidth() const { return m_canvas_width; }
+    int getCanvasHeight() const { return m_canvas_height; }
+
+    AVRational getTimeBase() const { return m_time_base; }
+
+    /**
+     *  @return The text of an ASS dialogue event without its leading fields and override tags, split into lines.
+     */
+    static std::vector<std::string> parseAssDialogue(const char *ass);
+
+private:
+    AVCodecContextPtr m_codec_ctx {};
+    AVRational m_time_base {};
+    int m_canvas_width {};
+    int m_canvas_height {};
+    uint64_t m_next_id {};
+};
@@ -0,0 +1,274 @@
+#include "thumbnail_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include "base/job_system.h"
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "media/demuxer.h"
+#include "media/frame_seeker.h"
+#include "render/convert/cpu_converter.h"
+#include "trace/tracer.h"
+
+namespace {
+
+struct Target {
+    int cell;
+    int64_t pts;
+    int64_t keyframe_pts;  // AV_NOPTS_VALUE without an index
+    bool keyframe_only;
+};
+
+// Consecutive targets after the same keyframe; one worker decodes them in a single pass.
+struct Segment {
+    size_t begin;
+    size_t end;
+};
+
+int roundToEven(double value) { return std::max(2, static_cast<int>(std::lround(value / 2)) * 2); }
+
+}  // namespace
+
+ThumbnailGenerator::Config ThumbnailGenerator::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.count = config_manager->getIntValue("thumbnails", "count", config.count);
+    config.columns = config_manager->getIntValue("thumbnails", "columns", config.columns);
+    config.width = config_manager->getIntValue("thumbnails", "width", config.width);
+    config.threads = config_manager->getIntValue("thumbnails", "threads", config.threads);
+    config.mode = parseMode(config_manager->getValue("thumbnails", "mode"), config.mode);
+    config.io = MappedFileIO::Config::fromConfigManager();
+    return config;
+}
+
+ThumbnailGenerator::Atlas ThumbnailGenerator::generate(const std::filesystem::path &path,
+                                                       const Config &config,
+                                                       const KeyframeIndex::Config &index_config,
+                                                       Stats *stats) {
+    TRACE_ZONE("thumbnails");
+    auto start_time = std::chrono::steady_clock::now();
+    std::shared_ptr<const KeyframeIndex> index =
+        index_config.enabled ? KeyframeIndex::loadOrBuild(path, index_config, config.io) : nullptr;
+
+    // Geometry and timing of the stream, from a demuxer that is closed again before the workers start.
+    int stream_index;
+    int64_t start;
+    int64_t duration;
+    int thumbnail_height;
+    const int thumbnail_width = roundToEven(config.width);
+    {
+        Demuxer probe {path, config.io};
+        const AVStream *stream = probe.getVideoStream();
+        if (!stream) {
+            FATAL("no video stream in {}", path.string());
+        }
+        stream_index = stream->index;
+        start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        duration = stream->duration;
+        if (duration == AV_NOPTS_VALUE || duration <= 0) {
+            duration = av_rescale_q(probe.getFormatContext()->duration, AV_TIME_BASE_Q, stream->time_base);
+        }
+        if (duration <= 0 && index && !index->getEntries(stream_index).empty()) {
+            duration = index->getEntries(stream_index).back().pts - start;
+        }
+        if (duration <= 0) {
+            FATAL("unknown duration of {}", path.string());
+        }
+
+        AVRational sar = stream->codecpar->sample_aspect_ratio;
+        double aspect = static_cast<double>(stream->codecpar->width) / stream->codecpar->height;
+        if (sar.num > 0 && sar.den > 0) {
+            aspect *= av_q2d(sar);
+        }
+        thumbnail_height = roundToEven(thumbnail_width / aspect);
+    }
+
+    const int count = std::max(1, config.count);
+    const int columns = std::clamp(config.columns, 1, count);
+    const int rows = (count + columns - 1) / columns;
+    Atlas atlas {columns, rows, thumbnail_width, thumbnail_height, {}};
+    atlas.rgba.resize(static_cast<size_t>(atlas.getWidth()) * atlas.getHeight() * 4);
+
+    // Each thumbnail shows the middle of its interval. A keyframe within half an interval is close enough.
+    const double interval = static_cast<double>(duration) / count;
+    std::vector<Target> targets;
+    for (int i = 0; i < count; ++i) {
+        int64_t pts = start + static_cast<int64_t>((i + 0.5) * interval);
+        const KeyframeIndex::Entry *keyframe = index ? index->findKeyframe(stream_index, pts) : nullptr;
+        bool keyframe_only = config.mode == Mode::Keyframes ||
+                             (config.mode == Mode::Auto && keyframe && pts - keyframe->pts <= interval / 2);
+        targets.push_back({i, pts, keyframe ? keyframe->pts : AV_NOPTS_VALUE, keyframe_only});
+    }
+
+    std::vector<Segment> segments;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const bool same_gop = !segments.empty() && !targets[i].keyframe_only && !targets[i - 1].keyframe_only &&
+                              targets[i].keyframe_pts != AV_NOPTS_VALUE &&
+                              targets[i].keyframe_pts == targets[i - 1].keyframe_pts;
+        if (same_gop) {
+            segments.back().end = i + 1;
+        } else {
+            segments.push_back({i, i + 1});
+        }
+    }
+
+    int threads = config.threads > 0 ? config.threads : JobSystem::get()->getWorkerCount();
+    threads = std::clamp(threads, 1, static_cast<int>(segments.size()));
+
+    std::atomic<size_t> next_segment {0};
+    std::atomic<int> keyframe_thumbnails {0};
+    std::atomic<int> exact_thumbnails {0};
+    std::atomic<int> failed_thumbnails {0};
+    std::atomic<uint64_t> packets {0};
+    std::atomic<uint64_t> frames_decoded {0};
+
+    // Each task is a worker draining the shared segment list, so a seeker is opened once per task, not per segment.
+    auto worker = [&](int worker_index) {
+        // One codec thread each: the parallelism is across segments.
+        std::unique_ptr<FrameSeeker> seeker;
+        try {
+            seeker = std::make_unique<FrameSeeker>(path, config.io, index, 1);
+        } catch (const std::runtime_error &e) {
+            ERROR("thumbnail worker {} failed to open {}: {}", worker_index, path.string(), e.what());
+            return;
+        }
+
+        // Box-filtered SIMD conversion where the format allows it, swscale for everything else.
+        CpuConverter converter {CpuConverter::Filter::Box};
+        SwsContext *sws = nullptr;
+        size_t segment;
+        while ((segment = next_segment.fetch_add(1, std::memory_order_relaxed)) < segments.size()) {
+            for (size_t i = segments[segment].begin; i < segments[segment].end; ++i) {
+                TRACE_ZONE("thumbnail");
+                const auto &target = targets[i];
+                auto frame = target.keyframe_only ? seeker->seekKeyframe(target.pts) : seeker->seek(target.pts);
+                if (!frame) {
+                    ++failed_thumbnails;
+                    continue;
+                }
+                (target.keyframe_only ? keyframe_thumbnails : exact_thumbnails)++;
+
+                // Cells do not overlap, so workers write into the atlas without synchronization.
+                const int x = target.cell % columns * thumbnail_width;
+                const int y = target.cell / columns * thumbnail_height;
+                uint8_t *cell = atlas.rgba.data() + (static_cast<size_t>(y) * atlas.getWidth() + x) * 4;
+                const int stride = atlas.getWidth() * 4;
+                if (converter.convert(frame.get(), cell, stride, thumbnail_width, thumbnail_height)) {
+                    continue;
+                }
+
+                sws = sws_getCachedContext(sws,
+                                           frame->width,
+                                           frame->height,
+                                           static_cast<AVPixelFormat>(frame->format),
+                                           thumbnail_width,
+                                           thumbnail_height,
+                                           AV_PIX_FMT_RGBA,
+                                           SWS_AREA,
+                                           nullptr,
+                                           nullptr,
+                                           nullptr);
+                if (!sws) {
+                    ERROR("failed to create scaler for thumbnails");
+                    break;
+                }
+                uint8_t *dst[4] {cell};
+                int dst_stride[4] {stride};
+                sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+            }
+        }
+        sws_freeContext(sws);
+
+        packets += seeker->getStats().packets;
+        frames_decoded += seeker->getStats().frames_decoded;
+    };
+
+    {
+        TaskGroup workers;
+        for (int i = 0; i < threads; ++i) {
+            workers.run([&worker, i] { worker(i); });
+        }
+    }
+
+    if (stats) {
+        *stats = {threads,
+                  static_cast<int>(segments.size()),
+                  keyframe_thumbnails,
+                  exact_thumbnails,
+                  failed_thumbnails,
+                  packets,
+                  frames_decoded,
+                  std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count()};
+    }
+    if (failed_thumbnails > 0) {
+        WARN("{} of {} thumbnails of {} failed", failed_thumbnails.load(), count, path.string());
+    }
+    return atlas;
+}
+
+bool ThumbnailGenerator::writePng(const Atlas &atlas, const std::filesystem::path &path) {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec) {
+        ERROR("no PNG encoder in this FFmpeg build");
+        return false;
+    }
+    AVCodecContextPtr encoder_ctx {avcodec_alloc_context3(codec)};
+    encoder_ctx->width = atlas.getWidth();
+    encoder_ctx->height = atlas.getHeight();
+    encoder_ctx->pix_fmt = AV_PIX_FMT_RGBA;
+    encoder_ctx->time_base = {1, 1};
+    int ret = avcodec_open2(encoder_ctx.get(), codec, nullptr);
+    if (ret < 0) {
+        ERROR("failed to open PNG encoder: {}", avErrorString(ret));
+        return false;
+    }
+
+    // The frame only borrows the atlas; the encoder copies what it needs.
+    AVFramePtr frame = allocFrame();
+    frame->format = AV_PIX_FMT_RGBA;
+    frame->width = atlas.getWidth();
+    frame->height = atlas.getHeight();
+    frame->data[0] = const_cast<uint8_t *>(atlas.rgba.data());
+    frame->linesize[0] = atlas.getWidth() * 4;
+
+    AVPacketPtr packet = allocPacket();
+    ret = avcodec_send_frame(encoder_ctx.get(), frame.get());
+    if (ret >= 0) {
+        avcodec_send_frame(encoder_ctx.get(), nullptr);
+        ret = avcodec_receive_packet(encoder_ctx.get(), packet.get());
+    }
+    if (ret < 0) {
+        ERROR("failed to encode thumbnail atlas: {}", avErrorString(ret));
+        return false;
+    }
+
+    std::ofstream out {path, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(packet->data), packet->size);
+    if (!out) {
+        ERROR("failed to write {}", path.string());
+        return false;
+    }
+    INFO("wrote {}x{} thumbnail atlas to {}", atlas.getWidth(), atlas.getHeight(), path.string());
+    return true;
+}
+
+ThumbnailGenerator::Mode ThumbnailGenerator::parseMode(const std::string &name, Mode fallback) {
+    if (name == "auto") {
+        return Mode::Auto;
+    }
+    if (name == "keyframes") {
+        return Mode::Keyframes;
+    }
+    if (name == "exact") {
+        return Mode::Exact;
+    }
+    return fallback;
+}
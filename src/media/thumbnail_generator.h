@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "media/keyframe_index.h"
+#include "media/mapped_file_io.h"
+
+/**
+ *  @class ThumbnailGenerator
+ *
+ *  @brief Renders evenly spaced thumbnails of a video into one RGBA atlas (a contact sheet), headless.
+ *
+ *  The thumbnail times are grouped into keyframe-aligned segments, which JobSystem tasks pick up in order. Every
+ *  task has its own FrameSeeker, hence its own AVFormatContext and single-threaded AVCodecContext, so segments
+ *  decode in parallel without sharing any codec state. When the keyframe before a thumbnail is close enough to
+ *  its time, only that keyframe is decoded; otherwise the task decodes forward to the exact frame. Each
+ *  thumbnail is downscaled straight into its cell of the atlas.
+ */
+class ThumbnailGenerator {
+public:
+    enum class Mode {
+        Auto,       // keyframe when it is within half a thumbnail interval of the target, exact frame otherwise
+        Keyframes,  // always the keyframe at or before the target
+        Exact,      // always the exact frame
+    };
+
+    struct Config {
+        int count {64};
+        int columns {8};
+        int width {256};   // of one thumbnail; the height follows the display aspect ratio
+        int threads {0};   // concurrent decode tasks; 0 uses every job system worker
+        Mode mode {Mode::Auto};
+        MappedFileIO::Config io {};
+
+        /**
+         *  @brief Reads the `[thumbnails]` and `[io]` sections of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Atlas {
+        int columns;
+        int rows;
+        int thumbnail_width;
+        int thumbnail_height;
+        std::vector<uint8_t> rgba;  // (columns * thumbnail_width) x (rows * thumbnail_height), tightly packed
+
+        int getWidth() const { return columns * thumbnail_width; }
+        int getHeight() const { return rows * thumbnail_height; }
+    };
+
+    struct Stats {
+        int threads;
+        int segments;
+        int keyframe_thumbnails;  // served by decoding only a keyframe
+        int exact_thumbnails;     // decoded forward to the exact frame
+        int failed_thumbnails;
+        uint64_t packets;         // video packets sent to the decoders
+        uint64_t frames_decoded;
+        double seconds;           // wall time, index lookup included
+    };
+
+    /**
+     *  @brief Generates the atlas of `path`, building its keyframe index first if needed.
+     *
+     *  @note Throws std::runtime_error if the file cannot be opened or has no video stream.
+     */
+    static Atlas generate(const std::filesystem::path &path,
+                          const Config &config,
+                          const KeyframeIndex::Config &index_config,
+                          Stats *stats = nullptr);
+
+    /**
+     *  @brief Encodes `atlas` as a PNG file.
+     *
+     *  @return false if the encoder is unavailable or the file cannot be written.
+     */
+    static bool writePng(const Atlas &atlas, const std::filesystem::path &path);
+
+    /**
+     *  @return The mode named `name` ("auto", "keyframes" or "exact"), or `fallback` if unknown.
+     */
+    static Mode parseMode(const std::string &name, Mode fallback);
+};
@@ -0,0 +1,203 @@
+#include "transcoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stop_token>
+#include <thread>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "media/media_engine.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/pixel_readback_ring.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/yuv_converter.h"
+#include "trace/tracer.h"
+
+namespace {
+
+int roundToEven(double value) { return std::max(2, static_cast<int>(std::lround(value / 2)) * 2); }
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+double fraction(double busy_seconds, double seconds) {
+    return seconds > 0 ? std::clamp(busy_seconds / seconds, 0.0, 1.0) : 0.0;
+}
+
+}  // namespace
+
+Transcoder::Config Transcoder::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.width = config_manager->getIntValue("export", "width", config.width);
+    config.height = config_manager->getIntValue("export", "height", config.height);
+    config.readback_slots = config_manager->getIntValue("export", "readback_slots", config.readback_slots);
+    config.encoder = VideoEncoder::Config::fromConfigManager();
+    return config;
+}
+
+bool Transcoder::run(const std::filesystem::path &input,
+                     const std::filesystem::path &output,
+                     const Config &config,
+                     Stats *stats) {
+    TRACE_ZONE("export");
+    const auto start_time = std::chrono::steady_clock::now();
+
+    auto media_config = MediaEngine::Config::fromConfigManager();
+    // Exports are not burnt in with subtitles; do not read their packets.
+    media_config.subtitles = false;
+    auto engine = MediaEngine::create(input, media_config);
+    if (!engine->hasVideo()) {
+        FATAL("no video stream in {}", input.string());
+    }
+    const AVCodecContext *codec_ctx = engine->getVideoDecoder()->getCodecContext();
+    const size_t slot_size = YuvConverter::getStagingSize(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height);
+    if (slot_size == 0) {
+        FATAL("unsupported pixel format {} in {}", av_get_pix_fmt_name(codec_ctx->pix_fmt), input.string());
+    }
+
+    // Scaling happens on the GPU: frames are drawn straight at the output size.
+    const double aspect = double(codec_ctx->width) / codec_ctx->height;
+    int width = config.width;
+    int height = config.height;
+    if (width <= 0 && height <= 0) {
+        width = codec_ctx->width;
+        height = codec_ctx->height;
+    } else if (width <= 0) {
+        width = height * aspect;
+    } else if (height <= 0) {
+        height = width / aspect;
+    }
+    width = roundToEven(width);
+    height = roundToEven(height);
+
+    const AVRational time_base = engine->getVideoDecoder()->getTimeBase();
+    const AVRational frame_rate = codec_ctx->framerate.num > 0 && codec_ctx->framerate.den > 0
+                                      ? codec_ctx->framerate
+                                      : AVRational {25, 1};
+    const int64_t frame_duration = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(frame_rate), time_base));
+
+    // The window is never shown; it only carries the context, so this also runs under Xvfb with llvmpipe.
+    auto gl = GLContext::createWithWindow({width, height, "video-app export"}, false);
+    gl->makeCurrentContext();
+    auto &state = gl->getStateCache();
+
+    auto upload_ring = gl->createPixelUploadRing(media_config.video_frame_queue_depth + 3, slot_size);
+    upload_ring->pump();
+    YuvConverter converter {gl};
+
+    GLuint target, fbo;
+    glCall(gl, GenTextures, 1, &target);
+    state.bindTexture(0, GL_TEXTURE_2D, target);
+    glCall(gl, TexImage2D, GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glCall(gl, GenFramebuffers, 1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glCall(gl, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    state.viewport(0, 0, width, height);
+
+    auto readback_ring = gl->createPixelReadbackRing(std::max<size_t>(config.readback_slots, 1), width, height);
+    auto encoder = std::make_unique<VideoEncoder>(output, width, height, time_base, frame_rate, config.encoder);
+    encoder->start(readback_ring);
+
+    // Time the decode thread waits for a mapped upload slot, i.e. for the GL thread.
+    std::atomic<uint64_t> upload_wait_ns {0};
+    engine->start([&](AVFrame *frame, const std::stop_token &stop) {
+        const auto wait_start = std::chrono::steady_clock::now();
+        auto slot = upload_ring->acquireWritable(stop);
+        upload_wait_ns.fetch_add(nanosecondsSince(wait_start), std::memory_order_relaxed);
+        if (!slot) {
+            return false;
+        }
+        if (!YuvConverter::stage(slot, frame)) {
+            upload_ring->publish(slot);
+            return true;
+        }
+        frame->opaque = slot;
+        return true;
+    });
+
+    uint64_t frames = 0;
+    uint64_t gl_ns = 0;
+    int64_t last_pts = AV_NOPTS_VALUE;
+    const std::stop_token never_stop {};
+    while (!engine->isVideoFinished() && !encoder->hasFailed()) {
+        // Audio is not exported; popping it keeps the demux thread from blocking on a full audio queue.
+        while (engine->tryPopAudioFrame()) {
+        }
+        upload_ring->pump();
+        // Readbacks that finished while this thread waited for frames go to the encoder now.
+        readback_ring->pump();
+
+        auto frame = engine->tryPopVideoFrame();
+        if (!frame) {
+            while (auto slot = upload_ring->tryPopFilled()) {
+                upload_ring->discard(slot);
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        const auto frame_start = std::chrono::steady_clock::now();
+        {
+            GL_ERROR_SCOPE(gl, "export frame");
+            if (auto slot = static_cast<PixelUploadRing::Slot *>(frame->opaque)) {
+                converter.upload(*upload_ring, slot, frame.get());
+            }
+            converter.drawFullViewport();
+
+            // Encoders need increasing timestamps; missing or repeated ones continue at the nominal rate.
+            int64_t pts = frame->best_effort_timestamp;
+            if (pts == AV_NOPTS_VALUE || (last_pts != AV_NOPTS_VALUE && pts <= last_pts)) {
+                pts = last_pts == AV_NOPTS_VALUE ? 0 : last_pts + frame_duration;
+            }
+            last_pts = pts;
+            readback_ring->readback(readback_ring->acquireFree(never_stop), pts);
+        }
+        gl_ns += nanosecondsSince(frame_start);
+        ++frames;
+    }
+    readback_ring->close();
+    const bool written = encoder->finish();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    if (stats) {
+        const auto media_stats = engine->getStats();
+        const auto readback_stats = readback_ring->getStats();
+        const auto encoder_stats = encoder->getStats();
+        const double demux_wait =
+            (media_stats.video_packets.push_wait_ns + media_stats.audio_packets.push_wait_ns) * 1e-9;
+        const double decode_wait = (media_stats.video_packets.pop_wait_ns + media_stats.video_frames.push_wait_ns +
+                                    upload_wait_ns.load(std::memory_order_relaxed)) *
+                                   1e-9;
+        const double readback_wait = readback_stats.fence_wait_ns * 1e-9;
+        const double gl_wait = readback_wait + readback_stats.reader_wait_ns * 1e-9;
+
+        stats->frames = frames;
+        stats->seconds = seconds;
+        stats->fps = seconds > 0 ? frames / seconds : 0.0;
+        stats->demux_busy = fraction(media_stats.demux_seconds - demux_wait, seconds);
+        stats->decode_busy = fraction(media_stats.video_decode_seconds - decode_wait, seconds);
+        stats->gl_busy = fraction(gl_ns * 1e-9 - gl_wait, seconds);
+        stats->readback_wait = fraction(readback_wait, seconds);
+        stats->encode_busy = fraction(encoder_stats.busy_seconds, seconds);
+    }
+
+    // The decode thread stages into the upload ring until it stops, and the encoder holds the readback ring.
+    engine.reset();
+    encoder.reset();
+    readback_ring.reset();
+    upload_ring.reset();
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
+    state.deleteTextures(1, &target);
+    return written;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "media/video_encoder.h"
+
+/**
+ *  @class Transcoder
+ *
+ *  @brief Exports a video headless: decode, render through GL, read back and encode, with every stage on its own
+ *         thread.
+ *
+ *  MediaEngine demuxes and decodes as for playback, staging frames into a PixelUploadRing on the decode thread.
+ *  The calling thread owns an invisible GLContext: it uploads and converts each frame into an offscreen target of
+ *  the output size, and queues an asynchronous readback into a PixelReadbackRing. VideoEncoder consumes the mapped
+ *  readbacks on its own thread. Decode, GPU work, readback and encode thus overlap, and each stage only waits when
+ *  the next one is full.
+ *
+ *  @note Only the video stream is exported.
+ */
+class Transcoder {
+public:
+    struct Config {
+        int width {0};  // of the output; 0 keeps the source size, or follows its aspect ratio if the other is set
+        int height {0};
+        size_t readback_slots {4};
+        VideoEncoder::Config encoder {};
+
+        /**
+         *  @brief Reads the `[export]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t frames;
+        double seconds;  // wall time, opening the input and the output included
+        double fps;
+
+        // Fractions of the wall time each stage spent working rather than waiting for the others.
+        double demux_busy;
+        double decode_busy;
+        double gl_busy;
+        double readback_wait;  // the GL thread blocked on readback fences
+        double encode_busy;
+    };
+
+    /**
+     *  @brief Exports the video of `input` into `output`, the container guessed from its extension.
+     *
+     *  @return false if encoding or writing failed.
+     *
+     *  @note This function must only be called from the main thread. Throws std::runtime_error if the input
+     *        cannot be opened or decoded, or the encoder or output file cannot be opened.
+     */
+    static bool run(const std::filesystem::path &input,
+                    const std::filesystem::path &output,
+                    const Config &config,
+                    Stats *stats = nullptr);
+};
@@ -0,0 +1,231 @@
+#include "video_encoder.h"
+
+#include <chrono>
+
+extern "C" {
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "render/context/pixel_readback_ring.h"
+#include "trace/tracer.h"
+
+namespace {
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+VideoEncoder::Config VideoEncoder::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    if (auto codec = config_manager->getValue("export", "codec"); !codec.empty()) {
+        config.codec = codec;
+    }
+    if (auto preset = config_manager->getValue("export", "preset"); !preset.empty()) {
+        config.preset = preset;
+    }
+    config.bitrate_kbps = config_manager->getIntValue("export", "bitrate_kbps", config.bitrate_kbps);
+    config.threads = config_manager->getIntValue("export", "encoder_threads", config.threads);
+    return config;
+}
+
+void VideoEncoder::OutputDeleter::operator()(AVFormatContext *ctx) const {
+    if (ctx->pb) {
+        avio_closep(&ctx->pb);
+    }
+    avformat_free_context(ctx);
+}
+
+VideoEncoder::VideoEncoder(const std::filesystem::path &path,
+                           int width,
+                           int height,
+                           AVRational time_base,
+                           AVRational frame_rate,
+                           const Config &config)
+    : m_config(config), m_path(path), m_frame(allocFrame()), m_packet(allocPacket()) {
+    const AVCodec *codec = avcodec_find_encoder_by_name(config.codec.c_str());
+    if (!codec) {
+        FATAL("encoder {} not available", config.codec);
+    }
+
+    AVFormatContext *output = nullptr;
+    int ret = avformat_alloc_output_context2(&output, nullptr, nullptr, path.c_str());
+    if (ret < 0) {
+        FATAL("failed to create muxer for {}: {}", path.string(), avErrorString(ret));
+    }
+    m_output.reset(output);
+
+    m_encoder.reset(avcodec_alloc_context3(codec));
+    if (!m_encoder) {
+        FATAL("failed to allocate codec context!");
+    }
+    m_encoder->width = width;
+    m_encoder->height = height;
+    m_encoder->pix_fmt = codec->pix_fmts ? codec->pix_fmts[0] : AV_PIX_FMT_YUV420P;
+    m_encoder->time_base = time_base;
+    m_encoder->framerate = frame_rate;
+    m_encoder->thread_count = config.threads;
+    if (config.bitrate_kbps > 0) {
+        m_encoder->bit_rate = config.bitrate_kbps * 1000ll;
+    }
+    // What libswscale produces from RGB by default.
+    m_encoder->colorspace = AVCOL_SPC_SMPTE170M;
+    m_encoder->color_range = AVCOL_RANGE_MPEG;
+    if (m_output->oformat->flags & AVFMT_GLOBALHEADER) {
+        m_encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    // Encoders without a preset option ignore it.
+    av_opt_set(m_encoder->priv_data, "preset", config.preset.c_str(), 0);
+
+    ret = avcodec_open2(m_encoder.get(), codec, nullptr);
+    if (ret < 0) {
+        FATAL("failed to open encoder {}: {}", config.codec, avErrorString(ret));
+    }
+
+    m_stream = avformat_new_stream(m_output.get(), nullptr);
+    if (!m_stream) {
+        FATAL("failed to create output stream!");
+    }
+    m_stream->time_base = m_encoder->time_base;
+    m_stream->avg_frame_rate = frame_rate;
+    avcodec_parameters_from_context(m_stream->codecpar, m_encoder.get());
+
+    ret = avio_open(&m_output->pb, path.c_str(), AVIO_FLAG_WRITE);
+    if (ret >= 0) {
+        ret = avformat_write_header(m_output.get(), nullptr);
+    }
+    if (ret < 0) {
+        FATAL("failed to start writing {}: {}", path.string(), avErrorString(ret));
+    }
+
+    m_sws = sws_getContext(
+        width, height, AV_PIX_FMT_RGBA, width, height, m_encoder->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    m_frame->format = m_encoder->pix_fmt;
+    m_frame->width = width;
+    m_frame->height = height;
+    if (!m_sws || av_frame_get_buffer(m_frame.get(), 0) < 0) {
+        FATAL("failed to set up RGBA conversion for {}", config.codec);
+    }
+
+    INFO("encoding {}x{} {} into {}", width, height, config.codec, path.string());
+}
+
+VideoEncoder::~VideoEncoder() {
+    m_thread.request_stop();
+    m_thread = {};
+    sws_freeContext(m_sws);
+    DEBUG("release VideoEncoder: {}", (void *)this);
+}
+
+void VideoEncoder::start(std::shared_ptr<PixelReadbackRing> ring) {
+    if (m_thread.joinable()) {
+        FATAL("VideoEncoder already started!");
+    }
+    m_ring = std::move(ring);
+    m_thread = std::jthread {[this](std::stop_token stop) { run(stop); }};
+}
+
+bool VideoEncoder::finish() {
+    // No stop request: the thread ends on the ring's end of stream, after flushing the encoder.
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    return !m_failed;
+}
+
+VideoEncoder::Stats VideoEncoder::getStats() const {
+    return {
+        m_frames.load(std::memory_order_relaxed),
+        m_packets.load(std::memory_order_relaxed),
+        m_bytes.load(std::memory_order_relaxed),
+        m_busy_ns.load(std::memory_order_relaxed) * 1e-9,
+        m_wait_ns.load(std::memory_order_relaxed) * 1e-9,
+    };
+}
+
+void VideoEncoder::run(std::stop_token stop) {
+    Tracer::get()->setThreadName("encode");
+
+    while (true) {
+        auto wait_start = std::chrono::steady_clock::now();
+        PixelReadbackRing::Slot *slot = m_ring->acquireReadable(stop);
+        m_wait_ns.fetch_add(nanosecondsSince(wait_start), std::memory_order_relaxed);
+        if (!slot) {
+            break;
+        }
+
+        if (m_failed) {
+            // Keeps draining, so the GL thread never waits for a slot that would not come back.
+            m_ring->release(slot);
+            continue;
+        }
+
+        auto busy_start = std::chrono::steady_clock::now();
+        {
+            TRACE_ZONE("encode frame");
+            if (av_frame_make_writable(m_frame.get()) < 0) {
+                ERROR("failed to allocate encoder frame");
+                m_failed = true;
+                m_ring->release(slot);
+                continue;
+            }
+            // GL reads rows bottom-up; walking them backwards flips the picture.
+            const uint8_t *source = slot->data + (slot->height - 1) * slot->stride;
+            const int source_stride = -static_cast<int>(slot->stride);
+            sws_scale(m_sws, &source, &source_stride, 0, slot->height, m_frame->data, m_frame->linesize);
+            m_frame->pts = slot->pts;
+            // The pixels are copied out, so the slot can take the next readback while this frame encodes.
+            m_ring->release(slot);
+
+            if (writePackets(m_frame.get())) {
+                m_frames.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_failed = true;
+            }
+        }
+        m_busy_ns.fetch_add(nanosecondsSince(busy_start), std::memory_order_relaxed);
+    }
+
+    // Stopped by the destructor before the end of the stream: the file is left unfinished.
+    if (!m_ring->isDrained() || m_failed) {
+        return;
+    }
+    auto busy_start = std::chrono::steady_clock::now();
+    if (!writePackets(nullptr)) {
+        m_failed = true;
+        return;
+    }
+    const int ret = av_write_trailer(m_output.get());
+    if (ret < 0) {
+        ERROR("failed to finish {}: {}", m_path.string(), avErrorString(ret));
+        m_failed = true;
+    }
+    m_busy_ns.fetch_add(nanosecondsSince(busy_start), std::memory_order_relaxed);
+}
+
+bool VideoEncoder::writePackets(const AVFrame *frame) {
+    int ret = avcodec_send_frame(m_encoder.get(), frame);
+    if (ret < 0) {
+        ERROR("failed to send frame to encoder: {}", avErrorString(ret));
+        return false;
+    }
+
+    while ((ret = avcodec_receive_packet(m_encoder.get(), m_packet.get())) >= 0) {
+        av_packet_rescale_ts(m_packet.get(), m_encoder->time_base, m_stream->time_base);
+        m_packet->stream_index = m_stream->index;
+        m_packets.fetch_add(1, std::memory_order_relaxed);
+        m_bytes.fetch_add(m_packet->size, std::memory_order_relaxed);
+        // Takes over the packet's data and leaves it blank for the next one.
+        ret = av_interleaved_write_frame(m_output.get(), m_packet.get());
+        if (ret < 0) {
+            ERROR("failed to write packet: {}", avErrorString(ret));
+            return false;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
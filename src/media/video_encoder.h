@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+
+struct SwsContext;
+class PixelReadbackRing;
+
+/**
+ *  @class VideoEncoder
+ *
+ *  @brief Encodes rendered RGBA frames into a video file on its own thread.
+ *
+ *  The thread consumes mapped slots of a PixelReadbackRing in order, converts each to the encoder's pixel format
+ *  with libswscale straight from the mapped memory (flipping GL's bottom-up rows on the way), releases the slot,
+ *  then encodes and muxes the frame. The GL thread therefore never waits for the codec, only for a free slot when
+ *  the encoder falls behind.
+ */
+class VideoEncoder {
+public:
+    NONCOPYABLE(VideoEncoder)
+    NONMOVABLE(VideoEncoder)
+
+    struct Config {
+        std::string codec {"libx264"};
+        std::string preset {"veryfast"};  // passed to encoders that have the option
+        int bitrate_kbps {0};             // 0 keeps the encoder's default rate control
+        int threads {0};                  // encoder threads; 0 lets the codec decide
+
+        /**
+         *  @brief Reads the `[export]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t frames;
+        uint64_t packets;
+        uint64_t bytes;
+        double busy_seconds;  // converting, encoding and muxing
+        double wait_seconds;  // waiting for the next readback
+    };
+
+    /**
+     *  @brief Opens the encoder and creates `path`, its container guessed from the extension.
+     *
+     *  @param time_base Unit of the pts of the frames read back.
+     *  @param frame_rate Nominal rate, for rate control and the container.
+     *
+     *  @note Throws std::runtime_error if the encoder or the file cannot be opened.
+     */
+    VideoEncoder(const std::filesystem::path &path,
+                 int width,
+                 int height,
+                 AVRational time_base,
+                 AVRational frame_rate,
+                 const Config &config);
+
+    /**
+     *  @brief Stops the thread and closes the file, finished or not.
+     */
+    ~VideoEncoder();
+
+    /**
+     *  @brief Starts encoding the slots of `ring` until it is closed.
+     */
+    void start(std::shared_ptr<PixelReadbackRing> ring);
+
+    /**
+     *  @brief Waits until every slot of the closed ring is encoded, then flushes the encoder and finishes the file.
+     *
+     *  @return false if encoding or writing failed.
+     */
+    bool finish();
+
+    /**
+     *  @return true once encoding or writing failed; the remaining slots are then released without being encoded.
+     *
+     *  @note Thread-safe.
+     */
+    bool hasFailed() const { return m_failed; }
+
+    /**
+     *  @note Thread-safe.
+     */
+    Stats getStats() const;
+
+private:
+    struct OutputDeleter {
+        void operator()(AVFormatContext *ctx) const;
+    };
+
+    Config m_config {};
+    std::filesystem::path m_path {};
+
+    AVCodecContextPtr m_encoder {};
+    std::unique_ptr<AVFormatContext, OutputDeleter> m_output {};
+    AVStream *m_stream {};
+    SwsContext *m_sws {};
+    AVFramePtr m_frame {};
+    AVPacketPtr m_packet {};
+
+    std::shared_ptr<PixelReadbackRing> m_ring {};
+    std::atomic<bool> m_failed {false};
+
+    std::atomic<uint64_t> m_frames {0};
+    std::atomic<uint64_t> m_packets {0};
+    std::atomic<uint64_t> m_bytes {0};
+    std::atomic<uint64_t> m_busy_ns {0};
+    std::atomic<uint64_t> m_wait_ns {0};
+
+    // Declared last so the thread is joined before anything it touches is destroyed.
+    std::jthread m_thread {};
+
+    void run(std::stop_token stop);
+
+    /**
+     *  @brief Sends `frame` (nullptr flushes) and muxes every packet the encoder returns.
+     */
+    bool writePackets(const AVFrame *frame);
+};
@@ -1,6 +1,11 @@
 #include "gl_context.h"
 
+#include "gl_state_cache.h"
+#include "gpu_tracer.h"
 #include "log/log_system.h"
+#include "pixel_readback_ring.h"
+#include "pixel_upload_ring.h"
+#include "program_cache.h"
 #include "window_manager.h"
 
 std::weak_ptr<GLContext::GLFWOwnership> GLContext::s_glfw_existence {};
@@ -27,8 +32,11 @@ void GLContext::getGLFWOwnership() {
     DEBUG("GLFW owner: {}", m_glfw_ownership.use_count());
 }
 
-GLContext::GLContext(const WindowInfo &info, bool visible) {
+GLContext::GLContext(const WindowInfo &info, bool visible, GLFWwindow *share) {
     getGLFWOwnership();
+    // Loading the function pointers needs this context current; whatever was current before is restored after.
+    GLFWwindow *previous_window = glfwGetCurrentContext();
+    auto previous_context = s_current_context;
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
@@ -39,7 +47,7 @@ GLContext::GLContext(const WindowInfo &info, bool visible) {
 
     glfwWindowHint(GLFW_VISIBLE, visible);
 
-    m_window = glfwCreateWindow(info.width, info.height, info.title.c_str(), nullptr, nullptr);
+    m_window = glfwCreateWindow(info.width, info.height, info.title.c_str(), nullptr, share);
     if (!m_window) {
         FATAL("failed to create window and GL context!");
     }
@@ -50,10 +58,14 @@ GLContext::GLContext(const WindowInfo &info, bool visible) {
         FATAL("failed to load function pointers!");
     }
     INFO("loaded OpenGL {}.{}", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
-    resetCurrentContext();
+    m_state_cache = std::unique_ptr<GLStateCache> {new GLStateCache {this}};
+    glfwMakeContextCurrent(previous_window);
+    s_current_context = previous_context;
 }
 
 GLContext::~GLContext() {
+    auto stats = m_state_cache->getStats();
+    DEBUG("GL state cache: {} calls issued, {} skipped", stats.issued, stats.skipped);
     glfwDestroyWindow(m_window);
     DEBUG("release GLContext: {}", (void *)this);
 }
@@ -62,6 +74,10 @@ std::shared_ptr<GLContext> GLContext::createWithWindow(const WindowInfo &info, b
     return std::shared_ptr<GLContext> {new GLContext {info, visible}};
 }
 
+std::shared_ptr<GLContext> GLContext::createSharedContext() {
+    return std::shared_ptr<GLContext> {new GLContext {{1, 1, "shared"}, false, m_window}};
+}
+
 void GLContext::resetCurrentContext() {
     glfwMakeContextCurrent(nullptr);
     s_current_context.reset();
@@ -82,8 +98,43 @@ void GLContext::swapBuffers() const {
     }
 
     glfwSwapBuffers(m_window);
+    if (m_gpu_tracer) {
+        m_gpu_tracer->collect();
+    }
+}
+
+GpuTracer *GLContext::getGpuTracer() {
+    if (!m_gpu_tracer) {
+        m_gpu_tracer = std::unique_ptr<GpuTracer> {new GpuTracer {&m_gl}};
+    }
+    return m_gpu_tracer.get();
+}
+
+ProgramCache *GLContext::getProgramCache() {
+    if (!m_program_cache) {
+        auto config = ProgramCache::Config::fromConfigManager();
+        m_program_cache = std::unique_ptr<ProgramCache> {new ProgramCache {this, config}};
+    }
+    return m_program_cache.get();
 }
 
 std::shared_ptr<WindowManager> GLContext::createWindowManager() {
     return std::shared_ptr<WindowManager> {new WindowManager {shared_from_this()}};
 }
+
+std::shared_ptr<PixelUploadRing> GLContext::createPixelUploadRing(size_t slot_count, size_t slot_size) {
+    return std::shared_ptr<PixelUploadRing> {new PixelUploadRing {shared_from_this(), slot_count, slot_size}};
+}
+
+std::shared_ptr<PixelReadbackRing> GLContext::createPixelReadbackRing(size_t slot_count, int width, int height) {
+    return std::shared_ptr<PixelReadbackRing> {new PixelReadbackRing {shared_from_this(), slot_count, width, height}};
+}
+
+double GLContext::getRefreshRate() const {
+    GLFWmonitor *monitor = glfwGetWindowMonitor(m_window);
+    if (!monitor) {
+        monitor = glfwGetPrimaryMonitor();
+    }
+    const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    return mode ? mode->refreshRate : 0.0;
+}
@@ -9,7 +9,13 @@
 #include "base/noncopyable.h"
 #include "base/nonmovable.h"
 #include "log/log_system.h"
+#include "trace/tracer.h"
 
+class GLStateCache;
+class GpuTracer;
+class PixelReadbackRing;
+class PixelUploadRing;
+class ProgramCache;
 class WindowManager;
 
 class GLContext : public std::enable_shared_from_this<GLContext> {
@@ -46,13 +52,50 @@ public:
      */
     static std::shared_ptr<GLContext> createWithWindow(const WindowInfo &info, bool visible = true);
 
+    /**
+     *  @brief Creates a context on a hidden window that shares objects (textures, buffers, sync objects) with this
+     *         one, so another thread can make it current and prepare GL objects for this context.
+     *
+     *  @return A shared pointer to the created `GLContext` instance.
+     *
+     *  @note This function must only be called from the main thread. The context current on the calling thread
+     *        is left current.
+     */
+    std::shared_ptr<GLContext> createSharedContext();
+
     static std::weak_ptr<GLContext> getCurrentContext() { return s_current_context; }
 
     static void resetCurrentContext();
 
     void makeCurrentContext();
+
+    /**
+     *  @brief Presents the back buffer, then harvests finished GPU trace zones.
+     */
     void swapBuffers() const;
 
+    /**
+     *  @brief Sets how many vblanks `swapBuffers` waits for; 0 presents immediately.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    void setSwapInterval(int interval) const { glfwSwapInterval(interval); }
+
+    /**
+     *  @return The refresh rate of the monitor the window is full screen on, or of the primary monitor, in Hz; 0 if
+     *          unknown.
+     *
+     *  @note This function must only be called from the main thread.
+     */
+    double getRefreshRate() const;
+
+    /**
+     *  @brief Retrieves the size of the window's framebuffer in pixels.
+     *
+     *  @note This function must only be called from the main thread.
+     */
+    void getFramebufferSize(int *width, int *height) const { glfwGetFramebufferSize(m_window, width, height); }
+
     /**
      *  @brief Checks the visibility of the window.
      *
@@ -85,6 +128,52 @@ public:
      */
     std::shared_ptr<WindowManager> createWindowManager();
 
+    /**
+     *  @brief Creates a ring of pixel-unpack buffers for streaming texture uploads.
+     *
+     *  @param slot_count Number of buffers in flight; more slots hide more GPU latency.
+     *  @param slot_size Size of each buffer in bytes, large enough for one frame.
+     *
+     *  @return A shared pointer to the created PixelUploadRing instance.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    std::shared_ptr<PixelUploadRing> createPixelUploadRing(size_t slot_count, size_t slot_size);
+
+    /**
+     *  @brief Creates a ring of pixel-pack buffers for reading rendered frames back asynchronously.
+     *
+     *  @param slot_count Number of readbacks in flight; more slots hide more GPU and reader latency.
+     *  @param width, height Size of the region read back from the bound read framebuffer, in pixels.
+     *
+     *  @return A shared pointer to the created PixelReadbackRing instance.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    std::shared_ptr<PixelReadbackRing> createPixelReadbackRing(size_t slot_count, int width, int height);
+
+    /**
+     *  @brief Returns the GPU timer-query tracer of this context, creating it on first use.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    GpuTracer *getGpuTracer();
+
+    /**
+     *  @brief Returns the on-disk program binary cache of this context, configured from the `[shader_cache]`
+     *         section and created on first use.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    ProgramCache *getProgramCache();
+
+    /**
+     *  @brief Returns the cache that binds and state changes should go through.
+     *
+     *  @note This context must be current on the calling thread.
+     */
+    GLStateCache &getStateCache() { return *m_state_cache; }
+
     const GL &getGL() const { return m_gl; }
 
 private:
@@ -102,9 +191,13 @@ private:
     GLFWwindow *m_window {};
     GladGLContext m_gl {};
 
+    std::unique_ptr<GLStateCache> m_state_cache {};
+    std::unique_ptr<GpuTracer> m_gpu_tracer {};
+    std::unique_ptr<ProgramCache> m_program_cache {};
+
     void getGLFWOwnership();
 
-    GLContext(const WindowInfo &info, bool visible);
+    GLContext(const WindowInfo &info, bool visible, GLFWwindow *share = nullptr);
 };
 
 inline const char *glErrorString(GLenum err) {
@@ -124,14 +217,75 @@ inline const char *glErrorString(GLenum err) {
     }
 }
 
+inline GLContext *glContextPointer(GLContext *ctx) { return ctx; }
+
+template<typename ContextPtr>
+GLContext *glContextPointer(const ContextPtr &ctx) {
+    return ctx.get();
+}
+
+/**
+ *  @class GLErrorScope
+ *
+ *  @brief Defers `GL_ERROR_CHECK` error checks to the end of the outermost scope.
+ *
+ *  `glGetError` after every call forces the driver to synchronize, which distorts Debug timings. Inside a scope,
+ *  `glCall` skips its own check and errors are collected once, when the outermost scope (typically one frame)
+ *  ends. Errors are then attributed to the scope rather than to the exact call.
+ */
+class GLErrorScope {
+public:
+    NONCOPYABLE(GLErrorScope)
+    NONMOVABLE(GLErrorScope)
+
+    GLErrorScope(GLContext *ctx, const char *name, const char *file, int line, const char *function)
+        : m_ctx(ctx), m_name(name), m_location {file, line, function} {
+        ++s_depth;
+    }
+
+    ~GLErrorScope() {
+        if (--s_depth > 0) {
+            return;
+        }
+        auto logger = LogSystem::get()->getLogger();
+        GLenum err;
+        while ((err = m_ctx->getGL().GetError()) != GL_NO_ERROR) {
+            logger->log(m_location, spdlog::level::err, "OpenGL error in {}: {}", m_name, glErrorString(err));
+        }
+    }
+
+    static bool isActive() { return s_depth > 0; }
+
+private:
+    static inline thread_local int s_depth = 0;
+
+    GLContext *m_ctx;
+    const char *m_name;
+    spdlog::source_loc m_location;
+};
+
+// Per-call CPU zones are opt-in (VA_TRACE_GL_CALLS): cheap, but they fill the trace rings quickly.
+#ifdef TRACE_GL_CALLS
+#define GL_CALL_ZONE(name) TRACE_ZONE(name)
+#else
+#define GL_CALL_ZONE(name)
+#endif
+
 template<typename GlFunction, typename... Params>
 auto glCallImpl(const char *file,
                 int line,
                 const char *function,
+                const char *name,
                 GLContext *ctx,
                 GlFunction glFunction,
                 Params... params) -> std::enable_if_t<std::is_same_v<void, decltype(glFunction(params...))>> {
-    glFunction(params...);
+    {
+        GL_CALL_ZONE(name);
+        glFunction(params...);
+    }
+    if (GLErrorScope::isActive()) {
+        return;
+    }
     auto logger = LogSystem::get()->getLogger();
     GLenum err;
     while ((err = ctx->getGL().GetError()) != GL_NO_ERROR) {
@@ -143,11 +297,18 @@ template<typename GlFunction, typename... Params>
 auto glCallImpl(const char *file,
                 int line,
                 const char *function,
+                const char *name,
                 GLContext *ctx,
                 GlFunction glFunction,
                 Params... params)
     -> std::enable_if_t<!std::is_same_v<void, decltype(glFunction(params...))>, decltype(glFunction(params...))> {
-    auto ret = glFunction(params...);
+    auto ret = [&] {
+        GL_CALL_ZONE(name);
+        return glFunction(params...);
+    }();
+    if (GLErrorScope::isActive()) {
+        return ret;
+    }
     auto logger = LogSystem::get()->getLogger();
     GLenum err;
     while ((err = ctx->getGL().GetError()) != GL_NO_ERROR) {
@@ -156,8 +317,34 @@ auto glCallImpl(const char *file,
     return ret;
 }
 
-#ifdef GL_ERROR_CHECK
-#define glCall(ctx, func, ...) glCallImpl(__FILE__, __LINE__, __FUNCTION__, ctx.get(), ctx->getGL().func, __VA_ARGS__)
+template<typename GlFunction, typename... Params>
+decltype(auto) glTracedCall(const char *name, GlFunction glFunction, Params... params) {
+    TRACE_ZONE(name);
+    return glFunction(params...);
+}
+
+#if defined(GL_ERROR_CHECK)
+#define glCall(ctx, func, ...)        \
+    glCallImpl(__FILE__,              \
+               __LINE__,              \
+               __FUNCTION__,          \
+               "gl" #func,            \
+               glContextPointer(ctx), \
+               ctx->getGL().func __VA_OPT__(, ) __VA_ARGS__)
+#elif defined(TRACE_GL_CALLS)
+#define glCall(ctx, func, ...) glTracedCall("gl" #func, ctx->getGL().func __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define glCall(ctx, func, ...) ctx->getGL().func(__VA_ARGS__)
+#endif
+
+/**
+ *  @brief Checks GL errors once when the enclosing scope ends instead of after every `glCall` (`GL_ERROR_CHECK`
+ *         builds only).
+ */
+#ifdef GL_ERROR_CHECK
+#define GL_ERROR_SCOPE(ctx, name)                         \
+    GLErrorScope TRACE_CONCAT(gl_error_scope_, __LINE__) { \
+        glContextPointer(ctx), name, __FILE__, __LINE__, __FUNCTION__}
+#else
+#define GL_ERROR_SCOPE(ctx, name)
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "gl_state_cache.h"
+
+#include "gl_context.h"
+
+// Starts from the state of a freshly created context.
+GLStateCache::GLStateCache(GLContext *ctx) : m_ctx(ctx), m_blend_func {GL_ONE, GL_ZERO, GL_ONE, GL_ZERO} {}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (update(m_program, program)) {
+        glCall(m_ctx, UseProgram, program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (update(m_vao, vao)) {
+        glCall(m_ctx, BindVertexArray, vao);
+    }
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer) {
+    bool changed;
+    switch (target) {
+        case GL_DRAW_FRAMEBUFFER:
+            changed = update(m_draw_framebuffer, framebuffer);
+            break;
+        case GL_READ_FRAMEBUFFER:
+            changed = update(m_read_framebuffer, framebuffer);
+            break;
+        default:
+            // GL_FRAMEBUFFER sets both.
+            changed = m_draw_framebuffer != framebuffer || m_read_framebuffer != framebuffer;
+            m_draw_framebuffer = m_read_framebuffer = framebuffer;
+            ++(changed ? m_issued : m_skipped);
+            break;
+    }
+    if (changed) {
+        glCall(m_ctx, BindFramebuffer, target, framebuffer);
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+    int index = bufferTargetIndex(target);
+    if (index < 0) {
+        ++m_issued;
+        glCall(m_ctx, BindBuffer, target, buffer);
+    } else if (update(m_buffers[index], buffer)) {
+        glCall(m_ctx, BindBuffer, target, buffer);
+    }
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+    int index = textureTargetIndex(target);
+    if (index < 0 || unit >= kMaxTextureUnits) {
+        activeTexture(unit);
+        ++m_issued;
+        glCall(m_ctx, BindTexture, target, texture);
+        return;
+    }
+
+    if (m_textures[unit][index] == texture) {
+        ++m_skipped;
+        return;
+    }
+    activeTexture(unit);
+    m_textures[unit][index] = texture;
+    ++m_issued;
+    glCall(m_ctx, BindTexture, target, texture);
+}
+
+void GLStateCache::setBlend(bool enabled) {
+    if (update(m_blend_enabled, static_cast<GLuint>(enabled))) {
+        if (enabled) {
+            glCall(m_ctx, Enable, GL_BLEND);
+        } else {
+            glCall(m_ctx, Disable, GL_BLEND);
+        }
+    }
+}
+
+void GLStateCache::blendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    std::array<GLenum, 4> func {src_rgb, dst_rgb, src_alpha, dst_alpha};
+    if (update(m_blend_func, func)) {
+        glCall(m_ctx, BlendFuncSeparate, src_rgb, dst_rgb, src_alpha, dst_alpha);
+    }
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    std::array<GLint, 4> viewport {x, y, width, height};
+    if (m_viewport_known && m_viewport == viewport) {
+        ++m_skipped;
+        return;
+    }
+    m_viewport = viewport;
+    m_viewport_known = true;
+    ++m_issued;
+    glCall(m_ctx, Viewport, x, y, width, height);
+}
+
+void GLStateCache::deleteProgram(GLuint program) {
+    glCall(m_ctx, DeleteProgram, program);
+    if (m_program == program) {
+        // A program deleted while in use stays current until another one is used; keep issuing the next use.
+        m_program = kUnknown;
+    }
+}
+
+void GLStateCache::deleteVertexArrays(GLsizei count, const GLuint *vaos) {
+    glCall(m_ctx, DeleteVertexArrays, count, vaos);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (m_vao == vaos[i]) {
+            m_vao = 0;
+        }
+    }
+}
+
+void GLStateCache::deleteFramebuffers(GLsizei count, const GLuint *framebuffers) {
+    glCall(m_ctx, DeleteFramebuffers, count, framebuffers);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (m_draw_framebuffer == framebuffers[i]) {
+            m_draw_framebuffer = 0;
+        }
+        if (m_read_framebuffer == framebuffers[i]) {
+            m_read_framebuffer = 0;
+        }
+    }
+}
+
+void GLStateCache::deleteBuffers(GLsizei count, const GLuint *buffers) {
+    glCall(m_ctx, DeleteBuffers, count, buffers);
+    for (GLsizei i = 0; i < count; ++i) {
+        for (auto &bound : m_buffers) {
+            if (bound == buffers[i]) {
+                bound = 0;
+            }
+        }
+    }
+}
+
+void GLStateCache::deleteTextures(GLsizei count, const GLuint *textures) {
+    glCall(m_ctx, DeleteTextures, count, textures);
+    for (GLsizei i = 0; i < count; ++i) {
+        for (auto &unit : m_textures) {
+            for (auto &bound : unit) {
+                if (bound == textures[i]) {
+                    bound = 0;
+                }
+            }
+        }
+    }
+}
+
+void GLStateCache::invalidate() {
+    m_program = kUnknown;
+    m_vao = kUnknown;
+    m_draw_framebuffer = kUnknown;
+    m_read_framebuffer = kUnknown;
+    m_buffers.fill(kUnknown);
+    m_active_texture_unit = kUnknown;
+    for (auto &unit : m_textures) {
+        unit.fill(kUnknown);
+    }
+    m_blend_enabled = kUnknown;
+    m_blend_func.fill(kUnknown);
+    m_viewport_known = false;
+}
+
+int GLStateCache::bufferTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return ArrayBuffer;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return PixelUnpackBuffer;
+        case GL_PIXEL_PACK_BUFFER:
+            return PixelPackBuffer;
+        case GL_UNIFORM_BUFFER:
+            return UniformBuffer;
+        case GL_COPY_READ_BUFFER:
+            return CopyReadBuffer;
+        case GL_COPY_WRITE_BUFFER:
+            return CopyWriteBuffer;
+        default:
+            // GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, so it is never cached.
+            return -1;
+    }
+}
+
+int GLStateCache::textureTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D:
+            return Texture2D;
+        case GL_TEXTURE_2D_ARRAY:
+            return Texture2DArray;
+        default:
+            return -1;
+    }
+}
+
+void GLStateCache::activeTexture(GLuint unit) {
+    if (update(m_active_texture_unit, unit)) {
+        glCall(m_ctx, ActiveTexture, GL_TEXTURE0 + unit);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+class GLContext;
+
+/**
+ *  @class GLStateCache
+ *
+ *  @brief Shadows the binding and fixed-function state of one GL context and drops calls that change nothing.
+ *
+ *  Tracked state: current program, vertex array, framebuffers, buffers bound to the non-VAO targets, 2D and 2D
+ *  array textures for the first `kMaxTextureUnits` units, blending and the viewport. Anything else passes straight
+ *  through, so the cache is never wrong about state it does not know.
+ *
+ *  @note The cache is only correct if all of its state goes through it: code that binds through `glCall` directly
+ *        must call `invalidate()` afterwards. Objects must be deleted through the `delete*` functions, since GL
+ *        resets bindings of deleted objects and names are recycled.
+ *  @note Owned by GLContext; must only be used on the thread where that context is current.
+ */
+class GLStateCache {
+    friend GLContext;
+
+public:
+    NONCOPYABLE(GLStateCache)
+    NONMOVABLE(GLStateCache)
+
+    struct Stats {
+        uint64_t issued;   // calls forwarded to GL
+        uint64_t skipped;  // calls dropped because the state was already set
+    };
+
+    static constexpr int kMaxTextureUnits = 16;
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+    void bindBuffer(GLenum target, GLuint buffer);
+
+    /**
+     *  @brief Binds `texture` to `target` on texture unit `unit` (0-based), selecting the unit only if needed.
+     */
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void setBlend(bool enabled);
+    void blendFunc(GLenum src, GLenum dst) { blendFuncSeparate(src, dst, src, dst); }
+    void blendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    void deleteProgram(GLuint program);
+    void deleteVertexArrays(GLsizei count, const GLuint *vaos);
+    void deleteFramebuffers(GLsizei count, const GLuint *framebuffers);
+    void deleteBuffers(GLsizei count, const GLuint *buffers);
+    void deleteTextures(GLsizei count, const GLuint *textures);
+
+    /**
+     *  @brief Forgets all tracked state, so the next call of each kind is issued unconditionally.
+     */
+    void invalidate();
+
+    Stats getStats() const { return {m_issued, m_skipped}; }
+
+private:
+    // Sentinel for "not known", never a valid object name or enum.
+    static constexpr GLuint kUnknown = ~0u;
+
+    enum BufferTarget {
+        ArrayBuffer,
+        PixelUnpackBuffer,
+        PixelPackBuffer,
+        UniformBuffer,
+        CopyReadBuffer,
+        CopyWriteBuffer,
+        BufferTargetCount,
+    };
+
+    enum TextureTarget {
+        Texture2D,
+        Texture2DArray,
+        TextureTargetCount,
+    };
+
+    GLContext *m_ctx {};
+
+    GLuint m_program {};
+    GLuint m_vao {};
+    GLuint m_draw_framebuffer {};
+    GLuint m_read_framebuffer {};
+    std::array<GLuint, BufferTargetCount> m_buffers {};
+    GLuint m_active_texture_unit {};
+    std::array<std::array<GLuint, TextureTargetCount>, kMaxTextureUnits> m_textures {};
+
+    GLuint m_blend_enabled {};
+    std::array<GLenum, 4> m_blend_func {};
+    std::array<GLint, 4> m_viewport {};
+    bool m_viewport_known {};
+
+    uint64_t m_issued {};
+    uint64_t m_skipped {};
+
+    explicit GLStateCache(GLContext *ctx);
+
+    static int bufferTargetIndex(GLenum target);
+    static int textureTargetIndex(GLenum target);
+
+    void activeTexture(GLuint unit);
+
+    /**
+     *  @return true if `cached` differs from `value`, after storing `value` into it; counts the outcome.
+     */
+    template<typename T>
+    bool update(T &cached, const T &value) {
+        if (cached == value) {
+            ++m_skipped;
+            return false;
+        }
+        cached = value;
+        ++m_issued;
+        return true;
+    }
+};
\ No newline at end of file
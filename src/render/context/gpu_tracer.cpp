@@ -0,0 +1,81 @@
+#include "gpu_tracer.h"
+
+#include "gl_context.h"
+#include "log/log_system.h"
+
+GpuTracer::GpuTracer(const GladGLContext *gl)
+    : m_gl(gl), m_track(Tracer::get()->createTrack("GPU")), m_pending(kMaxPending) {}
+
+GpuTracer::~GpuTracer() {
+    DEBUG("GPU tracer: {} zones, {} nested skipped, {} overflowed", m_zones, m_nested_skipped, m_overflowed);
+    Tracer::get()->releaseTrack(m_track);
+    DEBUG("release GpuTracer: {}", (void *)this);
+}
+
+void GpuTracer::begin(const char *name) {
+    if (m_depth++ > 0) {
+        ++m_nested_skipped;
+        return;
+    }
+    if (m_pending_count == kMaxPending) {
+        ++m_overflowed;
+        return;
+    }
+
+    GLuint query;
+    if (m_free_queries.empty()) {
+        m_gl->GenQueries(1, &query);
+    } else {
+        query = m_free_queries.back();
+        m_free_queries.pop_back();
+    }
+    m_gl->BeginQuery(GL_TIME_ELAPSED, query);
+    m_current = {query, name, Tracer::now()};
+    m_timing = true;
+}
+
+void GpuTracer::end() {
+    if (m_depth == 0 || --m_depth > 0 || !m_timing) {
+        return;
+    }
+
+    m_gl->EndQuery(GL_TIME_ELAPSED);
+    m_pending[(m_pending_head + m_pending_count) % kMaxPending] = m_current;
+    ++m_pending_count;
+    m_timing = false;
+}
+
+void GpuTracer::collect() {
+    while (m_pending_count > 0) {
+        const auto &pending = m_pending[m_pending_head];
+        GLint available = GL_FALSE;
+        m_gl->GetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        // Queries finish in submission order, so the first unfinished one ends the harvest.
+        if (!available) {
+            break;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        m_gl->GetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed_ns);
+        m_track->record(pending.name, pending.submit_ns, pending.submit_ns + elapsed_ns);
+        ++m_zones;
+
+        m_free_queries.push_back(pending.query);
+        m_pending_head = (m_pending_head + 1) % kMaxPending;
+        --m_pending_count;
+    }
+}
+
+GpuTraceZone::~GpuTraceZone() {
+    if (m_active) {
+        m_ctx->getGpuTracer()->end();
+    }
+}
+
+void GpuTraceZone::begin(const char *name) {
+    if (!Tracer::get()->isEnabled()) {
+        return;
+    }
+    m_ctx->getGpuTracer()->begin(name);
+    m_active = true;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "trace/tracer.h"
+
+class GLContext;
+
+/**
+ *  @class GpuTracer
+ *
+ *  @brief Times GPU work with `GL_TIME_ELAPSED` queries and records it on a "GPU" track of the Tracer.
+ *
+ *  Queries are read back asynchronously: `collect` only harvests results that are already available, so the CPU
+ *  never waits for the GPU. Elapsed-time queries cannot nest, so only outermost zones are timed; inner ones still
+ *  show up as CPU zones. Each GPU zone starts at the CPU time it was submitted, which is earlier than when the GPU
+ *  actually ran it; its duration is exact.
+ *
+ *  @note Owned by a GLContext; all calls must happen on the thread where that context is current. GL functions are
+ *        called directly rather than through `glCall`, so the tracer never times itself.
+ */
+class GpuTracer {
+    friend GLContext;
+
+public:
+    NONCOPYABLE(GpuTracer)
+    NONMOVABLE(GpuTracer)
+
+    struct Stats {
+        uint64_t zones;           // zones timed and recorded
+        uint64_t nested_skipped;  // inner zones not timed because a query was already running
+        uint64_t overflowed;      // zones dropped because too many queries were still pending
+    };
+
+    /**
+     *  @note Query objects are not deleted here; they are destroyed together with the context.
+     */
+    ~GpuTracer();
+
+    void begin(const char *name);
+    void end();
+
+    /**
+     *  @brief Records every finished query, oldest first, and recycles it.
+     */
+    void collect();
+
+    Stats getStats() const { return {m_zones, m_nested_skipped, m_overflowed}; }
+
+private:
+    struct Pending {
+        GLuint query;
+        const char *name;
+        uint64_t submit_ns;
+    };
+
+    static constexpr size_t kMaxPending = 256;
+
+    const GladGLContext *m_gl {};
+    Tracer::Track *m_track {};
+
+    std::vector<GLuint> m_free_queries {};
+    std::vector<Pending> m_pending {};  // ring, oldest at m_pending_head
+    size_t m_pending_head {};
+    size_t m_pending_count {};
+
+    int m_depth {};
+    bool m_timing {false};  // whether the outermost open zone owns a running query
+    Pending m_current {};
+
+    uint64_t m_zones {};
+    uint64_t m_nested_skipped {};
+    uint64_t m_overflowed {};
+
+    explicit GpuTracer(const GladGLContext *gl);
+};
+
+/**
+ *  @class GpuTraceZone
+ *
+ *  @brief Times the GPU work submitted in a scope, and the scope itself as a CPU zone.
+ */
+class GpuTraceZone {
+public:
+    NONCOPYABLE(GpuTraceZone)
+    NONMOVABLE(GpuTraceZone)
+
+    template<typename Context>
+    GpuTraceZone(const Context &ctx, const char *name) : m_cpu_zone(name), m_ctx(ctx.get()) {
+        begin(name);
+    }
+
+    ~GpuTraceZone();
+
+private:
+    TraceZone m_cpu_zone;
+    GLContext *m_ctx;
+    bool m_active {false};
+
+    void begin(const char *name);
+};
+
+/**
+ *  @brief Traces the GPU and CPU time of the enclosing scope under `name`, which must be a string literal.
+ */
+#define TRACE_GPU_ZONE(ctx, name) GpuTraceZone TRACE_CONCAT(gpu_trace_zone_, __LINE__) {ctx, name}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "pixel_readback_ring.h"
+
+#include <chrono>
+#include <thread>
+
+#include "gl_context.h"
+#include "gl_state_cache.h"
+#include "log/log_system.h"
+
+namespace {
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+PixelReadbackRing::PixelReadbackRing(std::shared_ptr<GLContext> ctx, size_t slot_count, int width, int height)
+    : m_ctx(ctx), m_width(width), m_height(height), m_slot_size(size_t(width) * height * 4), m_slots(slot_count),
+      m_in_flight(slot_count), m_readable(slot_count + 1), m_released(slot_count) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+    if (slot_count == 0 || width <= 0 || height <= 0) {
+        FATAL("invalid readback ring size: {} x {}x{}", slot_count, width, height);
+    }
+
+    for (auto &slot : m_slots) {
+        glCall(m_ctx, GenBuffers, 1, &slot.pbo);
+        m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glCall(m_ctx, BufferData, GL_PIXEL_PACK_BUFFER, m_slot_size, nullptr, GL_STREAM_READ);
+        slot.width = width;
+        slot.height = height;
+        slot.stride = size_t(width) * 4;
+        m_free.push_back(&slot);
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    DEBUG("created PixelReadbackRing: {} slots x {}x{}", slot_count, width, height);
+}
+
+PixelReadbackRing::~PixelReadbackRing() {
+    for (auto &slot : m_slots) {
+        if (slot.fence) {
+            glCall(m_ctx, DeleteSync, slot.fence);
+        }
+        if (slot.data) {
+            m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            glCall(m_ctx, UnmapBuffer, GL_PIXEL_PACK_BUFFER);
+        }
+        m_ctx->getStateCache().deleteBuffers(1, &slot.pbo);
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    DEBUG("release PixelReadbackRing: {}", (void *)this);
+}
+
+void PixelReadbackRing::pump(bool wait) {
+    TRACE_ZONE("pump readback ring");
+    unmapReleased();
+
+    bool mapped_any = false;
+    while (m_in_flight_count > 0) {
+        Slot *slot = m_in_flight[m_in_flight_head];
+        GLenum status = glCall(m_ctx, ClientWaitSync, slot->fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (!wait || mapped_any) {
+                break;
+            }
+
+            ++m_fence_waits;
+            auto start = std::chrono::steady_clock::now();
+            status = glCall(m_ctx, ClientWaitSync, slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            m_fence_wait_ns += nanosecondsSince(start);
+        }
+        if (status == GL_WAIT_FAILED) {
+            ERROR("glClientWaitSync failed on readback slot {}", (void *)slot);
+            break;
+        }
+        glCall(m_ctx, DeleteSync, slot->fence);
+        slot->fence = nullptr;
+
+        m_in_flight_head = (m_in_flight_head + 1) % m_in_flight.size();
+        --m_in_flight_count;
+        if (!map(slot)) {
+            // The frame is lost, but the slot stays usable.
+            m_free.push_back(slot);
+            continue;
+        }
+        m_readable.tryPush(slot);
+        mapped_any = true;
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+PixelReadbackRing::Slot *PixelReadbackRing::acquireFree(const std::stop_token &stop) {
+    pump();
+    while (m_free.empty()) {
+        if (stop.stop_requested()) {
+            return nullptr;
+        }
+        if (m_in_flight_count > 0) {
+            pump(true);
+            continue;
+        }
+
+        // Every slot is mapped or being read: the reader is behind.
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        unmapReleased();
+        m_reader_wait_ns += nanosecondsSince(start);
+    }
+    Slot *slot = m_free.back();
+    m_free.pop_back();
+    return slot;
+}
+
+void PixelReadbackRing::readback(Slot *slot, int64_t pts) {
+    TRACE_ZONE("readback slot");
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    // Into the bound buffer, so this only queues the copy.
+    glCall(m_ctx, ReadPixels, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence = glCall(m_ctx, FenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Polled without the flush bit by `pump`, so the fence has to reach the GPU now.
+    glCall(m_ctx, Flush);
+    slot->pts = pts;
+
+    m_in_flight[(m_in_flight_head + m_in_flight_count) % m_in_flight.size()] = slot;
+    ++m_in_flight_count;
+    ++m_readbacks;
+    m_bytes_read += m_slot_size;
+}
+
+void PixelReadbackRing::close() {
+    while (m_in_flight_count > 0) {
+        const size_t in_flight = m_in_flight_count;
+        pump(true);
+        if (m_in_flight_count == in_flight) {
+            // Only a failed fence wait makes no progress; its frames are given up.
+            break;
+        }
+    }
+    m_readable.tryPush(nullptr);
+}
+
+PixelReadbackRing::Slot *PixelReadbackRing::acquireReadable(const std::stop_token &stop) {
+    if (auto slot = m_readable.tryPop()) {
+        m_drained = !*slot;
+        return *slot;
+    }
+
+    m_reader_stalls.fetch_add(1, std::memory_order_relaxed);
+    while (!stop.stop_requested()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        if (auto slot = m_readable.tryPop()) {
+            m_drained = !*slot;
+            return *slot;
+        }
+    }
+    return nullptr;
+}
+
+void PixelReadbackRing::release(Slot *slot) { m_released.tryPush(slot); }
+
+PixelReadbackRing::Stats PixelReadbackRing::getStats() const {
+    return {
+        m_readbacks,
+        m_bytes_read,
+        m_fence_waits,
+        m_fence_wait_ns,
+        m_reader_wait_ns,
+        m_reader_stalls.load(std::memory_order_relaxed),
+    };
+}
+
+void PixelReadbackRing::unmapReleased() {
+    while (auto slot = m_released.tryPop()) {
+        m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, (*slot)->pbo);
+        glCall(m_ctx, UnmapBuffer, GL_PIXEL_PACK_BUFFER);
+        (*slot)->data = nullptr;
+        m_free.push_back(*slot);
+    }
+}
+
+bool PixelReadbackRing::map(Slot *slot) {
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    void *data = glCall(m_ctx, MapBufferRange, GL_PIXEL_PACK_BUFFER, 0, m_slot_size, GL_MAP_READ_BIT);
+    if (!data) {
+        ERROR("failed to map readback slot {}", (void *)slot);
+        return false;
+    }
+    slot->data = static_cast<const uint8_t *>(data);
+    return true;
+}
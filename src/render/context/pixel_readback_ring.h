@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/spsc_queue.h"
+
+class GLContext;
+
+/**
+ *  @class PixelReadbackRing
+ *
+ *  @brief Ring of pixel-pack buffers for streaming the rendered picture back to the CPU without stalling on it.
+ *
+ *  Every slot owns one PBO. The GL thread reads the bound read framebuffer into a free slot with `glReadPixels`,
+ *  which only queues the copy, and fences it. Once the fence has signaled, `pump` maps the slot with
+ *  `GL_MAP_READ_BIT` and hands it to a reader thread, which consumes the pixels from mapped memory and releases
+ *  the slot; the GL thread unmaps it again on its next `pump`. With a few slots in flight, the GPU renders the
+ *  next frames while earlier ones are still being copied and read.
+ *
+ *  Slot lifecycle: free -> read back and fenced (`readback`) -> mapped (`pump`) -> reading (`acquireReadable`)
+ *  -> released (`release`) -> unmapped (`pump`) -> free.
+ *
+ *  @note `acquireFree`, `readback`, `pump` and `close` must only be called from the thread owning the GL context.
+ *        `acquireReadable` and `release` must only be called from a single reader thread.
+ */
+class PixelReadbackRing {
+    friend GLContext;
+
+public:
+    NONCOPYABLE(PixelReadbackRing)
+    NONMOVABLE(PixelReadbackRing)
+
+    struct Slot {
+        // Reader-visible part, valid between `acquireReadable` and `release`.
+        const uint8_t *data {};  // RGBA rows, bottom row first as GL reads them
+        int width {};
+        int height {};
+        size_t stride {};
+        int64_t pts {};
+
+        // Owned by the GL thread.
+        GLuint pbo {};
+        GLsync fence {};
+    };
+
+    struct Stats {
+        uint64_t readbacks;
+        uint64_t bytes_read;
+        uint64_t fence_waits;     // times the oldest readback was not done when the GL thread needed its slot
+        uint64_t fence_wait_ns;   // time the GL thread spent blocked on readback fences
+        uint64_t reader_wait_ns;  // time the GL thread waited for the reader to release a slot
+        uint64_t reader_stalls;   // times the reader found no mapped slot
+    };
+
+    /**
+     *  @brief Deletes all fences and buffers.
+     *
+     *  @note The GL context must be current on the calling thread.
+     */
+    ~PixelReadbackRing();
+
+    /**
+     *  @brief Maps every read back slot whose fence has signaled and offers it to the reader, and unmaps every
+     *         slot the reader released.
+     *
+     *  @param wait If true and nothing could be mapped, blocks on the oldest fence instead of returning.
+     */
+    void pump(bool wait = false);
+
+    /**
+     *  @brief Returns a free slot, pumping and waiting for the GPU or the reader as needed.
+     *
+     *  @return The slot, or nullptr if `stop` was requested first.
+     */
+    Slot *acquireFree(const std::stop_token &stop);
+
+    /**
+     *  @brief Copies the bound read framebuffer into `slot` and fences the copy. Returns immediately.
+     */
+    void readback(Slot *slot, int64_t pts);
+
+    /**
+     *  @brief Waits for every slot still in flight, offers it to the reader, then signals the end of the stream.
+     */
+    void close();
+
+    /**
+     *  @brief Waits for the next mapped slot, in readback order.
+     *
+     *  @return The slot, or nullptr once the ring was closed and drained, or if `stop` was requested first.
+     */
+    Slot *acquireReadable(const std::stop_token &stop);
+
+    /**
+     *  @return true once `acquireReadable` returned the end of the stream, as opposed to giving up on `stop`.
+     *
+     *  @note This function must only be called from the reader thread.
+     */
+    bool isDrained() const { return m_drained; }
+
+    /**
+     *  @brief Hands a consumed slot back to the GL thread.
+     */
+    void release(Slot *slot);
+
+    size_t getSlotCount() const { return m_slots.size(); }
+
+    /**
+     *  @note This function must only be called from the GL thread.
+     */
+    Stats getStats() const;
+
+private:
+    std::shared_ptr<GLContext> m_ctx {};
+
+    int m_width {};
+    int m_height {};
+    size_t m_slot_size {};
+    std::vector<Slot> m_slots {};
+
+    // GL thread only: free slots, and read back slots in readback order.
+    std::vector<Slot *> m_free {};
+    std::vector<Slot *> m_in_flight {};
+    size_t m_in_flight_head {};
+    size_t m_in_flight_count {};
+
+    // nullptr marks the end of the stream.
+    SpscQueue<Slot *> m_readable;
+    SpscQueue<Slot *> m_released;
+    bool m_drained {false};  // reader thread only
+
+    uint64_t m_readbacks {};
+    uint64_t m_bytes_read {};
+    uint64_t m_fence_waits {};
+    uint64_t m_fence_wait_ns {};
+    uint64_t m_reader_wait_ns {};
+    std::atomic<uint64_t> m_reader_stalls {};
+
+    PixelReadbackRing(std::shared_ptr<GLContext> ctx, size_t slot_count, int width, int height);
+
+    void unmapReleased();
+    bool map(Slot *slot);
+};
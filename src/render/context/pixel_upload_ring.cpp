@@ -0,0 +1,209 @@
+#include "pixel_upload_ring.h"
+
+#include <chrono>
+#include <thread>
+
+#include "gl_context.h"
+#include "gl_state_cache.h"
+#include "log/log_system.h"
+
+PixelUploadRing::PixelUploadRing(std::shared_ptr<GLContext> ctx, size_t slot_count, size_t slot_size)
+    : m_ctx(ctx), m_slot_size(slot_size), m_slots(slot_count), m_idle(slot_count), m_writable(slot_count),
+      m_filled(slot_count) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+    if (slot_count == 0 || slot_size == 0) {
+        FATAL("invalid upload ring size: {} x {} bytes", slot_count, slot_size);
+    }
+
+    for (auto &slot : m_slots) {
+        glCall(m_ctx, GenBuffers, 1, &slot.pbo);
+        m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glCall(m_ctx, BufferData, GL_PIXEL_UNPACK_BUFFER, slot_size, nullptr, GL_STREAM_DRAW);
+        slot.capacity = slot_size;
+        pushIdle(&slot);
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    DEBUG("created PixelUploadRing: {} slots x {} bytes", slot_count, slot_size);
+}
+
+PixelUploadRing::~PixelUploadRing() {
+    for (auto &slot : m_slots) {
+        if (slot.fence) {
+            glCall(m_ctx, DeleteSync, slot.fence);
+        }
+        if (slot.data) {
+            m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glCall(m_ctx, UnmapBuffer, GL_PIXEL_UNPACK_BUFFER);
+        }
+        m_ctx->getStateCache().deleteBuffers(1, &slot.pbo);
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    DEBUG("release PixelUploadRing: {}", (void *)this);
+}
+
+void PixelUploadRing::pump(bool wait) {
+    TRACE_ZONE("pump upload ring");
+    bool mapped_any = false;
+    while (m_idle_count > 0) {
+        Slot *slot = m_idle[m_idle_head];
+        if (slot->fence) {
+            GLenum status = glCall(m_ctx, ClientWaitSync, slot->fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                ++m_fence_waits;
+                if (!wait || mapped_any) {
+                    break;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                status = glCall(m_ctx, ClientWaitSync, slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                m_fence_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - start)
+                                       .count();
+            }
+            if (status == GL_WAIT_FAILED) {
+                ERROR("glClientWaitSync failed on upload slot {}", (void *)slot);
+                break;
+            }
+            glCall(m_ctx, DeleteSync, slot->fence);
+            slot->fence = nullptr;
+        }
+
+        if (!map(slot)) {
+            break;
+        }
+        m_idle_head = (m_idle_head + 1) % m_idle.size();
+        --m_idle_count;
+        m_writable.tryPush(slot);
+        mapped_any = true;
+    }
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PixelUploadRing::Slot *PixelUploadRing::tryAcquireWritable() {
+    if (auto slot = m_writable.tryPop()) {
+        (*slot)->size = 0;
+        (*slot)->region_count = 0;
+        return *slot;
+    }
+    m_writer_stalls.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+PixelUploadRing::Slot *PixelUploadRing::acquireWritable(const std::stop_token &stop) {
+    if (auto slot = tryAcquireWritable()) {
+        return slot;
+    }
+
+    while (!stop.stop_requested()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        if (auto slot = m_writable.tryPop()) {
+            (*slot)->size = 0;
+            (*slot)->region_count = 0;
+            return *slot;
+        }
+    }
+    return nullptr;
+}
+
+void PixelUploadRing::publish(Slot *slot) { m_filled.tryPush(slot); }
+
+PixelUploadRing::Slot *PixelUploadRing::tryPopFilled() {
+    auto slot = m_filled.tryPop();
+    return slot ? *slot : nullptr;
+}
+
+PixelUploadRing::Slot *PixelUploadRing::peekFilled() {
+    auto slot = m_filled.front();
+    return slot ? *slot : nullptr;
+}
+
+void PixelUploadRing::upload(Slot *slot) {
+    TRACE_ZONE("upload slot");
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+    glCall(m_ctx, UnmapBuffer, GL_PIXEL_UNPACK_BUFFER);
+    slot->data = nullptr;
+
+    glCall(m_ctx, PixelStorei, GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < slot->region_count; ++i) {
+        const auto &region = slot->regions[i];
+        glCall(m_ctx, PixelStorei, GL_UNPACK_ROW_LENGTH, region.row_length);
+        if (region.layer >= 0) {
+            m_ctx->getStateCache().bindTexture(0, GL_TEXTURE_2D_ARRAY, region.texture);
+            glCall(m_ctx,
+                   TexSubImage3D,
+                   GL_TEXTURE_2D_ARRAY,
+                   0,
+                   region.x,
+                   region.y,
+                   region.layer,
+                   region.width,
+                   region.height,
+                   1,
+                   region.format,
+                   region.type,
+                   reinterpret_cast<const void *>(region.offset));
+            continue;
+        }
+        m_ctx->getStateCache().bindTexture(0, GL_TEXTURE_2D, region.texture);
+        glCall(m_ctx,
+               TexSubImage2D,
+               GL_TEXTURE_2D,
+               0,
+               region.x,
+               region.y,
+               region.width,
+               region.height,
+               region.format,
+               region.type,
+               reinterpret_cast<const void *>(region.offset));
+    }
+    glCall(m_ctx, PixelStorei, GL_UNPACK_ROW_LENGTH, 0);
+    glCall(m_ctx, PixelStorei, GL_UNPACK_ALIGNMENT, 4);
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    slot->fence = glCall(m_ctx, FenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    ++m_uploads;
+    m_bytes_uploaded += slot->size;
+    pushIdle(slot);
+}
+
+void PixelUploadRing::discard(Slot *slot) {
+    // Still mapped, so it can go straight back to the writer.
+    m_writable.tryPush(slot);
+}
+
+PixelUploadRing::Stats PixelUploadRing::getStats() const {
+    return {
+        m_uploads,
+        m_bytes_uploaded,
+        m_fence_waits,
+        m_fence_wait_ns,
+        m_writer_stalls.load(std::memory_order_relaxed),
+    };
+}
+
+void PixelUploadRing::pushIdle(Slot *slot) {
+    m_idle[(m_idle_head + m_idle_count) % m_idle.size()] = slot;
+    ++m_idle_count;
+}
+
+bool PixelUploadRing::map(Slot *slot) {
+    m_ctx->getStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+    // The fence already guarantees the GPU is done with this buffer, so skip the driver's implicit sync.
+    void *data = glCall(m_ctx,
+                        MapBufferRange,
+                        GL_PIXEL_UNPACK_BUFFER,
+                        0,
+                        m_slot_size,
+                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data) {
+        ERROR("failed to map upload slot {}", (void *)slot);
+        return false;
+    }
+    slot->data = static_cast<uint8_t *>(data);
+    return true;
+}
\ No newline at end of file
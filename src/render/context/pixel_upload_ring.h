@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/spsc_queue.h"
+
+class GLContext;
+
+/**
+ *  @class PixelUploadRing
+ *
+ *  @brief Ring of pixel-unpack buffers for streaming texture uploads.
+ *
+ *  Every slot owns one PBO. The GL thread maps idle slots with `GL_MAP_UNSYNCHRONIZED_BIT` and hands them to a
+ *  writer thread, which fills the mapped memory directly and describes the texture regions to update. The GL
+ *  thread then unmaps the slot, issues `glTexSubImage2D` (`glTexSubImage3D` for array layers) sourcing from the
+ *  PBO and fences it; the slot is only mapped again once its fence has signaled, so the GPU never reads memory
+ *  that is being rewritten.
+ *
+ *  Slot lifecycle: idle -> mapped (`pump`) -> writing (`tryAcquireWritable`) -> filled (`publish`)
+ *  -> uploaded and fenced (`upload`) -> idle.
+ *
+ *  @note `pump`, `tryPopFilled`, `peekFilled` and `upload` must only be called from the thread owning the GL context.
+ *        `tryAcquireWritable` and `publish` must only be called from a single writer thread, which may be the
+ *        GL thread itself.
+ */
+class PixelUploadRing {
+    friend GLContext;
+
+public:
+    NONCOPYABLE(PixelUploadRing)
+    NONMOVABLE(PixelUploadRing)
+
+    struct Region {
+        GLuint texture;
+        GLint x;
+        GLint y;
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLenum type;
+        size_t offset;     // byte offset of the first row inside the slot
+        GLint row_length;  // pixels per row in the slot, 0 means tightly packed
+        GLint layer {-1};  // layer of a GL_TEXTURE_2D_ARRAY, -1 for a GL_TEXTURE_2D
+    };
+
+    struct Slot {
+        // Writer-visible part, valid between `tryAcquireWritable` and `publish`.
+        uint8_t *data {};
+        size_t capacity {};
+        size_t size {};  // bytes actually written, for accounting
+        std::array<Region, 4> regions {};
+        size_t region_count {};
+        int64_t pts {};
+
+        // Owned by the GL thread.
+        GLuint pbo {};
+        GLsync fence {};
+    };
+
+    struct Stats {
+        uint64_t uploads;
+        uint64_t bytes_uploaded;
+        uint64_t fence_waits;      // times a slot could not be recycled because the GPU still read from it
+        uint64_t fence_wait_ns;    // time spent blocked in `pump(true)`
+        uint64_t writer_stalls;    // times the writer found no mapped slot
+    };
+
+    /**
+     *  @brief Deletes all fences and buffers.
+     *
+     *  @note The GL context must be current on the calling thread.
+     */
+    ~PixelUploadRing();
+
+    /**
+     *  @brief Maps every idle slot whose fence has signaled and offers it to the writer.
+     *
+     *  @param wait If true and no slot can be recycled, blocks on the oldest fence instead of returning.
+     */
+    void pump(bool wait = false);
+
+    /**
+     *  @return A mapped slot to write into, or nullptr if none is available.
+     */
+    Slot *tryAcquireWritable();
+
+    /**
+     *  @brief Waits for a mapped slot to write into.
+     *
+     *  @return The slot, or nullptr if `stop` was requested first.
+     */
+    Slot *acquireWritable(const std::stop_token &stop);
+
+    /**
+     *  @brief Hands a filled slot back to the GL thread.
+     */
+    void publish(Slot *slot);
+
+    /**
+     *  @return The oldest published slot, or nullptr if none is pending.
+     */
+    Slot *tryPopFilled();
+
+    /**
+     *  @return The oldest published slot without popping it, or nullptr if none is pending.
+     */
+    Slot *peekFilled();
+
+    /**
+     *  @brief Unmaps `slot`, updates every region it describes and fences the upload.
+     */
+    void upload(Slot *slot);
+
+    /**
+     *  @brief Returns a written but unwanted slot (e.g. a dropped frame) to the writer without uploading it.
+     */
+    void discard(Slot *slot);
+
+    size_t getSlotCount() const { return m_slots.size(); }
+
+    /**
+     *  @return Slots waiting to be mapped again, usually for their fence; `pump` has to run again for them.
+     *
+     *  @note This function must only be called from the GL thread.
+     */
+    size_t getIdleCount() const { return m_idle_count; }
+    size_t getSlotSize() const { return m_slot_size; }
+
+    /**
+     *  @note This function must only be called from the GL thread.
+     */
+    Stats getStats() const;
+
+private:
+    std::shared_ptr<GLContext> m_ctx {};
+
+    size_t m_slot_size {};
+    std::vector<Slot> m_slots {};
+
+    // Slots waiting to be mapped, in upload order (GL thread only).
+    std::vector<Slot *> m_idle {};
+    size_t m_idle_head {};
+    size_t m_idle_count {};
+
+    SpscQueue<Slot *> m_writable;
+    SpscQueue<Slot *> m_filled;
+
+    uint64_t m_uploads {};
+    uint64_t m_bytes_uploaded {};
+    uint64_t m_fence_waits {};
+    uint64_t m_fence_wait_ns {};
+    std::atomic<uint64_t> m_writer_stalls {};
+
+    PixelUploadRing(std::shared_ptr<GLContext> ctx, size_t slot_count, size_t slot_size);
+
+    void pushIdle(Slot *slot);
+    bool map(Slot *slot);
+};
\ No newline at end of file
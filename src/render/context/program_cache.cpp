@@ -0,0 +1,194 @@
+#include "program_cache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "base/atomic_file.h"
+#include "base/hash.h"
+#include "config/config_manager.h"
+#include "gl_context.h"
+#include "log/log_system.h"
+
+namespace {
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string getString(GLContext *ctx, GLenum name) {
+    auto value = reinterpret_cast<const char *>(glCall(ctx, GetString, name));
+    return value ? value : "";
+}
+
+}  // namespace
+
+ProgramCache::Config ProgramCache::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.directory = config_manager->getValue("shader_cache", "directory");
+    config.enabled = config_manager->getIntValue("shader_cache", "enabled", config.enabled) != 0;
+    return config;
+}
+
+ProgramCache::ProgramCache(GLContext *ctx, const Config &config) : m_ctx(ctx) {
+    GLint format_count = 0;
+    glCall(m_ctx, GetIntegerv, GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    m_supported = format_count > 0;
+    m_driver = getString(m_ctx, GL_VENDOR) + '\n' + getString(m_ctx, GL_RENDERER) + '\n' +
+               getString(m_ctx, GL_VERSION);
+    if (!m_supported) {
+        INFO("GL driver has no program binary format, shader cache disabled");
+    }
+    setConfig(config);
+}
+
+ProgramCache::~ProgramCache() {
+    DEBUG("GL program cache: {} hits, {} misses, {} rejected, {} stored; {:.1f} ms loading, {:.1f} ms building",
+          m_hits,
+          m_misses,
+          m_rejected,
+          m_stores,
+          m_load_ns / 1e6,
+          m_build_ns / 1e6);
+    DEBUG("release ProgramCache: {}", (void *)this);
+}
+
+void ProgramCache::setConfig(const Config &config) {
+    m_directory = config.directory.empty() ? std::filesystem::temp_directory_path() / "video-app-shaders"
+                                           : config.directory;
+    m_enabled = config.enabled && m_supported;
+    DEBUG("shader cache: {}, in {}", m_enabled ? "enabled" : "disabled", m_directory.string());
+}
+
+GLuint ProgramCache::load(const std::string &vertex_source, const std::string &fragment_source) {
+    if (!m_enabled) {
+        return 0;
+    }
+    TRACE_ZONE("load program binary");
+    auto start = std::chrono::steady_clock::now();
+
+    const uint64_t key = getKey(vertex_source, fragment_source);
+    auto path = getEntryPath(vertex_source, fragment_source);
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(path, ec);
+    std::ifstream in {path, std::ios::binary};
+    if (ec || !in) {
+        ++m_misses;
+        return 0;
+    }
+
+    FileHeader header {};
+    std::vector<char> binary;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (in && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+        (header.version != kVersion || header.key != key || header.driver_size != m_driver.size() ||
+         header.vertex_size != vertex_source.size() || header.fragment_size != fragment_source.size())) {
+        // Written by another version of the cache or for other sources hashing alike; store() replaces it.
+        DEBUG("program binary {} is stale, rebuilding", path.string());
+        m_load_ns += nanosecondsSince(start);
+        ++m_misses;
+        return 0;
+    }
+    // The size comes from the file, so it is bounded by the file before anything is allocated.
+    if (in && file_size >= sizeof(header) && header.binary_size <= file_size - sizeof(header)) {
+        binary.resize(header.binary_size);
+        in.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    }
+
+    GLuint program = 0;
+    if (in && !binary.empty()) {
+        program = glCall(m_ctx, CreateProgram);
+        glCall(m_ctx,
+               ProgramBinary,
+               program,
+               header.binary_format,
+               binary.data(),
+               static_cast<GLsizei>(binary.size()));
+        GLint status = GL_FALSE;
+        glCall(m_ctx, GetProgramiv, program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE) {
+            // Never bound, so the state cache has nothing to forget.
+            glCall(m_ctx, DeleteProgram, program);
+            program = 0;
+        }
+    }
+    m_load_ns += nanosecondsSince(start);
+
+    if (!program) {
+        WARN("program binary {} is invalid or was rejected by the driver, rebuilding", path.string());
+        in.close();
+        std::filesystem::remove(path, ec);
+        ++m_rejected;
+        return 0;
+    }
+    ++m_hits;
+    return program;
+}
+
+void ProgramCache::store(const std::string &vertex_source, const std::string &fragment_source, GLuint program) {
+    if (!m_enabled) {
+        return;
+    }
+    TRACE_ZONE("store program binary");
+
+    GLint length = 0;
+    glCall(m_ctx, GetProgramiv, program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> bytes(sizeof(FileHeader) + length);
+    GLenum format = 0;
+    glCall(m_ctx, GetProgramBinary, program, length, &length, &format, bytes.data() + sizeof(FileHeader));
+    bytes.resize(sizeof(FileHeader) + length);
+
+    FileHeader header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.binary_format = format;
+    header.key = getKey(vertex_source, fragment_source);
+    header.driver_size = m_driver.size();
+    header.vertex_size = vertex_source.size();
+    header.fragment_size = fragment_source.size();
+    header.binary_size = static_cast<uint64_t>(length);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    // Written under a name of its own and renamed, so another instance never loads a half-written binary, and two
+    // instances storing the same program at once do not write into the same file.
+    auto path = getEntryPath(vertex_source, fragment_source);
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (!writeFileAtomically(path, bytes.data(), bytes.size(), ec)) {
+        WARN("failed to write program binary {}: {}", path.string(), ec.message());
+        return;
+    }
+    ++m_stores;
+}
+
+ProgramCache::Stats ProgramCache::getStats() const {
+    return {
+        m_hits,
+        m_misses,
+        m_rejected,
+        m_stores,
+        m_load_ns,
+        m_build_ns,
+    };
+}
+
+std::filesystem::path ProgramCache::getEntryPath(const std::string &vertex_source,
+                                                 const std::string &fragment_source) const {
+    return m_directory / fmt::format("{:016x}.glprog", getKey(vertex_source, fragment_source));
+}
+
+uint64_t ProgramCache::getKey(const std::string &vertex_source, const std::string &fragment_source) const {
+    // The separators keep moving text from one source to the other from giving the same key.
+    uint64_t hash = fnv1a64(m_driver);
+    hash = fnv1a64({"\0", 1}, hash);
+    hash = fnv1a64(vertex_source, hash);
+    hash = fnv1a64({"\0", 1}, hash);
+    return fnv1a64(fragment_source, hash);
+}
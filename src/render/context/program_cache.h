@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+class GLContext;
+
+/**
+ *  @class ProgramCache
+ *
+ *  @brief Persists linked GL program binaries on disk, so programs seen before skip compiling and linking.
+ *
+ *  Binaries are keyed by a hash of the shader sources and of the driver's vendor, renderer and version strings: a
+ *  driver update or another GPU misses instead of feeding the driver a binary it did not produce. The key is 64-bit
+ *  FNV-1a, stable across builds; the header also records the length of every hashed string, so a key collision
+ *  between different sources is still treated as a miss. A driver may still reject a binary it produced (e.g. after a
+ *  build with the same version string); the entry is then deleted and the caller compiles from source.
+ *
+ *  @note Must only be used on the thread owning the GL context.
+ */
+class ProgramCache {
+    friend GLContext;
+
+public:
+    NONCOPYABLE(ProgramCache)
+    NONMOVABLE(ProgramCache)
+
+    struct Config {
+        std::filesystem::path directory {};  // empty means a directory under the temp dir
+        bool enabled {true};
+
+        /**
+         *  @brief Reads the `[shader_cache]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;     // no entry, or a stale one left by another cache version or other sources
+        uint64_t rejected;   // binaries found but refused by the driver
+        uint64_t stores;
+        uint64_t load_ns;    // reading and handing binaries to the driver, hits and rejections
+        uint64_t build_ns;   // compiling and linking on misses, reported by the caller
+    };
+
+    ~ProgramCache();
+
+    /**
+     *  @return A linked program built from the cached binary of these sources, or 0 on a miss.
+     */
+    GLuint load(const std::string &vertex_source, const std::string &fragment_source);
+
+    /**
+     *  @brief Writes the binary of `program`, linked from these sources, to the cache.
+     *
+     *  @note `program` must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     */
+    void store(const std::string &vertex_source, const std::string &fragment_source, GLuint program);
+
+    /**
+     *  @brief Adds the time spent compiling and linking a program that missed, for the stats.
+     */
+    void addBuildTime(uint64_t ns) { m_build_ns += ns; }
+
+    /**
+     *  @return true if programs are looked up and stored; false if disabled or the driver has no binary format.
+     */
+    bool isEnabled() const { return m_enabled; }
+
+    /**
+     *  @brief Replaces the configuration, e.g. to point at another directory. Resets nothing else.
+     */
+    void setConfig(const Config &config);
+
+    Stats getStats() const;
+
+    std::filesystem::path getEntryPath(const std::string &vertex_source, const std::string &fragment_source) const;
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t binary_format;
+        uint64_t key;
+        uint64_t driver_size;  // lengths of the hashed strings, checked along with the key
+        uint64_t vertex_size;
+        uint64_t fragment_size;
+        uint64_t binary_size;
+    };
+
+    static constexpr char kMagic[8] {'V', 'A', 'G', 'L', 'P', 'R', 'G', '\0'};
+    static constexpr uint32_t kVersion = 2;
+
+    GLContext *m_ctx;
+    std::filesystem::path m_directory {};
+    bool m_enabled {};
+    bool m_supported {};
+    std::string m_driver {};  // vendor, renderer and version, part of every key
+
+    uint64_t m_hits {};
+    uint64_t m_misses {};
+    uint64_t m_rejected {};
+    uint64_t m_stores {};
+    uint64_t m_load_ns {};
+    uint64_t m_build_ns {};
+
+    ProgramCache(GLContext *ctx, const Config &config);
+
+    uint64_t getKey(const std::string &vertex_source, const std::string &fragment_source) const;
+};
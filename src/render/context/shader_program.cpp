@@ -0,0 +1,84 @@
+#include "shader_program.h"
+
+#include <chrono>
+
+#include "gl_context.h"
+#include "gl_state_cache.h"
+#include "log/log_system.h"
+#include "program_cache.h"
+
+ShaderProgram::ShaderProgram(std::shared_ptr<GLContext> ctx,
+                             const std::string &vertex_source,
+                             const std::string &fragment_source)
+    : m_ctx(ctx) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+
+    auto cache = m_ctx->getProgramCache();
+    m_program = cache->load(vertex_source, fragment_source);
+    if (m_program) {
+        return;
+    }
+
+    TRACE_ZONE("build program");
+    auto start = std::chrono::steady_clock::now();
+    GLuint vertex_shader = compile(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, fragment_source);
+
+    m_program = glCall(m_ctx, CreateProgram);
+    glCall(m_ctx, AttachShader, m_program, vertex_shader);
+    glCall(m_ctx, AttachShader, m_program, fragment_shader);
+    if (cache->isEnabled()) {
+        glCall(m_ctx, ProgramParameteri, m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glCall(m_ctx, LinkProgram, m_program);
+    glCall(m_ctx, DeleteShader, vertex_shader);
+    glCall(m_ctx, DeleteShader, fragment_shader);
+
+    GLint status = GL_FALSE;
+    glCall(m_ctx, GetProgramiv, m_program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[1024] {};
+        glCall(m_ctx, GetProgramInfoLog, m_program, sizeof(log), nullptr, log);
+        m_ctx->getStateCache().deleteProgram(m_program);
+        FATAL("failed to link program: {}", log);
+    }
+    cache->addBuildTime(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    cache->store(vertex_source, fragment_source, m_program);
+}
+
+ShaderProgram::~ShaderProgram() {
+    m_ctx->getStateCache().deleteProgram(m_program);
+    DEBUG("release ShaderProgram: {}", (void *)this);
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgram::create(std::shared_ptr<GLContext> ctx,
+                                                     const std::string &vertex_source,
+                                                     const std::string &fragment_source) {
+    return std::shared_ptr<ShaderProgram> {new ShaderProgram {ctx, vertex_source, fragment_source}};
+}
+
+void ShaderProgram::use() const { m_ctx->getStateCache().useProgram(m_program); }
+
+GLint ShaderProgram::getUniformLocation(const char *name) const {
+    return glCall(m_ctx, GetUniformLocation, m_program, name);
+}
+
+GLuint ShaderProgram::compile(GLenum type, const std::string &source) const {
+    GLuint shader = glCall(m_ctx, CreateShader, type);
+    const char *sources[] {source.c_str()};
+    glCall(m_ctx, ShaderSource, shader, 1, sources, nullptr);
+    glCall(m_ctx, CompileShader, shader);
+
+    GLint status = GL_FALSE;
+    glCall(m_ctx, GetShaderiv, shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[1024] {};
+        glCall(m_ctx, GetShaderInfoLog, shader, sizeof(log), nullptr, log);
+        glCall(m_ctx, DeleteShader, shader);
+        FATAL("failed to compile {} shader: {}", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+    }
+    return shader;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+class GLContext;
+
+/**
+ *  @class ShaderProgram
+ *
+ *  @brief Owns a linked vertex + fragment GL program.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context.
+ */
+class ShaderProgram {
+public:
+    NONCOPYABLE(ShaderProgram)
+    NONMOVABLE(ShaderProgram)
+
+    ~ShaderProgram();
+
+    /**
+     *  @brief Compiles and links a program from GLSL sources, or loads its binary from the context's ProgramCache.
+     *
+     *  @note Throws std::runtime_error with the driver's info log if compiling or linking fails.
+     */
+    static std::shared_ptr<ShaderProgram> create(std::shared_ptr<GLContext> ctx,
+                                                 const std::string &vertex_source,
+                                                 const std::string &fragment_source);
+
+    void use() const;
+
+    GLint getUniformLocation(const char *name) const;
+
+    GLuint getHandle() const { return m_program; }
+
+private:
+    std::shared_ptr<GLContext> m_ctx {};
+    GLuint m_program {};
+
+    ShaderProgram(std::shared_ptr<GLContext> ctx, const std::string &vertex_source, const std::string &fragment_source);
+
+    GLuint compile(GLenum type, const std::string &source) const;
+};
\ No newline at end of file
@@ -1,11 +1,83 @@
 #include "window_manager.h"
 
 #include "log/log_system.h"
+#include "trace/tracer.h"
 #include "gl_context.h"
 
-WindowManager::~WindowManager() { DEBUG("release WindowManager: {}", (void *)this); }
+WindowManager::~WindowManager() {
+    DEBUG("release WindowManager: {}", (void *)this);
+    // The window may outlive this; events it reports from now on are dropped.
+    auto window = m_ctx->m_window;
+    glfwSetWindowUserPointer(window, nullptr);
+    glfwSetKeyCallback(window, nullptr);
+    glfwSetCursorPosCallback(window, nullptr);
+    glfwSetCursorEnterCallback(window, nullptr);
+    glfwSetMouseButtonCallback(window, nullptr);
+    glfwSetScrollCallback(window, nullptr);
+    glfwSetFramebufferSizeCallback(window, nullptr);
+    glfwSetWindowSizeCallback(window, nullptr);
+    glfwSetDropCallback(window, nullptr);
+}
+
+void WindowManager::pollEvents() {
+    glfwPollEvents();
+    dispatchEvents();
+}
+
+void WindowManager::waitEvents(double timeout) {
+    if (timeout > 0) {
+        glfwWaitEventsTimeout(timeout);
+    } else {
+        glfwPollEvents();
+    }
+    dispatchEvents();
+}
+
+void WindowManager::postEvent(const Event &event) {
+    if (event.type == EventType::Drop) {
+        WARN("drop events cannot be posted");
+        return;
+    }
+    queueEvent(event);
+}
 
-void WindowManager::pollEvents() const { glfwPollEvents(); }
+void WindowManager::dispatchEvents() {
+    if (m_events.empty()) {
+        return;
+    }
+    TRACE_ZONE("dispatch events");
+    // Events a listener causes (e.g. by resizing the window) are appended and dispatched in this pass, but never
+    // merged into ones already dispatched.
+    m_coalesce_index.fill(kNoEvent);
+    m_dispatching = true;
+    size_t drop_path = 0;
+    // By index and by value: the queue may grow while a listener runs.
+    for (size_t i = 0; i < m_events.size(); ++i) {
+        const Event event = m_events[i];
+        dispatchEvent(event, drop_path);
+    }
+    m_dispatching = false;
+    m_dispatched += m_events.size();
+    m_events.clear();
+    m_drop_paths.clear();
+    m_coalesce_index.fill(kNoEvent);
+
+    m_on_key_funcs.commit();
+    m_on_cursor_pos_funcs.commit();
+    m_on_cursor_enter_funcs.commit();
+    m_on_mouse_button_funcs.commit();
+    m_on_scroll_funcs.commit();
+    m_on_framebuffer_size_funcs.commit();
+    m_on_window_size_funcs.commit();
+    m_on_drop_funcs.commit();
+}
+
+bool WindowManager::unregisterFunc(ListenerId id) {
+    return m_on_key_funcs.remove(id, m_dispatching) || m_on_cursor_pos_funcs.remove(id, m_dispatching) ||
+           m_on_cursor_enter_funcs.remove(id, m_dispatching) || m_on_mouse_button_funcs.remove(id, m_dispatching) ||
+           m_on_scroll_funcs.remove(id, m_dispatching) || m_on_framebuffer_size_funcs.remove(id, m_dispatching) ||
+           m_on_window_size_funcs.remove(id, m_dispatching) || m_on_drop_funcs.remove(id, m_dispatching);
+}
 
 bool WindowManager::shouldClose() const { return glfwWindowShouldClose(m_ctx->m_window); }
 
@@ -19,6 +91,8 @@ WindowManager::WindowManager(std::shared_ptr<GLContext> ctx) : m_ctx(ctx) {
     if (!ctx) {
         FATAL("invalid context!");
     }
+    m_events.reserve(kInitialQueueSize);
+    m_coalesce_index.fill(kNoEvent);
 
     auto window = m_ctx->m_window;
     glfwSetWindowUserPointer(window, this);
@@ -33,87 +107,119 @@ WindowManager::WindowManager(std::shared_ptr<GLContext> ctx) : m_ctx(ctx) {
     glfwSetDropCallback(window, dropCallback);
 }
 
-void WindowManager::onKey(int key, int scancode, int action, int mods) {
-    for (auto func : m_on_key_funcs) {
-        func(this, key, scancode, action, mods);
-    }
-}
-
-void WindowManager::onCursorPos(double xpos, double ypos) {
-    for (auto func : m_on_cursor_pos_funcs) {
-        func(this, xpos, ypos);
+void WindowManager::queueEvent(const Event &event) {
+    ++m_received;
+    auto &index = m_coalesce_index[static_cast<size_t>(event.type)];
+    switch (event.type) {
+        case EventType::CursorPos:
+        case EventType::FramebufferSize:
+        case EventType::WindowSize:
+            if (index != kNoEvent) {
+                m_events[index] = event;
+                ++m_coalesced;
+                return;
+            }
+            break;
+        case EventType::Scroll:
+            if (index != kNoEvent) {
+                m_events[index].x += event.x;
+                m_events[index].y += event.y;
+                ++m_coalesced;
+                return;
+            }
+            break;
+        default:
+            // Ordered events: what comes after must not be merged into what came before.
+            m_coalesce_index.fill(kNoEvent);
+            m_events.push_back(event);
+            return;
     }
-}
-
-void WindowManager::onCursorEnter(bool entered) {
-    for (auto func : m_on_cursor_enter_funcs) {
-        func(this, entered);
-    }
-}
-
-void WindowManager::onMouseButton(int button, int action, int mods) {
-    for (auto func : m_on_mouse_button_funcs) {
-        func(this, button, action, mods);
-    }
-}
-
-void WindowManager::onScroll(double xoffset, double yoffset) {
-    for (auto func : m_on_scroll_funcs) {
-        func(this, xoffset, yoffset);
-    }
-}
-
-void WindowManager::onFramebufferSize(int width, int height) {
-    for (auto func : m_on_framebuffer_size_funcs) {
-        func(this, width, height);
-    }
-}
-
-void WindowManager::onWindowSize(int width, int height) {
-    for (auto func : m_on_window_size_funcs) {
-        func(this, width, height);
+    index = m_events.size();
+    m_events.push_back(event);
+}
+
+void WindowManager::dispatchEvent(const Event &event, size_t &drop_path) {
+    switch (event.type) {
+        case EventType::Key:
+            m_listener_calls += m_on_key_funcs.call(this, event.key, event.scancode, event.action, event.mods);
+            break;
+        case EventType::CursorPos:
+            m_listener_calls += m_on_cursor_pos_funcs.call(this, event.x, event.y);
+            break;
+        case EventType::CursorEnter:
+            m_listener_calls += m_on_cursor_enter_funcs.call(this, event.entered);
+            break;
+        case EventType::MouseButton:
+            m_listener_calls += m_on_mouse_button_funcs.call(this, event.key, event.action, event.mods);
+            break;
+        case EventType::Scroll:
+            m_listener_calls += m_on_scroll_funcs.call(this, event.x, event.y);
+            break;
+        case EventType::FramebufferSize:
+            m_listener_calls += m_on_framebuffer_size_funcs.call(this, event.width, event.height);
+            break;
+        case EventType::WindowSize:
+            m_listener_calls += m_on_window_size_funcs.call(this, event.width, event.height);
+            break;
+        case EventType::Drop: {
+            // The path strings no longer move once queued; the pointer array was sized when they were.
+            const char **paths = m_drop_path_ptrs.data() + drop_path;
+            for (int i = 0; i < event.path_count; ++i) {
+                paths[i] = m_drop_paths[drop_path + i].c_str();
+            }
+            drop_path += event.path_count;
+            m_listener_calls += m_on_drop_funcs.call(this, event.path_count, paths);
+            break;
+        }
     }
 }
 
 void WindowManager::onDrop(int path_count, const char *paths[]) {
-    for (auto func : m_on_drop_funcs) {
-        func(this, path_count, paths);
+    for (int i = 0; i < path_count; ++i) {
+        m_drop_paths.emplace_back(paths[i]);
+    }
+    if (m_drop_path_ptrs.size() < m_drop_paths.size()) {
+        m_drop_path_ptrs.resize(m_drop_paths.size());
     }
+    Event event {};
+    event.type = EventType::Drop;
+    event.path_count = path_count;
+    queueEvent(event);
 }
 
 void WindowManager::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onKey(key, scancode, action, mods);
+    wm->queueEvent({.type = EventType::Key, .key = key, .scancode = scancode, .action = action, .mods = mods});
 }
 
 void WindowManager::cursorPosCallback(GLFWwindow *window, double xpos, double ypos) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onCursorPos(xpos, ypos);
+    wm->queueEvent({.type = EventType::CursorPos, .x = xpos, .y = ypos});
 }
 
 void WindowManager::cursorEnterCallback(GLFWwindow *window, int entered) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onCursorEnter(entered);
+    wm->queueEvent({.type = EventType::CursorEnter, .entered = entered != 0});
 }
 
 void WindowManager::mouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onMouseButton(button, action, mods);
+    wm->queueEvent({.type = EventType::MouseButton, .key = button, .action = action, .mods = mods});
 }
 
 void WindowManager::scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onScroll(xoffset, yoffset);
+    wm->queueEvent({.type = EventType::Scroll, .x = xoffset, .y = yoffset});
 }
 
 void WindowManager::framebufferSizeCallback(GLFWwindow *window, int width, int height) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onFramebufferSize(width, height);
+    wm->queueEvent({.type = EventType::FramebufferSize, .width = width, .height = height});
 }
 
 void WindowManager::windowSizeCallback(GLFWwindow *window, int width, int height) {
     auto wm = reinterpret_cast<WindowManager *>(glfwGetWindowUserPointer(window));
-    wm->onWindowSize(width, height);
+    wm->queueEvent({.type = EventType::WindowSize, .width = width, .height = height});
 }
 
 void WindowManager::dropCallback(GLFWwindow *window, int path_count, const char *paths[]) {
@@ -1,9 +1,14 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "base/delegate.h"
 #include "base/noncopyable.h"
 #include "base/nonmovable.h"
 
@@ -16,20 +21,60 @@ class GLFWwindow;
  *
  *  @brief Manages window-related events and interactions.
  *
+ *  GLFW callbacks only queue events; `pollEvents` dispatches the queue once per frame. While queued, cursor
+ *  positions and window/framebuffer sizes collapse into the latest value and scroll offsets are summed, as long as
+ *  no key, button, cursor enter or drop event came in between, so listeners see a flood of cursor moves as one
+ *  event at the right place in the order. Listeners are stored in non-allocating delegates and called by
+ *  reference: dispatching allocates nothing.
+ *
  *  @note This class can only be created by GLContext, and used only in main thread.
  */
 class WindowManager {
     friend GLContext;
 
 public:
-    using OnKeyFunc = std::function<void(WindowManager *wm, int key, int scancode, int action, int mods)>;
-    using OnCursorPosFunc = std::function<void(WindowManager *wm, double xpos, double ypos)>;
-    using OnCursorEnterFunc = std::function<void(WindowManager *wm, bool entered)>;
-    using OnMouseButtonFunc = std::function<void(WindowManager *wm, int button, int action, int mods)>;
-    using OnScrollFunc = std::function<void(WindowManager *wm, double xoffset, double yoffset)>;
-    using OnFramebufferSizeFunc = std::function<void(WindowManager *wm, int width, int height)>;
-    using OnWindowSizeFunc = std::function<void(WindowManager *wm, int width, int height)>;
-    using OnDropFunc = std::function<void(WindowManager *wm, int path_count, const char *paths[])>;
+    using ListenerId = uint64_t;
+
+    using OnKeyFunc = Delegate<void(WindowManager *wm, int key, int scancode, int action, int mods)>;
+    using OnCursorPosFunc = Delegate<void(WindowManager *wm, double xpos, double ypos)>;
+    using OnCursorEnterFunc = Delegate<void(WindowManager *wm, bool entered)>;
+    using OnMouseButtonFunc = Delegate<void(WindowManager *wm, int button, int action, int mods)>;
+    using OnScrollFunc = Delegate<void(WindowManager *wm, double xoffset, double yoffset)>;
+    using OnFramebufferSizeFunc = Delegate<void(WindowManager *wm, int width, int height)>;
+    using OnWindowSizeFunc = Delegate<void(WindowManager *wm, int width, int height)>;
+    using OnDropFunc = Delegate<void(WindowManager *wm, int path_count, const char *paths[])>;
+
+    enum class EventType : uint8_t {
+        Key,
+        CursorPos,
+        CursorEnter,
+        MouseButton,
+        Scroll,
+        FramebufferSize,
+        WindowSize,
+        Drop,
+    };
+
+    struct Event {
+        EventType type {};
+        int key {};       // Key: key, MouseButton: button
+        int scancode {};  // Key
+        int action {};    // Key, MouseButton
+        int mods {};      // Key, MouseButton
+        int width {};     // FramebufferSize, WindowSize
+        int height {};
+        int path_count {};  // Drop, the paths are kept by the window manager
+        bool entered {};    // CursorEnter
+        double x {};        // CursorPos: position, Scroll: offset
+        double y {};
+    };
+
+    struct Stats {
+        uint64_t received;        // events reported by GLFW or posted
+        uint64_t coalesced;       // events merged into an earlier one of the same type
+        uint64_t dispatched;      // events handed to listeners
+        uint64_t listener_calls;
+    };
 
     NONCOPYABLE(WindowManager)
     NONMOVABLE(WindowManager)
@@ -37,11 +82,31 @@ public:
     ~WindowManager();
 
     /**
-     *  @brief Processes all pending events.
+     *  @brief Processes all pending events, then dispatches them to the listeners.
      *
      *  @note This function must only be called from the main thread.
      */
-    void pollEvents() const;
+    void pollEvents();
+
+    /**
+     *  @brief Sleeps until an event arrives or `timeout` seconds passed, then dispatches the events; a timeout of 0
+     *         only polls.
+     *
+     *  @note This function must only be called from the main thread.
+     */
+    void waitEvents(double timeout);
+
+    /**
+     *  @brief Queues an event as if GLFW had reported it, for synthetic input. Drop events cannot be posted.
+     */
+    void postEvent(const Event &event);
+
+    /**
+     *  @brief Calls the listeners for every queued event, in order, and empties the queue.
+     *
+     *  @note Listeners may register and unregister listeners; the changes take effect after this dispatch.
+     */
+    void dispatchEvents();
 
     bool shouldClose() const;
     void setShouldClose(bool value) const;
@@ -68,38 +133,140 @@ public:
      */
     int getMouseButton(int button) const;
 
-    void registerOnKeyFunc(OnKeyFunc func) { m_on_key_funcs.push_back(std::move(func)); }
-    void registerOnCursorPosFunc(OnCursorPosFunc func) { m_on_cursor_pos_funcs.push_back(std::move(func)); }
-    void registerOnCursorEnterFunc(OnCursorEnterFunc func) { m_on_cursor_enter_funcs.push_back(std::move(func)); }
-    void registerOnMouseButtonFunc(OnMouseButtonFunc func) { m_on_mouse_button_funcs.push_back(std::move(func)); }
-    void registerOnScrollFunc(OnScrollFunc func) { m_on_scroll_funcs.push_back(std::move(func)); };
-    void registerOnFramebufferSizeFunc(OnFramebufferSizeFunc func) {
-        m_on_framebuffer_size_funcs.push_back(std::move(func));
+    ListenerId registerOnKeyFunc(OnKeyFunc func) { return addListener(m_on_key_funcs, std::move(func)); }
+    ListenerId registerOnCursorPosFunc(OnCursorPosFunc func) {
+        return addListener(m_on_cursor_pos_funcs, std::move(func));
+    }
+    ListenerId registerOnCursorEnterFunc(OnCursorEnterFunc func) {
+        return addListener(m_on_cursor_enter_funcs, std::move(func));
+    }
+    ListenerId registerOnMouseButtonFunc(OnMouseButtonFunc func) {
+        return addListener(m_on_mouse_button_funcs, std::move(func));
+    }
+    ListenerId registerOnScrollFunc(OnScrollFunc func) { return addListener(m_on_scroll_funcs, std::move(func)); }
+    ListenerId registerOnFramebufferSizeFunc(OnFramebufferSizeFunc func) {
+        return addListener(m_on_framebuffer_size_funcs, std::move(func));
+    }
+    ListenerId registerOnWindowSizeFunc(OnWindowSizeFunc func) {
+        return addListener(m_on_window_size_funcs, std::move(func));
     }
-    void registerOnWindowSizeFunc(OnWindowSizeFunc func) { m_on_window_size_funcs.push_back(std::move(func)); }
-    void registerOnDropFunc(OnDropFunc func) { m_on_drop_funcs.push_back(std::move(func)); }
+    ListenerId registerOnDropFunc(OnDropFunc func) { return addListener(m_on_drop_funcs, std::move(func)); }
+
+    /**
+     *  @brief Removes a listener added by any of the register functions. It is not called again, even if it is
+     *         removed during a dispatch.
+     *
+     *  @return false if `id` is unknown or already removed.
+     */
+    bool unregisterFunc(ListenerId id);
+
+    Stats getStats() const { return {m_received, m_coalesced, m_dispatched, m_listener_calls}; }
 
 private:
+    template<typename Func>
+    class ListenerList {
+    public:
+        void add(ListenerId id, Func func, bool dispatching) {
+            // Appending to the list being iterated could move the delegate that is running.
+            (dispatching ? m_added : m_listeners).push_back({id, std::move(func)});
+        }
+
+        bool remove(ListenerId id, bool dispatching) {
+            auto matches = [id](const Listener &listener) { return listener.id == id && !listener.removed; };
+            if (std::erase_if(m_added, matches)) {
+                return true;
+            }
+            auto it = std::find_if(m_listeners.begin(), m_listeners.end(), matches);
+            if (it == m_listeners.end()) {
+                return false;
+            }
+            // A listener may be removing itself; it is destroyed once the dispatch is over.
+            if (dispatching) {
+                it->removed = true;
+            } else {
+                m_listeners.erase(it);
+            }
+            return true;
+        }
+
+        template<typename... Args>
+        uint64_t call(Args... args) const {
+            uint64_t calls = 0;
+            for (const auto &listener : m_listeners) {
+                if (!listener.removed) {
+                    listener.func(args...);
+                    ++calls;
+                }
+            }
+            return calls;
+        }
+
+        /**
+         *  @brief Applies the changes made during a dispatch.
+         */
+        void commit() {
+            std::erase_if(m_listeners, [](const Listener &listener) { return listener.removed; });
+            for (auto &listener : m_added) {
+                m_listeners.push_back(std::move(listener));
+            }
+            m_added.clear();
+        }
+
+    private:
+        struct Listener {
+            ListenerId id {};
+            Func func {};
+            bool removed {false};
+        };
+
+        std::vector<Listener> m_listeners {};
+        std::vector<Listener> m_added {};
+    };
+
+    static constexpr size_t kNoEvent = std::numeric_limits<size_t>::max();
+    static constexpr size_t kInitialQueueSize = 64;
+
     std::shared_ptr<GLContext> m_ctx {};
 
-    std::vector<OnKeyFunc> m_on_key_funcs {};
-    std::vector<OnCursorPosFunc> m_on_cursor_pos_funcs {};
-    std::vector<OnCursorEnterFunc> m_on_cursor_enter_funcs {};
-    std::vector<OnMouseButtonFunc> m_on_mouse_button_funcs {};
-    std::vector<OnScrollFunc> m_on_scroll_funcs {};
-    std::vector<OnFramebufferSizeFunc> m_on_framebuffer_size_funcs {};
-    std::vector<OnWindowSizeFunc> m_on_window_size_funcs {};
-    std::vector<OnDropFunc> m_on_drop_funcs {};
+    ListenerList<OnKeyFunc> m_on_key_funcs {};
+    ListenerList<OnCursorPosFunc> m_on_cursor_pos_funcs {};
+    ListenerList<OnCursorEnterFunc> m_on_cursor_enter_funcs {};
+    ListenerList<OnMouseButtonFunc> m_on_mouse_button_funcs {};
+    ListenerList<OnScrollFunc> m_on_scroll_funcs {};
+    ListenerList<OnFramebufferSizeFunc> m_on_framebuffer_size_funcs {};
+    ListenerList<OnWindowSizeFunc> m_on_window_size_funcs {};
+    ListenerList<OnDropFunc> m_on_drop_funcs {};
+    ListenerId m_next_listener_id {1};
+    bool m_dispatching {false};
+
+    // Reused every frame, so only the first frames or bursts larger than any before grow them.
+    std::vector<Event> m_events {};
+    std::vector<std::string> m_drop_paths {};     // copied, GLFW's are only valid during the callback
+    std::vector<const char *> m_drop_path_ptrs {};
+    // Per event type, the queued event a new one of that type may be merged into.
+    std::array<size_t, static_cast<size_t>(EventType::Drop) + 1> m_coalesce_index {};
+
+    uint64_t m_received {};
+    uint64_t m_coalesced {};
+    uint64_t m_dispatched {};
+    uint64_t m_listener_calls {};
 
     WindowManager(std::shared_ptr<GLContext> ctx_ref);
 
-    void onKey(int key, int scancode, int action, int mods);
-    void onCursorPos(double xpos, double ypos);
-    void onCursorEnter(bool entered);
-    void onMouseButton(int button, int action, int mods);
-    void onScroll(double xoffset, double yoffset);
-    void onFramebufferSize(int width, int height);
-    void onWindowSize(int width, int height);
+    template<typename Func>
+    ListenerId addListener(ListenerList<Func> &list, Func func) {
+        const ListenerId id = m_next_listener_id++;
+        list.add(id, std::move(func), m_dispatching);
+        return id;
+    }
+
+    /**
+     *  @brief Queues `event`, or merges it into the queued event of the same type if nothing ordered came since.
+     */
+    void queueEvent(const Event &event);
+
+    void dispatchEvent(const Event &event, size_t &drop_path);
+
     void onDrop(int path_count, const char *paths[]);
 
     static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
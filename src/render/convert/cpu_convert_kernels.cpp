@@ -0,0 +1,116 @@
+#include "cpu_convert_kernels.h"
+
+#include <algorithm>
+
+namespace {
+
+// The reference every other kernel must match byte for byte.
+
+void verticalScalar(const uint8_t *const *rows,
+                    const int16_t *weights,
+                    int weight_stride,
+                    int taps,
+                    uint8_t *dst,
+                    int width) {
+    for (int i = 0; i < width; ++i) {
+        uint32_t sum = 1 << (kCpuFilterShift - 1);
+        for (int t = 0; t < taps; ++t) {
+            sum += rows[t][i] * static_cast<uint32_t>(weights[t * weight_stride]);
+        }
+        dst[i] = static_cast<uint8_t>(sum >> kCpuFilterShift);
+    }
+}
+
+void horizontalScalar(const uint8_t *src,
+                      const int32_t *start,
+                      const int16_t *weights,
+                      int taps,
+                      int step,
+                      int offset,
+                      uint8_t *dst,
+                      int dst_width) {
+    for (int x = 0; x < dst_width; ++x) {
+        uint32_t sum = 1 << (kCpuFilterShift - 1);
+        for (int t = 0; t < taps; ++t) {
+            sum += src[(start[x] + t) * step + offset] * static_cast<uint32_t>(weights[t * dst_width + x]);
+        }
+        dst[x] = static_cast<uint8_t>(sum >> kCpuFilterShift);
+    }
+}
+
+void yuvToRgbaScalar(const uint8_t *y,
+                     const uint8_t *u,
+                     const uint8_t *v,
+                     const CpuYuvCoefficients &c,
+                     uint8_t *dst,
+                     int width) {
+    constexpr int32_t round = 1 << (kCpuColorShift - 1);
+    for (int i = 0; i < width; ++i) {
+        const int32_t luma = c.y_mul * (y[i] - c.y_offset) + round;
+        const int32_t cb = u[i] - 128;
+        const int32_t cr = v[i] - 128;
+        dst[4 * i + 0] = static_cast<uint8_t>(std::clamp((luma + c.r_v * cr) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 1] = static_cast<uint8_t>(std::clamp((luma - c.g_u * cb - c.g_v * cr) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 2] = static_cast<uint8_t>(std::clamp((luma + c.b_u * cb) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 3] = 255;
+    }
+}
+
+constexpr CpuConvertKernels kScalarConvertKernels {verticalScalar, horizontalScalar, yuvToRgbaScalar};
+
+CpuIsa detectCpuIsa() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return CpuIsa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return CpuIsa::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return CpuIsa::SSE42;
+    }
+#endif
+    return CpuIsa::Scalar;
+}
+
+}  // namespace
+
+CpuIsa getBestCpuIsa() {
+    static const CpuIsa s_isa = detectCpuIsa();
+    return s_isa;
+}
+
+bool isCpuIsaSupported(CpuIsa isa) { return static_cast<int>(isa) <= static_cast<int>(getBestCpuIsa()); }
+
+const char *getCpuIsaName(CpuIsa isa) {
+    switch (isa) {
+        case CpuIsa::SSE42:
+            return "sse4.2";
+        case CpuIsa::AVX2:
+            return "avx2";
+        case CpuIsa::AVX512:
+            return "avx512";
+        case CpuIsa::Scalar:
+        default:
+            return "scalar";
+    }
+}
+
+const CpuConvertKernels *getCpuConvertKernels(CpuIsa isa) {
+    if (!isCpuIsaSupported(isa)) {
+        return &kScalarConvertKernels;
+    }
+    switch (isa) {
+#if defined(__x86_64__) || defined(__i386__)
+        case CpuIsa::SSE42:
+            return &kSse42ConvertKernels;
+        case CpuIsa::AVX2:
+            return &kAvx2ConvertKernels;
+        case CpuIsa::AVX512:
+            return &kAvx512ConvertKernels;
+#endif
+        default:
+            return &kScalarConvertKernels;
+    }
+}
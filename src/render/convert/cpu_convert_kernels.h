@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ *  Row kernels of CpuConverter, one table per instruction set. Every table computes bit-identical results.
+ */
+
+enum class CpuIsa {
+    Scalar,
+    SSE42,
+    AVX2,
+    AVX512,
+};
+
+// YUV -> RGB in 13-bit fixed point: R = (y_mul * (Y - y_offset) + r_v * (V - 128) + 4096) >> 13, and so on.
+struct CpuYuvCoefficients {
+    int32_t y_offset;
+    int32_t y_mul;
+    int32_t r_v;
+    int32_t g_u;
+    int32_t g_v;
+    int32_t b_u;
+};
+
+inline constexpr int kCpuFilterShift = 8;   // filter weights sum to 1 << kCpuFilterShift
+inline constexpr int kCpuColorShift = 13;   // fixed-point precision of CpuYuvCoefficients
+inline constexpr int kCpuGatherPadding = 3;  // bytes readable past the last sample of a horizontal source row
+
+struct CpuConvertKernels {
+    /**
+     *  dst[i] = (sum over t of rows[t][i] * weights[t * weight_stride] + 128) >> 8, for i in [0, width).
+     */
+    void (*vertical)(const uint8_t *const *rows,
+                     const int16_t *weights,
+                     int weight_stride,
+                     int taps,
+                     uint8_t *dst,
+                     int width);
+
+    /**
+     *  dst[x] = (sum over t of src[(start[x] + t) * step + offset] * weights[t * dst_width + x] + 128) >> 8.
+     *
+     *  `src` must stay readable kCpuGatherPadding bytes past the last sample.
+     */
+    void (*horizontal)(const uint8_t *src,
+                       const int32_t *start,
+                       const int16_t *weights,
+                       int taps,
+                       int step,
+                       int offset,
+                       uint8_t *dst,
+                       int dst_width);
+
+    /**
+     *  Converts `width` pixels of Y, U and V samples to RGBA, alpha 255.
+     */
+    void (*yuvToRgba)(const uint8_t *y,
+                      const uint8_t *u,
+                      const uint8_t *v,
+                      const CpuYuvCoefficients &coefficients,
+                      uint8_t *dst,
+                      int width);
+};
+
+/**
+ *  @return The best instruction set the CPU and OS support, detected once with CPUID.
+ */
+CpuIsa getBestCpuIsa();
+
+bool isCpuIsaSupported(CpuIsa isa);
+
+const char *getCpuIsaName(CpuIsa isa);
+
+/**
+ *  @return The kernels for `isa`, or the scalar ones if it is not supported here.
+ */
+const CpuConvertKernels *getCpuConvertKernels(CpuIsa isa);
+
+#if defined(__x86_64__) || defined(__i386__)
+extern const CpuConvertKernels kSse42ConvertKernels;
+extern const CpuConvertKernels kAvx2ConvertKernels;
+extern const CpuConvertKernels kAvx512ConvertKernels;
+#endif
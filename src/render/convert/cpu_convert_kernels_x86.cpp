@@ -0,0 +1,385 @@
+#include "cpu_convert_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+// Kernels are compiled per function with target attributes, so the rest of the build keeps its baseline ISA and
+// these only run after getBestCpuIsa() has checked the CPU. Row tails fall back to the scalar formulas.
+
+namespace {
+
+constexpr int kFilterRound = 1 << (kCpuFilterShift - 1);
+constexpr int kColorRound = 1 << (kCpuColorShift - 1);
+
+void verticalTail(const uint8_t *const *rows,
+                  const int16_t *weights,
+                  int weight_stride,
+                  int taps,
+                  uint8_t *dst,
+                  int begin,
+                  int end) {
+    for (int i = begin; i < end; ++i) {
+        uint32_t sum = kFilterRound;
+        for (int t = 0; t < taps; ++t) {
+            sum += rows[t][i] * static_cast<uint32_t>(weights[t * weight_stride]);
+        }
+        dst[i] = static_cast<uint8_t>(sum >> kCpuFilterShift);
+    }
+}
+
+void horizontalTail(const uint8_t *src,
+                    const int32_t *start,
+                    const int16_t *weights,
+                    int taps,
+                    int step,
+                    int offset,
+                    uint8_t *dst,
+                    int dst_width,
+                    int begin) {
+    for (int x = begin; x < dst_width; ++x) {
+        uint32_t sum = kFilterRound;
+        for (int t = 0; t < taps; ++t) {
+            sum += src[(start[x] + t) * step + offset] * static_cast<uint32_t>(weights[t * dst_width + x]);
+        }
+        dst[x] = static_cast<uint8_t>(sum >> kCpuFilterShift);
+    }
+}
+
+void yuvToRgbaTail(const uint8_t *y,
+                   const uint8_t *u,
+                   const uint8_t *v,
+                   const CpuYuvCoefficients &c,
+                   uint8_t *dst,
+                   int begin,
+                   int end) {
+    for (int i = begin; i < end; ++i) {
+        const int32_t luma = c.y_mul * (y[i] - c.y_offset) + kColorRound;
+        const int32_t cb = u[i] - 128;
+        const int32_t cr = v[i] - 128;
+        dst[4 * i + 0] = static_cast<uint8_t>(std::clamp((luma + c.r_v * cr) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 1] = static_cast<uint8_t>(std::clamp((luma - c.g_u * cb - c.g_v * cr) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 2] = static_cast<uint8_t>(std::clamp((luma + c.b_u * cb) >> kCpuColorShift, 0, 255));
+        dst[4 * i + 3] = 255;
+    }
+}
+
+uint32_t load32(const uint8_t *src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+// SSE4.2: 16 bytes per vertical step, 4 lanes per horizontal and colour step. No gathers; samples are inserted.
+
+__attribute__((target("sse4.2"))) void verticalSse42(const uint8_t *const *rows,
+                                                     const int16_t *weights,
+                                                     int weight_stride,
+                                                     int taps,
+                                                     uint8_t *dst,
+                                                     int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(kFilterRound);
+    int i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m128i lo = round;
+        __m128i hi = round;
+        for (int t = 0; t < taps; ++t) {
+            const __m128i weight = _mm_set1_epi16(weights[t * weight_stride]);
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[t] + i));
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), weight));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), weight));
+        }
+        lo = _mm_srli_epi16(lo, kCpuFilterShift);
+        hi = _mm_srli_epi16(hi, kCpuFilterShift);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    verticalTail(rows, weights, weight_stride, taps, dst, i, width);
+}
+
+__attribute__((target("sse4.2"))) void horizontalSse42(const uint8_t *src,
+                                                       const int32_t *start,
+                                                       const int16_t *weights,
+                                                       int taps,
+                                                       int step,
+                                                       int offset,
+                                                       uint8_t *dst,
+                                                       int dst_width) {
+    const __m128i round = _mm_set1_epi32(kFilterRound);
+    int x = 0;
+    for (; x + 4 <= dst_width; x += 4) {
+        __m128i acc = round;
+        for (int t = 0; t < taps; ++t) {
+            const __m128i samples = _mm_setr_epi32(src[(start[x + 0] + t) * step + offset],
+                                                   src[(start[x + 1] + t) * step + offset],
+                                                   src[(start[x + 2] + t) * step + offset],
+                                                   src[(start[x + 3] + t) * step + offset]);
+            const __m128i weight =
+                _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights + t * dst_width + x)));
+            acc = _mm_add_epi32(acc, _mm_mullo_epi32(samples, weight));
+        }
+        acc = _mm_srli_epi32(acc, kCpuFilterShift);
+        acc = _mm_packus_epi16(_mm_packus_epi32(acc, acc), acc);
+        const uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+        std::memcpy(dst + x, &packed, sizeof(packed));
+    }
+    horizontalTail(src, start, weights, taps, step, offset, dst, dst_width, x);
+}
+
+__attribute__((target("sse4.2"))) void yuvToRgbaSse42(const uint8_t *y,
+                                                      const uint8_t *u,
+                                                      const uint8_t *v,
+                                                      const CpuYuvCoefficients &c,
+                                                      uint8_t *dst,
+                                                      int width) {
+    const __m128i y_offset = _mm_set1_epi32(c.y_offset);
+    const __m128i y_mul = _mm_set1_epi32(c.y_mul);
+    const __m128i r_v = _mm_set1_epi32(c.r_v);
+    const __m128i g_u = _mm_set1_epi32(c.g_u);
+    const __m128i g_v = _mm_set1_epi32(c.g_v);
+    const __m128i b_u = _mm_set1_epi32(c.b_u);
+    const __m128i round = _mm_set1_epi32(kColorRound);
+    const __m128i bias = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(255);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int32_t>(0xff000000u));
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        const __m128i luma_in = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load32(y + i))));
+        const __m128i cb = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load32(u + i)))), bias);
+        const __m128i cr = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load32(v + i)))), bias);
+        const __m128i luma = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(luma_in, y_offset), y_mul), round);
+
+        __m128i r = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(r_v, cr)), kCpuColorShift);
+        __m128i g = _mm_srai_epi32(
+            _mm_sub_epi32(_mm_sub_epi32(luma, _mm_mullo_epi32(g_u, cb)), _mm_mullo_epi32(g_v, cr)), kCpuColorShift);
+        __m128i b = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(b_u, cb)), kCpuColorShift);
+        r = _mm_min_epi32(_mm_max_epi32(r, zero), max);
+        g = _mm_min_epi32(_mm_max_epi32(g, zero), max);
+        b = _mm_min_epi32(_mm_max_epi32(b, zero), max);
+
+        const __m128i rgba =
+            _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), rgba);
+    }
+    yuvToRgbaTail(y, u, v, c, dst, i, width);
+}
+
+// AVX2: 32 bytes per vertical step, 8 lanes per horizontal (hardware gathers) and colour step.
+
+__attribute__((target("avx2"))) void verticalAvx2(const uint8_t *const *rows,
+                                                  const int16_t *weights,
+                                                  int weight_stride,
+                                                  int taps,
+                                                  uint8_t *dst,
+                                                  int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(kFilterRound);
+    int i = 0;
+    for (; i + 32 <= width; i += 32) {
+        __m256i lo = round;
+        __m256i hi = round;
+        for (int t = 0; t < taps; ++t) {
+            const __m256i weight = _mm256_set1_epi16(weights[t * weight_stride]);
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[t] + i));
+            lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(pixels, zero), weight));
+            hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(pixels, zero), weight));
+        }
+        // unpack and pack both work within 128-bit lanes, so the byte order comes back unchanged.
+        lo = _mm256_srli_epi16(lo, kCpuFilterShift);
+        hi = _mm256_srli_epi16(hi, kCpuFilterShift);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    verticalTail(rows, weights, weight_stride, taps, dst, i, width);
+}
+
+__attribute__((target("avx2"))) void horizontalAvx2(const uint8_t *src,
+                                                    const int32_t *start,
+                                                    const int16_t *weights,
+                                                    int taps,
+                                                    int step,
+                                                    int offset,
+                                                    uint8_t *dst,
+                                                    int dst_width) {
+    const __m256i round = _mm256_set1_epi32(kFilterRound);
+    const __m256i low_byte = _mm256_set1_epi32(0xff);
+    const __m256i steps = _mm256_set1_epi32(step);
+    const __m256i offsets = _mm256_set1_epi32(offset);
+    const int *base = reinterpret_cast<const int *>(src);
+    int x = 0;
+    for (; x + 8 <= dst_width; x += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(start + x));
+        index = _mm256_add_epi32(_mm256_mullo_epi32(index, steps), offsets);
+        __m256i acc = round;
+        for (int t = 0; t < taps; ++t) {
+            // Gathers 4 bytes per lane; only the first is the sample.
+            const __m256i samples = _mm256_and_si256(_mm256_i32gather_epi32(base, index, 1), low_byte);
+            const __m256i weight = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + t * dst_width + x)));
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(samples, weight));
+            index = _mm256_add_epi32(index, steps);
+        }
+        acc = _mm256_srli_epi32(acc, kCpuFilterShift);
+        // Within each 128-bit lane, packing leaves the lane's four bytes in its low 32 bits.
+        acc = _mm256_packus_epi16(_mm256_packus_epi32(acc, acc), acc);
+        const uint32_t lo = static_cast<uint32_t>(_mm256_extract_epi32(acc, 0));
+        const uint32_t hi = static_cast<uint32_t>(_mm256_extract_epi32(acc, 4));
+        std::memcpy(dst + x, &lo, sizeof(lo));
+        std::memcpy(dst + x + 4, &hi, sizeof(hi));
+    }
+    horizontalTail(src, start, weights, taps, step, offset, dst, dst_width, x);
+}
+
+__attribute__((target("avx2"))) void yuvToRgbaAvx2(const uint8_t *y,
+                                                   const uint8_t *u,
+                                                   const uint8_t *v,
+                                                   const CpuYuvCoefficients &c,
+                                                   uint8_t *dst,
+                                                   int width) {
+    const __m256i y_offset = _mm256_set1_epi32(c.y_offset);
+    const __m256i y_mul = _mm256_set1_epi32(c.y_mul);
+    const __m256i r_v = _mm256_set1_epi32(c.r_v);
+    const __m256i g_u = _mm256_set1_epi32(c.g_u);
+    const __m256i g_v = _mm256_set1_epi32(c.g_v);
+    const __m256i b_u = _mm256_set1_epi32(c.b_u);
+    const __m256i round = _mm256_set1_epi32(kColorRound);
+    const __m256i bias = _mm256_set1_epi32(128);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xff000000u));
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m256i luma_in = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + i)));
+        const __m256i cb =
+            _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i))), bias);
+        const __m256i cr =
+            _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i))), bias);
+        const __m256i luma =
+            _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(luma_in, y_offset), y_mul), round);
+
+        __m256i r = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(r_v, cr)), kCpuColorShift);
+        __m256i g = _mm256_srai_epi32(
+            _mm256_sub_epi32(_mm256_sub_epi32(luma, _mm256_mullo_epi32(g_u, cb)), _mm256_mullo_epi32(g_v, cr)),
+            kCpuColorShift);
+        __m256i b = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(b_u, cb)), kCpuColorShift);
+        r = _mm256_min_epi32(_mm256_max_epi32(r, zero), max);
+        g = _mm256_min_epi32(_mm256_max_epi32(g, zero), max);
+        b = _mm256_min_epi32(_mm256_max_epi32(b, zero), max);
+
+        const __m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                                             _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), rgba);
+    }
+    yuvToRgbaTail(y, u, v, c, dst, i, width);
+}
+
+// AVX-512 (F + BW): 64 bytes per vertical step, 16 lanes per horizontal and colour step.
+
+__attribute__((target("avx512f,avx512bw"))) void verticalAvx512(const uint8_t *const *rows,
+                                                               const int16_t *weights,
+                                                               int weight_stride,
+                                                               int taps,
+                                                               uint8_t *dst,
+                                                               int width) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i round = _mm512_set1_epi16(kFilterRound);
+    int i = 0;
+    for (; i + 64 <= width; i += 64) {
+        __m512i lo = round;
+        __m512i hi = round;
+        for (int t = 0; t < taps; ++t) {
+            const __m512i weight = _mm512_set1_epi16(weights[t * weight_stride]);
+            const __m512i pixels = _mm512_loadu_si512(rows[t] + i);
+            lo = _mm512_add_epi16(lo, _mm512_mullo_epi16(_mm512_unpacklo_epi8(pixels, zero), weight));
+            hi = _mm512_add_epi16(hi, _mm512_mullo_epi16(_mm512_unpackhi_epi8(pixels, zero), weight));
+        }
+        lo = _mm512_srli_epi16(lo, kCpuFilterShift);
+        hi = _mm512_srli_epi16(hi, kCpuFilterShift);
+        _mm512_storeu_si512(dst + i, _mm512_packus_epi16(lo, hi));
+    }
+    verticalTail(rows, weights, weight_stride, taps, dst, i, width);
+}
+
+__attribute__((target("avx512f,avx512bw"))) void horizontalAvx512(const uint8_t *src,
+                                                                 const int32_t *start,
+                                                                 const int16_t *weights,
+                                                                 int taps,
+                                                                 int step,
+                                                                 int offset,
+                                                                 uint8_t *dst,
+                                                                 int dst_width) {
+    const __m512i round = _mm512_set1_epi32(kFilterRound);
+    const __m512i low_byte = _mm512_set1_epi32(0xff);
+    const __m512i steps = _mm512_set1_epi32(step);
+    const __m512i offsets = _mm512_set1_epi32(offset);
+    int x = 0;
+    for (; x + 16 <= dst_width; x += 16) {
+        __m512i index = _mm512_loadu_si512(start + x);
+        index = _mm512_add_epi32(_mm512_mullo_epi32(index, steps), offsets);
+        __m512i acc = round;
+        for (int t = 0; t < taps; ++t) {
+            const __m512i samples = _mm512_and_si512(_mm512_i32gather_epi32(index, src, 1), low_byte);
+            const __m512i weight = _mm512_cvtepu16_epi32(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + t * dst_width + x)));
+            acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(samples, weight));
+            index = _mm512_add_epi32(index, steps);
+        }
+        acc = _mm512_srli_epi32(acc, kCpuFilterShift);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm512_cvtepi32_epi8(acc));
+    }
+    horizontalTail(src, start, weights, taps, step, offset, dst, dst_width, x);
+}
+
+__attribute__((target("avx512f,avx512bw"))) void yuvToRgbaAvx512(const uint8_t *y,
+                                                                const uint8_t *u,
+                                                                const uint8_t *v,
+                                                                const CpuYuvCoefficients &c,
+                                                                uint8_t *dst,
+                                                                int width) {
+    const __m512i y_offset = _mm512_set1_epi32(c.y_offset);
+    const __m512i y_mul = _mm512_set1_epi32(c.y_mul);
+    const __m512i r_v = _mm512_set1_epi32(c.r_v);
+    const __m512i g_u = _mm512_set1_epi32(c.g_u);
+    const __m512i g_v = _mm512_set1_epi32(c.g_v);
+    const __m512i b_u = _mm512_set1_epi32(c.b_u);
+    const __m512i round = _mm512_set1_epi32(kColorRound);
+    const __m512i bias = _mm512_set1_epi32(128);
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i max = _mm512_set1_epi32(255);
+    const __m512i alpha = _mm512_set1_epi32(static_cast<int32_t>(0xff000000u));
+    int i = 0;
+    for (; i + 16 <= width; i += 16) {
+        const __m512i luma_in = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i)));
+        const __m512i cb =
+            _mm512_sub_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(u + i))), bias);
+        const __m512i cr =
+            _mm512_sub_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i))), bias);
+        const __m512i luma =
+            _mm512_add_epi32(_mm512_mullo_epi32(_mm512_sub_epi32(luma_in, y_offset), y_mul), round);
+
+        __m512i r = _mm512_srai_epi32(_mm512_add_epi32(luma, _mm512_mullo_epi32(r_v, cr)), kCpuColorShift);
+        __m512i g = _mm512_srai_epi32(
+            _mm512_sub_epi32(_mm512_sub_epi32(luma, _mm512_mullo_epi32(g_u, cb)), _mm512_mullo_epi32(g_v, cr)),
+            kCpuColorShift);
+        __m512i b = _mm512_srai_epi32(_mm512_add_epi32(luma, _mm512_mullo_epi32(b_u, cb)), kCpuColorShift);
+        r = _mm512_min_epi32(_mm512_max_epi32(r, zero), max);
+        g = _mm512_min_epi32(_mm512_max_epi32(g, zero), max);
+        b = _mm512_min_epi32(_mm512_max_epi32(b, zero), max);
+
+        const __m512i rgba = _mm512_or_si512(_mm512_or_si512(r, _mm512_slli_epi32(g, 8)),
+                                             _mm512_or_si512(_mm512_slli_epi32(b, 16), alpha));
+        _mm512_storeu_si512(dst + 4 * i, rgba);
+    }
+    yuvToRgbaTail(y, u, v, c, dst, i, width);
+}
+
+}  // namespace
+
+const CpuConvertKernels kSse42ConvertKernels {verticalSse42, horizontalSse42, yuvToRgbaSse42};
+const CpuConvertKernels kAvx2ConvertKernels {verticalAvx2, horizontalAvx2, yuvToRgbaAvx2};
+const CpuConvertKernels kAvx512ConvertKernels {verticalAvx512, horizontalAvx512, yuvToRgbaAvx512};
+
+#endif
@@ -0,0 +1,210 @@
+#include "cpu_converter.h"
+
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include <libavutil/common.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "log/log_system.h"
+#include "render/convert/yuv_converter.h"
+#include "trace/tracer.h"
+
+CpuConverter::CpuConverter(Filter filter, CpuIsa isa)
+    : m_filter(filter),
+      m_isa(isCpuIsaSupported(isa) ? isa : CpuIsa::Scalar),
+      m_kernels(getCpuConvertKernels(m_isa)) {}
+
+bool CpuConverter::isSupported(AVPixelFormat format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_NV12:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool CpuConverter::convert(const AVFrame *frame, uint8_t *dst, int dst_stride, int dst_width, int dst_height) {
+    TRACE_ZONE("cpu convert");
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    if (!isSupported(format) || frame->width <= 0 || frame->height <= 0 || dst_width <= 0 || dst_height <= 0) {
+        return false;
+    }
+    if (format != m_format || frame->width != m_src_width || frame->height != m_src_height ||
+        dst_width != m_dst_width || dst_height != m_dst_height) {
+        configure(format, frame->width, frame->height, dst_width, dst_height);
+    }
+
+    const CpuYuvCoefficients coefficients = getCoefficients(frame);
+    for (int y = 0; y < dst_height; ++y) {
+        filterVertical(m_luma, frame->data[0], frame->linesize[0], m_src_width, y);
+        filterHorizontal(m_luma, 1, 0, m_y.data());
+
+        if (m_semi_planar) {
+            filterVertical(m_chroma, frame->data[1], frame->linesize[1], 2 * m_chroma_width, y);
+            filterHorizontal(m_chroma, 2, 0, m_u.data());
+            filterHorizontal(m_chroma, 2, 1, m_v.data());
+        } else {
+            filterVertical(m_chroma, frame->data[1], frame->linesize[1], m_chroma_width, y);
+            filterHorizontal(m_chroma, 1, 0, m_u.data());
+            filterVertical(m_chroma, frame->data[2], frame->linesize[2], m_chroma_width, y);
+            filterHorizontal(m_chroma, 1, 0, m_v.data());
+        }
+
+        m_kernels->yuvToRgba(m_y.data(), m_u.data(), m_v.data(), coefficients, dst + y * dst_stride, dst_width);
+    }
+    return true;
+}
+
+void CpuConverter::configure(AVPixelFormat format, int src_width, int src_height, int dst_width, int dst_height) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    m_format = format;
+    m_src_width = src_width;
+    m_src_height = src_height;
+    m_dst_width = dst_width;
+    m_dst_height = dst_height;
+    m_semi_planar = format == AV_PIX_FMT_NV12;
+    m_chroma_width = AV_CEIL_RSHIFT(src_width, desc->log2_chroma_w);
+    const int chroma_height = AV_CEIL_RSHIFT(src_height, desc->log2_chroma_h);
+
+    auto setup = [&](Plane &plane, int width, int height, int row_bytes) {
+        plane.vertical = makeFilter(m_filter, height, dst_height);
+        plane.horizontal = makeFilter(m_filter, width, dst_width);
+        plane.rows.resize(plane.vertical.taps);
+        plane.filtered.assign(row_bytes + kCpuGatherPadding, 0);
+    };
+    setup(m_luma, src_width, src_height, src_width);
+    setup(m_chroma, m_chroma_width, chroma_height, m_semi_planar ? 2 * m_chroma_width : m_chroma_width);
+
+    m_y.resize(dst_width);
+    m_u.resize(dst_width);
+    m_v.resize(dst_width);
+    DEBUG("CpuConverter configured for {} {}x{} -> {}x{} ({}, {} filter)",
+          av_get_pix_fmt_name(format),
+          src_width,
+          src_height,
+          dst_width,
+          dst_height,
+          getCpuIsaName(m_isa),
+          m_filter == Filter::Box ? "box" : "bilinear");
+}
+
+void CpuConverter::filterVertical(Plane &plane, const uint8_t *data, int linesize, int row_bytes, int y) {
+    const auto &table = plane.vertical;
+    for (int t = 0; t < table.taps; ++t) {
+        plane.rows[t] = data + static_cast<ptrdiff_t>(table.start[y] + t) * linesize;
+    }
+    m_kernels->vertical(
+        plane.rows.data(), &table.weights[y], table.dst_size, table.taps, plane.filtered.data(), row_bytes);
+}
+
+void CpuConverter::filterHorizontal(const Plane &plane, int step, int offset, uint8_t *dst) {
+    const auto &table = plane.horizontal;
+    m_kernels->horizontal(plane.filtered.data(),
+                          table.start.data(),
+                          table.weights.data(),
+                          table.taps,
+                          step,
+                          offset,
+                          dst,
+                          table.dst_size);
+}
+
+CpuConverter::FilterTable CpuConverter::makeFilter(Filter filter, int src_size, int dst_size) {
+    // Contributions of the source samples to every output, as (first sample, weights) before quantization.
+    std::vector<int> first(dst_size);
+    std::vector<std::vector<double>> contributions(dst_size);
+    const double scale = static_cast<double>(src_size) / dst_size;
+    for (int x = 0; x < dst_size; ++x) {
+        auto &weights = contributions[x];
+        if (filter == Filter::Box && scale > 1.0) {
+            // Overlap of every source sample with the output sample's footprint.
+            const double left = x * scale;
+            const double right = std::min((x + 1) * scale, static_cast<double>(src_size));
+            first[x] = static_cast<int>(left);
+            for (int i = first[x]; i < right; ++i) {
+                weights.push_back(std::min(right, i + 1.0) - std::max(left, static_cast<double>(i)));
+            }
+        } else {
+            // Bilinear; also the box filter when enlarging, where every output covers at most two samples.
+            const double center = std::clamp((x + 0.5) * scale - 0.5, 0.0, src_size - 1.0);
+            first[x] = std::min(static_cast<int>(center), std::max(src_size - 2, 0));
+            const double fraction = center - first[x];
+            weights.push_back(1.0 - fraction);
+            if (src_size > 1) {
+                weights.push_back(fraction);
+            }
+        }
+    }
+
+    FilterTable table {src_size, dst_size};
+    for (const auto &weights : contributions) {
+        table.taps = std::max(table.taps, static_cast<int>(weights.size()));
+    }
+    table.start.resize(dst_size);
+    table.weights.assign(static_cast<size_t>(table.taps) * dst_size, 0);
+
+    constexpr int one = 1 << kCpuFilterShift;
+    for (int x = 0; x < dst_size; ++x) {
+        const auto &weights = contributions[x];
+        // Every output reads `taps` samples; near the end, start earlier and leave the leading taps at zero.
+        const int start = std::min(first[x], src_size - table.taps);
+        const int skip = first[x] - start;
+        table.start[x] = start;
+
+        double total = 0.0;
+        for (double weight : weights) {
+            total += weight;
+        }
+        int sum = 0;
+        int largest = skip;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            const int tap = skip + static_cast<int>(i);
+            const auto quantized = static_cast<int16_t>(std::lround(weights[i] / total * one));
+            table.weights[static_cast<size_t>(tap) * dst_size + x] = quantized;
+            sum += quantized;
+            if (quantized > table.weights[static_cast<size_t>(largest) * dst_size + x]) {
+                largest = tap;
+            }
+        }
+        // Rounding leftovers go to the largest tap, so every output sums to exactly one and flat areas stay flat.
+        table.weights[static_cast<size_t>(largest) * dst_size + x] += one - sum;
+    }
+    return table;
+}
+
+CpuYuvCoefficients CpuConverter::getCoefficients(const AVFrame *frame) {
+    double kr, kb;
+    switch (YuvConverter::getColorMatrix(frame)) {
+        case YuvConverter::ColorMatrix::BT601:
+            kr = 0.299, kb = 0.114;
+            break;
+        case YuvConverter::ColorMatrix::BT2020:
+            kr = 0.2627, kb = 0.0593;
+            break;
+        case YuvConverter::ColorMatrix::BT709:
+        default:
+            kr = 0.2126, kb = 0.0722;
+            break;
+    }
+    const double kg = 1.0 - kr - kb;
+    const bool limited = YuvConverter::getColorRange(frame) == YuvConverter::ColorRange::Limited;
+    const double luma_scale = limited ? 255.0 / 219.0 : 1.0;
+    const double chroma_scale = limited ? 255.0 / 224.0 : 1.0;
+
+    auto fixed = [](double value) { return static_cast<int32_t>(std::lround(value * (1 << kCpuColorShift))); };
+    return {limited ? 16 : 0,
+            fixed(luma_scale),
+            fixed(2.0 * (1.0 - kr) * chroma_scale),
+            fixed(2.0 * kb * (1.0 - kb) / kg * chroma_scale),
+            fixed(2.0 * kr * (1.0 - kr) / kg * chroma_scale),
+            fixed(2.0 * (1.0 - kb) * chroma_scale)};
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "render/convert/cpu_convert_kernels.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+/**
+ *  @class CpuConverter
+ *
+ *  @brief Fused YUV -> RGBA conversion and downscale on the CPU, for output that has to end up in memory
+ *         (thumbnails, readback, machines without working GL).
+ *
+ *  Each output row is produced in three passes over small scratch rows: a vertical filter over the source rows
+ *  (contiguous, so vectorized across the row), a horizontal filter picking the output columns (gathers), and the
+ *  colour conversion. Luma and chroma are filtered separately straight to the output size, so chroma is never
+ *  upsampled to the source size first.
+ *
+ *  Filters use 8-bit fixed-point weights and the conversion 13-bit fixed-point coefficients. All kernels do the
+ *  same integer arithmetic, so every instruction set produces the exact same bytes as the scalar reference.
+ *
+ *  Handles 8-bit planar 4:2:0, 4:2:2 and 4:4:4 (including the yuvj variants) and NV12, with the BT.601, BT.709
+ *  and BT.2020 matrices in limited or full range.
+ *
+ *  @note Not thread-safe: it keeps scratch rows and filter tables. Use one converter per thread.
+ */
+class CpuConverter {
+public:
+    NONCOPYABLE(CpuConverter)
+
+    enum class Filter {
+        Box,       // area average; every source pixel contributes, the right choice for thumbnails
+        Bilinear,  // two taps per axis; cheaper, aliases when shrinking by more than 2x
+    };
+
+    explicit CpuConverter(Filter filter = Filter::Box, CpuIsa isa = getBestCpuIsa());
+    CpuConverter(CpuConverter &&) = default;
+    CpuConverter &operator=(CpuConverter &&) = default;
+
+    /**
+     *  @return true if frames of this pixel format can be converted.
+     */
+    static bool isSupported(AVPixelFormat format);
+
+    /**
+     *  @brief Converts `frame` to tightly or loosely packed RGBA of `dst_width` x `dst_height`.
+     *
+     *  @return false if the format is unsupported or a size is not positive.
+     */
+    bool convert(const AVFrame *frame, uint8_t *dst, int dst_stride, int dst_width, int dst_height);
+
+    CpuIsa getIsa() const { return m_isa; }
+    Filter getFilter() const { return m_filter; }
+
+private:
+    // Separable filter from `src_size` samples to `dst_size`, taps padded to the same count for every output.
+    struct FilterTable {
+        int src_size {};
+        int dst_size {};
+        int taps {};
+        std::vector<int32_t> start {};   // first source sample of every output
+        std::vector<int16_t> weights {};  // tap-major: weights[tap * dst_size + output], summing to 256 per output
+    };
+
+    struct Plane {
+        FilterTable vertical {};
+        FilterTable horizontal {};
+        std::vector<const uint8_t *> rows {};
+        std::vector<uint8_t> filtered {};  // the vertically filtered source row, padded for 4-byte gathers
+    };
+
+    Filter m_filter;
+    CpuIsa m_isa;
+    const CpuConvertKernels *m_kernels;
+
+    AVPixelFormat m_format {AV_PIX_FMT_NONE};
+    int m_src_width {};
+    int m_src_height {};
+    int m_dst_width {};
+    int m_dst_height {};
+    Plane m_luma {};
+    Plane m_chroma {};  // one table for both chroma planes, or for the interleaved NV12 plane
+    int m_chroma_width {};
+    bool m_semi_planar {false};
+    std::vector<uint8_t> m_y {};
+    std::vector<uint8_t> m_u {};
+    std::vector<uint8_t> m_v {};
+
+    void configure(AVPixelFormat format, int src_width, int src_height, int dst_width, int dst_height);
+
+    /**
+     *  @brief Filters the source rows of output row `y` into `plane.filtered`, `row_bytes` bytes wide.
+     */
+    void filterVertical(Plane &plane, const uint8_t *data, int linesize, int row_bytes, int y);
+
+    /**
+     *  @brief Filters `plane.filtered` into the output columns, reading every `step`th byte from `offset`.
+     */
+    void filterHorizontal(const Plane &plane, int step, int offset, uint8_t *dst);
+
+    static FilterTable makeFilter(Filter filter, int src_size, int dst_size);
+    static CpuYuvCoefficients getCoefficients(const AVFrame *frame);
+};
@@ -0,0 +1,266 @@
+#include "upload_thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/convert/yuv_converter.h"
+#include "trace/tracer.h"
+
+namespace {
+
+// Decode threads wait for mapped slots, so rings with slots still fenced are pumped this often even without tasks.
+constexpr auto kPumpInterval = std::chrono::milliseconds(1);
+
+}  // namespace
+
+UploadThread::Config UploadThread::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.enabled = config_manager->getIntValue("upload", "thread", config.enabled) != 0;
+    config.texture_sets = config_manager->getIntValue("upload", "texture_sets", config.texture_sets);
+    return config;
+}
+
+UploadThread::UploadThread(std::shared_ptr<GLContext> ctx, const Config &config) : m_ctx(ctx), m_config(config) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+    // One set stays on screen while another is written.
+    m_config.texture_sets = std::max<size_t>(m_config.texture_sets, 2);
+    m_shared_ctx = m_ctx->createSharedContext();
+
+    // Texture names are shared, so the sets are created here and used from both contexts.
+    for (size_t i = 0; i < m_config.texture_sets; ++i) {
+        auto set = std::make_unique<TextureSet>();
+        glCall(m_ctx, GenTextures, static_cast<GLsizei>(set->planes.size()), set->planes.data());
+        set->frame = allocFrame();
+        m_free.push_back(set.get());
+        m_sets.push_back(std::move(set));
+    }
+    // The names must exist before the other context uses them.
+    glCall(m_ctx, Flush);
+
+    m_thread = std::jthread {[this](std::stop_token stop) { run(stop); }};
+    DEBUG("created UploadThread: {} texture sets", m_config.texture_sets);
+}
+
+UploadThread::~UploadThread() {
+    m_thread.request_stop();
+    m_wakeup.notify_all();
+    m_thread.join();
+
+    for (auto &set : m_sets) {
+        if (set->uploaded) {
+            glCall(m_ctx, DeleteSync, set->uploaded);
+        }
+        if (set->released) {
+            glCall(m_ctx, DeleteSync, set->released);
+        }
+        m_ctx->getStateCache().deleteTextures(static_cast<GLsizei>(set->planes.size()), set->planes.data());
+    }
+    logStats();
+    DEBUG("release UploadThread: {}", (void *)this);
+}
+
+std::shared_ptr<PixelUploadRing> UploadThread::createRing(size_t slot_count, size_t slot_size) {
+    std::promise<PixelUploadRing *> created;
+    auto future = created.get_future();
+    post([this, &created, slot_count, slot_size] {
+        auto ring = m_shared_ctx->createPixelUploadRing(slot_count, slot_size);
+        ring->pump();
+        m_rings.push_back(ring);
+        created.set_value(ring.get());
+    });
+
+    // Not owning: the upload thread holds the ring and destroys it there, on its context.
+    return std::shared_ptr<PixelUploadRing> {future.get(), [this](PixelUploadRing *ring) {
+                                                 post([this, ring] {
+                                                     std::erase_if(m_rings, [ring](const auto &owned) {
+                                                         return owned.get() == ring;
+                                                     });
+                                                 });
+                                             }};
+}
+
+void UploadThread::upload(PixelUploadRing *ring, PixelUploadRing::Slot *slot, AVFramePtr frame) {
+    post([this, ring, slot, frame = std::move(frame)]() mutable { uploadSlot(ring, slot, std::move(frame)); });
+}
+
+void UploadThread::discard(PixelUploadRing *ring, PixelUploadRing::Slot *slot) {
+    post([ring, slot] { ring->discard(slot); });
+}
+
+const UploadThread::TextureSet *UploadThread::acquireLatest() {
+    TextureSet *latest = nullptr;
+    {
+        std::lock_guard lock {m_mutex};
+        if (m_uploaded.empty()) {
+            return nullptr;
+        }
+        latest = m_uploaded.back();
+        m_uploaded.pop_back();
+        // Never shown, so nothing on this side reads them.
+        m_superseded += m_uploaded.size();
+        m_free.insert(m_free.end(), m_uploaded.begin(), m_uploaded.end());
+        m_uploaded.clear();
+    }
+
+    // The GPU waits for the upload; this thread does not.
+    glCall(m_ctx, WaitSync, latest->uploaded, 0, GL_TIMEOUT_IGNORED);
+
+    if (m_current) {
+        // Covers every draw that read the set so far. Flushed, since the upload thread waits on it from its own
+        // context.
+        m_current->released = glCall(m_ctx, FenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glCall(m_ctx, Flush);
+        std::lock_guard lock {m_mutex};
+        m_free.push_back(m_current);
+    }
+    m_current = latest;
+    return latest;
+}
+
+UploadThread::Stats UploadThread::getStats() const {
+    std::lock_guard lock {m_mutex};
+    return {
+        m_uploads,
+        m_bytes_uploaded,
+        m_superseded,
+        m_uploads ? m_upload_seconds * 1000 / m_uploads : 0.0,
+        m_max_upload_seconds * 1000,
+    };
+}
+
+void UploadThread::logStats() const {
+    const auto stats = getStats();
+    INFO("upload thread: {} uploads, {:.1f} MB, {} superseded, {:.2f} ms mean {:.2f} ms max",
+         stats.uploads,
+         stats.bytes_uploaded / double(1 << 20),
+         stats.superseded,
+         stats.mean_upload_ms,
+         stats.max_upload_ms);
+}
+
+void UploadThread::post(Task task) {
+    {
+        std::lock_guard lock {m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+    m_wakeup.notify_one();
+}
+
+void UploadThread::run(std::stop_token stop) {
+    Tracer::get()->setThreadName("upload");
+    m_shared_ctx->makeCurrentContext();
+
+    bool fenced = false;
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock {m_mutex};
+            auto has_tasks = [this] { return !m_tasks.empty(); };
+            // Idle players leave this thread asleep.
+            if (fenced) {
+                m_wakeup.wait_for(lock, stop, kPumpInterval, has_tasks);
+            } else {
+                m_wakeup.wait(lock, stop, has_tasks);
+            }
+        }
+        fenced = runTasks();
+    }
+
+    // What was handed over before the stop still runs, ring releases included.
+    runTasks();
+    m_rings.clear();
+    glCall(m_shared_ctx, Finish);
+    GLContext::resetCurrentContext();
+}
+
+bool UploadThread::runTasks() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard lock {m_mutex};
+        tasks.swap(m_tasks);
+    }
+    for (auto &task : tasks) {
+        task();
+    }
+
+    bool fenced = false;
+    for (const auto &ring : m_rings) {
+        ring->pump();
+        // Slots the writer could not stage come back through the filled queue.
+        while (auto slot = ring->tryPopFilled()) {
+            ring->discard(slot);
+        }
+        fenced |= ring->getIdleCount() > 0;
+    }
+    return fenced;
+}
+
+void UploadThread::uploadSlot(PixelUploadRing *ring, PixelUploadRing::Slot *slot, AVFramePtr frame) {
+    TRACE_ZONE("upload thread upload");
+    const auto start = std::chrono::steady_clock::now();
+
+    TextureSet *set = acquireFreeSet();
+    // Set fences were created on either context; both belong to the share group.
+    if (set->released) {
+        glCall(m_shared_ctx, WaitSync, set->released, 0, GL_TIMEOUT_IGNORED);
+        glCall(m_shared_ctx, DeleteSync, set->released);
+        set->released = nullptr;
+    }
+    if (set->uploaded) {
+        glCall(m_shared_ctx, DeleteSync, set->uploaded);
+        set->uploaded = nullptr;
+    }
+
+    AVFrame *props = set->frame.get();
+    if (props->format != frame->format || props->width != frame->width || props->height != frame->height) {
+        YuvConverter::allocateTextures(m_shared_ctx.get(), frame.get(), set->planes);
+    }
+    for (size_t i = 0; i < slot->region_count; ++i) {
+        slot->regions[i].texture = set->planes[i];
+    }
+    const size_t bytes = slot->size;
+    ring->upload(slot);
+    set->uploaded = glCall(m_shared_ctx, FenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // The render thread waits on the fence from its own context.
+    glCall(m_shared_ctx, Flush);
+
+    av_frame_unref(props);
+    props->format = frame->format;
+    props->width = frame->width;
+    props->height = frame->height;
+    av_frame_copy_props(props, frame.get());
+    set->pts = frame->best_effort_timestamp;
+    frame.reset();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard lock {m_mutex};
+        m_uploaded.push_back(set);
+        ++m_uploads;
+        m_bytes_uploaded += bytes;
+        m_upload_seconds += seconds;
+        m_max_upload_seconds = std::max(m_max_upload_seconds, seconds);
+    }
+    // Wakes the render loop if it sleeps in the event wait.
+    glfwPostEmptyEvent();
+}
+
+UploadThread::TextureSet *UploadThread::acquireFreeSet() {
+    std::lock_guard lock {m_mutex};
+    if (m_free.empty()) {
+        ++m_superseded;
+        TextureSet *set = m_uploaded.front();
+        m_uploaded.pop_front();
+        return set;
+    }
+    TextureSet *set = m_free.back();
+    m_free.pop_back();
+    return set;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/delegate.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "render/context/pixel_upload_ring.h"
+
+class GLContext;
+
+/**
+ *  @class UploadThread
+ *
+ *  @brief Uploads staged frames into plane textures on a dedicated thread with its own shared GL context, so the
+ *         render thread's frame time does not depend on the upload size.
+ *
+ *  The thread owns the upload rings it creates: it maps their slots, uploads and recycles them. Decode threads
+ *  stage into the rings exactly as before. The render thread only hands over slots to upload or discard, and
+ *  picks up finished frames with `acquireLatest`.
+ *
+ *  Frames are uploaded into a small pool of texture sets. Each handoff is fenced in both directions:
+ *  - the upload thread fences every upload, and the render thread makes the GPU wait on that fence (`glWaitSync`)
+ *    before drawing, without blocking the CPU;
+ *  - when the render thread moves on to a newer set, it fences the old one, and the upload thread waits on that
+ *    fence before writing into the set again.
+ *  Uploaded sets the render thread has not picked up yet are superseded by newer ones and recycled.
+ *
+ *  @note Created, used and destroyed on the render thread, with the parent context current. Rings must be
+ *        released before the upload thread.
+ */
+class UploadThread {
+public:
+    NONCOPYABLE(UploadThread)
+    NONMOVABLE(UploadThread)
+
+    struct Config {
+        bool enabled {true};
+        size_t texture_sets {3};  // one on screen, one being uploaded, one spare
+
+        /**
+         *  @brief Reads the `[upload]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct TextureSet {
+        std::array<GLuint, 3> planes {};
+        AVFramePtr frame {};  // format, size and colour properties of the uploaded frame, without its pixels
+        int64_t pts {};
+        GLsync uploaded {};   // signaled once the upload is complete
+        GLsync released {};   // signaled once the render thread no longer reads the set
+    };
+
+    struct Stats {
+        uint64_t uploads;
+        uint64_t bytes_uploaded;
+        uint64_t superseded;       // uploaded sets replaced by a newer one before the render thread picked them up
+        double mean_upload_ms;     // time the upload thread spent per frame
+        double max_upload_ms;
+    };
+
+    /**
+     *  @brief Creates the shared context and starts the thread.
+     *
+     *  @note Must be called from the main thread, with `ctx` current.
+     */
+    UploadThread(std::shared_ptr<GLContext> ctx, const Config &config);
+
+    /**
+     *  @brief Stops the thread after it ran everything handed over so far, and releases its GL objects.
+     */
+    ~UploadThread();
+
+    /**
+     *  @brief Creates an upload ring owned by the upload thread, and waits until it is ready.
+     *
+     *  @return The ring, to be written by one writer thread. Releasing the last reference destroys it on the upload
+     *          thread.
+     */
+    std::shared_ptr<PixelUploadRing> createRing(size_t slot_count, size_t slot_size);
+
+    /**
+     *  @brief Uploads a slot of `ring` filled by `YuvConverter::stage` into a free texture set.
+     *
+     *  @param frame The staged frame; only its properties are kept.
+     */
+    void upload(PixelUploadRing *ring, PixelUploadRing::Slot *slot, AVFramePtr frame);
+
+    /**
+     *  @brief Returns a filled slot to the writer without uploading it.
+     */
+    void discard(PixelUploadRing *ring, PixelUploadRing::Slot *slot);
+
+    /**
+     *  @return The most recently uploaded set, if one finished since the last call, or nullptr. The set stays
+     *          valid until the next call that returns a set.
+     *
+     *  @note Issues the `glWaitSync` for the upload, so the set can be drawn right away.
+     */
+    const TextureSet *acquireLatest();
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    using Task = Delegate<void()>;
+
+    std::shared_ptr<GLContext> m_ctx {};         // the render thread's
+    std::shared_ptr<GLContext> m_shared_ctx {};  // current on the upload thread
+    Config m_config {};
+
+    mutable std::mutex m_mutex {};
+    std::condition_variable_any m_wakeup {};
+    std::vector<Task> m_tasks {};                // guarded by m_mutex
+    std::deque<TextureSet *> m_uploaded {};      // guarded by m_mutex, oldest first
+    std::vector<TextureSet *> m_free {};         // guarded by m_mutex
+
+    std::vector<std::unique_ptr<TextureSet>> m_sets {};
+    TextureSet *m_current {};                    // on screen, render thread only
+
+    // Upload thread only.
+    std::vector<std::shared_ptr<PixelUploadRing>> m_rings {};
+
+    // Guarded by m_mutex.
+    uint64_t m_uploads {};
+    uint64_t m_bytes_uploaded {};
+    uint64_t m_superseded {};
+    double m_upload_seconds {};
+    double m_max_upload_seconds {};
+
+    // Declared last so the thread is joined before anything it touches is destroyed.
+    std::jthread m_thread {};
+
+    void post(Task task);
+
+    void run(std::stop_token stop);
+
+    /**
+     *  @brief Runs the queued tasks, then recycles the slots of every ring.
+     *
+     *  @return true if some slot is still waiting for its fence.
+     */
+    bool runTasks();
+
+    void uploadSlot(PixelUploadRing *ring, PixelUploadRing::Slot *slot, AVFramePtr frame);
+
+    /**
+     *  @return A set the render thread is done with, taking back the oldest superseded one if none is free.
+     */
+    TextureSet *acquireFreeSet();
+};
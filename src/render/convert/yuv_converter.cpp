@@ -0,0 +1,438 @@
+#include "yuv_converter.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/gpu_tracer.h"
+#include "render/context/shader_program.h"
+
+namespace {
+
+const char *kVertexShader = R"(#version 410 core
+out vec2 v_uv;
+
+void main() {
+    // Single triangle covering the viewport; row 0 of the frame maps to the top.
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    v_uv = vec2(pos.x, 1.0 - pos.y);
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char *kFragmentShader = R"(#version 410 core
+in vec2 v_uv;
+out vec4 o_color;
+
+uniform sampler2D u_plane0;
+uniform sampler2D u_plane1;
+uniform sampler2D u_plane2;
+uniform bool u_semi_planar;
+uniform mat3 u_matrix;
+uniform vec3 u_offset;
+
+void main() {
+    vec3 yuv;
+    yuv.x = texture(u_plane0, v_uv).r;
+    if (u_semi_planar) {
+        yuv.yz = texture(u_plane1, v_uv).rg;
+    } else {
+        yuv.yz = vec2(texture(u_plane1, v_uv).r, texture(u_plane2, v_uv).r);
+    }
+    o_color = vec4(clamp(u_matrix * yuv + u_offset, 0.0, 1.0), 1.0);
+}
+)";
+
+struct PlaneLayout {
+    int plane_count;
+    int bytes_per_sample;
+    int log2_chroma_w;
+    int log2_chroma_h;
+    int depth;
+    int shift;
+};
+
+bool getPlaneLayout(AVPixelFormat format, PlaneLayout *layout) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    if (!desc) {
+        return false;
+    }
+
+    constexpr uint64_t unsupported_flags = AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BE |
+                                           AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                                           AV_PIX_FMT_FLAG_FLOAT;
+    if ((desc->flags & unsupported_flags) || !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || desc->nb_components != 3) {
+        return false;
+    }
+
+    int plane_count = av_pix_fmt_count_planes(format);
+    if (plane_count == 2) {
+        // Interleaved chroma must be in U, V order (NV12, P010), which excludes NV21.
+        if (desc->comp[1].plane != 1 || desc->comp[2].plane != 1 || desc->comp[2].offset < desc->comp[1].offset) {
+            return false;
+        }
+    } else if (plane_count != 3) {
+        return false;
+    }
+
+    int depth = desc->comp[0].depth;
+    if (depth > 16) {
+        return false;
+    }
+
+    *layout = {
+        plane_count,
+        depth > 8 ? 2 : 1,
+        desc->log2_chroma_w,
+        desc->log2_chroma_h,
+        depth,
+        desc->comp[0].shift,
+    };
+    return true;
+}
+
+struct PlaneSize {
+    int width;
+    int height;
+    int components;
+};
+
+PlaneSize getPlaneSize(const PlaneLayout &layout, int plane, int width, int height) {
+    if (plane == 0) {
+        return {width, height, 1};
+    }
+    return {
+        -((-width) >> layout.log2_chroma_w),
+        -((-height) >> layout.log2_chroma_h),
+        layout.plane_count == 2 ? 2 : 1,
+    };
+}
+
+}  // namespace
+
+YuvConverter::YuvConverter(std::shared_ptr<GLContext> ctx) : m_ctx(ctx) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+
+    m_program = ShaderProgram::create(ctx, kVertexShader, kFragmentShader);
+    m_program->use();
+    glCall(m_ctx, Uniform1i, m_program->getUniformLocation("u_plane0"), 0);
+    glCall(m_ctx, Uniform1i, m_program->getUniformLocation("u_plane1"), 1);
+    glCall(m_ctx, Uniform1i, m_program->getUniformLocation("u_plane2"), 2);
+    m_matrix_location = m_program->getUniformLocation("u_matrix");
+    m_offset_location = m_program->getUniformLocation("u_offset");
+    m_semi_planar_location = m_program->getUniformLocation("u_semi_planar");
+
+    // Core profile refuses to draw without a bound VAO, even though the triangle has no attributes.
+    glCall(m_ctx, GenVertexArrays, 1, &m_vao);
+    glCall(m_ctx, GenTextures, static_cast<GLsizei>(m_planes.size()), m_planes.data());
+}
+
+YuvConverter::~YuvConverter() {
+    m_ctx->getStateCache().deleteTextures(static_cast<GLsizei>(m_planes.size()), m_planes.data());
+    m_ctx->getStateCache().deleteVertexArrays(1, &m_vao);
+    DEBUG("release YuvConverter: {}", (void *)this);
+}
+
+bool YuvConverter::isSupported(AVPixelFormat format) {
+    PlaneLayout layout;
+    return getPlaneLayout(format, &layout);
+}
+
+size_t YuvConverter::getStagingSize(AVPixelFormat format, int width, int height) {
+    PlaneLayout layout;
+    if (!getPlaneLayout(format, &layout)) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (int plane = 0; plane < layout.plane_count; ++plane) {
+        auto plane_size = getPlaneSize(layout, plane, width, height);
+        size += static_cast<size_t>(plane_size.width) * plane_size.components * layout.bytes_per_sample *
+                plane_size.height;
+    }
+    return size;
+}
+
+bool YuvConverter::stage(PixelUploadRing::Slot *slot, const AVFrame *frame) {
+    TRACE_ZONE("stage frame");
+    PlaneLayout layout;
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    if (!getPlaneLayout(format, &layout) || getStagingSize(format, frame->width, frame->height) > slot->capacity) {
+        return false;
+    }
+
+    size_t offset = 0;
+    for (int plane = 0; plane < layout.plane_count; ++plane) {
+        auto plane_size = getPlaneSize(layout, plane, frame->width, frame->height);
+        int bytewidth = plane_size.width * plane_size.components * layout.bytes_per_sample;
+        av_image_copy_plane(slot->data + offset,
+                            bytewidth,
+                            frame->data[plane],
+                            frame->linesize[plane],
+                            bytewidth,
+                            plane_size.height);
+
+        // The texture is filled in by `upload`, which owns the plane textures.
+        slot->regions[plane] = {
+            0,
+            0,
+            0,
+            plane_size.width,
+            plane_size.height,
+            static_cast<GLenum>(plane_size.components == 2 ? GL_RG : GL_RED),
+            static_cast<GLenum>(layout.bytes_per_sample == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE),
+            offset,
+            0,
+        };
+        offset += static_cast<size_t>(bytewidth) * plane_size.height;
+    }
+    slot->region_count = layout.plane_count;
+    slot->size = offset;
+    slot->pts = frame->best_effort_timestamp;
+    return true;
+}
+
+void YuvConverter::upload(PixelUploadRing &ring, PixelUploadRing::Slot *slot, const AVFrame *frame) {
+    configure(frame);
+    if (frame->format != m_planes_format || frame->width != m_planes_width || frame->height != m_planes_height) {
+        allocateTextures(m_ctx.get(), frame, m_planes);
+        m_planes_format = static_cast<AVPixelFormat>(frame->format);
+        m_planes_width = frame->width;
+        m_planes_height = frame->height;
+    }
+    m_draw_planes = m_planes;
+    for (size_t i = 0; i < slot->region_count; ++i) {
+        slot->regions[i].texture = m_planes[i];
+    }
+    ring.upload(slot);
+}
+
+void YuvConverter::setFrame(const std::array<GLuint, 3> &planes, const AVFrame *frame) {
+    configure(frame);
+    m_draw_planes = planes;
+    // Storage another context respecified only becomes visible here once the texture is bound again.
+    for (int plane = 0; plane < m_plane_count; ++plane) {
+        m_ctx->getStateCache().bindTexture(plane, GL_TEXTURE_2D, 0);
+    }
+}
+
+bool YuvConverter::allocateTextures(GLContext *ctx, const AVFrame *frame, const std::array<GLuint, 3> &planes) {
+    PlaneLayout layout;
+    if (!getPlaneLayout(static_cast<AVPixelFormat>(frame->format), &layout)) {
+        return false;
+    }
+
+    for (int plane = 0; plane < layout.plane_count; ++plane) {
+        auto plane_size = getPlaneSize(layout, plane, frame->width, frame->height);
+        GLint internal_format;
+        if (plane_size.components == 2) {
+            internal_format = layout.bytes_per_sample == 2 ? GL_RG16 : GL_RG8;
+        } else {
+            internal_format = layout.bytes_per_sample == 2 ? GL_R16 : GL_R8;
+        }
+
+        ctx->getStateCache().bindTexture(0, GL_TEXTURE_2D, planes[plane]);
+        glCall(ctx,
+               TexImage2D,
+               GL_TEXTURE_2D,
+               0,
+               internal_format,
+               plane_size.width,
+               plane_size.height,
+               0,
+               plane_size.components == 2 ? GL_RG : GL_RED,
+               layout.bytes_per_sample == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE,
+               nullptr);
+        glCall(ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glCall(ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glCall(ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glCall(ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    return true;
+}
+
+void YuvConverter::draw(int framebuffer_width, int framebuffer_height) {
+    int x, y, width, height;
+    if (!getDisplayRect(framebuffer_width, framebuffer_height, &x, &y, &width, &height)) {
+        return;
+    }
+    m_ctx->getStateCache().viewport(x, y, width, height);
+    drawFullViewport();
+}
+
+bool YuvConverter::getDisplayRect(int framebuffer_width,
+                                  int framebuffer_height,
+                                  int *x,
+                                  int *y,
+                                  int *width,
+                                  int *height) const {
+    if (!hasFrame() || framebuffer_width <= 0 || framebuffer_height <= 0) {
+        return false;
+    }
+
+    double sar = m_sample_aspect_ratio.num > 0 ? av_q2d(m_sample_aspect_ratio) : 1.0;
+    double frame_aspect = m_width * sar / m_height;
+    double framebuffer_aspect = static_cast<double>(framebuffer_width) / framebuffer_height;
+
+    *width = framebuffer_width;
+    *height = framebuffer_height;
+    if (frame_aspect > framebuffer_aspect) {
+        *height = static_cast<int>(framebuffer_width / frame_aspect);
+    } else {
+        *width = static_cast<int>(framebuffer_height * frame_aspect);
+    }
+    *x = (framebuffer_width - *width) / 2;
+    *y = (framebuffer_height - *height) / 2;
+    return true;
+}
+
+void YuvConverter::drawFullViewport() {
+    if (!hasFrame()) {
+        return;
+    }
+    TRACE_GPU_ZONE(m_ctx, "yuv convert");
+
+    // Bindings are left in place; the state cache makes rebinding them next frame free.
+    auto &state = m_ctx->getStateCache();
+    m_program->use();
+    for (int plane = 0; plane < m_plane_count; ++plane) {
+        state.bindTexture(plane, GL_TEXTURE_2D, m_draw_planes[plane]);
+    }
+    state.bindVertexArray(m_vao);
+    glCall(m_ctx, DrawArrays, GL_TRIANGLES, 0, 3);
+}
+
+YuvConverter::ColorMatrix YuvConverter::getColorMatrix(const AVFrame *frame) {
+    switch (frame->colorspace) {
+        case AVCOL_SPC_BT709:
+            return ColorMatrix::BT709;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+            return ColorMatrix::BT601;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            return ColorMatrix::BT2020;
+        default:
+            // Untagged content: assume HD and above is BT.709, like most players do.
+            return frame->height >= 720 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+    }
+}
+
+YuvConverter::ColorRange YuvConverter::getColorRange(const AVFrame *frame) {
+    switch (frame->color_range) {
+        case AVCOL_RANGE_JPEG:
+            return ColorRange::Full;
+        case AVCOL_RANGE_MPEG:
+            return ColorRange::Limited;
+        default: {
+            auto format = static_cast<AVPixelFormat>(frame->format);
+            bool jpeg_format = format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_YUVJ422P ||
+                               format == AV_PIX_FMT_YUVJ444P;
+            return jpeg_format ? ColorRange::Full : ColorRange::Limited;
+        }
+    }
+}
+
+void YuvConverter::configure(const AVFrame *frame) {
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    auto matrix = getColorMatrix(frame);
+    auto range = getColorRange(frame);
+    m_sample_aspect_ratio = frame->sample_aspect_ratio;
+
+    if (format == m_format && frame->width == m_width && frame->height == m_height) {
+        if (matrix != m_matrix || range != m_range) {
+            m_matrix = matrix;
+            m_range = range;
+            updateColorUniforms();
+        }
+        return;
+    }
+
+    PlaneLayout layout;
+    if (!getPlaneLayout(format, &layout)) {
+        FATAL("unsupported pixel format: {}", av_get_pix_fmt_name(format));
+    }
+
+    m_format = format;
+    m_width = frame->width;
+    m_height = frame->height;
+    m_matrix = matrix;
+    m_range = range;
+    m_plane_count = layout.plane_count;
+
+    m_program->use();
+    glCall(m_ctx, Uniform1i, m_semi_planar_location, layout.plane_count == 2);
+    updateColorUniforms();
+
+    INFO("YuvConverter configured for {} {}x{}", av_get_pix_fmt_name(format), m_width, m_height);
+}
+
+void YuvConverter::updateColorUniforms() {
+    PlaneLayout layout;
+    getPlaneLayout(m_format, &layout);
+
+    double kr, kb;
+    switch (m_matrix) {
+        case ColorMatrix::BT601:
+            kr = 0.299, kb = 0.114;
+            break;
+        case ColorMatrix::BT2020:
+            kr = 0.2627, kb = 0.0593;
+            break;
+        case ColorMatrix::BT709:
+        default:
+            kr = 0.2126, kb = 0.0722;
+            break;
+    }
+    double kg = 1.0 - kr - kb;
+
+    // Texture samples are normalized to the container (8 or 16 bits) and may be MSB-aligned (P010), so first
+    // recover the integer code value, then map it to Y in [0, 1] and Cb/Cr in [-0.5, 0.5].
+    double texel_max = layout.bytes_per_sample == 2 ? 65535.0 : 255.0;
+    double code_scale = texel_max / (1 << layout.shift);
+    double depth_scale = 1 << (layout.depth - 8);
+
+    double luma_scale, luma_offset, chroma_scale, chroma_offset;
+    if (m_range == ColorRange::Limited) {
+        luma_scale = code_scale / (219.0 * depth_scale);
+        luma_offset = -16.0 / 219.0;
+        chroma_scale = code_scale / (224.0 * depth_scale);
+        chroma_offset = -128.0 / 224.0;
+    } else {
+        double code_max = (1 << layout.depth) - 1.0;
+        luma_scale = code_scale / code_max;
+        luma_offset = 0.0;
+        chroma_scale = code_scale / code_max;
+        chroma_offset = -(1 << (layout.depth - 1)) / code_max;
+    }
+
+    // Row-major YCbCr -> RGB matrix.
+    const double yuv_to_rgb[3][3] {
+        {1.0, 0.0, 2.0 * (1.0 - kr)},
+        {1.0, -2.0 * kb * (1.0 - kb) / kg, -2.0 * kr * (1.0 - kr) / kg},
+        {1.0, 2.0 * (1.0 - kb), 0.0},
+    };
+    const double scale[3] {luma_scale, chroma_scale, chroma_scale};
+    const double offset[3] {luma_offset, chroma_offset, chroma_offset};
+
+    // Fold the range expansion into the matrix: rgb = M * (S * t + o) = (M * S) * t + M * o.
+    GLfloat matrix[9];
+    GLfloat bias[3];
+    for (int row = 0; row < 3; ++row) {
+        bias[row] = 0.0f;
+        for (int col = 0; col < 3; ++col) {
+            matrix[row * 3 + col] = static_cast<GLfloat>(yuv_to_rgb[row][col] * scale[col]);
+            bias[row] += static_cast<GLfloat>(yuv_to_rgb[row][col] * offset[col]);
+        }
+    }
+
+    m_program->use();
+    glCall(m_ctx, UniformMatrix3fv, m_matrix_location, 1, GL_TRUE, matrix);
+    glCall(m_ctx, Uniform3fv, m_offset_location, 1, bias);
+}
\ No newline at end of file
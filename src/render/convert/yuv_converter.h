@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "render/context/pixel_upload_ring.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+class GLContext;
+class ShaderProgram;
+
+/**
+ *  @class YuvConverter
+ *
+ *  @brief Converts planar and semi-planar YUV frames to RGB in a fragment shader.
+ *
+ *  Every plane is uploaded as its own single-channel (or two-channel for interleaved chroma) texture, so no
+ *  colour conversion happens on the CPU. Handles 8-bit planar (yuv420p/422p/444p), NV12, and 10/12/16-bit
+ *  formats in either LSB (yuv420p10) or MSB (P010) alignment, with BT.601, BT.709 and BT.2020 matrices in
+ *  limited or full range.
+ *
+ *  Staging is split from uploading: `stage` only copies pixels into a mapped PixelUploadRing slot and can run on
+ *  a decode thread, while `upload` and `draw` run on the GL thread. Planes uploaded elsewhere (on a shared
+ *  context, see UploadThread) are drawn with `setFrame` instead of `upload`.
+ */
+class YuvConverter {
+public:
+    NONCOPYABLE(YuvConverter)
+    NONMOVABLE(YuvConverter)
+
+    enum class ColorMatrix { BT601, BT709, BT2020 };
+
+    enum class ColorRange { Limited, Full };
+
+    explicit YuvConverter(std::shared_ptr<GLContext> ctx);
+    ~YuvConverter();
+
+    /**
+     *  @return true if frames of this pixel format can be converted.
+     */
+    static bool isSupported(AVPixelFormat format);
+
+    /**
+     *  @return The number of bytes `stage` needs for a frame of this format and size, or 0 if unsupported.
+     */
+    static size_t getStagingSize(AVPixelFormat format, int width, int height);
+
+    /**
+     *  @brief Copies the planes of `frame` into `slot` and describes them as upload regions.
+     *
+     *  @return false if the format is unsupported or the slot is too small.
+     *
+     *  @note Safe to call from any thread that owns `slot`.
+     */
+    static bool stage(PixelUploadRing::Slot *slot, const AVFrame *frame);
+
+    /**
+     *  @brief Uploads a slot filled by `stage` into the plane textures, reallocating them if the format changed.
+     *
+     *  @param frame The frame that was staged; only its format, size and colour properties are read.
+     */
+    void upload(PixelUploadRing &ring, PixelUploadRing::Slot *slot, const AVFrame *frame);
+
+    /**
+     *  @brief Draws from plane textures filled by another context of the share group from now on.
+     *
+     *  @param planes Textures allocated by `allocateTextures` for `frame`.
+     *  @param frame Only its format, size and colour properties are read.
+     *
+     *  @note The upload must be complete on the GPU before the next draw, e.g. by a `glWaitSync` on its fence.
+     */
+    void setFrame(const std::array<GLuint, 3> &planes, const AVFrame *frame);
+
+    /**
+     *  @brief (Re)allocates plane textures for frames of the format and size of `frame`.
+     *
+     *  @return false if the format is unsupported.
+     *
+     *  @note `ctx` must be current on the calling thread.
+     */
+    static bool allocateTextures(GLContext *ctx, const AVFrame *frame, const std::array<GLuint, 3> &planes);
+
+    /**
+     *  @brief Draws the last uploaded frame, letterboxed into a framebuffer of the given size.
+     */
+    void draw(int framebuffer_width, int framebuffer_height);
+
+    /**
+     *  @brief Computes where `draw` puts the picture in a framebuffer of the given size. The rectangle is centred,
+     *         so `y` is the same counted from the top or from the bottom.
+     *
+     *  @return false if there is no frame to draw.
+     */
+    bool getDisplayRect(int framebuffer_width, int framebuffer_height, int *x, int *y, int *width, int *height) const;
+
+    /**
+     *  @brief Draws the last uploaded frame into the currently set viewport.
+     */
+    void drawFullViewport();
+
+    bool hasFrame() const { return m_format != AV_PIX_FMT_NONE; }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    /**
+     *  @return The matrix and range that will be used for `frame`, filling in defaults for unspecified values.
+     */
+    static ColorMatrix getColorMatrix(const AVFrame *frame);
+    static ColorRange getColorRange(const AVFrame *frame);
+
+private:
+    std::shared_ptr<GLContext> m_ctx {};
+    std::shared_ptr<ShaderProgram> m_program {};
+    GLuint m_vao {};
+    std::array<GLuint, 3> m_planes {};
+    std::array<GLuint, 3> m_draw_planes {};  // m_planes, or the textures given to `setFrame`
+
+    // What m_planes are allocated for.
+    AVPixelFormat m_planes_format {AV_PIX_FMT_NONE};
+    int m_planes_width {};
+    int m_planes_height {};
+
+    // The frame being drawn.
+    AVPixelFormat m_format {AV_PIX_FMT_NONE};
+    int m_width {};
+    int m_height {};
+    AVRational m_sample_aspect_ratio {0, 1};
+    ColorMatrix m_matrix {ColorMatrix::BT709};
+    ColorRange m_range {ColorRange::Limited};
+    int m_plane_count {};
+
+    GLint m_matrix_location {-1};
+    GLint m_offset_location {-1};
+    GLint m_semi_planar_location {-1};
+
+    void configure(const AVFrame *frame);
+    void updateColorUniforms();
+};
\ No newline at end of file
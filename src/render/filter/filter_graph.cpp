@@ -0,0 +1,420 @@
+#include "filter_graph.h"
+
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/gpu_tracer.h"
+#include "render/context/shader_program.h"
+
+namespace {
+
+const char *kVertexShader = R"(#version 410 core
+out vec2 v_uv;
+
+void main() {
+    // Single triangle covering the viewport, in GL texture orientation.
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    v_uv = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char *kScaleSource = R"(
+vec4 $weights(float t) {
+    // Catmull-Rom weights of the taps at -1, 0, 1 and 2.
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return vec4(-0.5 * t3 + t2 - 0.5 * t,
+                1.5 * t3 - 2.5 * t2 + 1.0,
+                -1.5 * t3 + 2.0 * t2 + 0.5 * t,
+                0.5 * t3 - 0.5 * t2);
+}
+
+vec4 $apply(sampler2D src, vec2 uv) {
+    ivec2 size = textureSize(src, 0);
+    vec2 pos = uv * vec2(size) - 0.5;
+    vec2 base = floor(pos);
+    vec4 wx = $weights(pos.x - base.x);
+    vec4 wy = $weights(pos.y - base.y);
+    vec4 color = vec4(0.0);
+    for (int j = 0; j < 4; ++j) {
+        vec4 row = vec4(0.0);
+        for (int i = 0; i < 4; ++i) {
+            ivec2 texel = clamp(ivec2(base) + ivec2(i - 1, j - 1), ivec2(0), size - 1);
+            row += wx[i] * texelFetch(src, texel, 0);
+        }
+        color += wy[j] * row;
+    }
+    return clamp(color, 0.0, 1.0);
+}
+)";
+
+const char *kSharpenSource = R"(
+uniform float $strength;
+
+vec4 $apply(sampler2D src, vec2 uv) {
+    vec2 texel = 1.0 / vec2(textureSize(src, 0));
+    vec4 center = texture(src, uv);
+    vec4 edges = texture(src, uv + vec2(texel.x, 0.0)) + texture(src, uv - vec2(texel.x, 0.0)) +
+                 texture(src, uv + vec2(0.0, texel.y)) + texture(src, uv - vec2(0.0, texel.y));
+    vec4 corners = texture(src, uv + texel) + texture(src, uv - texel) +
+                   texture(src, uv + vec2(texel.x, -texel.y)) + texture(src, uv + vec2(-texel.x, texel.y));
+    vec4 blur = (4.0 * center + 2.0 * edges + corners) / 16.0;
+    return vec4(clamp(center.rgb + $strength * (center.rgb - blur.rgb), 0.0, 1.0), center.a);
+}
+)";
+
+const char *kLutSource = R"(
+uniform sampler3D $lut;
+uniform float $size;
+
+vec4 $apply(vec4 color, vec2 uv) {
+    // Entries sit at texel centres: 0 and 1 map onto the first and the last one.
+    vec3 coord = clamp(color.rgb, 0.0, 1.0) * (($size - 1.0) / $size) + 0.5 / $size;
+    return vec4(texture($lut, coord).rgb, color.a);
+}
+)";
+
+const char *kOverlaySource = R"(
+uniform sampler2D $overlay;
+uniform float $opacity;
+
+vec4 $apply(vec4 color, vec2 uv) {
+    vec4 overlay = texture($overlay, uv) * $opacity;
+    return vec4(overlay.rgb + color.rgb * (1.0 - overlay.a), color.a);
+}
+)";
+
+std::string replacePlaceholder(const std::string &source, const std::string &prefix) {
+    std::string result;
+    result.reserve(source.size() + prefix.size() * 8);
+    for (char c : source) {
+        if (c == '$') {
+            result += prefix;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+FilterGraph::FilterGraph(std::shared_ptr<GLContext> ctx, std::shared_ptr<RenderTargetPool> pool)
+    : m_ctx(ctx), m_pool(pool), m_owns_pool(!pool) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+    if (!m_pool) {
+        m_pool = std::make_shared<RenderTargetPool>(ctx);
+    }
+    // Core profile refuses to draw without a bound VAO, even though the triangle has no attributes.
+    glCall(m_ctx, GenVertexArrays, 1, &m_vao);
+}
+
+FilterGraph::~FilterGraph() {
+    if (m_output) {
+        m_pool->release(m_output);
+    }
+    for (const auto &run : m_pending) {
+        glCall(m_ctx, DeleteQueries, static_cast<GLsizei>(run.queries.size()), run.queries.data());
+    }
+    glCall(m_ctx, DeleteQueries, static_cast<GLsizei>(m_free_queries.size()), m_free_queries.data());
+    m_ctx->getStateCache().deleteVertexArrays(1, &m_vao);
+    DEBUG("release FilterGraph: {}", (void *)this);
+}
+
+FilterGraph::PassId FilterGraph::addPass(PassDesc desc) {
+    const PassId id = m_passes.size();
+    m_passes.push_back({std::move(desc), "p" + std::to_string(id) + "_", {}});
+    m_dirty = true;
+    return id;
+}
+
+FilterGraph::PassId FilterGraph::addScale(int width, int height) {
+    return addPass({"scale", PassType::Sampling, kScaleSource, width, height});
+}
+
+FilterGraph::PassId FilterGraph::addSharpen(float strength) {
+    const PassId id = addPass({"sharpen", PassType::Sampling, kSharpenSource});
+    setUniform(id, "strength", strength);
+    return id;
+}
+
+FilterGraph::PassId FilterGraph::addLut(GLuint lut, int size) {
+    const PassId id = addPass({"lut", PassType::Pointwise, kLutSource});
+    setTexture(id, "lut", GL_TEXTURE_3D, lut);
+    setUniform(id, "size", static_cast<float>(size));
+    return id;
+}
+
+FilterGraph::PassId FilterGraph::addOverlay(GLuint texture, float opacity) {
+    const PassId id = addPass({"overlay", PassType::Pointwise, kOverlaySource});
+    setTexture(id, "overlay", GL_TEXTURE_2D, texture);
+    setUniform(id, "opacity", opacity);
+    return id;
+}
+
+void FilterGraph::setUniform(PassId pass, const std::string &name, float value) {
+    auto &uniform = findUniform(pass, name);
+    uniform.components = 1;
+    uniform.value = {value, 0.0f, 0.0f, 0.0f};
+}
+
+void FilterGraph::setUniform(PassId pass, const std::string &name, float x, float y) {
+    auto &uniform = findUniform(pass, name);
+    uniform.components = 2;
+    uniform.value = {x, y, 0.0f, 0.0f};
+}
+
+void FilterGraph::setUniform(PassId pass, const std::string &name, float x, float y, float z, float w) {
+    auto &uniform = findUniform(pass, name);
+    uniform.components = 4;
+    uniform.value = {x, y, z, w};
+}
+
+void FilterGraph::setTexture(PassId pass, const std::string &name, GLenum target, GLuint texture) {
+    auto &uniform = findUniform(pass, name);
+    uniform.components = 0;
+    uniform.target = target;
+    uniform.texture = texture;
+}
+
+void FilterGraph::setFusion(bool enabled) {
+    if (m_fusion != enabled) {
+        m_fusion = enabled;
+        m_dirty = true;
+    }
+}
+
+const RenderTargetPool::RenderTarget *FilterGraph::run(GLuint input, int width, int height) {
+    if (m_passes.empty()) {
+        return nullptr;
+    }
+    if (m_dirty) {
+        build();
+    }
+    TRACE_GPU_ZONE(m_ctx, "filter graph");
+    collectTimings();
+
+    // The previous result has been consumed by now; its target can serve this run.
+    if (m_output) {
+        m_pool->release(m_output);
+        m_output = nullptr;
+    }
+
+    // Timestamps rather than elapsed-time queries, which cannot nest in the GPU tracer's zones.
+    PendingRun timing {m_generation, {}};
+    const bool timed = m_pending.size() < kMaxPendingRuns;
+    if (timed) {
+        timing.queries.push_back(acquireQuery());
+        glCall(m_ctx, QueryCounter, timing.queries.back(), GL_TIMESTAMP);
+    } else {
+        ++m_timing_dropped;
+    }
+
+    auto &state = m_ctx->getStateCache();
+    state.setBlend(false);
+    state.bindVertexArray(m_vao);
+
+    GLuint source = input;
+    const RenderTargetPool::RenderTarget *source_target = nullptr;
+    for (auto &stage : m_stages) {
+        const PassDesc &first = m_passes[stage.passes.front()].desc;
+        const bool resizes = first.type == PassType::Sampling && first.width > 0 && first.height > 0;
+        const int output_width = resizes ? first.width : width;
+        const int output_height = resizes ? first.height : height;
+        const auto *target = m_pool->acquire(output_width, output_height, first.format);
+
+        state.bindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+        state.viewport(0, 0, output_width, output_height);
+        stage.program->use();
+        state.bindTexture(0, GL_TEXTURE_2D, source);
+        bindUniforms(stage);
+        glCall(m_ctx, DrawArrays, GL_TRIANGLES, 0, 3);
+        if (timed) {
+            timing.queries.push_back(acquireQuery());
+            glCall(m_ctx, QueryCounter, timing.queries.back(), GL_TIMESTAMP);
+        }
+
+        if (source_target) {
+            m_pool->release(source_target);
+        }
+        source_target = target;
+        source = target->texture;
+        width = output_width;
+        height = output_height;
+    }
+    m_output = source_target;
+
+    if (timed) {
+        m_pending.push_back(std::move(timing));
+    }
+    ++m_runs;
+    // A shared pool is aged by its owner, once per frame rather than once per graph.
+    if (m_owns_pool) {
+        m_pool->endFrame();
+    }
+    return m_output;
+}
+
+std::vector<FilterGraph::StageTiming> FilterGraph::getTimings() const {
+    std::vector<StageTiming> timings;
+    for (const auto &stage : m_stages) {
+        timings.push_back({
+            stage.name,
+            stage.last_ms,
+            stage.samples ? stage.total_ms / stage.samples : 0.0,
+            stage.samples,
+        });
+    }
+    return timings;
+}
+
+FilterGraph::Stats FilterGraph::getStats() const {
+    return {
+        m_passes.size(),
+        m_stages.size(),
+        m_runs,
+        m_timing_dropped,
+        m_pool->getStats(),
+    };
+}
+
+FilterGraph::Uniform &FilterGraph::findUniform(PassId pass, const std::string &name) {
+    if (pass >= m_passes.size()) {
+        FATAL("invalid filter pass {}", pass);
+    }
+    auto &uniforms = m_passes[pass].uniforms;
+    for (auto &uniform : uniforms) {
+        if (uniform.name == name) {
+            return uniform;
+        }
+    }
+    uniforms.push_back({name, 1, {}, GL_TEXTURE_2D, 0});
+    return uniforms.back();
+}
+
+void FilterGraph::build() {
+    m_stages.clear();
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        const bool fuse = m_fusion && !m_stages.empty() && m_passes[i].desc.type == PassType::Pointwise;
+        if (!fuse) {
+            m_stages.emplace_back();
+        }
+        m_stages.back().passes.push_back(i);
+    }
+
+    for (auto &stage : m_stages) {
+        for (size_t pass : stage.passes) {
+            if (!stage.name.empty()) {
+                stage.name += '+';
+            }
+            stage.name += m_passes[pass].desc.name;
+            for (auto &uniform : m_passes[pass].uniforms) {
+                uniform.location = kUnresolved;
+            }
+        }
+        stage.program = ShaderProgram::create(m_ctx, kVertexShader, generateShader(stage));
+        stage.program->use();
+        glCall(m_ctx, Uniform1i, stage.program->getUniformLocation("u_input"), 0);
+    }
+
+    ++m_generation;
+    m_dirty = false;
+    DEBUG("built filter graph: {} passes in {} stages", m_passes.size(), m_stages.size());
+}
+
+std::string FilterGraph::generateShader(const Stage &stage) const {
+    std::string source = "#version 410 core\nin vec2 v_uv;\nout vec4 o_color;\nuniform sampler2D u_input;\n";
+    for (size_t pass : stage.passes) {
+        source += replacePlaceholder(m_passes[pass].desc.source, m_passes[pass].prefix);
+    }
+
+    source += "\nvoid main() {\n";
+    const Pass &first = m_passes[stage.passes.front()];
+    if (first.desc.type == PassType::Sampling) {
+        source += "    vec4 color = " + first.prefix + "apply(u_input, v_uv);\n";
+    } else {
+        source += "    vec4 color = texture(u_input, v_uv);\n";
+    }
+    for (size_t pass : stage.passes) {
+        if (m_passes[pass].desc.type == PassType::Pointwise) {
+            source += "    color = " + m_passes[pass].prefix + "apply(color, v_uv);\n";
+        }
+    }
+    source += "    o_color = color;\n}\n";
+    return source;
+}
+
+void FilterGraph::bindUniforms(Stage &stage) {
+    auto &state = m_ctx->getStateCache();
+    GLuint unit = 1;  // 0 is the input
+    for (size_t pass : stage.passes) {
+        for (auto &uniform : m_passes[pass].uniforms) {
+            if (uniform.location == kUnresolved) {
+                uniform.location = stage.program->getUniformLocation((m_passes[pass].prefix + uniform.name).c_str());
+            }
+            if (uniform.location < 0) {
+                // Unused by the shader, so optimized out.
+                continue;
+            }
+            switch (uniform.components) {
+                case 0:
+                    state.bindTexture(unit, uniform.target, uniform.texture);
+                    glCall(m_ctx, Uniform1i, uniform.location, static_cast<GLint>(unit));
+                    ++unit;
+                    break;
+                case 1:
+                    glCall(m_ctx, Uniform1f, uniform.location, uniform.value[0]);
+                    break;
+                case 2:
+                    glCall(m_ctx, Uniform2f, uniform.location, uniform.value[0], uniform.value[1]);
+                    break;
+                default:
+                    glCall(m_ctx, Uniform4fv, uniform.location, 1, uniform.value.data());
+                    break;
+            }
+        }
+    }
+}
+
+void FilterGraph::collectTimings() {
+    while (!m_pending.empty()) {
+        const PendingRun &run = m_pending.front();
+        GLint available = GL_FALSE;
+        glCall(m_ctx, GetQueryObjectiv, run.queries.back(), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        // Runs timed before the stages were rebuilt do not match them any more.
+        if (run.generation == m_generation && run.queries.size() == m_stages.size() + 1) {
+            GLuint64 previous = 0;
+            for (size_t i = 0; i < run.queries.size(); ++i) {
+                GLuint64 timestamp = 0;
+                glCall(m_ctx, GetQueryObjectui64v, run.queries[i], GL_QUERY_RESULT, &timestamp);
+                if (i > 0) {
+                    auto &stage = m_stages[i - 1];
+                    stage.last_ms = (timestamp - previous) / 1e6;
+                    stage.total_ms += stage.last_ms;
+                    ++stage.samples;
+                }
+                previous = timestamp;
+            }
+        }
+        m_free_queries.insert(m_free_queries.end(), run.queries.begin(), run.queries.end());
+        m_pending.erase(m_pending.begin());
+    }
+}
+
+GLuint FilterGraph::acquireQuery() {
+    if (m_free_queries.empty()) {
+        GLuint query;
+        glCall(m_ctx, GenQueries, 1, &query);
+        return query;
+    }
+    GLuint query = m_free_queries.back();
+    m_free_queries.pop_back();
+    return query;
+}
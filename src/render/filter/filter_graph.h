@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "render/filter/render_target_pool.h"
+
+class GLContext;
+class ShaderProgram;
+
+/**
+ *  @class FilterGraph
+ *
+ *  @brief Chain of fragment shader passes applied to a texture, e.g. scale, sharpen, colour grade and overlay.
+ *
+ *  Passes come in two kinds. A sampling pass reads its input anywhere (scaling, convolution kernels) and needs the
+ *  previous result in a texture. A pointwise pass only transforms the colour at the pixel being shaded (LUTs,
+ *  overlays, colour adjustments), so it is appended to the shader of the pass before it instead of getting a pass
+ *  of its own: every sampling pass, and the first pass of the chain, starts a stage, and the pointwise passes that
+ *  follow are fused into it. Each stage is one draw into a RenderTargetPool target; a stage's input is released to
+ *  the pool as soon as the stage is drawn, so intermediates ping-pong between a few textures.
+ *
+ *  Pass sources are GLSL snippets that define `$apply`: `vec4 $apply(sampler2D src, vec2 uv)` for sampling passes,
+ *  `vec4 $apply(vec4 color, vec2 uv)` for pointwise ones. `$` is replaced with a prefix unique to the pass, so
+ *  uniforms and helpers named `$something` never clash with another pass in the same shader; uniforms are set by
+ *  their name without the `$`.
+ *
+ *  Every stage is timed on the GPU with timestamp queries, read back without waiting, a few frames late.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context.
+ */
+class FilterGraph {
+public:
+    NONCOPYABLE(FilterGraph)
+    NONMOVABLE(FilterGraph)
+
+    enum class PassType {
+        Sampling,
+        Pointwise,
+    };
+
+    struct PassDesc {
+        std::string name;
+        PassType type {PassType::Pointwise};
+        std::string source;
+        int width {};   // of the output of a sampling pass; 0 keeps the input size
+        int height {};
+        GLenum format {GL_RGBA8};  // of the output of a sampling pass
+    };
+
+    using PassId = size_t;
+
+    struct StageTiming {
+        std::string name;  // names of the passes drawn by the stage, joined with '+'
+        double last_ms;
+        double mean_ms;
+        uint64_t samples;
+    };
+
+    struct Stats {
+        size_t passes;
+        size_t stages;            // draws per run after fusion
+        uint64_t runs;
+        uint64_t timing_dropped;  // runs not timed because too many queries were pending
+        RenderTargetPool::Stats pool;
+    };
+
+    /**
+     *  @param pool Shared with other graphs to recycle targets between them, in which case its owner calls
+     *              `endFrame` once per frame; a private pool is created if null and aged by every run.
+     */
+    explicit FilterGraph(std::shared_ptr<GLContext> ctx, std::shared_ptr<RenderTargetPool> pool = nullptr);
+    ~FilterGraph();
+
+    PassId addPass(PassDesc desc);
+
+    /**
+     *  @brief Resamples to `width` x `height` with a Catmull-Rom bicubic filter.
+     */
+    PassId addScale(int width, int height);
+
+    /**
+     *  @brief Unsharp mask over the 3x3 neighbourhood; `strength` 0 leaves the picture unchanged.
+     */
+    PassId addSharpen(float strength);
+
+    /**
+     *  @brief Colour grade through a 3D LUT: `lut` is a GL_TEXTURE_3D of `size`^3 RGB entries, linearly filtered.
+     */
+    PassId addLut(GLuint lut, int size);
+
+    /**
+     *  @brief Blends a premultiplied-alpha RGBA texture over the whole picture.
+     */
+    PassId addOverlay(GLuint texture, float opacity);
+
+    void setUniform(PassId pass, const std::string &name, float value);
+    void setUniform(PassId pass, const std::string &name, float x, float y);
+    void setUniform(PassId pass, const std::string &name, float x, float y, float z, float w);
+
+    /**
+     *  @brief Binds `texture` to the sampler uniform `name` of `pass`.
+     */
+    void setTexture(PassId pass, const std::string &name, GLenum target, GLuint texture);
+
+    /**
+     *  @brief Enables or disables fusing pointwise passes into the stage before them. Enabled by default.
+     */
+    void setFusion(bool enabled);
+
+    /**
+     *  @brief Runs the chain on `input`, a 2D texture of `width` x `height`.
+     *
+     *  @return The target holding the result, valid until the next run; nullptr if the graph has no pass.
+     *
+     *  @note Leaves the result's framebuffer bound and the viewport set to its size.
+     */
+    const RenderTargetPool::RenderTarget *run(GLuint input, int width, int height);
+
+    /**
+     *  @return GPU time of every stage, in drawing order, from the runs whose queries have completed.
+     */
+    std::vector<StageTiming> getTimings() const;
+
+    Stats getStats() const;
+
+    const std::shared_ptr<RenderTargetPool> &getPool() const { return m_pool; }
+
+private:
+    // The location is looked up on first use with the current program.
+    static constexpr GLint kUnresolved = -2;
+
+    struct Uniform {
+        std::string name;
+        int components;  // 1, 2 or 4 floats; 0 for a texture
+        std::array<float, 4> value;
+        GLenum target;
+        GLuint texture;
+        GLint location {kUnresolved};
+    };
+
+    struct Pass {
+        PassDesc desc;
+        std::string prefix;
+        std::vector<Uniform> uniforms;
+    };
+
+    struct Stage {
+        std::vector<size_t> passes;  // first one is the sampling pass, or a plain copy if it is pointwise
+        std::shared_ptr<ShaderProgram> program;
+        std::string name;
+
+        double last_ms {};
+        double total_ms {};
+        uint64_t samples {};
+    };
+
+    // Timestamps of one run: one before the first stage and one after each stage.
+    struct PendingRun {
+        uint64_t generation;
+        std::vector<GLuint> queries;
+    };
+
+    static constexpr size_t kMaxPendingRuns = 8;
+
+    std::shared_ptr<GLContext> m_ctx {};
+    std::shared_ptr<RenderTargetPool> m_pool {};
+    bool m_owns_pool {};  // then `run` ends the pool's frame
+    GLuint m_vao {};
+
+    std::vector<Pass> m_passes {};
+    std::vector<Stage> m_stages {};
+    bool m_fusion {true};
+    bool m_dirty {true};
+    uint64_t m_generation {};  // bumped whenever the stages are rebuilt, so stale timings are dropped
+
+    const RenderTargetPool::RenderTarget *m_output {};
+
+    std::vector<GLuint> m_free_queries {};
+    std::vector<PendingRun> m_pending {};
+    uint64_t m_runs {};
+    uint64_t m_timing_dropped {};
+
+    Uniform &findUniform(PassId pass, const std::string &name);
+
+    /**
+     *  @brief Splits the passes into stages and compiles one program per stage.
+     */
+    void build();
+
+    std::string generateShader(const Stage &stage) const;
+
+    void bindUniforms(Stage &stage);
+
+    /**
+     *  @brief Reads back every pending run whose last query has completed, oldest first.
+     */
+    void collectTimings();
+
+    GLuint acquireQuery();
+};
@@ -0,0 +1,126 @@
+#include "render_target_pool.h"
+
+#include <algorithm>
+
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+
+RenderTargetPool::RenderTargetPool(std::shared_ptr<GLContext> ctx, uint64_t max_idle_frames)
+    : m_ctx(ctx), m_max_idle_frames(max_idle_frames) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+}
+
+RenderTargetPool::~RenderTargetPool() {
+    for (auto &target : m_targets) {
+        destroy(target.get());
+    }
+    DEBUG("release RenderTargetPool: {}", (void *)this);
+}
+
+const RenderTargetPool::RenderTarget *RenderTargetPool::acquire(int width, int height, GLenum format) {
+    for (auto &target : m_targets) {
+        if (!target->in_use && target->width == width && target->height == height && target->format == format) {
+            target->in_use = true;
+            target->last_used_frame = m_frame;
+            ++m_reuses;
+            return target.get();
+        }
+    }
+
+    auto target = std::make_unique<RenderTarget>();
+    target->width = width;
+    target->height = height;
+    target->format = format;
+    target->bytes = size_t(width) * height * getBytesPerPixel(format);
+    target->in_use = true;
+    target->last_used_frame = m_frame;
+
+    auto &state = m_ctx->getStateCache();
+    glCall(m_ctx, GenTextures, 1, &target->texture);
+    state.bindTexture(0, GL_TEXTURE_2D, target->texture);
+    // No pixels are passed, so any non-integer external format will do for every colour format used here.
+    glCall(m_ctx, TexImage2D, GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glCall(m_ctx, GenFramebuffers, 1, &target->framebuffer);
+    state.bindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glCall(m_ctx, FramebufferTexture2D, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+    const GLenum status = glCall(m_ctx, CheckFramebufferStatus, GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        ERROR("render target {}x{} format {:#x} incomplete: {:#x}", width, height, format, status);
+    }
+
+    m_bytes += target->bytes;
+    m_peak_bytes = std::max(m_peak_bytes, m_bytes);
+    ++m_allocations;
+    DEBUG("allocated render target {}x{} format {:#x}, {} KiB pooled", width, height, format, m_bytes >> 10);
+    m_targets.push_back(std::move(target));
+    return m_targets.back().get();
+}
+
+void RenderTargetPool::release(const RenderTarget *target) {
+    for (auto &owned : m_targets) {
+        if (owned.get() == target) {
+            owned->in_use = false;
+            owned->last_used_frame = m_frame;
+            return;
+        }
+    }
+    ERROR("render target {} does not belong to this pool", (void *)target);
+}
+
+void RenderTargetPool::endFrame() {
+    ++m_frame;
+    std::erase_if(m_targets, [this](const std::unique_ptr<RenderTarget> &target) {
+        if (target->in_use || m_frame - target->last_used_frame <= m_max_idle_frames) {
+            return false;
+        }
+        destroy(target.get());
+        ++m_evictions;
+        return true;
+    });
+}
+
+RenderTargetPool::Stats RenderTargetPool::getStats() const {
+    const size_t in_use = std::count_if(m_targets.begin(), m_targets.end(), [](const auto &target) {
+        return target->in_use;
+    });
+    return {
+        m_targets.size(),
+        in_use,
+        m_bytes,
+        m_peak_bytes,
+        m_allocations,
+        m_reuses,
+        m_evictions,
+    };
+}
+
+size_t RenderTargetPool::getBytesPerPixel(GLenum format) {
+    switch (format) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RGBA16:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            // GL_RGBA8, GL_SRGB8_ALPHA8, GL_RGB10_A2, GL_R11F_G11F_B10F
+            return 4;
+    }
+}
+
+void RenderTargetPool::destroy(RenderTarget *target) {
+    m_ctx->getStateCache().deleteFramebuffers(1, &target->framebuffer);
+    m_ctx->getStateCache().deleteTextures(1, &target->texture);
+    m_bytes -= target->bytes;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+class GLContext;
+
+/**
+ *  @class RenderTargetPool
+ *
+ *  @brief Recycles texture + framebuffer pairs for offscreen passes, keyed by size and internal format.
+ *
+ *  A target released by one pass is handed to the next pass that asks for the same size and format, within a frame
+ *  (ping-pong between intermediates) and across frames, so a steady filter chain allocates nothing after its first
+ *  frame. Targets left unused for `max_idle_frames` calls of `endFrame` are deleted, which returns the memory of
+ *  sizes that are no longer needed, e.g. after a resolution change.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context. GL orders reads and writes
+ *        of the same texture within a context, so a released target can be rendered to again right away.
+ */
+class RenderTargetPool {
+public:
+    NONCOPYABLE(RenderTargetPool)
+    NONMOVABLE(RenderTargetPool)
+
+    struct RenderTarget {
+        GLuint texture {};
+        GLuint framebuffer {};
+        int width {};
+        int height {};
+        GLenum format {};  // internal format of the texture
+        size_t bytes {};
+
+        // Owned by the pool.
+        bool in_use {};
+        uint64_t last_used_frame {};
+    };
+
+    struct Stats {
+        size_t targets;      // allocated, in use or not
+        size_t in_use;
+        size_t bytes;        // GPU memory held by all targets
+        size_t peak_bytes;
+        uint64_t allocations;
+        uint64_t reuses;
+        uint64_t evictions;  // idle targets deleted by `endFrame`
+    };
+
+    explicit RenderTargetPool(std::shared_ptr<GLContext> ctx, uint64_t max_idle_frames = 120);
+    ~RenderTargetPool();
+
+    /**
+     *  @return A target of the given size and internal format, recycled if one is free. Its contents are undefined.
+     */
+    const RenderTarget *acquire(int width, int height, GLenum format);
+
+    /**
+     *  @brief Returns `target` to the pool.
+     */
+    void release(const RenderTarget *target);
+
+    /**
+     *  @brief Advances the frame counter and deletes targets that have been idle for too long.
+     */
+    void endFrame();
+
+    Stats getStats() const;
+
+    /**
+     *  @return Bytes per texel of a colour-renderable internal format, 4 if unknown.
+     */
+    static size_t getBytesPerPixel(GLenum format);
+
+private:
+    std::shared_ptr<GLContext> m_ctx {};
+    uint64_t m_max_idle_frames {};
+
+    std::vector<std::unique_ptr<RenderTarget>> m_targets {};
+    uint64_t m_frame {};
+
+    size_t m_bytes {};
+    size_t m_peak_bytes {};
+    uint64_t m_allocations {};
+    uint64_t m_reuses {};
+    uint64_t m_evictions {};
+
+    void destroy(RenderTarget *target);
+};
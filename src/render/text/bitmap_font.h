@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ *  Built-in 8x8 font covering printable ASCII, the glyph source of GlyphAtlas. Rows are top to bottom, and the
+ *  least significant bit of a row is its leftmost pixel.
+ */
+
+inline constexpr int kBitmapFontSize = 8;
+
+/**
+ *  @return The 8 rows of `codepoint`, or of '?' if the font has no such glyph.
+ */
+const uint8_t *getBitmapGlyph(char32_t codepoint);
+
+/**
+ *  @brief Decodes the UTF-8 sequence at `text[*offset]` and advances `*offset` past it.
+ *
+ *  @return The codepoint, or U+FFFD for a malformed sequence (one byte is skipped).
+ */
+char32_t decodeUtf8(std::string_view text, size_t *offset);
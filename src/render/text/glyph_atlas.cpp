@@ -0,0 +1,154 @@
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "bitmap_font.h"
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+
+GlyphAtlas::GlyphAtlas(std::shared_ptr<GLContext> ctx, int size)
+    : m_ctx(ctx), m_size(size), m_pixels(size_t(size) * size * 4), m_dirty_top(INT_MAX) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+
+    auto &state = m_ctx->getStateCache();
+    glCall(m_ctx, GenTextures, 1, &m_texture);
+    state.bindTexture(0, GL_TEXTURE_2D, m_texture);
+    glCall(m_ctx, TexImage2D, GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    m_ctx->getStateCache().deleteTextures(1, &m_texture);
+    DEBUG("release GlyphAtlas: {}", (void *)this);
+}
+
+const GlyphAtlas::Region *GlyphAtlas::getGlyph(char32_t codepoint, int pixel_size) {
+    const uint64_t key = (uint64_t(codepoint) << 16) | uint16_t(pixel_size);
+    if (auto it = m_glyphs.find(key); it != m_glyphs.end()) {
+        return &it->second;
+    }
+
+    int x, y;
+    if (!allocate(pixel_size, pixel_size, &x, &y)) {
+        return nullptr;
+    }
+    // Nearest-neighbour scaling keeps the bitmap font's edges sharp at every size.
+    const uint8_t *rows = getBitmapGlyph(codepoint);
+    for (int row = 0; row < pixel_size; ++row) {
+        const uint8_t bits = rows[row * kBitmapFontSize / pixel_size];
+        uint8_t *dst = &m_pixels[(size_t(y + row) * m_size + x) * 4];
+        for (int column = 0; column < pixel_size; ++column) {
+            const uint8_t coverage = (bits >> (column * kBitmapFontSize / pixel_size)) & 1 ? 255 : 0;
+            dst[0] = dst[1] = dst[2] = dst[3] = coverage;
+            dst += 4;
+        }
+    }
+    return &m_glyphs.emplace(key, makeRegion(x, y, pixel_size, pixel_size)).first->second;
+}
+
+const GlyphAtlas::Region *GlyphAtlas::findImage(uint64_t key) const {
+    auto it = m_images.find(key);
+    return it != m_images.end() ? &it->second : nullptr;
+}
+
+const GlyphAtlas::Region *GlyphAtlas::addImage(uint64_t key, const uint8_t *rgba, int width, int height, int stride) {
+    int x, y;
+    if (!allocate(width, height, &x, &y)) {
+        return nullptr;
+    }
+    for (int row = 0; row < height; ++row) {
+        std::memcpy(&m_pixels[(size_t(y + row) * m_size + x) * 4], rgba + size_t(row) * stride, size_t(width) * 4);
+    }
+    return &m_images.insert_or_assign(key, makeRegion(x, y, width, height)).first->second;
+}
+
+void GlyphAtlas::reset() {
+    m_glyphs.clear();
+    m_images.clear();
+    m_shelves.clear();
+    m_next_shelf_y = 0;
+    // Stale pixels are never sampled again, but the padding of new entries has to be transparent.
+    std::fill(m_pixels.begin(), m_pixels.end(), 0);
+    m_dirty_top = 0;
+    m_dirty_bottom = m_size;
+    ++m_resets;
+}
+
+void GlyphAtlas::flush() {
+    if (m_dirty_bottom <= m_dirty_top) {
+        return;
+    }
+    TRACE_ZONE("upload glyph atlas");
+    // Whole rows, so the band is contiguous in the CPU copy and no unpack row length is needed.
+    m_ctx->getStateCache().bindTexture(0, GL_TEXTURE_2D, m_texture);
+    glCall(m_ctx,
+           TexSubImage2D,
+           GL_TEXTURE_2D,
+           0,
+           0,
+           m_dirty_top,
+           m_size,
+           m_dirty_bottom - m_dirty_top,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           &m_pixels[size_t(m_dirty_top) * m_size * 4]);
+    ++m_uploads;
+    m_upload_bytes += size_t(m_dirty_bottom - m_dirty_top) * m_size * 4;
+    m_dirty_top = INT_MAX;
+    m_dirty_bottom = 0;
+}
+
+GlyphAtlas::Stats GlyphAtlas::getStats() const {
+    return {
+        m_glyphs.size(),
+        m_images.size(),
+        m_uploads,
+        m_upload_bytes,
+        m_resets,
+        static_cast<double>(m_next_shelf_y) / m_size,
+    };
+}
+
+bool GlyphAtlas::allocate(int width, int height, int *x, int *y) {
+    const int padded_width = width + 2 * kPadding;
+    const int padded_height = height + 2 * kPadding;
+    if (width <= 0 || height <= 0 || padded_width > m_size || padded_height > m_size) {
+        return false;
+    }
+
+    // The tightest shelf that fits, not wasting more than a quarter of its height.
+    Shelf *best = nullptr;
+    for (auto &shelf : m_shelves) {
+        if (shelf.height >= padded_height && shelf.height * 3 <= padded_height * 4 &&
+            shelf.x + padded_width <= m_size && (!best || shelf.height < best->height)) {
+            best = &shelf;
+        }
+    }
+    if (!best) {
+        if (m_next_shelf_y + padded_height > m_size) {
+            return false;
+        }
+        best = &m_shelves.emplace_back(Shelf {m_next_shelf_y, padded_height, 0});
+        m_next_shelf_y += padded_height;
+    }
+
+    *x = best->x + kPadding;
+    *y = best->y + kPadding;
+    best->x += padded_width;
+    m_dirty_top = std::min(m_dirty_top, *y);
+    m_dirty_bottom = std::max(m_dirty_bottom, *y + height);
+    return true;
+}
+
+GlyphAtlas::Region GlyphAtlas::makeRegion(int x, int y, int width, int height) const {
+    const float scale = 1.0f / m_size;
+    return {x * scale, y * scale, (x + width) * scale, (y + height) * scale, width, height};
+}
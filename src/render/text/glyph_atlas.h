@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+
+class GLContext;
+
+/**
+ *  @class GlyphAtlas
+ *
+ *  @brief One RGBA texture holding rasterised glyphs and subtitle bitmaps, filled on demand.
+ *
+ *  Entries are packed into shelves of similar height and written to a CPU copy of the atlas; `flush` uploads the
+ *  band of rows touched since the last flush in a single call, so a frame that adds nothing uploads nothing.
+ *  Nothing is evicted piecemeal: when an entry no longer fits, the caller resets the whole atlas and adds what the
+ *  current frame needs again. Glyphs are white with the coverage in alpha, bitmaps are premultiplied RGBA, so both
+ *  are tinted and blended the same way.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context.
+ */
+class GlyphAtlas {
+public:
+    NONCOPYABLE(GlyphAtlas)
+    NONMOVABLE(GlyphAtlas)
+
+    struct Region {
+        float u0, v0, u1, v1;  // texture coordinates, v0 at the top row of the entry
+        int width;
+        int height;
+    };
+
+    struct Stats {
+        size_t glyphs;
+        size_t images;
+        uint64_t uploads;       // TexSubImage2D calls made by `flush`
+        uint64_t upload_bytes;
+        uint64_t resets;
+        double occupancy;       // share of the rows taken by shelves
+    };
+
+    explicit GlyphAtlas(std::shared_ptr<GLContext> ctx, int size = 1024);
+    ~GlyphAtlas();
+
+    /**
+     *  @return The glyph of `codepoint` rasterised in a `pixel_size` square cell, added if missing; nullptr if the
+     *          atlas is full.
+     */
+    const Region *getGlyph(char32_t codepoint, int pixel_size);
+
+    /**
+     *  @return The bitmap added under `key`, or nullptr.
+     */
+    const Region *findImage(uint64_t key) const;
+
+    /**
+     *  @brief Copies a premultiplied RGBA bitmap into the atlas under `key`.
+     *
+     *  @return Its region; nullptr if the atlas is full or the bitmap is larger than the atlas.
+     */
+    const Region *addImage(uint64_t key, const uint8_t *rgba, int width, int height, int stride);
+
+    /**
+     *  @brief Forgets every entry; regions handed out before are invalid afterwards.
+     */
+    void reset();
+
+    /**
+     *  @brief Uploads the rows written since the last flush.
+     */
+    void flush();
+
+    GLuint getTexture() const { return m_texture; }
+
+    int getSize() const { return m_size; }
+
+    Stats getStats() const;
+
+private:
+    // Transparent border around every entry, so linear filtering never reads a neighbour.
+    static constexpr int kPadding = 1;
+
+    struct Shelf {
+        int y;
+        int height;
+        int x;  // next free column
+    };
+
+    std::shared_ptr<GLContext> m_ctx {};
+    int m_size {};
+    GLuint m_texture {};
+
+    std::vector<uint8_t> m_pixels {};  // CPU copy of the texture, uploaded by row band
+    std::vector<Shelf> m_shelves {};
+    int m_next_shelf_y {};
+    int m_dirty_top {};
+    int m_dirty_bottom {};  // exclusive; empty band when not greater than the top
+
+    std::unordered_map<uint64_t, Region> m_glyphs {};  // by codepoint << 16 | pixel size
+    std::unordered_map<uint64_t, Region> m_images {};
+
+    uint64_t m_uploads {};
+    uint64_t m_upload_bytes {};
+    uint64_t m_resets {};
+
+    /**
+     *  @return The top-left corner of a free `width` x `height` area, padding excluded, or false if none is left.
+     */
+    bool allocate(int width, int height, int *x, int *y);
+
+    Region makeRegion(int x, int y, int width, int height) const;
+};
@@ -0,0 +1,114 @@
+#include "subtitle_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "render/text/text_renderer.h"
+#include "trace/tracer.h"
+
+SubtitleOverlay::Config SubtitleOverlay::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.font_size = config_manager->getIntValue("overlay", "font_size", config.font_size);
+    config.margin = config_manager->getIntValue("overlay", "margin", config.margin);
+    config.stats = config_manager->getIntValue("overlay", "stats", config.stats) != 0;
+    return config;
+}
+
+SubtitleOverlay::SubtitleOverlay(const Config &config) : m_config(config) {}
+
+SubtitleOverlay::~SubtitleOverlay() { DEBUG("release SubtitleOverlay: {}", (void *)this); }
+
+void SubtitleOverlay::setStream(const AVStream *stream, int video_width, int video_height) {
+    m_subtitles.clear();
+    m_decoder.reset();
+    ++m_generation;
+    if (!stream) {
+        return;
+    }
+    try {
+        m_decoder = std::make_unique<SubtitleDecoder>(stream, video_width, video_height);
+    } catch (const std::runtime_error &) {
+        WARN("cannot decode subtitle stream {}, not showing subtitles", stream->index);
+    }
+}
+
+void SubtitleOverlay::addPacket(const AVPacket *packet) {
+    if (!m_decoder) {
+        return;
+    }
+    TRACE_ZONE("decode subtitle");
+    SubtitleDecoder::Subtitle subtitle {};
+    if (!m_decoder->decode(packet, &subtitle)) {
+        return;
+    }
+
+    // Open-ended subtitles, and PGS/DVB screens in particular, are replaced by the next one.
+    for (auto &earlier : m_subtitles) {
+        if (std::isinf(earlier.end) && earlier.start <= subtitle.start) {
+            earlier.end = subtitle.start;
+        }
+    }
+    // An empty subtitle only clears the screen, which closing the earlier ones did.
+    if (subtitle.lines.empty() && subtitle.images.empty()) {
+        return;
+    }
+    if (m_subtitles.size() >= kMaxPending) {
+        m_subtitles.pop_front();
+    }
+    auto position = std::upper_bound(m_subtitles.begin(),
+                                     m_subtitles.end(),
+                                     subtitle.start,
+                                     [](double start, const auto &other) { return start < other.start; });
+    m_subtitles.insert(position, std::move(subtitle));
+}
+
+void SubtitleOverlay::layout(TextRenderer *renderer, double time, int x, int y, int width, int height) {
+    std::erase_if(m_subtitles, [time](const auto &subtitle) { return subtitle.end <= time; });
+    if (!m_decoder || m_subtitles.empty() || width <= 0 || height <= 0) {
+        return;
+    }
+
+    const float scale = height / 720.0f;
+    const float canvas_x = static_cast<float>(width) / m_decoder->getCanvasWidth();
+    const float canvas_y = static_cast<float>(height) / m_decoder->getCanvasHeight();
+    TextRenderer::Style style {};
+    style.pixel_size = std::max(8, static_cast<int>(std::lround(m_config.font_size * scale)));
+
+    size_t line_count = 0;
+    for (const auto &subtitle : m_subtitles) {
+        if (subtitle.start > time) {
+            break;
+        }
+        line_count += subtitle.lines.size();
+        for (size_t i = 0; i < subtitle.images.size(); ++i) {
+            const auto &image = subtitle.images[i];
+            renderer->addImage((m_generation << 48) | (subtitle.id << 8) | (i & 0xff),
+                               image.rgba.data(),
+                               image.width,
+                               image.height,
+                               image.width * 4,
+                               x + image.x * canvas_x,
+                               y + image.y * canvas_y,
+                               image.width * canvas_x,
+                               image.height * canvas_y);
+        }
+    }
+
+    // Text stacks up from the bottom margin, the earliest subtitle on top.
+    const float line_height = TextRenderer::getLineHeight(style.pixel_size);
+    float line_y = y + height - m_config.margin * scale - line_count * line_height;
+    for (const auto &subtitle : m_subtitles) {
+        if (subtitle.start > time) {
+            break;
+        }
+        for (const auto &line : subtitle.lines) {
+            const float line_width = TextRenderer::measureText(line, style.pixel_size);
+            renderer->addText(line, x + (width - line_width) / 2, line_y, style);
+            line_y += line_height;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/subtitle_decoder.h"
+
+class TextRenderer;
+
+/**
+ *  @class SubtitleOverlay
+ *
+ *  @brief Decodes the subtitle packets of the item on screen and lays out the ones due at the current video time
+ *         through a TextRenderer.
+ *
+ *  Text is centred at the bottom of the picture, bitmaps are scaled from their canvas onto it. A subtitle without
+ *  an end time lasts until the next one starts.
+ *
+ *  @note Not thread-safe; owned by the render thread.
+ */
+class SubtitleOverlay {
+public:
+    NONCOPYABLE(SubtitleOverlay)
+    NONMOVABLE(SubtitleOverlay)
+
+    struct Config {
+        int font_size {32};  // glyph cell size for a 720-line picture, scaled with the picture
+        int margin {24};     // above the bottom of a 720-line picture, scaled likewise
+        bool stats {false};  // also draw playback statistics in the top-left corner
+
+        /**
+         *  @brief Reads the `[overlay]` section of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    explicit SubtitleOverlay(const Config &config);
+    ~SubtitleOverlay();
+
+    /**
+     *  @brief Switches to another subtitle stream, dropping every subtitle of the previous one.
+     *
+     *  @param stream nullptr if the item on screen has no subtitles.
+     *  @param video_width, video_height Canvas of bitmap subtitles that do not give their own.
+     */
+    void setStream(const AVStream *stream, int video_width, int video_height);
+
+    void addPacket(const AVPacket *packet);
+
+    /**
+     *  @brief Queues the subtitles shown at `time` (seconds, in the stream's timeline) into `renderer`, over the
+     *         picture drawn at (`x`, `y`) with the given size in framebuffer pixels. Subtitles that ended are
+     *         released.
+     */
+    void layout(TextRenderer *renderer, double time, int x, int y, int width, int height);
+
+    const Config &getConfig() const { return m_config; }
+
+private:
+    // Subtitles kept ahead of the picture; demuxing runs ahead of decoding by the packet queues.
+    static constexpr size_t kMaxPending = 256;
+
+    Config m_config {};
+    std::unique_ptr<SubtitleDecoder> m_decoder {};
+    std::deque<SubtitleDecoder::Subtitle> m_subtitles {};  // by start time
+    // Bumped per stream, so atlas keys of bitmaps never collide with those of an earlier stream.
+    uint64_t m_generation {};
+};
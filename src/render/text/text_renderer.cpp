@@ -0,0 +1,274 @@
+#include "text_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "bitmap_font.h"
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/gpu_tracer.h"
+#include "render/context/shader_program.h"
+
+namespace {
+
+const char *kVertexShader = R"(#version 410 core
+layout(location = 0) in vec4 a_rect;
+layout(location = 1) in vec4 a_uv;
+layout(location = 2) in vec4 a_color;
+
+uniform vec2 u_scale;  // 2 / framebuffer size
+
+out vec2 v_uv;
+out vec4 v_color;
+
+void main() {
+    // Four vertices as a strip: top-left, top-right, bottom-left, bottom-right.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pos = a_rect.xy + corner * a_rect.zw;
+    gl_Position = vec4(pos.x * u_scale.x - 1.0, 1.0 - pos.y * u_scale.y, 0.0, 1.0);
+    v_uv = mix(a_uv.xy, a_uv.zw, corner);
+    v_color = vec4(a_color.rgb * a_color.a, a_color.a);
+}
+)";
+
+const char *kFragmentShader = R"(#version 410 core
+in vec2 v_uv;
+in vec4 v_color;
+
+uniform sampler2D u_atlas;
+
+out vec4 o_color;
+
+void main() {
+    o_color = texture(u_atlas, v_uv) * v_color;
+}
+)";
+
+}  // namespace
+
+TextRenderer::TextRenderer(std::shared_ptr<GLContext> ctx, int atlas_size)
+    : m_ctx(ctx), m_atlas(ctx, atlas_size) {
+    m_program = ShaderProgram::create(ctx, kVertexShader, kFragmentShader);
+    m_program->use();
+    glCall(m_ctx, Uniform1i, m_program->getUniformLocation("u_atlas"), 0);
+    m_scale_location = m_program->getUniformLocation("u_scale");
+
+    auto &state = m_ctx->getStateCache();
+    glCall(m_ctx, GenVertexArrays, 1, &m_vao);
+    glCall(m_ctx, GenBuffers, 1, &m_instance_buffer);
+    state.bindVertexArray(m_vao);
+    state.bindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    const auto stride = static_cast<GLsizei>(sizeof(Instance));
+    glCall(m_ctx, EnableVertexAttribArray, 0);
+    glCall(m_ctx,
+           VertexAttribPointer,
+           0,
+           4,
+           GL_FLOAT,
+           GL_FALSE,
+           stride,
+           reinterpret_cast<const void *>(offsetof(Instance, rect)));
+    glCall(m_ctx, EnableVertexAttribArray, 1);
+    glCall(m_ctx,
+           VertexAttribPointer,
+           1,
+           4,
+           GL_FLOAT,
+           GL_FALSE,
+           stride,
+           reinterpret_cast<const void *>(offsetof(Instance, uv)));
+    glCall(m_ctx, EnableVertexAttribArray, 2);
+    glCall(m_ctx,
+           VertexAttribPointer,
+           2,
+           4,
+           GL_UNSIGNED_BYTE,
+           GL_TRUE,
+           stride,
+           reinterpret_cast<const void *>(offsetof(Instance, color)));
+    for (GLuint attribute = 0; attribute < 3; ++attribute) {
+        glCall(m_ctx, VertexAttribDivisor, attribute, 1);
+    }
+}
+
+TextRenderer::~TextRenderer() {
+    DEBUG("text renderer: {} frames, {} atlas overflows, {} dropped", m_frames, m_atlas_overflows, m_dropped);
+    m_ctx->getStateCache().deleteBuffers(1, &m_instance_buffer);
+    m_ctx->getStateCache().deleteVertexArrays(1, &m_vao);
+    DEBUG("release TextRenderer: {}", (void *)this);
+}
+
+void TextRenderer::addText(std::string_view text, float x, float y, const Style &style) {
+    if (text.empty() || style.pixel_size <= 0) {
+        return;
+    }
+    m_text_items.push_back({m_text.size(), text.size(), x, y, style});
+    m_text.append(text);
+}
+
+void TextRenderer::addImage(uint64_t key,
+                            const uint8_t *rgba,
+                            int width,
+                            int height,
+                            int stride,
+                            float x,
+                            float y,
+                            float draw_width,
+                            float draw_height) {
+    m_image_items.push_back({key, rgba, width, height, stride, x, y, draw_width, draw_height});
+}
+
+float TextRenderer::measureText(std::string_view text, int pixel_size, int *line_count) {
+    size_t longest = 0;
+    size_t current = 0;
+    int lines = text.empty() ? 0 : 1;
+    for (size_t offset = 0; offset < text.size();) {
+        if (decodeUtf8(text, &offset) == U'\n') {
+            ++lines;
+            current = 0;
+            continue;
+        }
+        longest = std::max(longest, ++current);
+    }
+    if (line_count) {
+        *line_count = lines;
+    }
+    return static_cast<float>(longest * pixel_size);
+}
+
+void TextRenderer::draw(int framebuffer_width, int framebuffer_height) {
+    if ((m_text_items.empty() && m_image_items.empty()) || framebuffer_width <= 0 || framebuffer_height <= 0) {
+        m_text.clear();
+        m_text_items.clear();
+        m_image_items.clear();
+        return;
+    }
+    TRACE_ZONE("draw text");
+    TRACE_GPU_ZONE(m_ctx, "text overlay");
+    auto start = std::chrono::steady_clock::now();
+
+    m_instances.clear();
+    if (resolve() > 0) {
+        // Entries of earlier frames fill the atlas; start over with only this frame's.
+        ++m_atlas_overflows;
+        m_atlas.reset();
+        m_instances.clear();
+        if (const size_t dropped = resolve(); dropped > 0) {
+            WARN("text overlay does not fit into the glyph atlas, {} quads not drawn", dropped);
+            m_dropped += dropped;
+        }
+    }
+    m_atlas.flush();
+
+    if (!m_instances.empty()) {
+        auto &state = m_ctx->getStateCache();
+        state.bindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+        // A new store every frame: the driver orphans the one the previous draw may still be reading.
+        glCall(m_ctx,
+               BufferData,
+               GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(m_instances.size() * sizeof(Instance)),
+               m_instances.data(),
+               GL_STREAM_DRAW);
+
+        state.viewport(0, 0, framebuffer_width, framebuffer_height);
+        state.setBlend(true);
+        state.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        m_program->use();
+        glCall(m_ctx, Uniform2f, m_scale_location, 2.0f / framebuffer_width, 2.0f / framebuffer_height);
+        state.bindTexture(0, GL_TEXTURE_2D, m_atlas.getTexture());
+        state.bindVertexArray(m_vao);
+        glCall(m_ctx, DrawArraysInstanced, GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(m_instances.size()));
+        state.setBlend(false);
+    }
+
+    ++m_frames;
+    m_last_instances = m_instances.size();
+    m_text.clear();
+    m_text_items.clear();
+    m_image_items.clear();
+    m_cpu_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TextRenderer::Stats TextRenderer::getStats() const {
+    return {
+        m_frames,
+        m_last_instances,
+        m_last_instances * sizeof(Instance),
+        m_atlas_overflows,
+        m_dropped,
+        m_cpu_ns,
+        m_atlas.getStats(),
+    };
+}
+
+size_t TextRenderer::resolve() {
+    size_t missing = 0;
+
+    // Bitmaps first, so text drawn at the same place ends up on top.
+    for (const auto &item : m_image_items) {
+        const GlyphAtlas::Region *region = m_atlas.findImage(item.key);
+        if (!region) {
+            region = m_atlas.addImage(item.key, item.rgba, item.width, item.height, item.stride);
+        }
+        if (!region) {
+            ++missing;
+            continue;
+        }
+        m_instances.push_back({
+            {item.x, item.y, item.draw_width, item.draw_height},
+            {region->u0, region->v0, region->u1, region->v1},
+            {255, 255, 255, 255},
+        });
+    }
+
+    for (const auto &item : m_text_items) {
+        const std::string_view text {m_text.data() + item.offset, item.length};
+        const int size = item.style.pixel_size;
+        const uint8_t color[4] {
+            uint8_t(item.style.color >> 24),
+            uint8_t(item.style.color >> 16),
+            uint8_t(item.style.color >> 8),
+            uint8_t(item.style.color),
+        };
+        const float shadow_offset = std::max(1, size / 16);
+
+        // Shadows of the whole item go first, so they never cover a neighbouring glyph.
+        for (int pass = item.style.shadow ? 0 : 1; pass < 2; ++pass) {
+            const bool shadow = pass == 0;
+            float x = item.x + (shadow ? shadow_offset : 0.0f);
+            float y = item.y + (shadow ? shadow_offset : 0.0f);
+            for (size_t offset = 0; offset < text.size();) {
+                const char32_t codepoint = decodeUtf8(text, &offset);
+                if (codepoint == U'\n') {
+                    x = item.x + (shadow ? shadow_offset : 0.0f);
+                    y += getLineHeight(size);
+                    continue;
+                }
+                if (codepoint != U' ') {
+                    const GlyphAtlas::Region *region = m_atlas.getGlyph(codepoint, size);
+                    if (!region) {
+                        ++missing;
+                        x += size;
+                        continue;
+                    }
+                    m_instances.push_back({
+                        {x, y, float(size), float(size)},
+                        {region->u0, region->v0, region->u1, region->v1},
+                        {
+                            shadow ? uint8_t(0) : color[0],
+                            shadow ? uint8_t(0) : color[1],
+                            shadow ? uint8_t(0) : color[2],
+                            color[3],
+                        },
+                    });
+                }
+                x += size;
+            }
+        }
+    }
+    return missing;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "render/text/glyph_atlas.h"
+
+class GLContext;
+class ShaderProgram;
+
+/**
+ *  @class TextRenderer
+ *
+ *  @brief Draws text and subtitle bitmaps over the picture, every quad of a frame in one instanced draw.
+ *
+ *  Text and bitmaps are queued during the frame and resolved in `draw`: each glyph or bitmap becomes one instance
+ *  (screen rectangle, atlas rectangle, colour) in a buffer uploaded with a single call, and all instances are drawn
+ *  with one `glDrawArraysInstanced` sampling the GlyphAtlas. The number of GL calls per frame is the same for one
+ *  glyph as for ten thousand; only the instance buffer grows.
+ *
+ *  If the atlas fills up while resolving, it is reset and the frame is resolved again, so only what is on screen
+ *  takes atlas space.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context.
+ */
+class TextRenderer {
+public:
+    NONCOPYABLE(TextRenderer)
+    NONMOVABLE(TextRenderer)
+
+    struct Style {
+        int pixel_size {24};          // cell size of a glyph; lines are 1.25 cells apart
+        uint32_t color {0xffffffff};  // 0xRRGGBBAA, not premultiplied
+        bool shadow {true};           // black copy offset by 1/16 of the size, for legibility over video
+    };
+
+    struct Stats {
+        uint64_t frames;
+        size_t instances;          // quads in the last draw
+        size_t instance_bytes;     // uploaded for the last draw
+        uint64_t atlas_overflows;  // frames the atlas had to be reset for
+        uint64_t dropped;          // glyphs or bitmaps that did not fit even into an empty atlas
+        uint64_t cpu_ns;           // resolving and submitting the last draw
+        GlyphAtlas::Stats atlas;
+    };
+
+    explicit TextRenderer(std::shared_ptr<GLContext> ctx, int atlas_size = 1024);
+    ~TextRenderer();
+
+    /**
+     *  @brief Queues UTF-8 text with its first line's top-left corner at (`x`, `y`), in framebuffer pixels from
+     *         the top-left. '\n' starts a new line.
+     */
+    void addText(std::string_view text, float x, float y, const Style &style);
+
+    /**
+     *  @brief Queues a premultiplied RGBA bitmap drawn into the rectangle at (`x`, `y`) of `draw_width` x
+     *         `draw_height` pixels. The bitmap is copied into the atlas once per `key`.
+     *
+     *  @note `rgba` must stay valid until `draw` returns.
+     */
+    void addImage(uint64_t key,
+                  const uint8_t *rgba,
+                  int width,
+                  int height,
+                  int stride,
+                  float x,
+                  float y,
+                  float draw_width,
+                  float draw_height);
+
+    /**
+     *  @return Width of the longest line of `text` and number of lines, in pixels and lines at `pixel_size`.
+     */
+    static float measureText(std::string_view text, int pixel_size, int *line_count = nullptr);
+
+    static float getLineHeight(int pixel_size) { return pixel_size * 1.25f; }
+
+    /**
+     *  @brief Draws everything queued since the last draw over the framebuffer, then clears the queue.
+     *
+     *  @note Sets the viewport to the whole framebuffer.
+     */
+    void draw(int framebuffer_width, int framebuffer_height);
+
+    Stats getStats() const;
+
+private:
+    struct TextItem {
+        size_t offset;  // into m_text
+        size_t length;
+        float x;
+        float y;
+        Style style;
+    };
+
+    struct ImageItem {
+        uint64_t key;
+        const uint8_t *rgba;
+        int width;
+        int height;
+        int stride;
+        float x;
+        float y;
+        float draw_width;
+        float draw_height;
+    };
+
+    // One quad, matching the vertex attributes of the shader.
+    struct Instance {
+        float rect[4];  // x, y, width, height in framebuffer pixels
+        float uv[4];    // u0, v0, u1, v1
+        uint8_t color[4];
+    };
+
+    std::shared_ptr<GLContext> m_ctx {};
+    GlyphAtlas m_atlas;
+    std::shared_ptr<ShaderProgram> m_program {};
+    GLint m_scale_location {-1};
+    GLuint m_vao {};
+    GLuint m_instance_buffer {};
+
+    // Queued items; the storage is kept across frames.
+    std::string m_text {};
+    std::vector<TextItem> m_text_items {};
+    std::vector<ImageItem> m_image_items {};
+    std::vector<Instance> m_instances {};
+
+    uint64_t m_frames {};
+    size_t m_last_instances {};
+    uint64_t m_atlas_overflows {};
+    uint64_t m_dropped {};
+    uint64_t m_cpu_ns {};
+
+    /**
+     *  @brief Appends the instances of every queued item.
+     *
+     *  @return How many glyphs and bitmaps found no space in the atlas and were left out.
+     */
+    size_t resolve();
+};
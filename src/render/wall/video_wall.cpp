@@ -0,0 +1,421 @@
+#include "video_wall.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include "base/job_system.h"
+#include "config/config_manager.h"
+#include "log/log_system.h"
+#include "render/context/gl_context.h"
+#include "render/context/gl_state_cache.h"
+#include "render/context/gpu_tracer.h"
+#include "render/context/shader_program.h"
+
+namespace {
+
+const char *kVertexShader = R"(#version 410 core
+layout(location = 0) in vec4 a_rect;
+layout(location = 1) in vec3 a_uv_layer;
+
+uniform vec2 u_scale;  // 2 / framebuffer size
+
+out vec3 v_uv;
+
+void main() {
+    // Four vertices as a strip: top-left, top-right, bottom-left, bottom-right.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pos = a_rect.xy + corner * a_rect.zw;
+    gl_Position = vec4(pos.x * u_scale.x - 1.0, 1.0 - pos.y * u_scale.y, 0.0, 1.0);
+    v_uv = vec3(corner * a_uv_layer.xy, a_uv_layer.z);
+}
+)";
+
+const char *kFragmentShader = R"(#version 410 core
+in vec3 v_uv;
+
+uniform sampler2DArray u_tiles;
+
+out vec4 o_color;
+
+void main() {
+    o_color = texture(u_tiles, v_uv);
+}
+)";
+
+const char *getQualityName(WallStream::Quality quality) {
+    switch (quality) {
+        case WallStream::Quality::Full:
+            return "full";
+        case WallStream::Quality::NoLoopFilter:
+            return "no loop filter";
+        case WallStream::Quality::DropNonReference:
+            return "reference frames only";
+        case WallStream::Quality::KeyframesOnly:
+            return "keyframes only";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+VideoWall::Config VideoWall::Config::fromConfigManager() {
+    auto config_manager = ConfigManager::get();
+    Config config {};
+    config.tile_width = config_manager->getIntValue("wall", "tile_width", config.tile_width);
+    config.tile_height = config_manager->getIntValue("wall", "tile_height", config.tile_height);
+    config.columns = config_manager->getIntValue("wall", "columns", config.columns);
+    config.queue_depth = config_manager->getIntValue("wall", "queue_depth", config.queue_depth);
+    config.loop = config_manager->getIntValue("wall", "loop", config.loop) != 0;
+    config.qos_window =
+        config_manager->getIntValue("wall", "qos_window_ms", std::lround(config.qos_window * 1000)) / 1000.0;
+    config.qos_degrade_ratio =
+        config_manager->getIntValue("wall", "qos_degrade_percent", std::lround(config.qos_degrade_ratio * 100)) /
+        100.0;
+    config.qos_recover_windows =
+        config_manager->getIntValue("wall", "qos_recover_windows", config.qos_recover_windows);
+    config.io = MappedFileIO::Config::fromConfigManager();
+    return config;
+}
+
+VideoWall::VideoWall(std::shared_ptr<GLContext> ctx,
+                     const std::vector<std::filesystem::path> &paths,
+                     const Config &config)
+    : m_ctx(ctx), m_config(config) {
+    if (!ctx) {
+        FATAL("invalid context!");
+    }
+    m_config.tile_width = std::max(2, m_config.tile_width);
+    m_config.tile_height = std::max(2, m_config.tile_height);
+    m_config.queue_depth = std::max(1, m_config.queue_depth);
+
+    // Opening probes every file; do them all at once instead of one after the other.
+    std::vector<std::unique_ptr<WallStream>> streams(paths.size());
+    {
+        TaskGroup group;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            group.run([&, i] {
+                try {
+                    streams[i] = std::make_unique<WallStream>(paths[i],
+                                                              m_config.io,
+                                                              m_config.tile_width,
+                                                              m_config.tile_height,
+                                                              m_config.loop);
+                } catch (const std::runtime_error &e) {
+                    WARN("leaving {} off the wall: {}", paths[i].string(), e.what());
+                }
+            });
+        }
+    }
+    std::erase_if(streams, [](const auto &stream) { return !stream; });
+
+    GLint max_layers = 0;
+    glCall(m_ctx, GetIntegerv, GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    if (static_cast<GLint>(streams.size()) > max_layers) {
+        WARN("only {} of {} inputs fit into a texture array", max_layers, streams.size());
+        streams.resize(max_layers);
+    }
+
+    auto &state = m_ctx->getStateCache();
+    glCall(m_ctx, GenTextures, 1, &m_texture);
+    state.bindTexture(0, GL_TEXTURE_2D_ARRAY, m_texture);
+    glCall(m_ctx,
+           TexImage3D,
+           GL_TEXTURE_2D_ARRAY,
+           0,
+           GL_RGBA8,
+           m_config.tile_width,
+           m_config.tile_height,
+           std::max<GLsizei>(1, static_cast<GLsizei>(streams.size())),
+           0,
+           GL_RGBA,
+           GL_UNSIGNED_BYTE,
+           nullptr);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glCall(m_ctx, TexParameteri, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // One staged frame per slot; two more are still being read by the GPU.
+    const size_t slot_count = m_config.queue_depth + 2;
+    const size_t slot_size = static_cast<size_t>(m_config.tile_width) * m_config.tile_height * 4;
+    for (auto &stream : streams) {
+        Cell cell {};
+        cell.stream = std::move(stream);
+        cell.ring = m_ctx->createPixelUploadRing(slot_count, slot_size);
+        cell.ring->pump();
+        m_cells.push_back(std::move(cell));
+    }
+    for (size_t i = 0; i < m_cells.size(); ++i) {
+        m_cells[i].stream->start(m_cells[i].ring, m_texture, static_cast<int>(i));
+    }
+
+    m_program = ShaderProgram::create(ctx, kVertexShader, kFragmentShader);
+    m_program->use();
+    glCall(m_ctx, Uniform1i, m_program->getUniformLocation("u_tiles"), 0);
+    m_scale_location = m_program->getUniformLocation("u_scale");
+
+    glCall(m_ctx, GenVertexArrays, 1, &m_vao);
+    glCall(m_ctx, GenBuffers, 1, &m_instance_buffer);
+    state.bindVertexArray(m_vao);
+    state.bindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    const auto stride = static_cast<GLsizei>(sizeof(Instance));
+    glCall(m_ctx, EnableVertexAttribArray, 0);
+    glCall(m_ctx,
+           VertexAttribPointer,
+           0,
+           4,
+           GL_FLOAT,
+           GL_FALSE,
+           stride,
+           reinterpret_cast<const void *>(offsetof(Instance, rect)));
+    // The layer follows the texture coordinates, so one vec3 carries both.
+    glCall(m_ctx, EnableVertexAttribArray, 1);
+    glCall(m_ctx,
+           VertexAttribPointer,
+           1,
+           3,
+           GL_FLOAT,
+           GL_FALSE,
+           stride,
+           reinterpret_cast<const void *>(offsetof(Instance, uv)));
+    glCall(m_ctx, VertexAttribDivisor, 0, 1);
+    glCall(m_ctx, VertexAttribDivisor, 1, 1);
+
+    INFO("video wall: {} of {} inputs in {}x{} tiles",
+         m_cells.size(),
+         paths.size(),
+         m_config.tile_width,
+         m_config.tile_height);
+}
+
+VideoWall::~VideoWall() {
+    logStats();
+    // Streams first: their tasks write into the rings until they are gone.
+    for (auto &cell : m_cells) {
+        cell.stream.reset();
+    }
+    m_cells.clear();
+    auto &state = m_ctx->getStateCache();
+    state.deleteBuffers(1, &m_instance_buffer);
+    state.deleteVertexArrays(1, &m_vao);
+    state.deleteTextures(1, &m_texture);
+    DEBUG("release VideoWall: {}", (void *)this);
+}
+
+size_t VideoWall::update(double time) {
+    TRACE_ZONE("wall update");
+    size_t uploaded = 0;
+    for (auto &cell : m_cells) {
+        uploaded += present(cell, time);
+        // Consuming a frame freed a slot; a stream that ran out of them is idle until scheduled again.
+        cell.stream->schedule();
+    }
+    updateQuality(time);
+    return uploaded;
+}
+
+void VideoWall::draw(int framebuffer_width, int framebuffer_height) {
+    if (m_cells.empty() || framebuffer_width <= 0 || framebuffer_height <= 0) {
+        return;
+    }
+    TRACE_ZONE("draw wall");
+    TRACE_GPU_ZONE(m_ctx, "video wall");
+
+    const int count = static_cast<int>(m_cells.size());
+    const int columns = m_config.columns > 0 ? std::min(m_config.columns, count)
+                                             : static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const int rows = (count + columns - 1) / columns;
+    const float cell_width = static_cast<float>(framebuffer_width) / columns;
+    const float cell_height = static_cast<float>(framebuffer_height) / rows;
+
+    m_instances.clear();
+    for (int i = 0; i < count; ++i) {
+        const Cell &cell = m_cells[i];
+        if (cell.content_width <= 0 || cell.content_height <= 0) {
+            continue;
+        }
+        const float aspect = static_cast<float>(cell.content_width) / cell.content_height;
+        float width = cell_width;
+        float height = width / aspect;
+        if (height > cell_height) {
+            height = cell_height;
+            width = height * aspect;
+        }
+        // Half a texel short, so linear filtering never reads past the picture into the rest of the layer.
+        m_instances.push_back({
+            {
+                i % columns * cell_width + (cell_width - width) / 2,
+                i / columns * cell_height + (cell_height - height) / 2,
+                width,
+                height,
+            },
+            {
+                (cell.content_width - 0.5f) / m_config.tile_width,
+                (cell.content_height - 0.5f) / m_config.tile_height,
+            },
+            static_cast<float>(i),
+        });
+    }
+    if (m_instances.empty()) {
+        return;
+    }
+
+    auto &state = m_ctx->getStateCache();
+    state.bindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    glCall(m_ctx,
+           BufferData,
+           GL_ARRAY_BUFFER,
+           static_cast<GLsizeiptr>(m_instances.size() * sizeof(Instance)),
+           m_instances.data(),
+           GL_STREAM_DRAW);
+
+    state.viewport(0, 0, framebuffer_width, framebuffer_height);
+    m_program->use();
+    glCall(m_ctx, Uniform2f, m_scale_location, 2.0f / framebuffer_width, 2.0f / framebuffer_height);
+    state.bindTexture(0, GL_TEXTURE_2D_ARRAY, m_texture);
+    state.bindVertexArray(m_vao);
+    glCall(m_ctx, DrawArraysInstanced, GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(m_instances.size()));
+}
+
+bool VideoWall::isFinished() const {
+    return std::all_of(m_cells.begin(), m_cells.end(), [](const Cell &cell) {
+        return cell.stream->isFinished() && !cell.ring->peekFilled();
+    });
+}
+
+VideoWall::Stats VideoWall::getStats() const {
+    Stats stats {};
+    stats.streams = m_cells.size();
+    stats.quality_changes = m_quality_changes;
+    for (const auto &cell : m_cells) {
+        const auto stream = cell.stream->getStats();
+        stats.presented += cell.presented;
+        stats.dropped += cell.dropped;
+        stats.underruns += cell.underruns;
+        stats.degraded_streams += cell.stream->getQuality() != WallStream::Quality::Full;
+        stats.decoded_frames += stream.frames;
+        stats.decode_stalls += stream.stalls;
+        stats.decode_busy_seconds += stream.busy_ns * 1e-9;
+    }
+    return stats;
+}
+
+void VideoWall::logStats() const {
+    for (const auto &cell : m_cells) {
+        const auto stream = cell.stream->getStats();
+        INFO("wall {}: {} shown, {} dropped, {} missed, quality {}, lowres {}, {} staged, {} stalls, {:.3f}s busy",
+             cell.stream->getPath().filename().string(),
+             cell.presented,
+             cell.dropped,
+             cell.underruns,
+             getQualityName(cell.stream->getQuality()),
+             stream.lowres,
+             stream.frames,
+             stream.stalls,
+             stream.busy_ns * 1e-9);
+    }
+    const auto stats = getStats();
+    INFO("wall: {} streams, {} shown, {} dropped, {} missed, {} quality changes, {} degraded",
+         stats.streams,
+         stats.presented,
+         stats.dropped,
+         stats.underruns,
+         stats.quality_changes,
+         stats.degraded_streams);
+}
+
+size_t VideoWall::present(Cell &cell, double time) {
+    PixelUploadRing &ring = *cell.ring;
+    ring.pump();
+
+    const double time_base = av_q2d(cell.stream->getTimeBase());
+    const double frame_duration = cell.stream->getFrameDuration();
+    PixelUploadRing::Slot *due = nullptr;
+    if (!m_config.paced) {
+        due = ring.tryPopFilled();
+    } else {
+        while (PixelUploadRing::Slot *head = ring.peekFilled()) {
+            const double pts = head->pts * time_base;
+            if (!cell.started) {
+                cell.origin = time - pts;
+                cell.next_due = time;
+                cell.started = true;
+            }
+            if (cell.origin + pts > time) {
+                break;
+            }
+            ring.tryPopFilled();
+            // Only the latest due frame is shown; the ones it supersedes go back to the stream unseen.
+            if (due) {
+                ring.discard(due);
+                ++cell.dropped;
+                ++cell.window_late;
+            }
+            due = head;
+        }
+    }
+
+    if (!due) {
+        // Counted once per frame duration the stream is behind, not once per update.
+        if (m_config.paced && cell.started && !cell.stream->isFinished() && time > cell.next_due + frame_duration) {
+            ++cell.underruns;
+            ++cell.window_late;
+            cell.next_due += frame_duration;
+        }
+        return 0;
+    }
+
+    if (due->region_count > 0) {
+        cell.content_width = due->regions[0].width;
+        cell.content_height = due->regions[0].height;
+    }
+    if (m_config.paced) {
+        cell.next_due = cell.origin + due->pts * time_base + frame_duration;
+    }
+    ring.upload(due);
+    ++cell.presented;
+    ++cell.window_presented;
+    return 1;
+}
+
+void VideoWall::updateQuality(double time) {
+    if (!m_config.paced) {
+        return;
+    }
+    if (m_window_start < 0) {
+        m_window_start = time;
+        return;
+    }
+    if (time - m_window_start < m_config.qos_window) {
+        return;
+    }
+    m_window_start = time;
+
+    for (auto &cell : m_cells) {
+        const int quality = static_cast<int>(cell.stream->getQuality());
+        int next = quality;
+        if (cell.window_late > 0 && cell.window_late > cell.window_presented * m_config.qos_degrade_ratio) {
+            cell.clean_windows = 0;
+            next = std::min(quality + 1, WallStream::kQualityLevels - 1);
+        } else if (cell.window_late > 0) {
+            cell.clean_windows = 0;
+        } else if (++cell.clean_windows >= m_config.qos_recover_windows && quality > 0) {
+            cell.clean_windows = 0;
+            next = quality - 1;
+        }
+        if (next != quality) {
+            cell.stream->setQuality(static_cast<WallStream::Quality>(next));
+            ++m_quality_changes;
+            DEBUG("wall {}: {} late of {} shown, quality {} -> {}",
+                  cell.stream->getPath().filename().string(),
+                  cell.window_late,
+                  cell.window_presented,
+                  getQualityName(static_cast<WallStream::Quality>(quality)),
+                  getQualityName(static_cast<WallStream::Quality>(next)));
+        }
+        cell.window_presented = 0;
+        cell.window_late = 0;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "render/wall/wall_stream.h"
+
+class GLContext;
+class ShaderProgram;
+
+/**
+ *  @class VideoWall
+ *
+ *  @brief Plays many inputs at once in a grid, composited in a single draw call.
+ *
+ *  Every input is a WallStream decoding on the shared JobSystem into its own PixelUploadRing. Frames are converted
+ *  to RGBA at the tile size on the workers and uploaded into one layer per stream of a single `GL_TEXTURE_2D_ARRAY`.
+ *  The grid is drawn with one `glDrawArraysInstanced`, one instance per stream sampling its layer. The GL cost of a
+ *  frame is one upload per stream that changed plus one draw, whatever the number of streams.
+ *
+ *  Each stream runs on its own clock, which starts when its first frame is shown. Every `update` shows the latest
+ *  staged frame that is due; older ones are dropped. A frame that was due but not decoded yet is an underrun.
+ *
+ *  Quality control is per stream. When a stream's dropped and missed frames exceed `qos_degrade_ratio` of the ones
+ *  it showed over a window, its WallStream::Quality is lowered one step. After `qos_recover_windows` clean windows
+ *  it is raised one step again. On an overloaded node the streams that fall behind shed decode work first.
+ *
+ *  @note Must only be created, used and destroyed on the thread owning the GL context.
+ */
+class VideoWall {
+public:
+    NONCOPYABLE(VideoWall)
+    NONMOVABLE(VideoWall)
+
+    struct Config {
+        int tile_width {480};   // size of a texture array layer; pictures are fitted into it
+        int tile_height {270};
+        int columns {0};        // 0 picks a near-square grid
+        int queue_depth {3};    // frames staged ahead of the display per stream
+        bool loop {true};       // rewind inputs at their end
+        bool paced {true};      // false shows every frame as soon as it is decoded, e.g. to measure throughput
+        double qos_window {1.0};         // seconds between quality decisions
+        double qos_degrade_ratio {0.1};  // dropped and missed frames per shown frame that lower a stream's quality
+        int qos_recover_windows {3};     // clean windows before a stream's quality is raised again
+        MappedFileIO::Config io {};
+
+        /**
+         *  @brief Reads the `[wall]` and `[io]` sections of the config file, keeping defaults for missing keys.
+         */
+        static Config fromConfigManager();
+    };
+
+    struct Stats {
+        size_t streams;
+        uint64_t presented;        // frames uploaded, over every stream
+        uint64_t dropped;          // staged frames superseded by a later one before they were shown
+        uint64_t underruns;        // frames that were due but not decoded in time
+        uint64_t quality_changes;
+        size_t degraded_streams;   // streams currently below WallStream::Quality::Full
+        uint64_t decoded_frames;   // staged by the streams
+        uint64_t decode_stalls;    // decode tasks that found no free slot
+        double decode_busy_seconds;
+    };
+
+    /**
+     *  @brief Opens every input in parallel on the JobSystem and starts decoding. Inputs that fail to open are
+     *         left out with a warning.
+     */
+    VideoWall(std::shared_ptr<GLContext> ctx, const std::vector<std::filesystem::path> &paths, const Config &config);
+
+    /**
+     *  @brief Stops every stream, then logs the stats.
+     */
+    ~VideoWall();
+
+    /**
+     *  @brief Uploads the frames due at `time` (seconds on any monotonic clock), decides quality changes and
+     *         schedules the streams that have free slots again.
+     *
+     *  @return Number of layers updated.
+     */
+    size_t update(double time);
+
+    /**
+     *  @brief Draws the grid over the whole framebuffer, each picture letterboxed into its cell.
+     *
+     *  @note Sets the viewport to the whole framebuffer.
+     */
+    void draw(int framebuffer_width, int framebuffer_height);
+
+    /**
+     *  @return true once every stream finished and its last frame was shown; never with `loop`.
+     */
+    bool isFinished() const;
+
+    size_t getStreamCount() const { return m_cells.size(); }
+
+    Stats getStats() const;
+
+    void logStats() const;
+
+private:
+    struct Cell {
+        std::unique_ptr<WallStream> stream {};
+        std::shared_ptr<PixelUploadRing> ring {};
+        double origin {};         // clock time of pts 0, once the first frame was shown
+        bool started {false};
+        double next_due {};       // clock time the frame after the one on screen is due
+        int content_width {};     // picture size inside the layer, 0 until the first upload
+        int content_height {};
+        uint64_t presented {};
+        uint64_t dropped {};
+        uint64_t underruns {};
+        // Current quality window.
+        uint64_t window_presented {};
+        uint64_t window_late {};
+        int clean_windows {};
+    };
+
+    // One grid cell, matching the vertex attributes of the shader.
+    struct Instance {
+        float rect[4];  // x, y, width, height in framebuffer pixels
+        float uv[2];    // extent of the picture in its layer
+        float layer;
+    };
+
+    std::shared_ptr<GLContext> m_ctx {};
+    Config m_config {};
+    std::vector<Cell> m_cells {};
+
+    GLuint m_texture {};
+    std::shared_ptr<ShaderProgram> m_program {};
+    GLint m_scale_location {-1};
+    GLuint m_vao {};
+    GLuint m_instance_buffer {};
+    std::vector<Instance> m_instances {};
+
+    double m_window_start {-1.0};
+    uint64_t m_quality_changes {};
+
+    size_t present(Cell &cell, double time);
+    void updateQuality(double time);
+};
@@ -0,0 +1,291 @@
+#include "wall_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include "log/log_system.h"
+#include "trace/tracer.h"
+
+WallStream::WallStream(const std::filesystem::path &path,
+                       const MappedFileIO::Config &io,
+                       int tile_width,
+                       int tile_height,
+                       bool loop)
+    : m_path(path), m_loop(loop), m_tile_width(tile_width) {
+    m_demuxer = std::make_unique<Demuxer>(path, io);
+    const AVStream *stream = m_demuxer->getVideoStream();
+    if (!stream) {
+        FATAL("no video stream in {}", path.string());
+    }
+    m_stream_index = stream->index;
+    m_time_base = stream->time_base;
+    const AVRational frame_rate = stream->avg_frame_rate;
+    m_frame_duration = frame_rate.num > 0 && frame_rate.den > 0 ? av_q2d(av_inv_q(frame_rate)) : 1.0 / 30;
+
+    const AVCodecParameters *codecpar = stream->codecpar;
+    if (codecpar->width <= 0 || codecpar->height <= 0) {
+        FATAL("unknown video size in {}", path.string());
+    }
+    double aspect = static_cast<double>(codecpar->width) / codecpar->height;
+    if (codecpar->sample_aspect_ratio.num > 0 && codecpar->sample_aspect_ratio.den > 0) {
+        aspect *= av_q2d(codecpar->sample_aspect_ratio);
+    }
+    m_fit_width = tile_width;
+    m_fit_height = static_cast<int>(std::lround(tile_width / aspect));
+    if (m_fit_height > tile_height) {
+        m_fit_height = tile_height;
+        m_fit_width = static_cast<int>(std::lround(tile_height * aspect));
+    }
+    m_fit_width = std::clamp(m_fit_width, 1, tile_width);
+    m_fit_height = std::clamp(m_fit_height, 1, tile_height);
+
+    // Every halving of the decoded size that still covers the tile is decode work saved.
+    int lowres = 0;
+    while (lowres < 3 && (codecpar->width >> (lowres + 1)) >= m_fit_width &&
+           (codecpar->height >> (lowres + 1)) >= m_fit_height) {
+        ++lowres;
+    }
+    m_decoder = std::make_unique<Decoder>(stream, 1, nullptr, lowres);
+
+    m_packet = allocPacket();
+    m_frame = allocFrame();
+    if (!m_packet || !m_frame) {
+        FATAL("failed to allocate packet or frame!");
+    }
+}
+
+WallStream::~WallStream() {
+    m_stopping.store(true, std::memory_order_relaxed);
+    m_tasks.wait();
+    sws_freeContext(m_sws);
+    DEBUG("release WallStream: {}", (void *)this);
+}
+
+void WallStream::start(std::shared_ptr<PixelUploadRing> ring, GLuint texture, int layer) {
+    if (m_ring) {
+        FATAL("WallStream already started!");
+    }
+    m_ring = std::move(ring);
+    m_texture = texture;
+    m_layer = layer;
+    schedule();
+}
+
+void WallStream::schedule() {
+    if (!m_ring || isFinished() || m_stopping.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    m_tasks.run([this] { run(); });
+}
+
+WallStream::Stats WallStream::getStats() const {
+    return {
+        m_packets.load(std::memory_order_relaxed),
+        m_skipped_packets.load(std::memory_order_relaxed),
+        m_frames.load(std::memory_order_relaxed),
+        m_stalls.load(std::memory_order_relaxed),
+        m_loops.load(std::memory_order_relaxed),
+        m_busy_ns.load(std::memory_order_relaxed),
+        m_decoder->getCodecContext()->lowres,
+    };
+}
+
+void WallStream::run() {
+    TRACE_ZONE("wall decode");
+    const auto start = std::chrono::steady_clock::now();
+
+    bool more = true;
+    for (int staged = 0; staged < kFramesPerTask; ++staged) {
+        if (m_stopping.load(std::memory_order_relaxed)) {
+            more = false;
+            break;
+        }
+        if (!m_frame_pending) {
+            if (!decodeFrame()) {
+                m_finished.store(true, std::memory_order_release);
+                more = false;
+                break;
+            }
+            m_frame_pending = true;
+        }
+
+        // Decoded before a slot is taken: a mapped slot can only go back to the GL thread filled.
+        PixelUploadRing::Slot *slot = m_ring->tryAcquireWritable();
+        if (!slot) {
+            m_stalls.fetch_add(1, std::memory_order_relaxed);
+            more = false;
+            break;
+        }
+        if (!stage(slot)) {
+            // The slot still goes through the GL thread, which uploads nothing for it.
+            slot->region_count = 0;
+            slot->size = 0;
+        }
+        m_ring->publish(slot);
+        m_frame_pending = false;
+        av_frame_unref(m_frame.get());
+        m_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    m_busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                        std::memory_order_relaxed);
+    m_scheduled.store(false, std::memory_order_release);
+    // Out of budget with slots likely left: continue right away, behind the tasks of the other streams.
+    if (more) {
+        schedule();
+    }
+}
+
+bool WallStream::decodeFrame() {
+    while (true) {
+        int ret = m_decoder->receiveFrame(m_frame.get());
+        if (ret >= 0) {
+            return true;
+        }
+        if (ret == AVERROR_EOF) {
+            if (!m_loop || !rewind()) {
+                return false;
+            }
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            WARN("failed to decode {}: {}", m_path.string(), avErrorString(ret));
+            return false;
+        }
+        if (m_draining) {
+            return false;
+        }
+
+        ret = m_demuxer->readPacket(m_packet.get());
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                WARN("failed to read {}: {}", m_path.string(), avErrorString(ret));
+            }
+            // Drains the frames the codec still holds, then ends or rewinds on AVERROR_EOF.
+            m_decoder->sendPacket(nullptr);
+            m_draining = true;
+            continue;
+        }
+        if (m_packet->stream_index != m_stream_index) {
+            av_packet_unref(m_packet.get());
+            continue;
+        }
+
+        const Quality quality = getQuality();
+        applyQuality(quality);
+        if (quality >= Quality::DropNonReference && (m_packet->flags & AV_PKT_FLAG_DISPOSABLE)) {
+            av_packet_unref(m_packet.get());
+            m_skipped_packets.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        ret = m_decoder->sendPacket(m_packet.get());
+        av_packet_unref(m_packet.get());
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            WARN("failed to send packet of {}: {}", m_path.string(), avErrorString(ret));
+        }
+        m_packets.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool WallStream::rewind() {
+    AVFormatContext *format_ctx = m_demuxer->getFormatContext();
+    const int64_t start = m_first_pts != AV_NOPTS_VALUE ? m_first_pts : 0;
+    int ret = av_seek_frame(format_ctx, m_stream_index, start, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+        WARN("failed to rewind {}: {}", m_path.string(), avErrorString(ret));
+        return false;
+    }
+    m_decoder->flush();
+    m_draining = false;
+    if (m_first_pts != AV_NOPTS_VALUE && m_last_pts != AV_NOPTS_VALUE) {
+        const int64_t frame_ticks = std::max<int64_t>(1, std::llround(m_frame_duration / av_q2d(m_time_base)));
+        m_pts_offset += m_last_pts - m_first_pts + frame_ticks;
+    }
+    m_last_pts = AV_NOPTS_VALUE;
+    m_loops.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void WallStream::applyQuality(Quality quality) {
+    AVCodecContext *codec_ctx = m_decoder->getCodecContext();
+    codec_ctx->skip_loop_filter = quality >= Quality::NoLoopFilter ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+    if (quality >= Quality::KeyframesOnly) {
+        codec_ctx->skip_frame = AVDISCARD_NONKEY;
+    } else if (quality >= Quality::DropNonReference) {
+        codec_ctx->skip_frame = AVDISCARD_NONREF;
+    } else {
+        codec_ctx->skip_frame = AVDISCARD_DEFAULT;
+    }
+}
+
+bool WallStream::stage(PixelUploadRing::Slot *slot) {
+    TRACE_ZONE("wall convert");
+    const AVFrame *frame = m_frame.get();
+
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) {
+        // Untimed frames follow the previous one by the nominal duration.
+        const int64_t frame_ticks = std::max<int64_t>(1, std::llround(m_frame_duration / av_q2d(m_time_base)));
+        pts = m_last_pts != AV_NOPTS_VALUE ? m_last_pts + frame_ticks : 0;
+    }
+    if (m_first_pts == AV_NOPTS_VALUE) {
+        m_first_pts = pts;
+    }
+    m_last_pts = pts;
+    slot->pts = pts + m_pts_offset;
+
+    const int stride = m_tile_width * 4;
+    if (static_cast<size_t>(stride) * m_fit_height > slot->capacity) {
+        WARN("wall slot too small for a {}x{} tile", m_tile_width, m_fit_height);
+        return false;
+    }
+    if (!m_converter.convert(frame, slot->data, stride, m_fit_width, m_fit_height)) {
+        m_sws = sws_getCachedContext(m_sws,
+                                     frame->width,
+                                     frame->height,
+                                     static_cast<AVPixelFormat>(frame->format),
+                                     m_fit_width,
+                                     m_fit_height,
+                                     AV_PIX_FMT_RGBA,
+                                     SWS_BILINEAR,
+                                     nullptr,
+                                     nullptr,
+                                     nullptr);
+        if (!m_sws) {
+            WARN("cannot convert {} frames of {}",
+                 av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)),
+                 m_path.string());
+            return false;
+        }
+        uint8_t *dst[4] {slot->data};
+        int dst_stride[4] {stride};
+        sws_scale(m_sws, frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+    }
+
+    // Only the picture's rectangle of the layer is updated; the wall samples no further.
+    slot->regions[0] = {
+        m_texture,
+        0,
+        0,
+        m_fit_width,
+        m_fit_height,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        0,
+        m_tile_width,
+        m_layer,
+    };
+    slot->region_count = 1;
+    slot->size = static_cast<size_t>(stride) * m_fit_height;
+    return true;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include <glad/gl.h>
+
+#include "base/job_system.h"
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "media/av_utils.h"
+#include "media/decoder.h"
+#include "media/demuxer.h"
+#include "render/context/pixel_upload_ring.h"
+#include "render/convert/cpu_converter.h"
+
+struct SwsContext;
+
+/**
+ *  @class WallStream
+ *
+ *  @brief One input of a VideoWall: demuxed, decoded and scaled down to its tile by short tasks on the JobSystem.
+ *
+ *  A stream has no thread of its own. Each decode task produces a few frames straight into the mapped slots of the
+ *  stream's PixelUploadRing, converted to RGBA at the size of its tile, and queues the next task itself. When every
+ *  slot is staged or still on the GPU, the task ends instead of waiting, and the stream idles until the wall
+ *  schedules it again after consuming a frame. That is the stream's back-pressure: a stream that is not shown
+ *  fast enough stops decoding without holding a worker.
+ *
+ *  Each stream decodes on one codec thread, and the parallelism is across streams, so aggregate throughput grows
+ *  with the worker count. Codecs that support it decode at a reduced resolution (`AVCodecContext::lowres`) when
+ *  the tile is at most half the coded size.
+ *
+ *  The quality level trades picture quality for decode time, and is set by the wall as the stream falls behind or
+ *  catches up. The task applies it before every packet.
+ *
+ *  @note `schedule`, `setQuality` and the getters may be called from any thread; `start` from the thread owning
+ *        the GL context.
+ */
+class WallStream {
+public:
+    NONCOPYABLE(WallStream)
+    NONMOVABLE(WallStream)
+
+    enum class Quality {
+        Full,
+        NoLoopFilter,      // deblocking skipped on every frame
+        DropNonReference,  // non-reference frames neither decoded nor shown
+        KeyframesOnly,     // only keyframes decoded
+    };
+    static constexpr int kQualityLevels = 4;
+
+    struct Stats {
+        uint64_t packets;          // sent to the decoder
+        uint64_t skipped_packets;  // disposable packets not even sent, below DropNonReference
+        uint64_t frames;           // staged into the ring
+        uint64_t stalls;           // tasks that found no free slot
+        uint64_t loops;            // rewinds at the end of the input
+        uint64_t busy_ns;          // time spent in decode tasks
+        int lowres;
+    };
+
+    /**
+     *  @brief Opens `path` and its video decoder; nothing is decoded before `start`.
+     *
+     *  @param io How the file is read, see Demuxer.
+     *  @param loop Rewind at the end of the input instead of finishing.
+     *
+     *  @note Throws std::runtime_error if the file cannot be opened or has no video stream.
+     */
+    WallStream(const std::filesystem::path &path,
+               const MappedFileIO::Config &io,
+               int tile_width,
+               int tile_height,
+               bool loop);
+
+    /**
+     *  @brief Stops decoding and waits for the running task.
+     */
+    ~WallStream();
+
+    /**
+     *  @brief Starts decoding into `ring`, whose slots describe uploads into `layer` of the array `texture`.
+     *
+     *  @note `ring` must hold slots of at least `tile_width * tile_height * 4` bytes.
+     */
+    void start(std::shared_ptr<PixelUploadRing> ring, GLuint texture, int layer);
+
+    /**
+     *  @brief Queues a decode task unless one is already queued or running, or the stream finished.
+     */
+    void schedule();
+
+    void setQuality(Quality quality) { m_quality.store(quality, std::memory_order_relaxed); }
+    Quality getQuality() const { return m_quality.load(std::memory_order_relaxed); }
+
+    /**
+     *  @return true once the last frame has been staged (never with `loop`), or after a decoding error.
+     */
+    bool isFinished() const { return m_finished.load(std::memory_order_acquire); }
+
+    const std::filesystem::path &getPath() const { return m_path; }
+    AVRational getTimeBase() const { return m_time_base; }
+
+    /**
+     *  @return Nominal frame duration in seconds, from the stream's frame rate; 1/30 if unknown.
+     */
+    double getFrameDuration() const { return m_frame_duration; }
+
+    Stats getStats() const;
+
+private:
+    // Frames staged per task before yielding the worker to other streams.
+    static constexpr int kFramesPerTask = 2;
+
+    std::filesystem::path m_path {};
+    std::unique_ptr<Demuxer> m_demuxer {};
+    std::unique_ptr<Decoder> m_decoder {};
+    AVRational m_time_base {};
+    double m_frame_duration {};
+    int m_stream_index {-1};
+    bool m_loop {};
+
+    // Rectangle of the tile the picture fills, keeping its display aspect ratio.
+    int m_tile_width {};
+    int m_fit_width {};
+    int m_fit_height {};
+
+    std::shared_ptr<PixelUploadRing> m_ring {};
+    GLuint m_texture {};
+    int m_layer {};
+
+    // Only touched by the running task.
+    AVPacketPtr m_packet {};
+    AVFramePtr m_frame {};
+    bool m_frame_pending {false};  // decoded but not staged for want of a slot
+    bool m_draining {false};
+    int64_t m_first_pts {AV_NOPTS_VALUE};
+    int64_t m_last_pts {AV_NOPTS_VALUE};
+    int64_t m_pts_offset {0};  // added to timestamps after each rewind, so they keep increasing
+    CpuConverter m_converter {CpuConverter::Filter::Box};
+    SwsContext *m_sws {};
+
+    std::atomic<Quality> m_quality {Quality::Full};
+    std::atomic<bool> m_scheduled {false};
+    std::atomic<bool> m_stopping {false};
+    std::atomic<bool> m_finished {false};
+
+    std::atomic<uint64_t> m_packets {0};
+    std::atomic<uint64_t> m_skipped_packets {0};
+    std::atomic<uint64_t> m_frames {0};
+    std::atomic<uint64_t> m_stalls {0};
+    std::atomic<uint64_t> m_loops {0};
+    std::atomic<uint64_t> m_busy_ns {0};
+
+    // Declared last so the running task is waited for before anything it touches is destroyed.
+    TaskGroup m_tasks {};
+
+    void run();
+
+    /**
+     *  @brief Decodes the next frame into `m_frame`, rewinding at the end of the input if looping.
+     *
+     *  @return false at the end of the input or on error.
+     */
+    bool decodeFrame();
+
+    bool rewind();
+
+    void applyQuality(Quality quality);
+
+    bool stage(PixelUploadRing::Slot *slot);
+};
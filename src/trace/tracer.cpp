@@ -0,0 +1,181 @@
+#include "tracer.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+
+namespace {
+
+// Releases the thread's track when the thread exits.
+struct ThreadTrack {
+    Tracer::Track *track {};
+
+    ~ThreadTrack() {
+        if (track) {
+            Tracer::get()->releaseTrack(track);
+        }
+    }
+};
+
+thread_local ThreadTrack t_thread_track {};
+
+void writeJsonString(std::ostream &out, const std::string &value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << fmt::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}  // namespace
+
+Tracer::Track::Track(std::string name, uint32_t id, size_t capacity)
+    : m_name(std::move(name)), m_id(id), m_capacity(capacity), m_mask(capacity - 1) {}
+
+Tracer::Event *Tracer::Track::allocate() {
+    m_storage = std::make_unique<Event[]>(m_capacity);
+    m_events.store(m_storage.get(), std::memory_order_release);
+    return m_storage.get();
+}
+
+Tracer::Tracer() : m_epoch_ns(now()) {}
+
+void Tracer::initialize() {
+    auto config_manager = ConfigManager::get();
+    // Rounded up to a power of two so the ring index is a mask.
+    m_track_capacity = std::bit_ceil(static_cast<size_t>(
+        std::max(1ll, config_manager->getIntValue("trace", "events_per_thread", m_track_capacity))));
+    auto output_path = config_manager->getValue("trace", "output_path");
+    if (!output_path.empty()) {
+        m_output_path = output_path;
+    }
+    setEnabled(config_manager->getIntValue("trace", "enabled", 0) != 0);
+
+    DEBUG("tracer: {}, {} events per thread, dumps to {}",
+          isEnabled() ? "enabled" : "disabled",
+          m_track_capacity,
+          m_output_path.string());
+}
+
+uint64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+Tracer::Track *Tracer::getThreadTrack() {
+    if (!t_thread_track.track) {
+        t_thread_track.track = createTrack({});
+    }
+    return t_thread_track.track;
+}
+
+void Tracer::setThreadName(const std::string &name) {
+    auto track = getThreadTrack();
+    std::lock_guard lock {m_tracks_mutex};
+    track->m_name = name;
+}
+
+Tracer::Track *Tracer::createTrack(const std::string &name) {
+    std::lock_guard lock {m_tracks_mutex};
+    auto id = m_next_track_id++;
+    m_tracks.push_back(std::unique_ptr<Track> {new Track {name.empty() ? fmt::format("thread {}", id) : name,
+                                                          id,
+                                                          m_track_capacity}});
+    return m_tracks.back().get();
+}
+
+void Tracer::releaseTrack(Track *track) {
+    std::lock_guard lock {m_tracks_mutex};
+    auto it = std::find_if(m_tracks.begin(), m_tracks.end(), [&](const auto &t) { return t.get() == track; });
+    if (it == m_tracks.end() || track->m_retired) {
+        return;
+    }
+    if (!track->m_events.load(std::memory_order_relaxed)) {
+        m_tracks.erase(it);
+        return;
+    }
+
+    track->m_retired = true;
+    if (++m_retired_count > kRetiredTracks) {
+        auto oldest = std::find_if(m_tracks.begin(), m_tracks.end(), [](const auto &t) { return t->m_retired; });
+        m_tracks.erase(oldest);
+        --m_retired_count;
+    }
+}
+
+void Tracer::writeChromeTrace(std::ostream &out) const {
+    std::lock_guard lock {m_tracks_mutex};
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&] {
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+    };
+
+    std::vector<Event> events;
+    for (const auto &track : m_tracks) {
+        separator();
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << track->m_id << ",\"args\":{\"name\":";
+        writeJsonString(out, track->m_name);
+        out << "}}";
+
+        const Event *storage = track->m_events.load(std::memory_order_acquire);
+        if (!storage) {
+            continue;
+        }
+
+        // Copy first, then drop whatever the writer may have overwritten while we were copying.
+        const uint64_t capacity = track->m_capacity;
+        uint64_t head = track->m_head.load(std::memory_order_acquire);
+        uint64_t begin = head > capacity ? head - capacity : 0;
+        events.clear();
+        for (uint64_t i = begin; i < head; ++i) {
+            events.push_back(storage[i & track->m_mask]);
+        }
+        uint64_t head_after = track->m_head.load(std::memory_order_acquire);
+        uint64_t valid_begin = head_after > capacity ? head_after - capacity : 0;
+        size_t skip = valid_begin > begin ? std::min<size_t>(valid_begin - begin, events.size()) : 0;
+
+        for (size_t i = skip; i < events.size(); ++i) {
+            const auto &event = events[i];
+            if (event.begin_ns < m_epoch_ns || event.end_ns < event.begin_ns) {
+                continue;
+            }
+            separator();
+            out << fmt::format("{{\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"name\":",
+                               track->m_id,
+                               (event.begin_ns - m_epoch_ns) / 1000.0,
+                               (event.end_ns - event.begin_ns) / 1000.0);
+            writeJsonString(out, event.name);
+            out << "}";
+        }
+    }
+    out << "]}\n";
+}
+
+bool Tracer::dump(const std::filesystem::path &path) const {
+    auto output_path = path.empty() ? m_output_path : path;
+    std::ofstream out {output_path};
+    if (!out) {
+        ERROR("failed to open trace file: {}", output_path.string());
+        return false;
+    }
+    writeChromeTrace(out);
+    INFO("wrote trace to {}", output_path.string());
+    return static_cast<bool>(out);
+}
\ No newline at end of file
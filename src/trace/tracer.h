@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "base/nonmovable.h"
+#include "base/singleton.h"
+
+/**
+ *  @class Tracer
+ *
+ *  @brief Flight recorder of timed zones, exported as Chrome/Perfetto trace JSON.
+ *
+ *  Every thread records into its own fixed-size ring (a Track), so recording a zone is two clock reads and one
+ *  store, with no lock, allocation or logging. When a ring is full the oldest zones are overwritten, so a dump
+ *  always holds the most recent history. Extra tracks can be created for timelines that are not CPU threads,
+ *  e.g. GPU timer queries.
+ *
+ *  A ring is only allocated by the first zone its track records, so threads that never trace while enabled cost
+ *  a name. A thread's track is released when the thread exits; the history of the last `kRetiredTracks` exited
+ *  threads is kept for the dump, older ones are freed.
+ *
+ *  Tracing starts disabled; a disabled zone costs one relaxed atomic load.
+ */
+class Tracer : public Singleton<Tracer> {
+    friend Singleton<Tracer>;
+
+public:
+    struct Event {
+        const char *name;  // must outlive the tracer, in practice a string literal
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    /**
+     *  @class Track
+     *
+     *  @brief Single-writer ring of events.
+     *
+     *  @note `record` must only be called from one thread at a time; the dump may read concurrently.
+     */
+    class Track {
+        friend Tracer;
+
+    public:
+        NONCOPYABLE(Track)
+        NONMOVABLE(Track)
+
+        void record(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+            Event *events = m_events.load(std::memory_order_relaxed);
+            if (!events) [[unlikely]] {
+                events = allocate();
+            }
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            events[head & m_mask] = {name, begin_ns, end_ns};
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        const std::string &getName() const { return m_name; }
+
+    private:
+        std::string m_name {};
+        uint32_t m_id {};
+        size_t m_capacity {};
+        uint64_t m_mask {};
+        std::unique_ptr<Event[]> m_storage {};  // writer only; the dump reads through `m_events`
+        std::atomic<Event *> m_events {nullptr};
+        std::atomic<uint64_t> m_head {0};
+        bool m_retired {false};  // guarded by the tracer's track mutex
+
+        Track(std::string name, uint32_t id, size_t capacity);
+
+        Event *allocate();
+    };
+
+    /**
+     *  @brief Reads the `[trace]` section of the config file and enables tracing if requested.
+     */
+    void initialize();
+
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /**
+     *  @return Monotonic time in nanoseconds, the time base of every event.
+     */
+    static uint64_t now();
+
+    /**
+     *  @return The calling thread's track, created on first use.
+     */
+    Track *getThreadTrack();
+
+    /**
+     *  @brief Names the calling thread's track in the exported trace.
+     */
+    void setThreadName(const std::string &name);
+
+    /**
+     *  @brief Creates a track that is not tied to a CPU thread; hand it back with `releaseTrack`.
+     */
+    Track *createTrack(const std::string &name);
+
+    /**
+     *  @brief Retires a track whose writer is gone. A track that recorded nothing is freed right away; otherwise
+     *         it stays in the dump until `kRetiredTracks` newer tracks were retired.
+     *
+     *  @note Thread tracks are released when their thread exits.
+     */
+    void releaseTrack(Track *track);
+
+    /**
+     *  @brief Writes every track as Chrome trace event JSON (load it in chrome://tracing or ui.perfetto.dev).
+     */
+    void writeChromeTrace(std::ostream &out) const;
+
+    /**
+     *  @brief Writes the trace to `path`, or to the configured output path if empty.
+     *
+     *  @return false if the file could not be written.
+     */
+    bool dump(const std::filesystem::path &path = {}) const;
+
+private:
+    static constexpr size_t kRetiredTracks = 16;
+
+    std::atomic<bool> m_enabled {false};
+    size_t m_track_capacity {1 << 16};
+    std::filesystem::path m_output_path {"trace.json"};
+    uint64_t m_epoch_ns {};
+
+    mutable std::mutex m_tracks_mutex {};
+    std::vector<std::unique_ptr<Track>> m_tracks {};  // in creation order
+    size_t m_retired_count {};
+    uint32_t m_next_track_id {1};
+
+    Tracer();
+};
+
+/**
+ *  @class TraceZone
+ *
+ *  @brief Records the lifetime of a scope on the calling thread's track.
+ */
+class TraceZone {
+public:
+    NONCOPYABLE(TraceZone)
+    NONMOVABLE(TraceZone)
+
+    explicit TraceZone(const char *name)
+        : m_name(name), m_begin_ns(Tracer::get()->isEnabled() ? Tracer::now() : 0) {}
+
+    ~TraceZone() {
+        if (m_begin_ns) {
+            Tracer::get()->getThreadTrack()->record(m_name, m_begin_ns, Tracer::now());
+        }
+    }
+
+private:
+    const char *m_name;
+    uint64_t m_begin_ns;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+/**
+ *  @brief Traces the enclosing scope under `name`, which must be a string literal.
+ */
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__) {name}
\ No newline at end of file
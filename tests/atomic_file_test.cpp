@@ -0,0 +1,74 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "test.h"
+
+#include "base/atomic_file.h"
+
+namespace {
+
+std::filesystem::path makeDirectory() {
+    auto directory = std::filesystem::temp_directory_path() / ("video-app-atomic-file-" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+std::string readFile(const std::filesystem::path &path) {
+    std::ifstream in {path, std::ios::binary};
+    return {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+}
+
+}  // namespace
+
+TEST_CASE(concurrent_writers_leave_one_complete_file) {
+    const auto directory = makeDirectory();
+    const auto path = directory / "entry.bin";
+
+    // Large enough that writes take several syscalls, each thread with its own byte value.
+    constexpr int kThreads = 8;
+    constexpr size_t kSize = 1 << 20;
+    std::atomic<int> failures {0};
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([&, i] {
+                const std::string payload(kSize, static_cast<char>('a' + i));
+                for (int round = 0; round < 10; ++round) {
+                    std::error_code ec;
+                    failures += !writeFileAtomically(path, payload.data(), payload.size(), ec);
+                }
+            });
+        }
+    }
+
+    CHECK_EQ(failures.load(), 0);
+    const std::string contents = readFile(path);
+    REQUIRE(contents.size() == kSize);
+    CHECK_EQ(contents.find_first_not_of(contents.front()), std::string::npos);
+    // No temporary file is left behind.
+    CHECK_EQ(std::distance(std::filesystem::directory_iterator {directory}, std::filesystem::directory_iterator {}),
+             std::ptrdiff_t {1});
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE(failed_write_removes_its_temporary_file) {
+    const auto directory = makeDirectory();
+    const auto path = directory / "entry.bin";
+
+    // The target is a non-empty directory, so the rename fails after the data was written.
+    std::filesystem::create_directories(path / "child");
+    std::error_code ec;
+    CHECK(!writeFileAtomically(path, "new", 3, ec));
+    CHECK(static_cast<bool>(ec));
+    CHECK_EQ(std::distance(std::filesystem::directory_iterator {directory}, std::filesystem::directory_iterator {}),
+             std::ptrdiff_t {1});
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,36 @@
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+#include "log/binary_log.h"
+
+TEST_CASE(exited_threads_release_their_ring) {
+    auto binary_log = BinaryLog::get();
+    binary_log->flush();
+    const auto before = binary_log->getStats();
+
+    constexpr int kThreads = 4;
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([i] { BLOG_INFO(CORE, "short-lived thread {}", i); });
+        }
+    }
+    // Joined threads have retired their rings; draining passes the records on, then frees the rings.
+    binary_log->flush();
+    const auto after = binary_log->getStats();
+    CHECK_EQ(after.records - before.records, uint64_t {kThreads});
+    CHECK_EQ(after.threads - before.threads, size_t {kThreads});
+    CHECK_EQ(after.buffers, before.buffers);
+}
+
+TEST_CASE(live_thread_keeps_its_ring) {
+    auto binary_log = BinaryLog::get();
+    BLOG_INFO(CORE, "main thread {}", 0);
+    binary_log->flush();
+    const auto stats = binary_log->getStats();
+    binary_log->flush();
+    CHECK_EQ(binary_log->getStats().buffers, stats.buffers);
+    CHECK(stats.buffers >= 1);
+}
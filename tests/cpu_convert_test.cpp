@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include "test.h"
+
+#include "media/av_utils.h"
+#include "render/convert/cpu_converter.h"
+
+namespace {
+
+struct ConvertCase {
+    AVPixelFormat format;
+    int width;
+    int height;
+    int dst_width;
+    int dst_height;
+    AVColorSpace colorspace;
+    AVColorRange range;
+};
+
+// Odd sizes put every kernel into its row tails and uneven chroma subsampling; scales go both ways.
+const ConvertCase kCases[] {
+    {AV_PIX_FMT_YUV420P, 33, 17, 33, 17, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG},
+    {AV_PIX_FMT_YUV420P, 641, 359, 255, 143, AVCOL_SPC_BT470BG, AVCOL_RANGE_MPEG},
+    {AV_PIX_FMT_YUV420P, 97, 61, 211, 133, AVCOL_SPC_BT2020_NCL, AVCOL_RANGE_JPEG},
+    {AV_PIX_FMT_YUVJ420P, 1921, 1081, 63, 35, AVCOL_SPC_UNSPECIFIED, AVCOL_RANGE_JPEG},
+    {AV_PIX_FMT_YUV422P, 127, 73, 65, 37, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG},
+    {AV_PIX_FMT_YUV444P, 71, 45, 71, 45, AVCOL_SPC_BT709, AVCOL_RANGE_JPEG},
+    {AV_PIX_FMT_NV12, 131, 77, 129, 75, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG},
+    {AV_PIX_FMT_NV12, 1279, 719, 257, 145, AVCOL_SPC_BT470BG, AVCOL_RANGE_MPEG},
+};
+
+// Noise rather than a smooth pattern, so every tap and every lane sees different values.
+AVFramePtr makeFrame(const ConvertCase &test_case) {
+    AVFramePtr frame = allocFrame();
+    frame->format = test_case.format;
+    frame->width = test_case.width;
+    frame->height = test_case.height;
+    frame->colorspace = test_case.colorspace;
+    frame->color_range = test_case.range;
+    if (av_frame_get_buffer(frame.get(), 0) < 0) {
+        return nullptr;
+    }
+
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(test_case.format);
+    uint32_t state = 0x12345678u ^ static_cast<uint32_t>(test_case.width * 65536 + test_case.height);
+    for (int plane = 0; plane < 3 && frame->data[plane]; ++plane) {
+        const int rows = plane == 0 ? test_case.height : AV_CEIL_RSHIFT(test_case.height, desc->log2_chroma_h);
+        for (int y = 0; y < rows; ++y) {
+            uint8_t *row = frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane];
+            for (int x = 0; x < frame->linesize[plane]; ++x) {
+                state = state * 1664525u + 1013904223u;
+                row[x] = static_cast<uint8_t>(state >> 24);
+            }
+        }
+    }
+    return frame;
+}
+
+std::vector<uint8_t> convert(const AVFrame *frame,
+                             const ConvertCase &test_case,
+                             CpuConverter::Filter filter,
+                             CpuIsa isa) {
+    // A stride wider than the row checks that nothing is written past `dst_width`.
+    const int stride = test_case.dst_width * 4 + 12;
+    std::vector<uint8_t> rgba(static_cast<size_t>(stride) * test_case.dst_height, 0xcd);
+    CpuConverter converter {filter, isa};
+    REQUIRE(converter.convert(frame, rgba.data(), stride, test_case.dst_width, test_case.dst_height));
+    // A second call reuses the configured tables.
+    REQUIRE(converter.convert(frame, rgba.data(), stride, test_case.dst_width, test_case.dst_height));
+    return rgba;
+}
+
+}  // namespace
+
+TEST_CASE(simd_kernels_match_scalar_reference) {
+    std::vector<CpuIsa> isas;
+    for (auto isa : {CpuIsa::SSE42, CpuIsa::AVX2, CpuIsa::AVX512}) {
+        if (isCpuIsaSupported(isa)) {
+            isas.push_back(isa);
+        }
+    }
+    if (isas.empty()) {
+        SKIP("no SIMD instruction set supported, best is {}", getCpuIsaName(getBestCpuIsa()));
+    }
+
+    for (const auto &test_case : kCases) {
+        auto frame = makeFrame(test_case);
+        REQUIRE(frame);
+        for (auto filter : {CpuConverter::Filter::Box, CpuConverter::Filter::Bilinear}) {
+            const auto reference = convert(frame.get(), test_case, filter, CpuIsa::Scalar);
+            for (auto isa : isas) {
+                const auto rgba = convert(frame.get(), test_case, filter, isa);
+                size_t first_mismatch = rgba.size();
+                for (size_t i = 0; i < rgba.size() && first_mismatch == rgba.size(); ++i) {
+                    if (rgba[i] != reference[i]) {
+                        first_mismatch = i;
+                    }
+                }
+                if (first_mismatch != rgba.size()) {
+                    test::fail(__FILE__,
+                               __LINE__,
+                               fmt::format("{} {} {} {}x{} -> {}x{}: byte {} is {}, scalar {}",
+                                           getCpuIsaName(isa),
+                                           filter == CpuConverter::Filter::Box ? "box" : "bilinear",
+                                           av_get_pix_fmt_name(test_case.format),
+                                           test_case.width,
+                                           test_case.height,
+                                           test_case.dst_width,
+                                           test_case.dst_height,
+                                           first_mismatch,
+                                           rgba[first_mismatch],
+                                           reference[first_mismatch]));
+                }
+            }
+        }
+    }
+}
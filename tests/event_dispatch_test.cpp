@@ -0,0 +1,135 @@
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "test.h"
+
+#include "render/context/gl_context.h"
+#include "render/context/window_manager.h"
+
+namespace {
+
+// Counts the allocations of the calling thread while enabled; the counting operator new below is process-wide.
+thread_local bool t_count_allocations {false};
+thread_local uint64_t t_allocations {};
+
+constexpr int kFrames = 200;
+constexpr int kCursorMovesPerFrame = 500;
+constexpr int kScrollsPerFrame = 20;
+
+// The size of what the player's lambdas capture: more than std::function keeps inline.
+using Weights = std::array<double, 6>;
+
+struct Sink {
+    double sum {};
+    double last_x {};
+    double last_y {};
+    double scrolled {};
+    uint64_t calls {};
+};
+
+std::shared_ptr<GLContext> createContext() {
+    try {
+        return GLContext::createWithWindow({64, 64, "video-app-test"}, false);
+    } catch (const std::exception &e) {
+        SKIP("no window system: {}", e.what());
+    }
+}
+
+void postFrame(WindowManager &wm, int frame) {
+    for (int i = 0; i < kCursorMovesPerFrame; ++i) {
+        wm.postEvent({.type = WindowManager::EventType::CursorPos, .x = double(frame), .y = double(i)});
+        if (i % (kCursorMovesPerFrame / kScrollsPerFrame) == 0) {
+            wm.postEvent({.type = WindowManager::EventType::Scroll, .y = 1.0});
+        }
+    }
+    wm.postEvent({.type = WindowManager::EventType::Key, .key = frame & 0xff, .action = 1});
+}
+
+std::vector<WindowManager::ListenerId> registerListeners(WindowManager &wm, Sink &sink, int listeners) {
+    const Weights weights {1, 2, 3, 4, 5, 6};
+    std::vector<WindowManager::ListenerId> ids;
+    for (int i = 0; i < listeners; ++i) {
+        ids.push_back(wm.registerOnCursorPosFunc([&sink, weights](WindowManager *, double x, double y) {
+            sink.sum += x * weights[0] + y * weights[5];
+            sink.last_x = x;
+            sink.last_y = y;
+            ++sink.calls;
+        }));
+        ids.push_back(wm.registerOnScrollFunc([&sink, weights](WindowManager *, double, double y) {
+            sink.sum += y * weights[1];
+            sink.scrolled += y;
+            ++sink.calls;
+        }));
+        ids.push_back(wm.registerOnKeyFunc([&sink, weights](WindowManager *, int key, int, int, int) {
+            sink.sum += key * weights[2];
+            ++sink.calls;
+        }));
+    }
+    return ids;
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+    if (t_count_allocations) {
+        ++t_allocations;
+    }
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc {};
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+TEST_CASE(dispatch_does_not_allocate) {
+    auto gl = createContext();
+    auto wm = gl->createWindowManager();
+
+    for (int listeners : {1, 8}) {
+        Sink sink {};
+        const auto ids = registerListeners(*wm, sink, listeners);
+        // Warm-up: the queue grows to its steady size once.
+        postFrame(*wm, 0);
+        wm->dispatchEvents();
+
+        uint64_t allocations = 0;
+        for (int frame = 1; frame <= kFrames; ++frame) {
+            postFrame(*wm, frame);
+            t_allocations = 0;
+            t_count_allocations = true;
+            wm->dispatchEvents();
+            t_count_allocations = false;
+            allocations += t_allocations;
+        }
+        CHECK_EQ(allocations, uint64_t {0});
+        CHECK(sink.calls > 0);
+
+        for (auto id : ids) {
+            wm->unregisterFunc(id);
+        }
+    }
+}
+
+TEST_CASE(cursor_moves_and_scrolls_coalesce_per_frame) {
+    auto gl = createContext();
+    auto wm = gl->createWindowManager();
+    Sink sink {};
+    registerListeners(*wm, sink, 1);
+
+    postFrame(*wm, 7);
+    const auto before = wm->getStats();
+    wm->dispatchEvents();
+    const auto after = wm->getStats();
+
+    // One cursor position, one summed scroll and the key: the key ends the frame, so nothing merges across it.
+    CHECK_EQ(after.dispatched - before.dispatched, uint64_t {3});
+    CHECK_EQ(sink.calls, uint64_t {3});
+    CHECK_EQ(sink.last_x, 7.0);
+    CHECK_EQ(sink.last_y, double(kCursorMovesPerFrame - 1));
+    CHECK_EQ(sink.scrolled, double(kScrollsPerFrame));
+}
@@ -0,0 +1,136 @@
+#include <memory>
+#include <vector>
+
+#include "test.h"
+
+#include "base/frame_pool.h"
+#include "media/av_utils.h"
+
+namespace {
+
+constexpr size_t kPlentyOfBytes = size_t {1} << 30;
+constexpr int kInFlight = 8;  // frames held at once, like a decoder's references plus the queue behind it
+constexpr int kCycles = 1000;
+
+// The pool is driven through get_buffer2 like a decoder drives it, without decoding anything; any decoder that
+// takes custom buffers will do.
+AVCodecContextPtr openContext(const std::shared_ptr<FrameBufferPool> &pool) {
+    for (auto codec_id : {AV_CODEC_ID_H264, AV_CODEC_ID_HEVC, AV_CODEC_ID_VP9, AV_CODEC_ID_MPEG4}) {
+        const AVCodec *codec = avcodec_find_decoder(codec_id);
+        if (codec && (codec->capabilities & AV_CODEC_CAP_DR1)) {
+            AVCodecContextPtr ctx {avcodec_alloc_context3(codec)};
+            REQUIRE(ctx);
+            pool->attach(ctx.get());
+            return ctx;
+        }
+    }
+    SKIP("no decoder with custom buffer support");
+}
+
+AVFramePtr getBuffer(AVCodecContext *ctx, int width, int height) {
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->width = width;
+    ctx->height = height;
+    AVFramePtr frame = allocFrame();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (ctx->get_buffer2(ctx, frame.get(), 0) < 0) {
+        return nullptr;
+    }
+    return frame;
+}
+
+// One decoder's worth of frames and packets, acquired together and released together.
+void cycle(AVCodecContext *ctx) {
+    std::vector<AVFramePtr> frames;
+    std::vector<AVPacketPtr> packets;
+    for (int i = 0; i < kInFlight; ++i) {
+        frames.push_back(getBuffer(ctx, 640, 360));
+        REQUIRE(frames.back());
+        packets.push_back(allocPacket());
+    }
+}
+
+}  // namespace
+
+TEST_CASE(allocations_stay_flat_after_warm_up) {
+    auto pool = FrameBufferPool::create(kPlentyOfBytes);
+    auto ctx = openContext(pool);
+    cycle(ctx.get());
+
+    const uint64_t objects = AVObjectPool::get()->getAllocationCount();
+    const auto warm = pool->getStats();
+    CHECK_EQ(warm.allocations, uint64_t {kInFlight});
+    for (int i = 0; i < kCycles; ++i) {
+        cycle(ctx.get());
+    }
+
+    const auto stats = pool->getStats();
+    CHECK_EQ(AVObjectPool::get()->getAllocationCount(), objects);
+    CHECK_EQ(stats.allocations, warm.allocations);
+    CHECK_EQ(stats.reuses, warm.reuses + uint64_t {kInFlight} * kCycles);
+    CHECK_EQ(stats.evictions, uint64_t {0});
+    CHECK_EQ(stats.bytes_in_use, size_t {0});
+    CHECK_EQ(stats.bytes_pooled, warm.bytes_pooled);
+}
+
+TEST_CASE(free_lists_are_kept_per_resolution) {
+    auto pool = FrameBufferPool::create(kPlentyOfBytes);
+    auto ctx = openContext(pool);
+
+    auto small = getBuffer(ctx.get(), 320, 180);
+    REQUIRE(small);
+    const size_t small_size = pool->getStats().bytes_in_use;
+    auto large = getBuffer(ctx.get(), 1280, 720);
+    REQUIRE(large);
+    const size_t large_size = pool->getStats().bytes_in_use - small_size;
+    CHECK_LT(small_size, large_size);
+    small.reset();
+    large.reset();
+    CHECK_EQ(pool->getStats().bytes_pooled, small_size + large_size);
+
+    // Each resolution is served from its own list, whatever was released last.
+    large = getBuffer(ctx.get(), 1280, 720);
+    REQUIRE(large);
+    CHECK_EQ(pool->getStats().bytes_in_use, large_size);
+    small = getBuffer(ctx.get(), 320, 180);
+    REQUIRE(small);
+    CHECK_EQ(pool->getStats().bytes_in_use, small_size + large_size);
+    CHECK_EQ(pool->getStats().reuses, uint64_t {2});
+
+    // Nothing of that resolution is free anymore, so the next one comes from the heap.
+    auto other = getBuffer(ctx.get(), 320, 180);
+    REQUIRE(other);
+    CHECK_EQ(pool->getStats().allocations, uint64_t {3});
+    CHECK_EQ(pool->getStats().bytes_pooled, size_t {0});
+}
+
+TEST_CASE(memory_cap_rejects_allocations) {
+    size_t frame_size = 0;
+    {
+        auto probe = FrameBufferPool::create(kPlentyOfBytes);
+        auto ctx = openContext(probe);
+        auto frame = getBuffer(ctx.get(), 640, 360);
+        REQUIRE(frame);
+        frame_size = probe->getStats().bytes_in_use;
+    }
+
+    // Room for one frame and a little more, not for two.
+    auto pool = FrameBufferPool::create(frame_size + frame_size / 8);
+    auto ctx = openContext(pool);
+    auto frame = getBuffer(ctx.get(), 640, 360);
+    REQUIRE(frame);
+    CHECK(!getBuffer(ctx.get(), 640, 360));
+    CHECK_EQ(pool->getStats().cap_rejections, uint64_t {1});
+    CHECK_EQ(pool->getStats().bytes_in_use, frame_size);
+
+    // A released block of another resolution is given up to make room; one still in use is not.
+    frame.reset();
+    auto small = getBuffer(ctx.get(), 320, 180);
+    REQUIRE(small);
+    CHECK_EQ(pool->getStats().evictions, uint64_t {1});
+    CHECK_EQ(pool->getStats().bytes_pooled, size_t {0});
+    CHECK(!getBuffer(ctx.get(), 640, 360));
+    CHECK_EQ(pool->getStats().cap_rejections, uint64_t {2});
+}
@@ -0,0 +1,21 @@
+#include <cstdint>
+
+#include "test.h"
+
+#include "base/hash.h"
+
+// Published FNV-1a test vectors: cached files named by these hashes must keep their names across builds.
+static_assert(fnv1a64("") == kFnv1aOffset);
+static_assert(fnv1a64("a") == 0xaf63dc4c8601ec8cull);
+static_assert(fnv1a64("foobar") == 0x85944171f73967e8ull);
+
+TEST_CASE(hashing_in_pieces_matches_hashing_at_once) {
+    CHECK_EQ(fnv1a64("bar", fnv1a64("foo")), fnv1a64("foobar"));
+    CHECK_EQ(fnv1a64("", fnv1a64("foobar")), fnv1a64("foobar"));
+}
+
+TEST_CASE(high_bytes_hash_as_unsigned) {
+    // 0xff must be mixed in as 255, not sign-extended, or the values would differ between platforms.
+    constexpr uint64_t expected = (kFnv1aOffset ^ 0xffull) * 0x100000001b3ull;
+    CHECK_EQ(fnv1a64("\xff"), expected);
+}
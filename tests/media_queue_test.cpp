@@ -0,0 +1,46 @@
+#include <stop_token>
+
+#include "test.h"
+
+#include "media/media_queue.h"
+
+TEST_CASE(polling_an_empty_queue_counts_one_stall) {
+    MediaQueue<int> queue {4};
+    for (int i = 0; i < 100; ++i) {
+        CHECK(!queue.tryPop());
+    }
+    CHECK_EQ(queue.getStats().pop_stalls, uint64_t {1});
+
+    // A value ends the empty period; the next one starts a new stall.
+    CHECK(queue.tryPush(1));
+    CHECK(queue.tryPop());
+    CHECK(!queue.tryPop());
+    CHECK(!queue.tryPop());
+    CHECK_EQ(queue.getStats().pop_stalls, uint64_t {2});
+}
+
+TEST_CASE(polling_a_full_queue_counts_one_stall) {
+    MediaQueue<int> queue {2};
+    while (queue.tryPush(0)) {
+    }
+    for (int i = 0; i < 100; ++i) {
+        CHECK(!queue.tryPush(0));
+    }
+    CHECK_EQ(queue.getStats().push_stalls, uint64_t {1});
+
+    CHECK(queue.tryPop());
+    CHECK(queue.tryPush(0));
+    CHECK(!queue.tryPush(0));
+    CHECK_EQ(queue.getStats().push_stalls, uint64_t {2});
+}
+
+TEST_CASE(blocking_pop_after_polling_counts_the_same_stall) {
+    MediaQueue<int> queue {4};
+    CHECK(!queue.tryPop());
+
+    std::stop_source stop;
+    stop.request_stop();
+    CHECK(!queue.pop(stop.get_token()));
+    CHECK_EQ(queue.getStats().pop_stalls, uint64_t {1});
+    CHECK_EQ(queue.getStats().push_stalls, uint64_t {0});
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+#include "media/present_scheduler.h"
+
+namespace {
+
+// Every case runs on a simulated clock: waits, loop work and vsync-blocked swaps only advance `now`.
+constexpr double kSimulatedSeconds = 30.0;
+constexpr double kLoopWork = 0.0001;
+constexpr double kDrawWork = 0.0004;
+constexpr double kPollCost = 0.00002;
+constexpr double kPresentTolerance = 0.008;  // as FrameScheduler: frames this early are presented
+
+struct Display {
+    double refresh_rate;
+    double nominal_refresh_rate;
+    double max_wake_latency;  // the OS wakes a sleeping thread up to this late
+};
+
+// The first `count` of every `every` swaps return without waiting for the vblank, as an occluded window's do.
+struct EarlySwaps {
+    uint64_t every;
+    uint64_t count;
+};
+
+enum class Mode {
+    Continuous,  // the previous loop: poll, draw and swap every iteration
+    Paced,
+};
+
+struct Result {
+    PresentScheduler::Stats stats;
+    std::vector<double> timeouts;  // of every blocking wait
+    uint64_t frames;
+    double max_frame_delay;        // from a frame's due time to the vblank that showed it
+};
+
+/**
+ *  @brief Plays `fps` content (0: paused) on `display` for kSimulatedSeconds, like the render loop does.
+ */
+Result simulate(double fps, const Display &display, Mode mode, const EarlySwaps &early_swaps = {}) {
+    double now = 0;
+    std::mt19937 rng {11};
+    std::uniform_real_distribution<double> wake_latency {0.0, display.max_wake_latency};
+    const double period = 1.0 / display.refresh_rate;
+
+    Result result {};
+    PresentScheduler pacer {
+        {},
+        display.nominal_refresh_rate,
+        [&](double timeout) {
+            if (timeout > 0) {
+                result.timeouts.push_back(timeout);
+                now += timeout + wake_latency(rng);
+            } else {
+                now += kPollCost;
+            }
+        },
+        {},
+        [&] { return now; },
+    };
+
+    double due = 0;
+    uint64_t swaps = 0;
+    double shown_due = NAN;  // due time of the frame drawn this iteration
+    while (now < kSimulatedSeconds) {
+        if (mode == Mode::Continuous) {
+            pacer.requestRedraw();
+        }
+        pacer.waitForWork();
+        now += kLoopWork;
+        if (fps > 0) {
+            if (now >= due - kPresentTolerance) {
+                ++result.frames;
+                shown_due = due;
+                due += 1.0 / fps;
+                pacer.requestRedraw();
+            } else {
+                pacer.setFrameDue(due - kPresentTolerance - now);
+            }
+        }
+        if (pacer.shouldPresent()) {
+            now += kDrawWork;
+            pacer.beginSwap();
+            // Vsync: the swap returns at the next vblank.
+            if (early_swaps.every == 0 || swaps % early_swaps.every >= early_swaps.count) {
+                now = (std::floor(now / period) + 1) * period;
+            }
+            ++swaps;
+            pacer.endSwap();
+            if (!std::isnan(shown_due)) {
+                result.max_frame_delay = std::max(result.max_frame_delay, now - shown_due);
+                shown_due = NAN;
+            }
+        }
+    }
+    result.stats = pacer.getStats();
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE(paused_sleeps_for_idle_timeout) {
+    const PresentScheduler::Config config {};
+    const auto result = simulate(0, {60, 60, 0.0}, Mode::Paced);
+
+    // The first iteration draws and the one after it polls; from then on every wait is a full idle timeout.
+    CHECK_EQ(result.stats.presents, uint64_t {1});
+    REQUIRE(!result.timeouts.empty());
+    CHECK_EQ(result.stats.sleeps, uint64_t {result.timeouts.size()});
+    CHECK(result.stats.iterations <= result.stats.sleeps + 2);
+    for (double timeout : result.timeouts) {
+        CHECK_EQ(timeout, config.idle_timeout);
+    }
+    CHECK(result.stats.iterations <= static_cast<uint64_t>(kSimulatedSeconds / config.idle_timeout) + 3);
+    CHECK_LT(result.stats.awake_seconds / kSimulatedSeconds, 0.001);
+}
+
+TEST_CASE(paced_loop_sleeps_between_frames) {
+    for (const Display display : {Display {60, 60, 0.0005}, Display {144, 144, 0.0005}}) {
+        const auto paced = simulate(24, display, Mode::Paced);
+        const auto continuous = simulate(24, display, Mode::Continuous);
+
+        // Every frame is shown, with one present per frame instead of one per refresh.
+        CHECK_LT(std::abs(double(paced.frames) - double(continuous.frames)), 1.5);
+        CHECK_EQ(paced.stats.presents, paced.frames);
+        CHECK_LT(paced.stats.presents * 2, continuous.stats.presents);
+        CHECK_LT(paced.stats.awake_seconds, continuous.stats.awake_seconds);
+    }
+}
+
+TEST_CASE(refresh_estimate_converges_without_nominal_rate) {
+    for (double refresh_rate : {50.0, 60.0, 75.0, 144.0}) {
+        const auto continuous = simulate(60, {refresh_rate, 0, 0.0005}, Mode::Continuous);
+        CHECK_LT(std::abs(continuous.stats.refresh_rate - refresh_rate), 0.5);
+    }
+    // Paced content at most once per refresh, with intervals of differing vblank counts to measure.
+    for (double refresh_rate : {75.0, 144.0}) {
+        const auto paced = simulate(60, {refresh_rate, 0, 0.0005}, Mode::Paced);
+        CHECK_LT(std::abs(paced.stats.refresh_rate - refresh_rate), 0.5);
+    }
+}
+
+TEST_CASE(refresh_estimate_survives_early_swaps) {
+    for (double refresh_rate : {60.0, 144.0}) {
+        // A few swaps returning early now and then do not move the estimate.
+        const auto sporadic = simulate(60, {refresh_rate, refresh_rate, 0.0005}, Mode::Continuous, {120, 3});
+        CHECK_LT(std::abs(sporadic.stats.refresh_rate - refresh_rate), 0.5);
+        // Swaps returning early for a while lower it, and it recovers once they block again.
+        const auto occluded = simulate(60, {refresh_rate, refresh_rate, 0.0005}, Mode::Continuous, {1000000, 500});
+        CHECK_LT(std::abs(occluded.stats.refresh_rate - refresh_rate), 0.5);
+    }
+}
+
+TEST_CASE(paced_jitter_not_above_continuous) {
+    for (const Display display : {Display {59.94, 60, 0.0005}, Display {144, 144, 0.0005}}) {
+        for (double fps : {24000.0 / 1001, 30.0, 60.0}) {
+            const auto paced = simulate(fps, display, Mode::Paced);
+            const auto continuous = simulate(fps, display, Mode::Continuous);
+            // Sleeping until a frame is due never makes it miss the vblank the busy loop would have shown it at.
+            CHECK(paced.max_frame_delay <= continuous.max_frame_delay + 1e-9);
+            if (fps < display.refresh_rate) {
+                CHECK_LT(paced.max_frame_delay, 1.0 / display.refresh_rate + 1e-9);
+            }
+            // One histogram bucket of tolerance.
+            CHECK(paced.stats.jitter_p99 <= continuous.stats.jitter_p99 + 0.0001);
+        }
+    }
+}
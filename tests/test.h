@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+
+/**
+ *  @brief Minimal test harness. Every `*_test.cpp` file is its own executable, linked with `test_main.cpp`, so a
+ *         test may replace process-wide hooks (e.g. `operator new`) without affecting the other tests.
+ *
+ *  `CHECK*` failures are reported and the case goes on; `REQUIRE` ends the case. A case may `SKIP` when the
+ *  machine lacks what it needs (a display, an instruction set); a binary whose cases all skipped exits with
+ *  `kSkipExitCode`, which CTest reports as skipped.
+ */
+namespace test {
+
+inline constexpr int kSkipExitCode = 77;
+
+struct Case {
+    const char *name;
+    void (*run)();
+};
+
+std::vector<Case> &getCases();
+
+struct Registrar {
+    Registrar(const char *name, void (*run)()) { getCases().push_back({name, run}); }
+};
+
+struct Skipped {
+    std::string reason;
+};
+
+struct Aborted {};
+
+/**
+ *  @brief Reports a failed check and marks the current case as failed.
+ */
+void fail(const char *file, int line, const std::string &message);
+
+}  // namespace test
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const test::Registrar name##_registrar {#name, name}; \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            test::fail(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+        } \
+    } while (false)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        const auto &check_a = (a); \
+        const auto &check_b = (b); \
+        if (!(check_a == check_b)) { \
+            test::fail(__FILE__, __LINE__, fmt::format("CHECK_EQ({}, {}): {} != {}", #a, #b, check_a, check_b)); \
+        } \
+    } while (false)
+
+#define CHECK_LT(a, b) \
+    do { \
+        const auto &check_a = (a); \
+        const auto &check_b = (b); \
+        if (!(check_a < check_b)) { \
+            test::fail(__FILE__, __LINE__, fmt::format("CHECK_LT({}, {}): {} >= {}", #a, #b, check_a, check_b)); \
+        } \
+    } while (false)
+
+#define REQUIRE(condition) \
+    do { \
+        if (!(condition)) { \
+            test::fail(__FILE__, __LINE__, "REQUIRE(" #condition ")"); \
+            throw test::Aborted {}; \
+        } \
+    } while (false)
+
+#define SKIP(...) throw test::Skipped {fmt::format(__VA_ARGS__)}
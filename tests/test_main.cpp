@@ -0,0 +1,59 @@
+#include <cstring>
+#include <exception>
+
+#include "test.h"
+
+#include "config/config_manager.h"
+#include "log/log_system.h"
+
+namespace {
+
+bool t_case_failed {false};
+
+}  // namespace
+
+std::vector<test::Case> &test::getCases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void test::fail(const char *file, int line, const std::string &message) {
+    fmt::print("  {}:{}: {}\n", file, line, message);
+    t_case_failed = true;
+}
+
+int main(int argc, char **argv) {
+    // An optional argument runs the one case of that name.
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+
+    ConfigManager::get()->parse();
+    LogSystem::get()->initialize();
+
+    int passed = 0, failed = 0, skipped = 0;
+    for (const auto &test_case : test::getCases()) {
+        if (filter && std::strcmp(filter, test_case.name) != 0) {
+            continue;
+        }
+        t_case_failed = false;
+        try {
+            test_case.run();
+        } catch (const test::Skipped &skip) {
+            fmt::print("[ SKIP ] {}: {}\n", test_case.name, skip.reason);
+            ++skipped;
+            continue;
+        } catch (const test::Aborted &) {
+        } catch (const std::exception &e) {
+            fmt::print("  unexpected exception: {}\n", e.what());
+            t_case_failed = true;
+        }
+        fmt::print("[ {} ] {}\n", t_case_failed ? "FAIL" : " OK ", test_case.name);
+        ++(t_case_failed ? failed : passed);
+    }
+    fmt::print("{} passed, {} failed, {} skipped\n", passed, failed, skipped);
+
+    LogSystem::get()->shutdown();
+    if (failed > 0) {
+        return 1;
+    }
+    return passed == 0 && skipped > 0 ? test::kSkipExitCode : 0;
+}